@@ -0,0 +1,402 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "AutoTrayValidator.h"
+
+// Standard library
+#include <algorithm>
+#include <regex>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+
+// rules per thread below which it isn't worth starting another thread
+constexpr size_t rulesPerThreadMin_ = 64;
+
+struct Rule
+{
+    const Settings::AutoTray * autoTray {};
+    std::string executable; // lower case, executables are matched case insensitively
+    bool usable {}; // false if the rule has errors, so it can't shadow or be shadowed
+    size_t duplicateOf { static_cast<size_t>(-1) };
+};
+
+std::string toLower(std::string_view s);
+bool sameAction(const Settings::AutoTray & a, const Settings::AutoTray & b) noexcept;
+bool titleCovers(const std::string & earlier, const std::string & later) noexcept;
+bool covers(const Rule & earlier, const Rule & later) noexcept;
+const char * problemDescription(AutoTrayValidator::Problem problem) noexcept;
+
+// rule i is checked by thread i % threads, which also balances the shadowing
+// check where later rules have more work to do, each thread appends to its own
+// issue list so the results don't depend on scheduling
+template <typename Function>
+void parallelFor(size_t count, unsigned int threadCount, std::vector<AutoTrayValidator::Issue> & issues, Function && function)
+{
+    const size_t threads = std::clamp<size_t>(count / rulesPerThreadMin_, 1, threadCount);
+    std::vector<std::vector<AutoTrayValidator::Issue>> threadIssues(threads);
+
+    const auto work = [&function, &threadIssues, count, threads](size_t t) {
+        for (size_t i = t; i < count; i += threads) {
+            function(i, threadIssues[t]);
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads - 1);
+        for (size_t t = 1; t < threads; ++t) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+    } // workers join here
+
+    for (std::vector<AutoTrayValidator::Issue> & list : threadIssues) {
+        issues.insert(issues.end(), std::make_move_iterator(list.begin()), std::make_move_iterator(list.end()));
+    }
+}
+
+} // anonymous namespace
+
+namespace AutoTrayValidator
+{
+
+std::string Report::toString(size_t maxIssues) const
+{
+    std::string str = std::to_string(ruleCount) + " rules, " + std::to_string(errorCount) + " errors, " +
+        std::to_string(warningCount) + " warnings\n";
+
+    const size_t count = std::min(maxIssues, issues.size());
+    for (size_t i = 0; i < count; ++i) {
+        const Issue & issue = issues[i];
+        str += "rule " + std::to_string(issue.rule + 1) + ": " + problemDescription(issue.problem);
+        switch (issue.problem) {
+            case Problem::Conflict:
+            case Problem::Duplicate:
+            case Problem::Shadowed: str += " rule " + std::to_string(issue.other + 1); break;
+
+            case Problem::Empty:
+            case Problem::BadRegex:
+            case Problem::BadTrayEvent:
+            case Problem::BadMinimizePersistence:
+            default: break;
+        }
+        if (!issue.detail.empty()) {
+            str += ": " + issue.detail;
+        }
+        str += "\n";
+    }
+
+    if (count < issues.size()) {
+        str += "... and " + std::to_string(issues.size() - count) + " more\n";
+    }
+
+    return str;
+}
+
+Report validate(const std::vector<Settings::AutoTray> & rules, unsigned int threadCount)
+{
+    if (!threadCount) {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    Report report;
+    report.ruleCount = rules.size();
+
+    std::vector<Rule> prepared(rules.size());
+
+    // check each rule on its own, compiling the regular expressions is most of the work
+    parallelFor(rules.size(), threadCount, report.issues, [&rules, &prepared](size_t i, std::vector<Issue> & issues) {
+        const Settings::AutoTray & autoTray = rules[i];
+        Rule & rule = prepared[i];
+        rule.autoTray = &autoTray;
+        rule.executable = toLower(autoTray.executable_);
+        rule.usable = true;
+
+        if (autoTray.executable_.empty() && autoTray.windowClass_.empty() && autoTray.windowTitle_.empty()) {
+            issues.push_back({ i, i, Problem::Empty, {} });
+            rule.usable = false;
+        }
+
+        try {
+            const std::regex re(autoTray.windowTitle_);
+            static_cast<void>(re);
+        } catch (const std::regex_error & e) {
+            issues.push_back({ i, i, Problem::BadRegex, "'" + autoTray.windowTitle_ + "': " + e.what() });
+            rule.usable = false;
+        }
+
+        if (!trayEventValid(autoTray.trayEvent_)) {
+            issues.push_back({ i, i, Problem::BadTrayEvent, {} });
+            rule.usable = false;
+        }
+
+        if (!minimizePersistenceValid(autoTray.minimizePersistence_)) {
+            issues.push_back({ i, i, Problem::BadMinimizePersistence, {} });
+            rule.usable = false;
+        }
+    });
+
+    // rules with identical matchers are found by hashing, this needs to be in order
+    std::unordered_map<std::string, size_t> matchers;
+    matchers.reserve(rules.size());
+    for (size_t i = 0; i < prepared.size(); ++i) {
+        Rule & rule = prepared[i];
+        if (!rule.usable) {
+            continue;
+        }
+
+        std::string matcher = rule.executable;
+        matcher += '\0';
+        matcher += rule.autoTray->windowClass_;
+        matcher += '\0';
+        matcher += rule.autoTray->windowTitle_;
+        const auto [it, inserted] = matchers.try_emplace(std::move(matcher), i);
+        if (!inserted) {
+            rule.duplicateOf = it->second;
+            const bool same = sameAction(rules[it->second], rules[i]);
+            report.issues.push_back({ i, it->second, same ? Problem::Duplicate : Problem::Conflict, {} });
+        }
+    }
+
+    // rules are tried in order and the first match wins, so a rule is
+    // unreachable if any earlier rule matches everything that it matches
+    parallelFor(prepared.size(), threadCount, report.issues, [&prepared](size_t later, std::vector<Issue> & issues) {
+        const Rule & laterRule = prepared[later];
+        if (!laterRule.usable || (laterRule.duplicateOf != static_cast<size_t>(-1))) {
+            return;
+        }
+
+        for (size_t earlier = 0; earlier < later; ++earlier) {
+            const Rule & earlierRule = prepared[earlier];
+            if (earlierRule.usable && covers(earlierRule, laterRule)) {
+                const bool same = sameAction(*earlierRule.autoTray, *laterRule.autoTray);
+                issues.push_back({ later, earlier, same ? Problem::Shadowed : Problem::Conflict, {} });
+                break;
+            }
+        }
+    });
+
+    std::ranges::stable_sort(report.issues, [](const Issue & a, const Issue & b) noexcept { return a.rule < b.rule; });
+
+    for (const Issue & issue : report.issues) {
+        if ((issue.problem == Problem::Duplicate) || (issue.problem == Problem::Shadowed)) {
+            ++report.warningCount;
+        } else {
+            ++report.errorCount;
+        }
+    }
+
+    return report;
+}
+
+std::vector<Settings::AutoTray> withoutDuplicates(const std::vector<Settings::AutoTray> & rules, const Report & report)
+{
+    std::vector<bool> duplicate(rules.size());
+    for (const Issue & issue : report.issues) {
+        if ((issue.problem == Problem::Duplicate) && (issue.rule < duplicate.size())) {
+            duplicate[issue.rule] = true;
+        }
+    }
+
+    std::vector<Settings::AutoTray> committed;
+    committed.reserve(rules.size());
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (!duplicate[i]) {
+            committed.push_back(rules[i]);
+        }
+    }
+
+    return committed;
+}
+
+bool parseCsv(std::string_view csv, std::vector<Settings::AutoTray> & rules, std::string & error)
+{
+    constexpr size_t columnsMin = 3;
+    constexpr size_t columnsMax = 5;
+
+    std::vector<Settings::AutoTray> parsed;
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    bool fieldWasQuoted = false;
+    size_t line = 1;
+    size_t recordLine = 1;
+
+    const auto endRecord = [&]() {
+        fields.push_back(std::move(field));
+        field.clear();
+
+        // skip blank lines
+        if ((fields.size() == 1) && fields[0].empty() && !fieldWasQuoted) {
+            fields.clear();
+            return true;
+        }
+
+        // skip the header
+        if (parsed.empty() && (toLower(fields[0]) == "executable")) {
+            fields.clear();
+            return true;
+        }
+
+        if ((fields.size() < columnsMin) || (fields.size() > columnsMax)) {
+            error = "line " + std::to_string(recordLine) + ": expected " + std::to_string(columnsMin) + " to " +
+                std::to_string(columnsMax) + " fields, got " + std::to_string(fields.size());
+            return false;
+        }
+
+        Settings::AutoTray autoTray;
+        autoTray.executable_ = std::move(fields[0]);
+        autoTray.windowClass_ = std::move(fields[1]);
+        autoTray.windowTitle_ = std::move(fields[2]);
+        if ((fields.size() > 3) && !fields[3].empty()) {
+            autoTray.trayEvent_ = trayEventFromCString(fields[3].c_str());
+        }
+        if ((fields.size() > 4) && !fields[4].empty()) {
+            autoTray.minimizePersistence_ = minimizePersistenceFromCString(fields[4].c_str());
+        }
+        parsed.emplace_back(std::move(autoTray));
+
+        fields.clear();
+        return true;
+    };
+
+    for (size_t i = 0; i < csv.size(); ++i) {
+        const char c = csv[i];
+        if (quoted) {
+            if (c != '"') {
+                if (c == '\n') {
+                    ++line;
+                }
+                field += c;
+            } else if (((i + 1) < csv.size()) && (csv[i + 1] == '"')) {
+                field += '"';
+                ++i;
+            } else {
+                quoted = false;
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '"': {
+                if (!field.empty()) {
+                    error = "line " + std::to_string(line) + ": unexpected quote";
+                    return false;
+                }
+                quoted = true;
+                fieldWasQuoted = true;
+                break;
+            }
+
+            case ',': {
+                fields.push_back(std::move(field));
+                field.clear();
+                break;
+            }
+
+            case '\r': {
+                break;
+            }
+
+            case '\n': {
+                if (!endRecord()) {
+                    return false;
+                }
+                fieldWasQuoted = false;
+                recordLine = ++line;
+                break;
+            }
+
+            default: {
+                field += c;
+                break;
+            }
+        }
+    }
+
+    if (quoted) {
+        error = "line " + std::to_string(recordLine) + ": unterminated quote";
+        return false;
+    }
+
+    if ((!field.empty() || !fields.empty() || fieldWasQuoted) && !endRecord()) {
+        return false;
+    }
+
+    rules.insert(rules.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+    return true;
+}
+
+} // namespace AutoTrayValidator
+
+namespace
+{
+
+std::string toLower(std::string_view s)
+{
+    std::string lower(s);
+    for (char & c : lower) {
+        if ((c >= 'A') && (c <= 'Z')) {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return lower;
+}
+
+bool sameAction(const Settings::AutoTray & a, const Settings::AutoTray & b) noexcept
+{
+    return (a.trayEvent_ == b.trayEvent_) && (a.minimizePersistence_ == b.minimizePersistence_);
+}
+
+// conservative, only reports titles that are certainly covered
+bool titleCovers(const std::string & earlier, const std::string & later) noexcept
+{
+    return earlier.empty() || (earlier == ".*") || (earlier == later);
+}
+
+bool covers(const Rule & earlier, const Rule & later) noexcept
+{
+    const Settings::AutoTray & e = *earlier.autoTray;
+    const Settings::AutoTray & l = *later.autoTray;
+
+    if (!e.windowClass_.empty() && (e.windowClass_ != l.windowClass_)) {
+        return false;
+    }
+
+    if (!earlier.executable.empty() && (earlier.executable != later.executable)) {
+        return false;
+    }
+
+    return titleCovers(e.windowTitle_, l.windowTitle_);
+}
+
+const char * problemDescription(AutoTrayValidator::Problem problem) noexcept
+{
+    switch (problem) {
+        case AutoTrayValidator::Problem::Empty: return "nothing to match";
+        case AutoTrayValidator::Problem::BadRegex: return "couldn't parse window title regex";
+        case AutoTrayValidator::Problem::BadTrayEvent: return "bad tray event";
+        case AutoTrayValidator::Problem::BadMinimizePersistence: return "bad minimize persistence";
+        case AutoTrayValidator::Problem::Conflict: return "conflicting action, always matched first by";
+        case AutoTrayValidator::Problem::Duplicate: return "duplicate of";
+        case AutoTrayValidator::Problem::Shadowed: return "unreachable, always matched first by";
+        default: return "unknown problem";
+    }
+}
+
+} // anonymous namespace
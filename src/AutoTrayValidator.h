@@ -0,0 +1,83 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "Settings.h"
+
+// Standard library
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Validation of large sets of auto-tray rules, used for bulk imports. Rules are
+// checked in parallel, and the whole set is checked against itself for rules
+// that can never be reached because an earlier rule always matches first.
+namespace AutoTrayValidator
+{
+
+enum class Problem
+{
+    Empty, // error, rule has nothing to match
+    BadRegex, // error, window title is not a valid regular expression
+    BadTrayEvent, // error
+    BadMinimizePersistence, // error
+    Conflict, // error, unreachable and would do something different than the rule that shadows it
+    Duplicate, // warning, same as an earlier rule, dropped when committing
+    Shadowed // warning, unreachable but would do the same thing as the rule that shadows it
+};
+
+struct Issue
+{
+    size_t rule {};
+    size_t other {}; // the earlier rule, for duplicates, conflicts, and shadowing
+    Problem problem {};
+    std::string detail;
+};
+
+struct Report
+{
+    [[nodiscard]]
+    bool ok() const noexcept
+    {
+        return errorCount == 0;
+    }
+
+    // one line per issue, rules are numbered from one, at most maxIssues are listed
+    [[nodiscard]]
+    std::string toString(size_t maxIssues = static_cast<size_t>(-1)) const;
+
+    // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
+    size_t ruleCount {};
+    size_t errorCount {};
+    size_t warningCount {};
+    std::vector<Issue> issues; // sorted by rule
+    // NOLINTEND(misc-non-private-member-variables-in-classes)
+};
+
+// threadCount of zero uses one thread per core
+Report validate(const std::vector<Settings::AutoTray> & rules, unsigned int threadCount = 0);
+
+// the rules that should be committed after a successful validation
+std::vector<Settings::AutoTray> withoutDuplicates(const std::vector<Settings::AutoTray> & rules, const Report & report);
+
+// Rules in CSV format, one rule per line with the columns executable,
+// window-class, window-title, tray-event, minimize-persistence. Fields can be
+// quoted with double quotes, which is needed for regular expressions that
+// contain commas. The last two columns are optional, and a header line is
+// skipped if present.
+bool parseCsv(std::string_view csv, std::vector<Settings::AutoTray> & rules, std::string & error);
+
+} // namespace AutoTrayValidator
@@ -20,6 +20,7 @@
 #include "StringUtility.h"
 
 // Standard library
+#include <cstdint>
 #include <vector>
 
 namespace Bitmap
@@ -39,7 +40,7 @@ BitmapHandleWrapper getResource(unsigned int id)
     return bitmap;
 }
 
-bool replaceColor(const BitmapHandleWrapper & bitmap, COLORREF oldColor, COLORREF newColor)
+bool replaceColors(const BitmapHandleWrapper & bitmap, std::span<const PixelKernels::ColorReplacement> replacements)
 {
     if (!bitmap) {
         return false;
@@ -62,25 +63,22 @@ bool replaceColor(const BitmapHandleWrapper & bitmap, COLORREF oldColor, COLORRE
     bitmapInfo.bmiHeader.biPlanes = 1;
     bitmapInfo.bmiHeader.biBitCount = 32;
 
-    std::vector<COLORREF> pixels(static_cast<size_t>(bm.bmWidth) * static_cast<size_t>(bm.bmHeight));
+    std::vector<std::uint32_t> pixels(static_cast<size_t>(bm.bmWidth) * static_cast<size_t>(bm.bmHeight));
     if (!GetDIBits(desktopDC, bitmap, 0, narrow_cast<UINT>(bm.bmHeight), pixels.data(), &bitmapInfo, DIB_RGB_COLORS)) {
         WARNING_PRINTF("failed to get bitmap bits, GetDIBits() failed: %s\n", StringUtility::lastErrorString().c_str());
         return false;
     }
 
-    bool replaced = false;
-    for (COLORREF & pixelColor : pixels) {
-        if (pixelColor == oldColor) {
-            pixelColor = newColor;
-            replaced = true;
-        }
+    if (!PixelKernels::replaceColors(pixels, replacements)) {
+        return false;
     }
 
     if (!SetDIBits(desktopDC, bitmap, 0, narrow_cast<UINT>(bm.bmHeight), pixels.data(), &bitmapInfo, DIB_RGB_COLORS)) {
         WARNING_PRINTF("failed to set bitmap bits, SetDIBits() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return false;
     }
 
-    return replaced;
+    return true;
 }
 
 } // namespace Bitmap
@@ -16,14 +16,22 @@
 
 // App
 #include "BitmapHandleWrapper.h"
+#include "PixelKernels.h"
 
 // Windows
 #include <Windows.h>
 
+// Standard library
+#include <span>
+
 namespace Bitmap
 {
 
 BitmapHandleWrapper getResource(unsigned int id);
-bool replaceColor(const BitmapHandleWrapper & bitmap, COLORREF oldColor, COLORREF newColor);
+
+// Replaces colors in one pass over the bitmap's pixels, see
+// PixelKernels::replaceColors(), colors are 32 bit DIB pixels (0x00RRGGBB),
+// not COLORREF. Returns whether any pixels were replaced.
+bool replaceColors(const BitmapHandleWrapper & bitmap, std::span<const PixelKernels::ColorReplacement> replacements);
 
 } // namespace Bitmap
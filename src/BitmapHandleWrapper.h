@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -55,7 +56,7 @@ public:
     {
         if (hbitmap_) {
             if (!DeleteObject(hbitmap_)) {
-                WARNING_PRINTF("failed to destroy bitmap %#x\n", hbitmap_);
+                WARNING_LOG("failed to destroy bitmap {}\n", hbitmap_);
             }
             hbitmap_ = nullptr;
         }
@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -35,7 +36,7 @@ public:
     {
         if (hbrush_) {
             if (!DeleteObject(hbrush_)) {
-                WARNING_PRINTF("failed to destroy brush %#x\n", hbrush_);
+                WARNING_LOG("failed to destroy brush {}\n", hbrush_);
             }
         }
     }
@@ -0,0 +1,251 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "ContentHash.h"
+
+// Standard library
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define CONTENT_HASH_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CONTENT_HASH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+constexpr size_t lanes_ = 4;
+constexpr size_t stripeSize_ = lanes_ * sizeof(std::uint64_t);
+constexpr size_t stripesPerBlock_ = 8;
+constexpr size_t blockSize_ = stripeSize_ * stripesPerBlock_;
+
+constexpr std::uint64_t prime64a_ = 0x9e3779b185ebca87ULL;
+constexpr std::uint64_t prime64b_ = 0xc2b2ae3d27d4eb4fULL;
+constexpr std::uint32_t prime32_ = 0x9e3779b1U;
+
+// a key for each lane of each stripe in a block, then one each for scrambling, starting, and finishing
+constexpr size_t scrambleKey_ = stripesPerBlock_ * lanes_;
+constexpr size_t startKey_ = scrambleKey_ + lanes_;
+constexpr size_t finishKey_ = startKey_ + lanes_;
+constexpr size_t keyCount_ = finishKey_ + lanes_;
+
+constexpr std::uint64_t splitMix(std::uint64_t & state) noexcept
+{
+    std::uint64_t value = (state += prime64a_);
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+constexpr std::array<std::uint64_t, keyCount_> makeKeys() noexcept
+{
+    std::array<std::uint64_t, keyCount_> keys {};
+    std::uint64_t state = prime64b_;
+    for (std::uint64_t & key : keys) {
+        key = splitMix(state);
+    }
+    return keys;
+}
+
+alignas(16) constexpr std::array<std::uint64_t, keyCount_> keys_ = makeKeys();
+
+constexpr std::uint64_t avalanche(std::uint64_t value) noexcept
+{
+    value ^= value >> 33;
+    value *= prime64b_;
+    value ^= value >> 29;
+    value *= prime64a_;
+    return value ^ (value >> 32);
+}
+
+std::uint64_t load64(const std::uint8_t * bytes) noexcept
+{
+    std::uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+void accumulateScalar(std::uint64_t * accumulators, const std::uint8_t * stripe, const std::uint64_t * keys) noexcept
+{
+    for (size_t lane = 0; lane < lanes_; ++lane) {
+        const std::uint64_t data = load64(stripe + (lane * sizeof(std::uint64_t)));
+        const std::uint64_t keyed = data ^ keys[lane];
+        // the data is added to the neighbor too, so it isn't lost when the product is zero
+        accumulators[lane ^ 1] += data;
+        accumulators[lane] += (keyed & 0xffffffff) * (keyed >> 32);
+    }
+}
+
+void scrambleScalar(std::uint64_t * accumulators) noexcept
+{
+    for (size_t lane = 0; lane < lanes_; ++lane) {
+        std::uint64_t accumulator = accumulators[lane];
+        accumulator ^= accumulator >> 47;
+        accumulator ^= keys_[scrambleKey_ + lane];
+        accumulators[lane] = accumulator * prime32_;
+    }
+}
+
+#if defined(CONTENT_HASH_SSE2)
+
+void accumulate(std::uint64_t * accumulators, const std::uint8_t * stripe, const std::uint64_t * keys) noexcept
+{
+    for (size_t half = 0; half < 2; ++half) {
+        auto * const address = reinterpret_cast<__m128i *>(accumulators + (half * 2));
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe + (half * 16)));
+        const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + (half * 2)));
+        const __m128i keyed = _mm_xor_si128(data, key);
+        // the high half of each lane moved down for the multiply, which only uses the low halves
+        const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+        const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        _mm_storeu_si128(address, _mm_add_epi64(_mm_loadu_si128(address), _mm_add_epi64(product, swapped)));
+    }
+}
+
+void scramble(std::uint64_t * accumulators) noexcept
+{
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(prime32_));
+    for (size_t half = 0; half < 2; ++half) {
+        auto * const address = reinterpret_cast<__m128i *>(accumulators + (half * 2));
+        const std::uint64_t * const keys = keys_.data() + scrambleKey_ + (half * 2);
+        const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys));
+        __m128i accumulator = _mm_loadu_si128(address);
+        accumulator = _mm_xor_si128(accumulator, _mm_srli_epi64(accumulator, 47));
+        accumulator = _mm_xor_si128(accumulator, key);
+        // a 64 by 32 bit multiply, from the two halves
+        const __m128i low = _mm_mul_epu32(accumulator, prime);
+        const __m128i high = _mm_mul_epu32(_mm_srli_epi64(accumulator, 32), prime);
+        _mm_storeu_si128(address, _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+    }
+}
+
+#elif defined(CONTENT_HASH_NEON)
+
+void accumulate(std::uint64_t * accumulators, const std::uint8_t * stripe, const std::uint64_t * keys) noexcept
+{
+    for (size_t half = 0; half < 2; ++half) {
+        std::uint64_t * const address = accumulators + (half * 2);
+        const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(stripe + (half * 16)));
+        const uint64x2_t keyed = veorq_u64(data, vld1q_u64(keys + (half * 2)));
+        uint64x2_t accumulator = vmlal_u32(vld1q_u64(address), vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+        accumulator = vaddq_u64(accumulator, vextq_u64(data, data, 1));
+        vst1q_u64(address, accumulator);
+    }
+}
+
+void scramble(std::uint64_t * accumulators) noexcept
+{
+    for (size_t half = 0; half < 2; ++half) {
+        std::uint64_t * const address = accumulators + (half * 2);
+        uint64x2_t accumulator = vld1q_u64(address);
+        accumulator = veorq_u64(accumulator, vshrq_n_u64(accumulator, 47));
+        accumulator = veorq_u64(accumulator, vld1q_u64(keys_.data() + scrambleKey_ + (half * 2)));
+        // a 64 by 32 bit multiply, from the two halves
+        const uint64x2_t low = vmull_n_u32(vmovn_u64(accumulator), prime32_);
+        const uint64x2_t high = vmull_n_u32(vshrn_n_u64(accumulator, 32), prime32_);
+        vst1q_u64(address, vaddq_u64(low, vshlq_n_u64(high, 32)));
+    }
+}
+
+#else
+
+void accumulate(std::uint64_t * accumulators, const std::uint8_t * stripe, const std::uint64_t * keys) noexcept
+{
+    accumulateScalar(accumulators, stripe, keys);
+}
+
+void scramble(std::uint64_t * accumulators) noexcept
+{
+    scrambleScalar(accumulators);
+}
+
+#endif
+
+// Folds the bytes into the accumulators a block of stripes at a time, each
+// stripe with its own keys so reordered stripes hash differently, with the
+// accumulators scrambled after each block. The last partial stripe is padded
+// with zeros, the length is mixed in at the end to tell those apart.
+template <typename Accumulate, typename Scramble>
+std::uint64_t hashWith(
+    std::span<const std::uint8_t> bytes,
+    std::uint64_t seed,
+    Accumulate && accumulateStripe,
+    Scramble && scrambleBlock) noexcept
+{
+    alignas(16) std::uint64_t accumulators[lanes_];
+    for (size_t lane = 0; lane < lanes_; ++lane) {
+        accumulators[lane] = keys_[startKey_ + lane] ^ seed;
+    }
+
+    const std::uint8_t * data = bytes.data();
+    size_t remaining = bytes.size();
+    for (; remaining >= blockSize_; remaining -= blockSize_, data += blockSize_) {
+        for (size_t stripe = 0; stripe < stripesPerBlock_; ++stripe) {
+            accumulateStripe(accumulators, data + (stripe * stripeSize_), keys_.data() + (stripe * lanes_));
+        }
+        scrambleBlock(accumulators);
+    }
+
+    size_t stripe = 0;
+    for (; remaining >= stripeSize_; remaining -= stripeSize_, data += stripeSize_, ++stripe) {
+        accumulateStripe(accumulators, data, keys_.data() + (stripe * lanes_));
+    }
+
+    if (remaining) {
+        std::uint8_t last[stripeSize_] = {};
+        std::memcpy(last, data, remaining);
+        accumulateStripe(accumulators, last, keys_.data() + (stripe * lanes_));
+    }
+
+    std::uint64_t result = (static_cast<std::uint64_t>(bytes.size()) * prime64a_) ^ seed;
+    for (size_t lane = 0; lane < lanes_; ++lane) {
+        result ^= avalanche(accumulators[lane] ^ keys_[finishKey_ + lane]);
+        result = (std::rotl(result, 27) * prime64a_) + prime64b_;
+    }
+    return avalanche(result);
+}
+
+} // anonymous namespace
+
+namespace ContentHash
+{
+
+std::uint64_t hash(std::span<const std::uint8_t> bytes, std::uint64_t seed) noexcept
+{
+    return hashWith(bytes, seed, accumulate, scramble);
+}
+
+std::uint64_t hashScalar(std::span<const std::uint8_t> bytes, std::uint64_t seed) noexcept
+{
+    return hashWith(bytes, seed, accumulateScalar, scrambleScalar);
+}
+
+const char * kernelName() noexcept
+{
+#if defined(CONTENT_HASH_SSE2)
+    return "SSE2";
+#elif defined(CONTENT_HASH_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace ContentHash
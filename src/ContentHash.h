@@ -0,0 +1,38 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstdint>
+#include <span>
+
+// A fast 64 bit hash of a block of memory, for telling whether two images are
+// the same without keeping them around to compare. It's not cryptographic,
+// only well mixed, in the style of XXH3: 32 bytes at a time are folded into
+// four 64 bit accumulators with a 32 by 32 bit multiply each, which is done
+// two at a time with SSE2 on x86 and x64, or NEON on ARM64. Every kernel
+// gives the same hash for the same bytes, on a little endian CPU.
+namespace ContentHash
+{
+
+std::uint64_t hash(std::span<const std::uint8_t> bytes, std::uint64_t seed = 0) noexcept;
+
+// the same, 64 bits at a time, for checking and comparing with hash
+std::uint64_t hashScalar(std::span<const std::uint8_t> bytes, std::uint64_t seed = 0) noexcept;
+
+// what hash uses, "SSE2", "NEON", or "scalar"
+const char * kernelName() noexcept;
+
+} // namespace ContentHash
@@ -16,30 +16,114 @@
 #include "ContextMenu.h"
 
 #include "AppInfo.h"
-#include "Bitmap.h"
-#include "BitmapHandleWrapper.h"
 #include "Helpers.h"
+#include "LatencyHistogram.h"
 #include "Log.h"
 #include "MenuHandleWrapper.h"
+#include "MenuIcons.h"
+#include "MenuModel.h"
 #include "Resource.h"
 #include "StringUtility.h"
 #include "VirtualDesktop.h"
-#include "WindowIcon.h"
 #include "WindowInfo.h"
 #include "WindowTracker.h"
 
+// Standard library
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 namespace
 {
 
+// window item IDs, each window keeps its ID while it's in its section
 constexpr WORD IDM_VISIBLEWINDOW_BASE = 0x2000;
-constexpr WORD IDM_VISIBLEWINDOW_MAX = 0x2FFF;
-constexpr WORD IDM_MINIMIZEDWINDOW_BASE = 0x3000;
-constexpr WORD IDM_MINIMIZEDWINDOW_MAX = 0x3FFF;
-
-bool addMenuItemForWindow(HMENU menu, HWND hwnd, unsigned int id, const BitmapHandleWrapper & bitmap);
+constexpr WORD IDM_VISIBLEWINDOW_MAX = 0x7FFF;
+constexpr WORD IDM_MINIMIZEDWINDOW_BASE = 0x8000;
+constexpr WORD IDM_MINIMIZEDWINDOW_MAX = 0xDFFF;
 
-std::vector<HWND> visibleWindows_;
-std::vector<HWND> minimizedWindows_;
+// what the menu was built from, if none of it has changed the menu is up to date
+struct MenuSource
+{
+    std::uint64_t generation {};
+    MinimizePlacement minimizePlacement {};
+    DWORD menuColor {};
+
+    bool operator==(const MenuSource & other) const = default;
+};
+
+// The menu is kept between shows, with the model of what it shows, see
+// MenuModel.h. Each build makes a new model and applies only the edits
+// between the two to the menu. The icon and app of each window are kept
+// too, so they're only fetched when the window first appears, and the icons
+// of the commands. The icons are held in the menu icon atlas, see
+// MenuIcons.h, and released when their window leaves the menu. The menu is
+// built when the app is idle, and again when shown only if the windows
+// changed since.
+struct RetainedMenu
+{
+    std::unique_ptr<MenuHandleWrapper> menu;
+    MenuSource source;
+    std::vector<MenuModel::Item> items;
+    MenuModel::WindowIds visibleIds { IDM_VISIBLEWINDOW_BASE, IDM_VISIBLEWINDOW_MAX };
+    MenuModel::WindowIds minimizedIds { IDM_MINIMIZEDWINDOW_BASE, IDM_MINIMIZEDWINDOW_MAX };
+    std::unordered_map<HWND, MenuIcons::Icon> icons;
+    std::unordered_map<unsigned int, MenuIcons::Icon> commandIcons;
+    std::unordered_map<HWND, std::string> groups;
+};
+
+// the fixed labels, loaded once
+struct Labels
+{
+    std::string minimizeAll;
+    std::string restoreAll;
+    std::string settings;
+    std::string saveFlightRecorder;
+    std::string exit;
+};
+
+// the app's own icons for its commands, some with white and black backgrounds that become the menu color
+struct CommandIcon
+{
+    unsigned int id {};
+    unsigned int resource {};
+    bool transparent {};
+};
+
+// FIX - why doesn't HBMMENU_SYSTEM work for the app item?
+constexpr CommandIcon commandIcons_[] = {
+    { ContextMenu::IDM_APP, IDB_APP, true },
+    { ContextMenu::IDM_MINIMIZE_ALL, IDB_MINIMIZE, false },
+    { ContextMenu::IDM_RESTORE_ALL, IDB_RESTORE, false },
+    { ContextMenu::IDM_SETTINGS, IDB_SETTINGS, true },
+    { ContextMenu::IDM_EXIT, IDB_EXIT, true },
+};
+
+constexpr MenuModel::Layout layout_;
+
+RetainedMenu retained_;
+std::optional<MenuSource> prebuildFailed_;
+
+// how long from the hotkey or click until the menu is up, when it was already built, and when it had to be
+LatencyHistogram prebuiltLatency_;
+LatencyHistogram builtLatency_;
+std::optional<LARGE_INTEGER> showStart_;
+bool showPrebuilt_;
+
+MenuSource getMenuSource(MinimizePlacement minimizePlacement);
+bool build(const MenuSource & source);
+void reset() noexcept;
+void logLatency(const char * kind, const LatencyHistogram & latency);
+const Labels & getLabels();
+std::vector<MenuModel::Item> buildItems(MinimizePlacement minimizePlacement);
+bool applyEdit(const MenuModel::Edit & edit);
+void prune();
 
 } // anonymous namespace
 
@@ -50,296 +134,446 @@ bool show(HWND hwnd, MinimizePlacement minimizePlacement)
 {
     DEBUG_PRINTF("showing context menu, minimizePlacement %s\n", minimizePlacementToCString(minimizePlacement));
 
-    visibleWindows_.clear();
-    minimizedWindows_.clear();
+    // The message's time is when the key was pressed or the icon clicked, but
+    // only to the tick, about 16 ms, so only a long wait in the queue adds to
+    // the time it took.
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    const DWORD queued = GetTickCount() - static_cast<DWORD>(GetMessageTime());
+    start.QuadPart -= (static_cast<LONGLONG>(queued) * frequency.QuadPart) / 1000;
+    showStart_ = start;
+
+    const MenuSource source = getMenuSource(minimizePlacement);
+    showPrebuilt_ = retained_.menu && (retained_.source == source);
+    if (!showPrebuilt_ && !build(source)) {
+        showStart_.reset();
+        return false;
+    }
 
-    // create popup menu
-    const MenuHandleWrapper menu(CreatePopupMenu());
-    if (!menu) {
+    // activate our window
+    if (!SetForegroundWindow(hwnd)) {
         WARNING_PRINTF(
-            "failed to create context menu, CreatePopupMenu() failed: %s\n",
+            "failed to activate context menu, SetForegroundWindow() failed: %s\n",
             StringUtility::lastErrorString().c_str());
+        showStart_.reset();
         return false;
     }
 
-    // add menu entry and separator for the app itself
-    if (!AppendMenuA(menu, MF_STRING, IDM_APP, APP_NAME)) {
-        WARNING_PRINTF("failed to create menu entry, AppendMenuA() failed: %s\n", StringUtility::lastErrorString().c_str());
+    // get the current mouse position
+    POINT point = { 0, 0 };
+    if (!GetCursorPos(&point)) {
+        WARNING_PRINTF(
+            "failed to get menu position, GetCursorPos() failed: %s\n",
+            StringUtility::lastErrorString().c_str());
+        showStart_.reset();
         return false;
     }
-    if (!AppendMenuA(menu, MF_SEPARATOR, 0, nullptr)) {
-        WARNING_PRINTF("failed to create menu entry, AppendMenuA() failed: %s\n", StringUtility::lastErrorString().c_str());
+
+    // show the popup menu
+    const BOOL tracked = TrackPopupMenu(*retained_.menu, 0, point.x, point.y, 0, hwnd, nullptr);
+    showStart_.reset();
+    if (!tracked) {
+        WARNING_PRINTF(
+            "failed to show context menu, TrackPopupMenu() failed: %s\n",
+            StringUtility::lastErrorString().c_str());
         return false;
     }
 
-    // cppcheck-suppress variableScope
-    std::vector<BitmapHandleWrapper> bitmaps;
+    // force a task switch to our app
+    if (!PostMessage(hwnd, WM_USER, 0, 0)) {
+        WARNING_PRINTF("failed to activate app, PostMessage() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return false;
+    }
 
-    if (minimizePlacementIncludesMenu(minimizePlacement)) {
-        WindowTracker::enumerate([&](const WindowTracker::Item & item) {
-            if (item.visible_ && VirtualDesktop::isWindowOnCurrentDesktop(item.hwnd_)) {
-                DEBUG_PRINTF("adding visible window: %#x - '%s'\n", item.hwnd_, item.title_.c_str());
-                visibleWindows_.push_back(item.hwnd_);
-            } else if (item.minimized_) {
-                DEBUG_PRINTF("adding minimized window: %#x - '%s'\n", item.hwnd_, item.title_.c_str());
-                minimizedWindows_.push_back(item.hwnd_);
-            }
+    return true;
+}
 
-            return true;
-        });
+void prebuild(MinimizePlacement minimizePlacement)
+{
+    // a build that failed isn't tried again until something changes, rather than every time the app is idle
+    const MenuSource source = getMenuSource(minimizePlacement);
+    if ((retained_.menu && (retained_.source == source)) || (prebuildFailed_ == source)) {
+        return;
+    }
 
-        // add menu entries for visible windows
-        if (!visibleWindows_.empty()) {
-            for (size_t i = 0; i < visibleWindows_.size(); ++i) {
-                HWND visibleHwnd = visibleWindows_.at(i);
-                bitmaps.emplace_back(WindowIcon::bitmap(visibleHwnd));
-                if (!addMenuItemForWindow(
-                        menu,
-                        visibleHwnd,
-                        IDM_VISIBLEWINDOW_BASE + narrow_cast<unsigned int>(i),
-                        bitmaps.back())) {
-                    return false;
-                }
-            }
+    if (build(source)) {
+        prebuildFailed_.reset();
+    } else {
+        prebuildFailed_ = source;
+    }
+}
 
-            if (!AppendMenuA(menu, MF_SEPARATOR, 0, nullptr)) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, AppendMenuA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
-                return false;
-            }
+void shown()
+{
+    if (!showStart_) {
+        return;
+    }
 
-            if (!AppendMenuA(menu, MF_STRING, IDM_MINIMIZE_ALL, getResourceString(IDS_MENU_MINIMIZE_ALL).c_str())) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, AppendMenuA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
-                return false;
-            }
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    const auto microseconds =
+        static_cast<std::uint64_t>(((now.QuadPart - showStart_->QuadPart) * 1000000) / frequency.QuadPart);
+    (showPrebuilt_ ? prebuiltLatency_ : builtLatency_).record(microseconds);
+    DEBUG_PRINTF(
+        "context menu shown in %llu us, %s\n",
+        static_cast<unsigned long long>(microseconds),
+        showPrebuilt_ ? "prebuilt" : "built when shown");
+    showStart_.reset();
+}
 
-            if (!AppendMenuA(menu, MF_SEPARATOR, 0, nullptr)) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, AppendMenuA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
-                return false;
-            }
-        }
+void stop() noexcept
+{
+    logLatency("prebuilt", prebuiltLatency_);
+    logLatency("built when shown", builtLatency_);
+    reset();
+}
 
-        // add menu entries for minimized windows
-        if (!minimizedWindows_.empty()) {
-            for (size_t i = 0; i < minimizedWindows_.size(); ++i) {
-                HWND minimizedHwnd = minimizedWindows_.at(i);
-                bitmaps.emplace_back(WindowIcon::bitmap(minimizedHwnd));
-                if (!addMenuItemForWindow(
-                        menu,
-                        minimizedHwnd,
-                        IDM_MINIMIZEDWINDOW_BASE + narrow_cast<unsigned int>(i),
-                        bitmaps.back())) {
-                    return false;
-                }
-            }
+HWND getMinimizedWindow(unsigned int id)
+{
+    return reinterpret_cast<HWND>(retained_.minimizedIds.window(id));
+}
 
-            if (!AppendMenuA(menu, MF_SEPARATOR, 0, nullptr)) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, AppendMenuA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
-                return false;
-            }
+HWND getVisibleWindow(unsigned int id)
+{
+    return reinterpret_cast<HWND>(retained_.visibleIds.window(id));
+}
 
-            if (!AppendMenuA(menu, MF_STRING, IDM_RESTORE_ALL, getResourceString(IDS_MENU_RESTORE_ALL).c_str())) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, AppendMenuA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
-                return false;
-            }
+} // namespace ContextMenu
 
-            if (!AppendMenuA(menu, MF_SEPARATOR, 0, nullptr)) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, AppendMenuA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
-                return false;
-            }
+namespace
+{
+
+MenuSource getMenuSource(MinimizePlacement minimizePlacement)
+{
+    return { WindowTracker::generation(), minimizePlacement, GetSysColor(COLOR_MENU) };
+}
+
+bool build(const MenuSource & source)
+{
+    // the icons are drawn on the menu color, so a new color means starting over
+    if (!retained_.menu || (retained_.source.menuColor != source.menuColor)) {
+        reset();
+        MenuIcons::updateColors();
+        retained_.menu = std::make_unique<MenuHandleWrapper>(CreatePopupMenu());
+        if (!*retained_.menu) {
+            WARNING_PRINTF(
+                "failed to create context menu, CreatePopupMenu() failed: %s\n",
+                StringUtility::lastErrorString().c_str());
+            retained_.menu.reset();
+            return false;
         }
     }
 
-    // add menu entries for settings
-    if (!AppendMenuA(menu, MF_STRING, IDM_SETTINGS, getResourceString(IDS_MENU_SETTINGS).c_str())) {
-        WARNING_PRINTF("failed to create menu entry, AppendMenuA() failed: %s\n", StringUtility::lastErrorString().c_str());
-        return false;
+    std::vector<MenuModel::Item> items = buildItems(source.minimizePlacement);
+    std::vector<MenuModel::Edit> edits;
+    MenuModel::diff(retained_.items, items, edits);
+    for (const MenuModel::Edit & edit : edits) {
+        if (!applyEdit(edit)) {
+            // what the menu has is unknown, so it's rebuilt next time
+            reset();
+            return false;
+        }
     }
+    retained_.items = std::move(items);
+    retained_.source = source;
+    prune();
+
+    DEBUG_PRINTF(
+        "context menu has %zu visible and %zu minimized windows, %zu edits\n",
+        retained_.visibleIds.size(),
+        retained_.minimizedIds.size(),
+        edits.size());
+    return true;
+}
 
-    // add menu entry for exit
-    if (!AppendMenuA(menu, MF_STRING, IDM_EXIT, getResourceString(IDS_MENU_EXIT).c_str())) {
-        WARNING_PRINTF("failed to create menu entry, AppendMenuA() failed: %s\n", StringUtility::lastErrorString().c_str());
-        return false;
+void reset() noexcept
+{
+    for (const auto & [hwnd, icon] : retained_.icons) {
+        MenuIcons::release(icon);
+    }
+    for (const auto & [id, icon] : retained_.commandIcons) {
+        MenuIcons::release(icon);
+    }
+    retained_.items.clear();
+    retained_.icons.clear();
+    retained_.commandIcons.clear();
+    retained_.groups.clear();
+    retained_.menu.reset();
+}
+
+void logLatency(const char * kind, const LatencyHistogram & latency)
+{
+    if (!latency.count()) {
+        return;
     }
 
-    // create icons for the menu items
+    INFO_PRINTF(
+        "context menu %s: shown %llu times, in %llu us at least, %llu us median, %llu us 90th, %llu us 99th, "
+        "%llu us at most\n%s",
+        kind,
+        static_cast<unsigned long long>(latency.count()),
+        static_cast<unsigned long long>(latency.min()),
+        static_cast<unsigned long long>(latency.percentile(0.5)),
+        static_cast<unsigned long long>(latency.percentile(0.9)),
+        static_cast<unsigned long long>(latency.percentile(0.99)),
+        static_cast<unsigned long long>(latency.max()),
+        latency.format().c_str());
+}
 
-    const BitmapHandleWrapper appBitmap(Bitmap::getResource(IDB_APP));
-    const BitmapHandleWrapper minimizeBitmap(Bitmap::getResource(IDB_MINIMIZE));
-    const BitmapHandleWrapper restoreBitmap(Bitmap::getResource(IDB_RESTORE));
-    const BitmapHandleWrapper settingsBitmap(Bitmap::getResource(IDB_SETTINGS));
-    const BitmapHandleWrapper exitBitmap(Bitmap::getResource(IDB_EXIT));
+const Labels & getLabels()
+{
+    static const Labels labels = {
+        getResourceString(IDS_MENU_MINIMIZE_ALL),
+        getResourceString(IDS_MENU_RESTORE_ALL),
+        getResourceString(IDS_MENU_SETTINGS),
+        getResourceString(IDS_MENU_SAVE_FLIGHT_RECORDER),
+        getResourceString(IDS_MENU_EXIT),
+    };
+    return labels;
+}
 
-    if (!appBitmap || !minimizeBitmap || !restoreBitmap || !settingsBitmap || !exitBitmap) {
-        WARNING_PRINTF("failed to load bitmap: %s\n", StringUtility::lastErrorString().c_str());
-    } else {
-        constexpr COLORREF oldColor1 = RGB(0xFF, 0xFF, 0xFF);
-        constexpr COLORREF oldColor2 = RGB(0x00, 0x00, 0x00);
-        const DWORD menuColor = GetSysColor(COLOR_MENU);
-        const COLORREF newColor = RGB(GetBValue(menuColor), GetGValue(menuColor), GetRValue(menuColor));
-
-        Bitmap::replaceColor(appBitmap, oldColor1, newColor);
-        Bitmap::replaceColor(settingsBitmap, oldColor1, newColor);
-        Bitmap::replaceColor(exitBitmap, oldColor1, newColor);
-
-        Bitmap::replaceColor(appBitmap, oldColor2, newColor);
-        Bitmap::replaceColor(settingsBitmap, oldColor2, newColor);
-        Bitmap::replaceColor(exitBitmap, oldColor2, newColor);
-
-        MENUITEMINFOA menuItemInfo;
-        memset(&menuItemInfo, 0, sizeof(MENUITEMINFOA));
-        menuItemInfo.cbSize = sizeof(MENUITEMINFOA);
-        menuItemInfo.fMask = MIIM_BITMAP;
-
-        menuItemInfo.hbmpItem = appBitmap;
-        // FIX - why doesn't this work?
-        // menuItemInfo.hbmpItem = HBMMENU_SYSTEM;
-        // menuItemInfo.dwItemData = (ULONG_PTR)(HWND)appWindow_;
-        // DEBUG_PRINTF("dwItemData %x, app window: %x\n", menuItemInfo.dwItemData, (HWND)appWindow_);
-        if (!SetMenuItemInfoA(menu, IDM_APP, FALSE, &menuItemInfo)) {
-            WARNING_PRINTF(
-                "failed to create menu entry, SetMenuItemInfoA() failed: %s\n",
-                StringUtility::lastErrorString().c_str());
-        }
+// the app a window is grouped by in big menus, its executable's name, looked up once
+const std::string & getWindowGroup(HWND hwnd)
+{
+    const auto [it, added] = retained_.groups.try_emplace(hwnd);
+    if (added) {
+        const WindowInfo windowInfo(hwnd);
+        const std::string & executable = windowInfo.executable();
+        const size_t separator = executable.find_last_of("\\/");
+        it->second = (separator == std::string::npos) ? executable : executable.substr(separator + 1);
+    }
+    return it->second;
+}
 
-        if (!visibleWindows_.empty()) {
-            menuItemInfo.hbmpItem = minimizeBitmap;
-            if (!SetMenuItemInfoA(menu, IDM_MINIMIZE_ALL, FALSE, &menuItemInfo)) {
-                WARNING_PRINTF(
-                    "failed to create menu entry, SetMenuItemInfoA() failed: %s\n",
-                    StringUtility::lastErrorString().c_str());
+// the windows for a section, with the titles the tracker already has
+MenuModel::Section makeSection(
+    const std::vector<const WindowTracker::Item *> & items,
+    unsigned int allId,
+    const std::string & allLabel)
+{
+    MenuModel::Section section;
+    section.allId = allId;
+    section.allLabel = allLabel;
+    section.windows.reserve(items.size());
+    const bool grouped = items.size() > layout_.groupThreshold;
+    for (const WindowTracker::Item * item : items) {
+        section.windows.push_back({
+            reinterpret_cast<MenuModel::WindowId>(item->hwnd_),
+            item->title_,
+            grouped ? getWindowGroup(item->hwnd_) : std::string(),
+        });
+    }
+    return section;
+}
+
+// the model of the whole menu, the app, the window sections, and the fixed commands
+std::vector<MenuModel::Item> buildItems(MinimizePlacement minimizePlacement)
+{
+    std::vector<const WindowTracker::Item *> visibleItems;
+    std::vector<const WindowTracker::Item *> minimizedItems;
+    if (minimizePlacementIncludesMenu(minimizePlacement)) {
+        WindowTracker::enumerate([&](const WindowTracker::Item & item) {
+            if (item.visible_ && VirtualDesktop::isWindowOnCurrentDesktop(item.hwnd_)) {
+                visibleItems.push_back(&item);
+            } else if (item.minimized_) {
+                minimizedItems.push_back(&item);
             }
+
+            return true;
+        });
+    }
+
+    const Labels & labels = getLabels();
+    std::vector<MenuModel::Item> items;
+    items.push_back(MenuModel::command(ContextMenu::IDM_APP, APP_NAME));
+    items.push_back(MenuModel::separator());
+
+    size_t missing = MenuModel::appendSection(
+        items,
+        makeSection(visibleItems, ContextMenu::IDM_MINIMIZE_ALL, labels.minimizeAll),
+        retained_.visibleIds,
+        layout_);
+    missing += MenuModel::appendSection(
+        items,
+        makeSection(minimizedItems, ContextMenu::IDM_RESTORE_ALL, labels.restoreAll),
+        retained_.minimizedIds,
+        layout_);
+    retained_.visibleIds.releaseUnused();
+    retained_.minimizedIds.releaseUnused();
+    if (missing) {
+        WARNING_PRINTF("%zu windows don't fit in the menu\n", missing);
+    }
+
+    items.push_back(MenuModel::command(ContextMenu::IDM_SETTINGS, labels.settings));
+    items.push_back(MenuModel::command(ContextMenu::IDM_SAVE_FLIGHT_RECORDER, labels.saveFlightRecorder));
+    items.push_back(MenuModel::command(ContextMenu::IDM_EXIT, labels.exit));
+    return items;
+}
+
+// The icon for an item, the window's, fetched the first time it's in the
+// menu, or the app's own for a command, kept while the menu is.
+MenuIcons::Icon getItemIcon(const MenuModel::Item & item)
+{
+    if (item.kind == MenuModel::ItemKind::Window) {
+        const auto hwnd = reinterpret_cast<HWND>(item.window);
+        const auto [it, added] = retained_.icons.try_emplace(hwnd);
+        if (added) {
+            it->second = MenuIcons::acquireWindow(hwnd);
         }
+        return it->second;
+    }
+
+    if (item.kind != MenuModel::ItemKind::Command) {
+        return 0;
+    }
+
+    const auto commandIcon = std::ranges::find(commandIcons_, item.id, &CommandIcon::id);
+    if (commandIcon == std::end(commandIcons_)) {
+        return 0;
+    }
+
+    const auto [it, added] = retained_.commandIcons.try_emplace(item.id);
+    if (added) {
+        it->second = MenuIcons::acquireResource(commandIcon->resource, commandIcon->transparent);
+    }
+    return it->second;
+}
 
-        if (!minimizedWindows_.empty()) {
-            menuItemInfo.hbmpItem = restoreBitmap;
-            if (!SetMenuItemInfoA(menu, IDM_RESTORE_ALL, FALSE, &menuItemInfo)) {
+// the item draws its icon from the atlas, if it has one
+void setItemIcon(MENUITEMINFOA & menuItemInfo, const MenuModel::Item & item)
+{
+    const MenuIcons::Icon icon = getItemIcon(item);
+    menuItemInfo.fMask |= MIIM_BITMAP | MIIM_DATA;
+    menuItemInfo.hbmpItem = icon ? HBMMENU_CALLBACK : nullptr;
+    menuItemInfo.dwItemData = icon;
+}
+
+bool insertItem(HMENU menu, UINT position, const MenuModel::Item & item)
+{
+    MENUITEMINFOA menuItemInfo;
+    memset(&menuItemInfo, 0, sizeof(MENUITEMINFOA));
+    menuItemInfo.cbSize = sizeof(MENUITEMINFOA);
+
+    HMENU submenu = nullptr;
+    switch (item.kind) {
+        case MenuModel::ItemKind::Separator: {
+            menuItemInfo.fMask = MIIM_FTYPE;
+            menuItemInfo.fType = MFT_SEPARATOR;
+            break;
+        }
+        case MenuModel::ItemKind::Command:
+        case MenuModel::ItemKind::Window: {
+            menuItemInfo.fMask = MIIM_ID | MIIM_STRING;
+            menuItemInfo.wID = item.id;
+            menuItemInfo.dwTypeData = const_cast<char *>(item.label.c_str());
+            setItemIcon(menuItemInfo, item);
+            break;
+        }
+        case MenuModel::ItemKind::Submenu: {
+            submenu = CreatePopupMenu();
+            if (!submenu) {
                 WARNING_PRINTF(
-                    "failed to create menu entry, SetMenuItemInfoA() failed: %s\n",
+                    "failed to create submenu, CreatePopupMenu() failed: %s\n",
                     StringUtility::lastErrorString().c_str());
+                return false;
             }
-        }
-
-        menuItemInfo.hbmpItem = settingsBitmap;
-        if (!SetMenuItemInfoA(menu, IDM_SETTINGS, FALSE, &menuItemInfo)) {
-            WARNING_PRINTF(
-                "failed to create menu entry, SetMenuItemInfoA() failed: %s\n",
-                StringUtility::lastErrorString().c_str());
-        }
-
-        menuItemInfo.hbmpItem = exitBitmap;
-        if (!SetMenuItemInfoA(menu, IDM_EXIT, FALSE, &menuItemInfo)) {
-            WARNING_PRINTF(
-                "failed to create menu entry, SetMenuItemInfoA() failed: %s\n",
-                StringUtility::lastErrorString().c_str());
+            for (UINT childPosition = 0; childPosition < item.children.size(); ++childPosition) {
+                if (!insertItem(submenu, childPosition, item.children[childPosition])) {
+                    DestroyMenu(submenu);
+                    return false;
+                }
+            }
+            menuItemInfo.fMask = MIIM_STRING | MIIM_SUBMENU;
+            menuItemInfo.dwTypeData = const_cast<char *>(item.label.c_str());
+            menuItemInfo.hSubMenu = submenu;
+            break;
         }
     }
 
-    // activate our window
-    if (!SetForegroundWindow(hwnd)) {
+    if (!InsertMenuItemA(menu, position, TRUE, &menuItemInfo)) {
         WARNING_PRINTF(
-            "failed to activate context menu, SetForegroundWindow() failed: %s\n",
+            "failed to create menu entry, InsertMenuItemA() failed: %s\n",
             StringUtility::lastErrorString().c_str());
+        if (submenu) {
+            DestroyMenu(submenu);
+        }
         return false;
     }
 
-    // get the current mouse position
-    POINT point = { 0, 0 };
-    if (!GetCursorPos(&point)) {
-        WARNING_PRINTF(
-            "failed to get menu position, GetCursorPos() failed: %s\n",
-            StringUtility::lastErrorString().c_str());
-        return false;
+    return true;
+}
+
+bool updateItem(HMENU menu, UINT position, const MenuModel::Item & item)
+{
+    MENUITEMINFOA menuItemInfo;
+    memset(&menuItemInfo, 0, sizeof(MENUITEMINFOA));
+    menuItemInfo.cbSize = sizeof(MENUITEMINFOA);
+    menuItemInfo.fMask = MIIM_STRING;
+    menuItemInfo.dwTypeData = const_cast<char *>(item.label.c_str());
+    if (item.kind != MenuModel::ItemKind::Submenu) {
+        menuItemInfo.fMask |= MIIM_ID;
+        menuItemInfo.wID = item.id;
+        setItemIcon(menuItemInfo, item);
     }
 
-    // show the popup menu
-    if (!TrackPopupMenu(menu, 0, point.x, point.y, 0, hwnd, nullptr)) {
+    if (!SetMenuItemInfoA(menu, position, TRUE, &menuItemInfo)) {
         WARNING_PRINTF(
-            "failed to show context menu, TrackPopupMenu() failed: %s\n",
+            "failed to update menu entry, SetMenuItemInfoA() failed: %s\n",
             StringUtility::lastErrorString().c_str());
         return false;
     }
 
-    // force a task switch to our app
-    if (!PostMessage(hwnd, WM_USER, 0, 0)) {
-        WARNING_PRINTF("failed to activate app, PostMessage() failed: %s\n", StringUtility::lastErrorString().c_str());
-        return false;
-    }
-
     return true;
 }
 
-HWND getMinimizedWindow(unsigned int id)
+bool applyEdit(const MenuModel::Edit & edit)
 {
-    if (id >= IDM_MINIMIZEDWINDOW_BASE && id <= IDM_MINIMIZEDWINDOW_MAX) {
-        const unsigned int index = id - IDM_MINIMIZEDWINDOW_BASE;
-        if (index >= minimizedWindows_.size()) {
-            return nullptr;
+    HMENU menu = *retained_.menu;
+    for (size_t position : edit.path) {
+        menu = GetSubMenu(menu, narrow_cast<int>(position));
+        if (!menu) {
+            WARNING_PRINTF("failed to find submenu %zu to edit\n", position);
+            return false;
         }
-        return minimizedWindows_.at(index);
     }
 
-    return nullptr;
-}
-
-HWND getVisibleWindow(unsigned int id)
-{
-    if (id >= IDM_VISIBLEWINDOW_BASE && id <= IDM_VISIBLEWINDOW_MAX) {
-        const unsigned int index = id - IDM_VISIBLEWINDOW_BASE;
-        if (index >= visibleWindows_.size()) {
-            return nullptr;
+    const auto position = narrow_cast<UINT>(edit.position);
+    switch (edit.kind) {
+        case MenuModel::EditKind::Insert: return insertItem(menu, position, *edit.item);
+        case MenuModel::EditKind::Update: return updateItem(menu, position, *edit.item);
+        case MenuModel::EditKind::Remove: {
+            if (!DeleteMenu(menu, position, MF_BYPOSITION)) {
+                WARNING_PRINTF(
+                    "failed to remove menu entry, DeleteMenu() failed: %s\n",
+                    StringUtility::lastErrorString().c_str());
+                return false;
+            }
+            return true;
         }
-        return visibleWindows_.at(index);
     }
 
-    return nullptr;
+    return false;
 }
 
-} // namespace ContextMenu
-
-namespace
-{
-
-bool addMenuItemForWindow(HMENU menu, HWND hwnd, unsigned int id, const BitmapHandleWrapper & bitmap)
+// drops what's kept for windows no longer in the menu
+void prune()
 {
-    std::string title = WindowInfo::getTitle(hwnd);
-    constexpr size_t maxTitleLength = 30;
-    if (title.length() > maxTitleLength) {
-        const std::string_view ellipsis = "...";
-        title.resize(maxTitleLength - ellipsis.length());
-        title += ellipsis; // FIX - localize this?
-    }
-    if (!AppendMenuA(menu, MF_STRING, id, title.c_str())) {
-        WARNING_PRINTF("failed to create menu entry, AppendMenuA() failed: %s\n", StringUtility::lastErrorString().c_str());
-        return false;
-    }
-
-    if (bitmap) {
-        MENUITEMINFOA menuItemInfo;
-        memset(&menuItemInfo, 0, sizeof(MENUITEMINFOA));
-        menuItemInfo.cbSize = sizeof(MENUITEMINFOA);
-        menuItemInfo.fMask = MIIM_BITMAP;
-        menuItemInfo.hbmpItem = bitmap;
-        if (!SetMenuItemInfoA(menu, id, FALSE, &menuItemInfo)) {
-            WARNING_PRINTF(
-                "failed to create menu entry, SetMenuItemInfoA() failed: %s\n",
-                StringUtility::lastErrorString().c_str());
+    const auto gone = [](const auto & entry) {
+        const auto window = reinterpret_cast<MenuModel::WindowId>(entry.first);
+        return !retained_.visibleIds.contains(window) && !retained_.minimizedIds.contains(window);
+    };
+    std::erase_if(retained_.icons, [&gone](const auto & entry) {
+        if (!gone(entry)) {
             return false;
         }
-    }
-
-    return true;
+        MenuIcons::release(entry.second);
+        return true;
+    });
+    std::erase_if(retained_.groups, gone);
 }
 
 } // anonymous namespace
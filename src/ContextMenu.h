@@ -32,8 +32,22 @@ constexpr WORD IDM_ABOUT = 0x1003;
 constexpr WORD IDM_EXIT = 0x1004;
 constexpr WORD IDM_MINIMIZE_ALL = 0x1005;
 constexpr WORD IDM_RESTORE_ALL = 0x1006;
+constexpr WORD IDM_SAVE_FLIGHT_RECORDER = 0x1007;
 
+// Shows the menu, which is kept between shows and only patched where the windows in it changed
 bool show(HWND hwnd, MinimizePlacement minimizePlacement);
+
+// Brings the kept menu up to date ahead of showing it, when there's nothing
+// else to do, so showing it doesn't have to wait. Does nothing if the windows
+// haven't changed since it was last built.
+void prebuild(MinimizePlacement minimizePlacement);
+
+// the menu is up and waiting for the user, which ends the time taken to show it
+void shown();
+
+// drops the kept menu and logs how long it took to show
+void stop() noexcept;
+
 HWND getMinimizedWindow(unsigned int id);
 HWND getVisibleWindow(unsigned int id);
 
@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -42,7 +43,7 @@ public:
         , mode_(mode)
     {
         if (!hdc_) {
-            ERROR_PRINTF("invalid device context handle: %#x\n", hdc);
+            ERROR_LOG("invalid device context handle: {}\n", hdc);
         }
     }
 
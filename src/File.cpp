@@ -17,6 +17,7 @@
 #include "HandleWrapper.h"
 #include "Helpers.h"
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -58,7 +59,7 @@ std::string fileRead(const std::string & fileName)
     }
 
     if (bytesRead != fileSize.LowPart) {
-        WARNING_PRINTF("read %d bytes from '%s', expected %d\n", bytesRead, fileName.c_str(), fileSize.QuadPart);
+        WARNING_LOG("read {} bytes from '{}', expected {}\n", bytesRead, fileName, fileSize.QuadPart);
         return {};
     }
 
@@ -88,7 +89,7 @@ bool fileWrite(const std::string & fileName, const std::string & contents)
     }
 
     if (bytesWritten != contents.size()) {
-        WARNING_PRINTF("wrote %d bytes to '%s', expected %zu\n", bytesWritten, fileName.c_str(), contents.size());
+        WARNING_LOG("wrote {} bytes to '{}', expected {}\n", bytesWritten, fileName, contents.size());
         return false;
     }
 
@@ -119,3 +120,17 @@ bool directoryExists(const std::string & directory) noexcept
     const DWORD attrib = GetFileAttributesA(directory.c_str());
     return (attrib != INVALID_FILE_ATTRIBUTES && (attrib & FILE_ATTRIBUTE_DIRECTORY));
 }
+
+bool fileGetInfo(const std::string & fileName, unsigned long long & size, unsigned long long & writeTime) noexcept
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributeData;
+    memset(&attributeData, 0, sizeof(attributeData));
+    if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &attributeData)) {
+        return false;
+    }
+
+    size = (static_cast<unsigned long long>(attributeData.nFileSizeHigh) << 32) | attributeData.nFileSizeLow;
+    writeTime = (static_cast<unsigned long long>(attributeData.ftLastWriteTime.dwHighDateTime) << 32) |
+        attributeData.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
@@ -24,3 +24,4 @@ bool fileWrite(const std::string & fileName, const std::string & contents);
 bool fileExists(const std::string & fileName) noexcept;
 bool fileDelete(const std::string & fileName);
 bool directoryExists(const std::string & directory) noexcept;
+bool fileGetInfo(const std::string & fileName, unsigned long long & size, unsigned long long & writeTime) noexcept;
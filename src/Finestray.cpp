@@ -15,6 +15,7 @@
 // App
 #include "AboutDialog.h"
 #include "AppInfo.h"
+#include "AutoTrayValidator.h"
 #include "Bitmap.h"
 #include "BitmapHandleWrapper.h"
 #include "COMLibraryWrapper.h"
@@ -25,13 +26,18 @@
 #include "Hotkey.h"
 #include "IconHandleWrapper.h"
 #include "Log.h"
+#include "LogFormatters.h"
+#include "MappedFileWrapper.h"
 #include "MenuHandleWrapper.h"
+#include "MenuIcons.h"
 #include "Modifiers.h"
 #include "Path.h"
 #include "Resource.h"
 #include "Settings.h"
+#include "SettingsCache.h"
 #include "SettingsDialog.h"
 #include "StringUtility.h"
+#include "Switcher.h"
 #include "TrayIcon.h"
 #include "VirtualDesktop.h"
 #include "WinEventHookHandleWrapper.h"
@@ -46,6 +52,7 @@
 #include <Psapi.h>
 #include <WinUser.h>
 #include <Windows.h>
+#include <shellapi.h>
 
 // Standard library
 #include <cassert>
@@ -64,7 +71,8 @@ enum class HotkeyID : unsigned int
     MinimizeAll,
     Restore,
     RestoreAll,
-    Menu
+    Menu,
+    Switcher
 };
 
 LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -76,6 +84,7 @@ void minimizeWindow(HWND hwnd, MinimizePersistence minimizePersistence);
 void restoreAllWindows();
 void restoreWindow(HWND hwnd);
 void restoreLastWindow();
+void switchToWindow(HWND hwnd);
 void onAddWindow(HWND hwnd);
 void onMinimizeEvent(
     HWINEVENTHOOK hwineventhook,
@@ -87,13 +96,21 @@ void onMinimizeEvent(
     DWORD dwmsEventTime);
 bool readSettingsFromFile(const std::string & fileName, Settings & settings);
 bool writeSettingsToFile(const std::string & fileName, const Settings & settings);
+void writeSettingsCache(const std::string & fileName, const std::string & json, const Settings & settings);
 void showSettingsDialog();
 void toggleSettingsDialog();
 void onSettingsDialogComplete(bool success, const Settings & settings);
+std::string getImportFileName();
+void importAutoTrays(const std::string & fileName);
+void saveFlightRecorder();
 std::string getSettingsFileName();
+std::string getSettingsCacheFileName();
 std::string getStartupShortcutFullPath();
 void updateStartWithWindowsShortcut();
 
+// import reports can list thousands of issues, only show the first ones in message boxes
+constexpr size_t importReportIssuesMax_ = 20;
+
 alignas(4) const CHAR className_[] = APP_NAME "Class";
 alignas(4) const CHAR windowTitle_[] = APP_NAME;
 
@@ -102,11 +119,13 @@ TrayIcon trayIcon_;
 WindowHandleWrapper settingsDialogWindow_;
 bool contextMenuActive_;
 Settings settings_;
+bool settingsValidated_;
 Hotkey hotkeyMinimize_;
 Hotkey hotkeyMinimizeAll_;
 Hotkey hotkeyRestore_;
 Hotkey hotkeyRestoreAll_;
 Hotkey hotkeyMenu_;
+Hotkey hotkeySwitcher_;
 UINT modifiersOverride_;
 UINT taskbarCreatedMessage_;
 
@@ -138,11 +157,22 @@ int WINAPI wWinMain(_In_ HINSTANCE hinstance, _In_opt_ HINSTANCE hPrevInstance,
 
     INFO_PRINTF("launching %s %s (%s)\n", APP_NAME, APP_VERSION_STRING_SIMPLE, APP_DATE);
 
+    const std::string importFileName = getImportFileName();
+
     // check if already running
     HWND oldHwnd = FindWindowA(APP_NAME, nullptr);
     if (oldHwnd) {
         INFO_PRINTF("already running\n");
-        SendMessageA(oldHwnd, WM_SHOWSETTINGS, 0, 0);
+        if (importFileName.empty()) {
+            SendMessageA(oldHwnd, WM_SHOWSETTINGS, 0, 0);
+        } else {
+            // let the running instance do the import, it owns the settings
+            COPYDATASTRUCT copyData;
+            copyData.dwData = COPYDATA_IMPORT_AUTO_TRAY;
+            copyData.cbData = narrow_cast<DWORD>(importFileName.size() + 1);
+            copyData.lpData = const_cast<char *>(importFileName.c_str());
+            SendMessageA(oldHwnd, WM_COPYDATA, 0, reinterpret_cast<LPARAM>(&copyData));
+        }
         return 0;
     }
 
@@ -250,10 +280,10 @@ int WINAPI wWinMain(_In_ HINSTANCE hinstance, _In_opt_ HINSTANCE hPrevInstance,
         WINEVENT_OUTOFCONTEXT));
     if (!minimizeEventHook) {
         const std::string lastErrorString = StringUtility::lastErrorString();
-        ERROR_PRINTF(
-            "failed to hook minimize win event %#x, SetWinEventHook() failed: %s\n",
+        ERROR_LOG(
+            "failed to hook minimize win event for {}, SetWinEventHook() failed: {}\n",
             appWindow_.hwnd(),
-            lastErrorString.c_str());
+            lastErrorString);
         errorMessage(ErrorContext(IDS_ERROR_REGISTER_EVENTHOOK, lastErrorString));
         return IDS_ERROR_REGISTER_EVENTHOOK;
     }
@@ -271,14 +301,29 @@ int WINAPI wWinMain(_In_ HINSTANCE hinstance, _In_opt_ HINSTANCE hPrevInstance,
         }
     }
 
-    if (!WindowTracker::start(appWindow_, settings_.pollInterval_, onAddWindow)) {
+    // without the loader, icons are loaded when they're needed instead
+    WindowIcon::start(appWindow_);
+
+    if (!WindowTracker::start(appWindow_, settings_.pollInterval_, settings_.trayTipInterval_, onAddWindow)) {
         errorMessage(IDS_ERROR_START_WINDOW_TRACKER);
         return IDS_ERROR_START_WINDOW_TRACKER;
     }
 
+    if (!importFileName.empty()) {
+        importAutoTrays(importFileName);
+    }
+
     DEBUG_PRINTF("running message loop\n");
     MSG msg = {};
-    while (GetMessage(&msg, nullptr, 0, 0)) {
+    for (;;) {
+        // with nothing else to do, bring the menu up to date, so it shows as soon as it's asked for
+        if (!PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE)) {
+            ContextMenu::prebuild(settings_.minimizePlacement_);
+        }
+        if (!GetMessage(&msg, nullptr, 0, 0)) {
+            break;
+        }
+
         // needed to have working tab stops in the settings dialog
         if (settingsDialogWindow_ && IsDialogMessageA(settingsDialogWindow_, &msg)) {
             continue;
@@ -290,13 +335,36 @@ int WINAPI wWinMain(_In_ HINSTANCE hinstance, _In_opt_ HINSTANCE hPrevInstance,
     DEBUG_PRINTF("exiting\n");
 
     // if there are any minimized windows, restore them
+    std::vector<HWND> minimizedWindows;
+    WindowTracker::reverseEnumerate([&minimizedWindows](const WindowTracker::Item & item) {
+        if (item.minimized_) {
+            minimizedWindows.push_back(item.hwnd_);
+        }
+        return true;
+    });
     restoreAllWindows();
 
+    // windows left hidden are lost to the user, so keep a record of what led up to it
+    size_t hiddenCount = 0;
+    for (HWND hwnd : minimizedWindows) {
+        if (IsWindow(hwnd) && !isWindowUserVisible(hwnd)) {
+            ++hiddenCount;
+        }
+    }
+    if (hiddenCount) {
+        WARNING_PRINTF("%zu windows are still hidden at exit\n", hiddenCount);
+        static_cast<void>(Log::saveFlightRecorder());
+    }
+
     minimizeEventHook.destroy();
     trayIcon_.destroy();
     stop();
     VirtualDesktop::stop();
+    ContextMenu::stop();
+    MenuIcons::stop();
+    Switcher::stop();
     WindowTracker::stop();
+    WindowIcon::stop();
     settingsDialogWindow_.destroy();
     appWindow_.destroy();
 
@@ -339,6 +407,12 @@ LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     break;
                 }
 
+                case ContextMenu::IDM_SAVE_FLIGHT_RECORDER: {
+                    INFO_PRINTF("menu save recent log\n");
+                    saveFlightRecorder();
+                    break;
+                }
+
                 // exit the app
                 case ContextMenu::IDM_EXIT: {
                     INFO_PRINTF("menu exit\n");
@@ -425,6 +499,14 @@ LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     break;
                 }
 
+                case HotkeyID::Switcher: {
+                    INFO_PRINTF("hotkey switcher\n");
+                    if (!Switcher::show(switchToWindow)) {
+                        errorMessage(IDS_ERROR_CREATE_WINDOW);
+                    }
+                    break;
+                }
+
                 default: {
                     WARNING_PRINTF("invalid hotkey id %d\n", hkid);
                     break;
@@ -468,21 +550,21 @@ LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                             INFO_PRINTF("toggling settings dialog\n");
                             toggleSettingsDialog();
                         } else if (WindowTracker::isMinimized(hwndTray)) {
-                            INFO_PRINTF("restoring window from tray: %#x\n", hwndTray);
+                            INFO_LOG("restoring window from tray: {}\n", hwndTray);
                             restoreWindow(hwndTray);
                         } else {
-                            INFO_PRINTF("minimizing window to tray: %#x\n", hwndTray);
+                            INFO_LOG("minimizing window to tray: {}\n", hwndTray);
                             // must be persistent for this to happen
                             minimizeWindow(hwndTray, MinimizePersistence::None);
                         }
                     } else {
-                        WARNING_PRINTF("unknown tray icon id %#x\n", wParam);
+                        WARNING_LOG("unknown tray icon id {:#x}\n", wParam);
                     }
                     break;
                 }
 
                 default: {
-                    WARNING_PRINTF("unhandled WM_TRAYWINDOW message %x\n", lParam);
+                    WARNING_LOG("unhandled WM_TRAYWINDOW message {:#x}\n", lParam);
                     break;
                 }
             }
@@ -495,6 +577,31 @@ LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             break;
         }
 
+        // window icons loaded on the icon loader thread
+        case WM_ICONLOADED: {
+            WindowIcon::takeLoaded([](HWND hwnd, IconHandleWrapper && icon) {
+                WindowTracker::updateIcon(hwnd, std::move(icon));
+            });
+            break;
+        }
+
+        // import requested by another instance
+        case WM_COPYDATA: {
+            const COPYDATASTRUCT * copyData = reinterpret_cast<const COPYDATASTRUCT *>(lParam);
+            if (!copyData || (copyData->dwData != COPYDATA_IMPORT_AUTO_TRAY) || !copyData->lpData ||
+                !copyData->cbData) {
+                WARNING_PRINTF("ignoring unknown copy data\n");
+                return FALSE;
+            }
+
+            // the data is not necessarily nul terminated
+            const std::string fileName(
+                static_cast<const char *>(copyData->lpData),
+                strnlen(static_cast<const char *>(copyData->lpData), copyData->cbData));
+            importAutoTrays(fileName);
+            return TRUE;
+        }
+
         case WM_ENTERMENULOOP: {
             DEBUG_PRINTF("Context menu active\n");
             contextMenuActive_ = true;
@@ -506,18 +613,45 @@ LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             break;
         }
 
+        // the menu is up and waiting for the user
+        case WM_ENTERIDLE: {
+            if (wParam == MSGF_MENU) {
+                ContextMenu::shown();
+            }
+            break;
+        }
+
+        // the context menu's icons are drawn from the menu icon atlas
+        case WM_MEASUREITEM: {
+            if (MenuIcons::measure(*reinterpret_cast<MEASUREITEMSTRUCT *>(lParam))) {
+                return TRUE;
+            }
+            break;
+        }
+        case WM_DRAWITEM: {
+            if (MenuIcons::draw(*reinterpret_cast<const DRAWITEMSTRUCT *>(lParam))) {
+                return TRUE;
+            }
+            break;
+        }
+
         default: {
             if (uMsg == taskbarCreatedMessage_) {
                 INFO_PRINTF("taskbar created\n");
-                HINSTANCE hinstance = getInstance();
-                IconHandleWrapper icon(
-                    LoadIcon(hinstance, MAKEINTRESOURCE(IDI_FINESTRAY)),
-                    IconHandleWrapper::Mode::Referenced);
-                const ErrorContext err = trayIcon_.create(appWindow_, appWindow_, WM_TRAYWINDOW, std::move(icon));
+                ErrorContext err;
+                if (trayIcon_.created()) {
+                    err = trayIcon_.recreate();
+                } else {
+                    HINSTANCE hinstance = getInstance();
+                    IconHandleWrapper icon(
+                        LoadIcon(hinstance, MAKEINTRESOURCE(IDI_FINESTRAY)),
+                        IconHandleWrapper::Mode::Referenced);
+                    err = trayIcon_.create(appWindow_, appWindow_, WM_TRAYWINDOW, std::move(icon));
+                }
                 if (err) {
-                    ERROR_PRINTF("failed to create tray icon, TrayIcon::create() failed: %s\n", err.errorString().c_str());
+                    ERROR_PRINTF("failed to add tray icon again: %s\n", err.errorString().c_str());
                 }
-                WindowTracker::addAllMinimizedToTray(settings_.minimizePlacement_);
+                WindowTracker::recreateTrayIcons(settings_.minimizePlacement_);
             }
             break;
         }
@@ -528,7 +662,22 @@ LRESULT wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 ErrorContext start()
 {
-    Log::start(settings_.logToFile_, APP_NAME ".log");
+    Log::Options logOptions;
+    logOptions.level = settings_.logLevel_;
+    logOptions.overflow = settings_.logOverflow_;
+    logOptions.format = settings_.logFormat_;
+    logOptions.rotation.maxSize = settings_.logMaxSize_ * 1024ULL;
+    logOptions.rotation.maxAge = settings_.logMaxAge_ * 3600ULL;
+    logOptions.rotation.keep = settings_.logKeep_;
+    logOptions.rotation.compress = settings_.logCompress_;
+    logOptions.flightRecorder = settings_.logFlightRecorder_;
+    logOptions.flightLevel = settings_.logFlightRecorderLevel_;
+    logOptions.rateLimit = settings_.logRateLimit_;
+    logOptions.rateLimitWarning = settings_.logRateLimitWarning_;
+    logOptions.rateWindow = settings_.logRateWindow_;
+    logOptions.monotonicTimestamps = settings_.logMonotonicTimestamps_;
+    const bool binaryLog = settings_.logFormat_ == LogFormat::Binary;
+    Log::start(settings_.logToFile_, binaryLog ? APP_NAME ".binlog" : APP_NAME ".log", logOptions);
 
     DEBUG_PRINTF("starting\n");
 
@@ -617,6 +766,25 @@ ErrorContext start()
         }
     }
 
+    // register a hotkey that will be used to show the window switcher
+    UINT vkSwitcher = VK_END;
+    UINT modifiersSwitcher = MOD_ALT | MOD_CONTROL | MOD_SHIFT;
+    if (!Hotkey::parse(settings_.hotkeySwitcher_, vkSwitcher, modifiersSwitcher)) {
+        return { IDS_ERROR_PARSE_HOTKEY, "switcher" };
+    }
+    if (!vkSwitcher || !modifiersSwitcher) {
+        INFO_PRINTF("no hotkey to show window switcher\n");
+    } else {
+        DEBUG_PRINTF("registering hotkey to show window switcher\n");
+        if (!hotkeySwitcher_.create(
+                static_cast<INT>(HotkeyID::Switcher),
+                appWindow_,
+                vkSwitcher,
+                modifiersSwitcher | MOD_NOREPEAT)) {
+            return { IDS_ERROR_REGISTER_HOTKEY, "switcher" };
+        }
+    }
+
     // get modifiers that will be used to override auto-tray
     UINT vkOverride = 0;
     modifiersOverride_ = MOD_ALT | MOD_CONTROL | MOD_SHIFT;
@@ -633,13 +801,16 @@ ErrorContext start()
         return { IDS_ERROR_REGISTER_MODIFIER, "override" };
     }
 
-    // check auto-tray regular expressions to surface an error if needed
-    for (const Settings::AutoTray & autoTray : settings_.autoTrays_) {
-        try {
-            const std::regex re(autoTray.windowTitle_);
-            static_cast<void>(re);
-        } catch (const std::regex_error & e) {
-            return { IDS_ERROR_PARSE_REGEX, "'" + autoTray.windowTitle_ + "': " + e.what() };
+    // check auto-tray regular expressions to surface an error if needed,
+    // settings read from the cache were already checked when it was written
+    if (!settingsValidated_) {
+        for (const Settings::AutoTray & autoTray : settings_.autoTrays_) {
+            try {
+                const std::regex re(autoTray.windowTitle_);
+                static_cast<void>(re);
+            } catch (const std::regex_error & e) {
+                return { IDS_ERROR_PARSE_REGEX, "'" + autoTray.windowTitle_ + "': " + e.what() };
+            }
         }
     }
 
@@ -655,6 +826,7 @@ void stop() noexcept
     hotkeyMinimize_.destroy();
     hotkeyMinimizeAll_.destroy();
     hotkeyMenu_.destroy();
+    hotkeySwitcher_.destroy();
 }
 
 bool windowShouldAutoTray(HWND hwnd, TrayEvent trayEvent, MinimizePersistence * minimizePersistence)
@@ -747,7 +919,7 @@ void minimizeAllWindows()
 
     WindowTracker::enumerate([&windowsToMinimize](const WindowTracker::Item & item) {
         if (item.visible_ && !item.minimized_) {
-            DEBUG_PRINTF("minimizing window: %#x\n", item.hwnd_);
+            DEBUG_LOG("minimizing window: {}\n", item.hwnd_);
             windowsToMinimize.push_back(item.hwnd_);
         }
         return true;
@@ -769,7 +941,7 @@ void restoreAllWindows()
 
     WindowTracker::reverseEnumerate([&windowsToRestore](const WindowTracker::Item & item) {
         if (item.minimized_) {
-            DEBUG_PRINTF("restoring window: %#x\n", item.hwnd_);
+            DEBUG_LOG("restoring window: {}\n", item.hwnd_);
             windowsToRestore.push_back(item.hwnd_);
         }
         return true;
@@ -791,7 +963,7 @@ void restoreLastWindow()
 
     WindowTracker::reverseEnumerate([&hwnd](const WindowTracker::Item & item) {
         if (item.minimized_) {
-            DEBUG_PRINTF("restoring last minimized window: %#x\n", item.hwnd_);
+            DEBUG_LOG("restoring last minimized window: {}\n", item.hwnd_);
             hwnd = item.hwnd_;
             return false; // stop enumerating
         }
@@ -803,9 +975,26 @@ void restoreLastWindow()
     }
 }
 
+// Switches to a window picked in the switcher, taking it out of the tray if
+// it was minimized there.
+void switchToWindow(HWND hwnd)
+{
+    if (WindowTracker::isMinimized(hwnd)) {
+        restoreWindow(hwnd);
+        return;
+    }
+
+    if (IsIconic(hwnd)) {
+        // return value intentionally ignored, ShowWindow returns previous visibility
+        ShowWindow(hwnd, SW_RESTORE);
+    }
+    // return value intentionally ignored, SetForegroundWindow returns whether brought to foreground
+    SetForegroundWindow(hwnd);
+}
+
 void onAddWindow(HWND hwnd)
 {
-    DEBUG_PRINTF("added window: %#x\n", hwnd);
+    DEBUG_LOG("added window: {}\n", hwnd);
 
     MinimizePersistence minimizePersistence = MinimizePersistence::None;
     if (windowShouldAutoTray(hwnd, TrayEvent::Open, &minimizePersistence)) {
@@ -833,11 +1022,11 @@ void onMinimizeEvent(
     }
 
     if (!isWindowUserVisible(hwnd)) {
-        DEBUG_PRINTF("minimize event: ignoring invisible window: %#x\n", hwnd);
+        DEBUG_LOG("minimize event: ignoring invisible window: {}\n", hwnd);
         return;
     }
 
-    DEBUG_PRINTF("minimize event: hwnd %#x\n", hwnd);
+    DEBUG_LOG("minimize event: hwnd {}\n", hwnd);
     MinimizePersistence minimizePersistence = MinimizePersistence::None;
     if (!windowShouldAutoTray(hwnd, TrayEvent::Minimize, &minimizePersistence)) {
         if (modifiersActive(modifiersOverride_)) {
@@ -864,7 +1053,26 @@ bool readSettingsFromFile(const std::string & fileName, Settings & settings)
         return false;
     }
 
-    return settings.fromJSON(json);
+    // the settings cache is only used if it was written from this exact JSON file
+    unsigned long long size = 0;
+    unsigned long long writeTime = 0;
+    if (fileGetInfo(pathJoin(writeableDir, fileName), size, writeTime)) {
+        const std::string cacheFullPath = pathJoin(writeableDir, getSettingsCacheFileName());
+        const MappedFileWrapper cache(cacheFullPath);
+        if (cache && SettingsCache::decode(cache.data(), SettingsCache::source(json.c_str(), size, writeTime), settings)) {
+            DEBUG_PRINTF("read settings from cache '%s'\n", cacheFullPath.c_str());
+            settingsValidated_ = true;
+            return true;
+        }
+    }
+
+    if (!settings.fromJSON(json)) {
+        return false;
+    }
+
+    writeSettingsCache(fileName, json.c_str(), settings);
+
+    return true;
 }
 
 bool writeSettingsToFile(const std::string & fileName, const Settings & settings)
@@ -882,7 +1090,41 @@ bool writeSettingsToFile(const std::string & fileName, const Settings & settings
     }
 
     const std::string writeableDir = getWriteableDir();
-    return fileWrite(pathJoin(writeableDir, fileName), json);
+    if (!fileWrite(pathJoin(writeableDir, fileName), json)) {
+        return false;
+    }
+
+    writeSettingsCache(fileName, json, settings);
+
+    return true;
+}
+
+void writeSettingsCache(const std::string & fileName, const std::string & json, const Settings & settings)
+{
+    const std::string writeableDir = getWriteableDir();
+    const std::string cacheFullPath = pathJoin(writeableDir, getSettingsCacheFileName());
+
+    // an invalid settings file still gets reported on every start, so don't cache it
+    if (!settings.valid()) {
+        if (fileExists(cacheFullPath)) {
+            fileDelete(cacheFullPath);
+        }
+        return;
+    }
+
+    unsigned long long size = 0;
+    unsigned long long writeTime = 0;
+    if (!fileGetInfo(pathJoin(writeableDir, fileName), size, writeTime)) {
+        WARNING_PRINTF("could not get settings file info, not writing settings cache\n");
+        return;
+    }
+
+    const std::string cache = SettingsCache::encode(settings, SettingsCache::source(json, size, writeTime));
+    if (!fileWrite(cacheFullPath, cache)) {
+        WARNING_PRINTF("failed to write settings cache '%s'\n", cacheFullPath.c_str());
+    } else {
+        DEBUG_PRINTF("wrote settings cache '%s'\n", cacheFullPath.c_str());
+    }
 }
 
 void showSettingsDialog()
@@ -919,6 +1161,7 @@ void onSettingsDialogComplete(bool success, const Settings & settings)
         if (!settings.valid()) {
             WARNING_PRINTF("invalid settings\n");
             settings_ = settings;
+            settingsValidated_ = false;
             settings_.dump();
 
             // restart to trigger error message
@@ -939,6 +1182,7 @@ void onSettingsDialogComplete(bool success, const Settings & settings)
         if (settingsChanged || !Settings::fileExists(settingsFile)) {
             if (settingsChanged) {
                 settings_ = settings;
+                settingsValidated_ = false;
                 DEBUG_PRINTF("got updated settings from dialog:\n");
                 settings_.normalize();
                 settings_.dump();
@@ -971,11 +1215,121 @@ void onSettingsDialogComplete(bool success, const Settings & settings)
     settingsDialogWindow_.destroy();
 }
 
+// the file name following --import-auto-tray on the command line, as a full path
+std::string getImportFileName()
+{
+    int argc = 0;
+    LPWSTR * argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) {
+        WARNING_PRINTF("CommandLineToArgvW() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return {};
+    }
+
+    std::string fileName;
+    for (int i = 1; (i + 1) < argc; ++i) {
+        if (!wcscmp(argv[i], L"--import-auto-tray")) {
+            WCHAR fullPath[MAX_PATH] = {};
+            if (!GetFullPathNameW(argv[i + 1], MAX_PATH, fullPath, nullptr)) {
+                WARNING_PRINTF("GetFullPathNameW() failed: %s\n", StringUtility::lastErrorString().c_str());
+            } else {
+                fileName = StringUtility::wideStringToString(fullPath);
+            }
+            break;
+        }
+    }
+
+    if (LocalFree(argv)) {
+        WARNING_PRINTF("LocalFree() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+
+    return fileName;
+}
+
+// Imports auto-tray items from a JSON or CSV file. The imported items are
+// validated together with the existing ones, and nothing is changed unless
+// they are all valid.
+void importAutoTrays(const std::string & fileName)
+{
+    INFO_PRINTF("importing auto-tray items from '%s'\n", fileName.c_str());
+
+    // the dialog has its own copy of the settings that would overwrite the import
+    if (settingsDialogWindow_) {
+        errorMessage(ErrorContext(IDS_ERROR_IMPORT_AUTO_TRAY, "the settings dialog is open"));
+        showSettingsDialog();
+        return;
+    }
+
+    const std::string contents = fileRead(fileName);
+    if (contents.empty()) {
+        errorMessage(ErrorContext(IDS_ERROR_IMPORT_AUTO_TRAY, fileName));
+        return;
+    }
+
+    std::vector<Settings::AutoTray> autoTrays = settings_.autoTrays_;
+    const size_t existingCount = autoTrays.size();
+    std::string parseError;
+    const bool parsed = StringUtility::toLower(fileName).ends_with(".csv")
+        ? AutoTrayValidator::parseCsv(contents, autoTrays, parseError)
+        : Settings::autoTraysFromJSON(contents, autoTrays);
+    if (!parsed) {
+        errorMessage(ErrorContext(IDS_ERROR_IMPORT_AUTO_TRAY, parseError.empty() ? fileName : fileName + ": " + parseError));
+        return;
+    }
+
+    const AutoTrayValidator::Report report = AutoTrayValidator::validate(autoTrays);
+    INFO_PRINTF(
+        "validated %zu existing and %zu imported auto-tray items:\n%s",
+        existingCount,
+        autoTrays.size() - existingCount,
+        report.toString().c_str());
+    if (!report.ok()) {
+        errorMessage(ErrorContext(IDS_ERROR_IMPORT_AUTO_TRAY, "\n" + report.toString(importReportIssuesMax_)));
+        return;
+    }
+
+    Settings settings = settings_;
+    settings.autoTrays_ = AutoTrayValidator::withoutDuplicates(autoTrays, report);
+    settings.normalize();
+
+    // only commit once the settings are safely written
+    const std::string settingsFile = getSettingsFileName();
+    if (!writeSettingsToFile(settingsFile, settings)) {
+        errorMessage(ErrorContext(IDS_ERROR_SAVE_SETTINGS, settingsFile));
+        return;
+    }
+    settings_ = std::move(settings);
+
+    const std::string message =
+        getResourceString(IDS_IMPORT_AUTO_TRAY_COMPLETE) + "\n" + report.toString(importReportIssuesMax_);
+    if (!MessageBoxA(nullptr, message.c_str(), APP_NAME, MB_OK | MB_ICONINFORMATION)) {
+        WARNING_PRINTF("failed to display import report, MessageBoxA() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+}
+
+void saveFlightRecorder()
+{
+    const std::string path = Log::saveFlightRecorder();
+    if (path.empty()) {
+        errorMessage(ErrorContext(IDS_ERROR_SAVE_FLIGHT_RECORDER, getWriteableDir()));
+        return;
+    }
+
+    const std::string message = getResourceString(IDS_SAVED_FLIGHT_RECORDER) + "\n" + path;
+    if (!MessageBoxA(nullptr, message.c_str(), APP_NAME, MB_OK | MB_ICONINFORMATION)) {
+        WARNING_PRINTF("failed to display message, MessageBoxA() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+}
+
 std::string getSettingsFileName()
 {
     return std::string(APP_NAME) + ".json";
 }
 
+std::string getSettingsCacheFileName()
+{
+    return std::string(APP_NAME) + ".cache";
+}
+
 std::string getStartupShortcutFullPath()
 {
     const std::string startupDir = getStartupDir();
@@ -0,0 +1,263 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "Gzip.h"
+
+// Standard library
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+
+// NOLINTBEGIN(*-magic-numbers)
+
+constexpr size_t windowSize_ = 32768;
+constexpr size_t hashBits_ = 15;
+constexpr size_t matchMin_ = 3;
+constexpr size_t matchMax_ = 258;
+constexpr unsigned int chainMax_ = 64; // candidates tried per position, trades speed for size
+constexpr size_t none_ = ~size_t { 0 };
+
+struct Code
+{
+    std::uint16_t base;
+    std::uint8_t extraBits;
+};
+
+// deflate length codes 257 to 285
+constexpr std::array<Code, 29> lengthCodes_ { {
+    { 3, 0 },   { 4, 0 },   { 5, 0 },   { 6, 0 },   { 7, 0 },   { 8, 0 },   { 9, 0 },   { 10, 0 },
+    { 11, 1 },  { 13, 1 },  { 15, 1 },  { 17, 1 },  { 19, 2 },  { 23, 2 },  { 27, 2 },  { 31, 2 },
+    { 35, 3 },  { 43, 3 },  { 51, 3 },  { 59, 3 },  { 67, 4 },  { 83, 4 },  { 99, 4 },  { 115, 4 },
+    { 131, 5 }, { 163, 5 }, { 195, 5 }, { 227, 5 }, { 258, 0 },
+} };
+
+// deflate distance codes 0 to 29
+constexpr std::array<Code, 30> distanceCodes_ { {
+    { 1, 0 },     { 2, 0 },     { 3, 0 },      { 4, 0 },      { 5, 1 },      { 7, 1 },
+    { 9, 2 },     { 13, 2 },    { 17, 3 },     { 25, 3 },     { 33, 4 },     { 49, 4 },
+    { 65, 5 },    { 97, 5 },    { 129, 6 },    { 193, 6 },    { 257, 7 },    { 385, 7 },
+    { 513, 8 },   { 769, 8 },   { 1025, 9 },   { 1537, 9 },   { 2049, 10 },  { 3073, 10 },
+    { 4097, 11 }, { 6145, 11 }, { 8193, 12 },  { 12289, 12 }, { 16385, 13 }, { 24577, 13 },
+} };
+
+constexpr std::array<std::uint32_t, 256> crcTable_ = [] {
+    std::array<std::uint32_t, 256> table {};
+    for (std::uint32_t i = 0; i < table.size(); ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320U) : (crc >> 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+// deflate packs bits starting at the least significant bit of each byte
+class BitWriter
+{
+public:
+    explicit BitWriter(std::string & out) noexcept
+        : out_(out)
+    {
+    }
+
+    void bits(std::uint32_t value, unsigned int count)
+    {
+        buffer_ |= static_cast<std::uint64_t>(value) << count_;
+        count_ += count;
+        while (count_ >= 8) {
+            out_ += static_cast<char>(buffer_ & 0xff);
+            buffer_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    // Huffman codes are stored starting at their most significant bit
+    void code(std::uint32_t value, unsigned int count)
+    {
+        std::uint32_t reversed = 0;
+        for (unsigned int i = 0; i < count; ++i) {
+            reversed = (reversed << 1) | ((value >> i) & 1);
+        }
+        bits(reversed, count);
+    }
+
+    void finish()
+    {
+        if (count_) {
+            out_ += static_cast<char>(buffer_ & 0xff);
+        }
+        buffer_ = 0;
+        count_ = 0;
+    }
+
+private:
+    std::string & out_;
+    std::uint64_t buffer_ {};
+    unsigned int count_ {};
+};
+
+// the fixed literal and length codes
+void symbol(BitWriter & writer, unsigned int value)
+{
+    if (value < 144) {
+        writer.code(0x30 + value, 8);
+    } else if (value < 256) {
+        writer.code(0x190 + (value - 144), 9);
+    } else if (value < 280) {
+        writer.code(value - 256, 7);
+    } else {
+        writer.code(0xc0 + (value - 280), 8);
+    }
+}
+
+template <size_t Size>
+unsigned int findCode(const std::array<Code, Size> & codes, size_t value) noexcept
+{
+    const auto it = std::upper_bound(
+        codes.begin(),
+        codes.end(),
+        value,
+        [](size_t v, const Code & code) { return v < code.base; });
+    return static_cast<unsigned int>(it - codes.begin() - 1);
+}
+
+void match(BitWriter & writer, size_t length, size_t distance)
+{
+    const unsigned int lengthCode = findCode(lengthCodes_, length);
+    symbol(writer, 257 + lengthCode);
+    writer.bits(static_cast<std::uint32_t>(length - lengthCodes_[lengthCode].base), lengthCodes_[lengthCode].extraBits);
+
+    const unsigned int distanceCode = findCode(distanceCodes_, distance);
+    writer.code(distanceCode, 5);
+    writer.bits(
+        static_cast<std::uint32_t>(distance - distanceCodes_[distanceCode].base),
+        distanceCodes_[distanceCode].extraBits);
+}
+
+size_t hash(const std::string_view & data, size_t position) noexcept
+{
+    const auto byte = [&data](size_t i) { return static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i])); };
+    const std::uint32_t value = byte(position) | (byte(position + 1) << 8) | (byte(position + 2) << 16);
+    return (value * 2654435761U) >> (32 - hashBits_);
+}
+
+void putLittleEndian(std::string & out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>((value >> (i * 8)) & 0xff);
+    }
+}
+
+// NOLINTEND(*-magic-numbers)
+
+} // anonymous namespace
+
+namespace Gzip
+{
+
+std::uint32_t crc32(std::string_view data, std::uint32_t crc) noexcept
+{
+    crc = ~crc;
+    for (const char c : data) {
+        crc = crcTable_[(crc ^ static_cast<std::uint8_t>(c)) & 0xffU] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::string compress(std::string_view data)
+{
+    // header: magic, deflate, no flags, no time, no extra flags, unknown OS
+    std::string out { "\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10 };
+    out.reserve(out.size() + (data.size() / 4) + 64);
+
+    BitWriter writer(out);
+    writer.bits(1, 1); // final block
+    writer.bits(1, 2); // fixed codes
+
+    std::vector<size_t> head(size_t { 1 } << hashBits_, none_);
+    std::vector<size_t> previous(windowSize_, none_);
+    const auto insert = [&](size_t position) {
+        const size_t h = hash(data, position);
+        previous[position & (windowSize_ - 1)] = head[h];
+        head[h] = position;
+    };
+
+    size_t position = 0;
+    while (position < data.size()) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+
+        if ((data.size() - position) >= matchMin_) {
+            const size_t lengthMax = std::min(matchMax_, data.size() - position);
+            size_t candidate = head[hash(data, position)];
+            for (unsigned int tries = 0; (candidate != none_) && (tries < chainMax_); ++tries) {
+                if ((position - candidate) > windowSize_) {
+                    break;
+                }
+
+                size_t length = 0;
+                while ((length < lengthMax) && (data[candidate + length] == data[position + length])) {
+                    ++length;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = position - candidate;
+                    if (length == lengthMax) {
+                        break;
+                    }
+                }
+
+                // entries for positions that have left the window may have been reused
+                const size_t next = previous[candidate & (windowSize_ - 1)];
+                if ((next == none_) || (next >= candidate)) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+
+        if (bestLength >= matchMin_) {
+            match(writer, bestLength, bestDistance);
+            const size_t end = position + bestLength;
+            for (; position < end; ++position) {
+                if ((position + matchMin_) <= data.size()) {
+                    insert(position);
+                }
+            }
+        } else {
+            symbol(writer, static_cast<std::uint8_t>(data[position]));
+            if ((position + matchMin_) <= data.size()) {
+                insert(position);
+            }
+            ++position;
+        }
+    }
+
+    symbol(writer, 256); // end of block
+    writer.finish();
+
+    // trailer: checksum and size of the uncompressed data
+    putLittleEndian(out, crc32(data));
+    putLittleEndian(out, static_cast<std::uint32_t>(data.size()));
+
+    return out;
+}
+
+} // namespace Gzip
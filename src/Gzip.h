@@ -0,0 +1,33 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A small gzip (RFC 1952) compressor for rotated log files. It finds repeats
+// with a hash chain and encodes them with the fixed deflate codes, which is
+// much simpler than a full deflate and still compresses logs several times
+// over. The output can be opened with any gzip tool.
+namespace Gzip
+{
+
+std::uint32_t crc32(std::string_view data, std::uint32_t crc = 0) noexcept;
+
+std::string compress(std::string_view data);
+
+} // namespace Gzip
@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -51,7 +52,7 @@ public:
     {
         if (handle_ != INVALID_HANDLE_VALUE) {
             if (!CloseHandle(handle_)) {
-                WARNING_PRINTF("failed to close handle %#x: %lu\n", handle_, GetLastError());
+                WARNING_LOG("failed to close handle {}: {}\n", handle_, GetLastError());
                 return;
             }
 
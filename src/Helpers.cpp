@@ -16,6 +16,7 @@
 #include "Helpers.h"
 #include "AppInfo.h"
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -94,7 +95,7 @@ void errorMessage(const ErrorContext & errorContext)
         err += ": " + errorContext.errorString();
     }
 
-    ERROR_PRINTF("%s\n", err.c_str());
+    ERROR_LOG("{}\n", errorContext);
     if (!MessageBoxA(nullptr, err.c_str(), APP_NAME, MB_OK | MB_ICONERROR)) {
         WARNING_PRINTF(
             "failed to display error message %#x, MessageBoxA() failed: %s\n",
@@ -0,0 +1,105 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// App
+#include "IconAtlas.h"
+
+// Standard library
+#include <cassert>
+
+IconAtlas::IconAtlas(size_t cellCount)
+    : cells_(cellCount)
+{
+    clear();
+}
+
+bool IconAtlas::acquire(Key key, size_t & cell, bool & draw)
+{
+    const auto found = index_.find(key);
+    if (found != index_.end()) {
+        cell = found->second;
+        Cell & held = cells_[cell];
+        if (!held.holds) {
+            idle_.erase(held.idle);
+        }
+        ++held.holds;
+        ++hits_;
+        draw = false;
+        return true;
+    }
+
+    if (idle_.empty()) {
+        ++full_;
+        return false;
+    }
+
+    cell = idle_.front();
+    idle_.pop_front();
+    Cell & taken = cells_[cell];
+    if (taken.keyed) {
+        index_.erase(taken.key);
+        ++evictions_;
+    }
+    taken.key = key;
+    taken.keyed = true;
+    taken.forget = false;
+    taken.holds = 1;
+    index_.emplace(key, cell);
+    ++draws_;
+    draw = true;
+    return true;
+}
+
+void IconAtlas::release(size_t cell, bool forget) noexcept
+{
+    Cell & held = cells_[cell];
+    assert(held.holds);
+    held.forget = held.forget || forget;
+    if (--held.holds) {
+        return;
+    }
+
+    // a forgotten cell is as good as a new one, so it's taken before any with an icon
+    if (held.forget) {
+        index_.erase(held.key);
+        held.keyed = false;
+        held.forget = false;
+        held.idle = idle_.insert(idle_.begin(), cell);
+    } else {
+        held.idle = idle_.insert(idle_.end(), cell);
+    }
+}
+
+void IconAtlas::clear()
+{
+    index_.clear();
+    idle_.clear();
+    for (size_t cell = 0; cell < cells_.size(); ++cell) {
+        cells_[cell] = {};
+        cells_[cell].idle = idle_.insert(idle_.end(), cell);
+    }
+}
+
+IconAtlas::Statistics IconAtlas::statistics() const noexcept
+{
+    Statistics statistics;
+    statistics.hits = hits_;
+    statistics.draws = draws_;
+    statistics.evictions = evictions_;
+    statistics.full = full_;
+    statistics.size = index_.size();
+    statistics.held = cells_.size() - idle_.size();
+    return statistics;
+}
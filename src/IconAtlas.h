@@ -0,0 +1,96 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Hands out the cells of an atlas, one image holding many icons of the same
+// size, so each icon is drawn once into its cell and shown from there rather
+// than being a bitmap of its own. Cells are keyed by the icon drawn in them,
+// and counted by the users holding them, so every user of an icon shares its
+// cell.
+//
+// A cell no one holds keeps its icon, in case it's wanted again, until the
+// cell is needed for another icon, least recently released first. Cells that
+// were never used, or were forgotten, are handed out before any of those.
+// The number of cells is fixed, which caps the size of the image, so once
+// every cell is held there's no room for another icon.
+//
+// This is only used from one thread.
+class IconAtlas
+{
+public:
+    using Key = std::uint64_t;
+
+    struct Statistics
+    {
+        std::uint64_t hits {}; // the icon was already drawn
+        std::uint64_t draws {};
+        std::uint64_t evictions {}; // a released icon's cell was taken for another
+        std::uint64_t full {}; // every cell was held
+        size_t size {}; // cells with an icon
+        size_t held {};
+    };
+
+    explicit IconAtlas(size_t cellCount);
+
+    // Holds the cell with the key's icon, until it's released. If the key
+    // has no cell, one is taken for it and draw is set, the caller must draw
+    // the icon into it. Returns false if every cell is held.
+    bool acquire(Key key, size_t & cell, bool & draw);
+
+    // Lets go of a hold on a cell. Forgetting it drops its icon once no one
+    // holds it, for an icon that may not be the same the next time its key is
+    // acquired.
+    void release(size_t cell, bool forget = false) noexcept;
+
+    // forgets every icon, and lets go of every cell, for when they all need drawing again
+    void clear();
+
+    [[nodiscard]]
+    size_t cellCount() const noexcept
+    {
+        return cells_.size();
+    }
+
+    [[nodiscard]]
+    Statistics statistics() const noexcept;
+
+private:
+    using Idle = std::list<size_t>; // cells no one holds, the next to take first
+
+    struct Cell
+    {
+        Key key {};
+        bool keyed {};
+        bool forget {};
+        size_t holds {};
+        Idle::iterator idle; // while no one holds it
+    };
+
+    std::vector<Cell> cells_;
+    Idle idle_;
+    std::unordered_map<Key, size_t> index_;
+    std::uint64_t hits_ {};
+    std::uint64_t draws_ {};
+    std::uint64_t evictions_ {};
+    std::uint64_t full_ {};
+};
@@ -0,0 +1,192 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Keeps window icons so they're only rendered once for each app, rather than
+// every time a window is minimized or the menu is shown. Icons are keyed by
+// the app's identity, its AppUserModelID, and the DPI they were rendered for.
+//
+// Icons are handed out as shared pointers, so a tray icon or menu using one
+// keeps it alive, and the same icon is shared by every window of the app. The
+// number of icons kept is capped, to limit the GDI objects used. When there
+// are too many, the least recently used icons that aren't in use are
+// dropped. Icons in use aren't dropped, since that wouldn't free anything,
+// and the next window of the app would render another copy.
+//
+// Icons can be inserted ahead of being needed, prefetched, and the first
+// find of each counts as a prefetch hit, to tell whether that's worthwhile.
+//
+// Handle is the owning wrapper for an icon, or a bitmap of one, which destroys
+// it when the last pointer to it is gone. This is only used from one thread.
+template <typename Handle>
+class IconCache
+{
+public:
+    using Shared = std::shared_ptr<const Handle>;
+
+    struct Key
+    {
+        std::wstring identity; // AppUserModelID
+        unsigned int dpi {};
+
+        bool operator==(const Key & other) const = default;
+    };
+
+    struct Statistics
+    {
+        std::uint64_t hits {};
+        std::uint64_t misses {};
+        std::uint64_t evictions {};
+        size_t size {};
+        size_t inUse {}; // shared with a tray icon or menu
+        std::uint64_t prefetches {};
+        std::uint64_t prefetchHits {}; // prefetched icons found before being dropped
+    };
+
+    explicit IconCache(size_t capacity) noexcept
+        : capacity_(capacity)
+    {
+    }
+
+    ~IconCache() = default;
+    IconCache(const IconCache &) = delete;
+    IconCache(IconCache &&) = delete;
+    IconCache & operator=(const IconCache &) = delete;
+    IconCache & operator=(IconCache &&) = delete;
+
+    // the icon for the key, or null if it's not cached, which counts as a miss
+    Shared find(const Key & key)
+    {
+        const auto found = index_.find(key);
+        if (found == index_.end()) {
+            ++misses_;
+            return {};
+        }
+
+        ++hits_;
+        if (found->second->prefetched) {
+            found->second->prefetched = false;
+            ++prefetchHits_;
+        }
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return found->second->icon;
+    }
+
+    // whether the key is cached, without counting it or making it recently used
+    [[nodiscard]]
+    bool contains(const Key & key) const
+    {
+        return index_.contains(key);
+    }
+
+    // caches an icon, replacing any for the same key, and drops old ones if there are too many
+    void insert(const Key & key, const Shared & icon, bool prefetched = false)
+    {
+        if (!icon || !capacity_) {
+            return;
+        }
+
+        if (prefetched) {
+            ++prefetches_;
+        }
+
+        const auto found = index_.find(key);
+        if (found != index_.end()) {
+            found->second->icon = icon;
+            found->second->prefetched = prefetched;
+            entries_.splice(entries_.begin(), entries_, found->second);
+            return;
+        }
+
+        entries_.push_front({ key, icon, prefetched });
+        index_.emplace(key, entries_.begin());
+        trim();
+    }
+
+    // drops every icon, those in use stay alive until they're released
+    void clear() noexcept
+    {
+        index_.clear();
+        entries_.clear();
+    }
+
+    [[nodiscard]]
+    Statistics statistics() const noexcept
+    {
+        Statistics statistics;
+        statistics.hits = hits_;
+        statistics.misses = misses_;
+        statistics.evictions = evictions_;
+        statistics.prefetches = prefetches_;
+        statistics.prefetchHits = prefetchHits_;
+        statistics.size = entries_.size();
+        for (const Entry & entry : entries_) {
+            if (entry.icon.use_count() > 1) {
+                ++statistics.inUse;
+            }
+        }
+        return statistics;
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Shared icon;
+        bool prefetched {}; // and not found since
+    };
+
+    using Entries = std::list<Entry>; // most recently used first
+
+    struct KeyHash
+    {
+        size_t operator()(const Key & key) const noexcept
+        {
+            return std::hash<std::wstring>()(key.identity) ^ (std::hash<unsigned int>()(key.dpi) << 1);
+        }
+    };
+
+    void trim() noexcept
+    {
+        auto it = entries_.end();
+        while ((entries_.size() > capacity_) && (it != entries_.begin())) {
+            --it;
+            if (it->icon.use_count() > 1) {
+                continue;
+            }
+            index_.erase(it->key);
+            it = entries_.erase(it);
+            ++evictions_;
+        }
+    }
+
+    size_t capacity_;
+    Entries entries_;
+    std::unordered_map<Key, typename Entries::iterator, KeyHash> index_;
+    std::uint64_t hits_ {};
+    std::uint64_t misses_ {};
+    std::uint64_t evictions_ {};
+    std::uint64_t prefetches_ {};
+    std::uint64_t prefetchHits_ {};
+};
@@ -16,11 +16,16 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
 #include <Windows.h>
 
+// Standard library
+#include <memory>
+#include <utility>
+
 class IconHandleWrapper
 {
 public:
@@ -37,10 +42,18 @@ public:
         , mode_(mode)
     {
         if (!hicon_) {
-            ERROR_PRINTF("invalid icon handle: %#x\n", hicon);
+            ERROR_LOG("invalid icon handle: {}\n", hicon);
         }
     }
 
+    // uses an icon owned by someone else, such as a cache, keeping it alive while this exists
+    explicit IconHandleWrapper(std::shared_ptr<const IconHandleWrapper> shared) noexcept
+        : hicon_(shared ? static_cast<HICON>(*shared) : nullptr)
+        , mode_(Mode::Referenced)
+        , shared_(std::move(shared))
+    {
+    }
+
     ~IconHandleWrapper()
     {
         if (hicon_ && (mode_ == Mode::Created)) {
@@ -56,8 +69,15 @@ public:
 
     IconHandleWrapper & operator=(IconHandleWrapper && other) noexcept
     {
+        // an icon of our own being replaced is destroyed, like on destruction
+        if (hicon_ && (mode_ == Mode::Created) && (hicon_ != other.hicon_)) {
+            if (!DestroyIcon(hicon_)) {
+                WARNING_PRINTF("DestroyIcon() failed: %lu\n", GetLastError());
+            }
+        }
         hicon_ = other.hicon_;
         mode_ = other.mode_;
+        shared_ = std::move(other.shared_);
         other.hicon_ = nullptr;
         other.mode_ = Mode::Referenced;
         return *this;
@@ -72,4 +92,5 @@ public:
 private:
     HICON hicon_ {};
     Mode mode_ {};
+    std::shared_ptr<const IconHandleWrapper> shared_;
 };
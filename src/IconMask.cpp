@@ -0,0 +1,152 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "IconMask.h"
+
+// Standard library
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ICON_MASK_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define ICON_MASK_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+constexpr std::uint8_t opaqueAlpha_ = 128;
+constexpr size_t bytesPerPixel_ = 4;
+constexpr size_t alphaOffset_ = 3;
+
+#if defined(ICON_MASK_SSE2)
+
+constexpr std::uint8_t reverseBits(std::uint8_t value) noexcept
+{
+    std::uint8_t reversed = 0;
+    for (int bit = 0; bit < 8; ++bit) {
+        reversed = static_cast<std::uint8_t>((reversed << 1) | ((value >> bit) & 1));
+    }
+    return reversed;
+}
+
+struct ReversedBits
+{
+    std::uint8_t values[256];
+
+    constexpr ReversedBits() noexcept
+        : values()
+    {
+        for (int value = 0; value < 256; ++value) {
+            values[value] = reverseBits(static_cast<std::uint8_t>(value));
+        }
+    }
+};
+
+constexpr ReversedBits reversedBits_;
+
+// the mask bits of sixteen pixels, first pixel in the high bit of the first byte
+void maskSixteen(const std::uint8_t * pixels, std::uint8_t * mask) noexcept
+{
+    // move each alpha to the bottom of its pixel, and pack them into bytes, in order
+    const __m128i a0 = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)), 24);
+    const __m128i a1 = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 16)), 24);
+    const __m128i a2 = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 32)), 24);
+    const __m128i a3 = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 48)), 24);
+    const __m128i alpha = _mm_packus_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(a2, a3));
+
+    // an alpha of at least 128 has its high bit set, which movemask gathers, first pixel in the low bit
+    const auto opaque = static_cast<unsigned int>(_mm_movemask_epi8(alpha));
+    const unsigned int transparent = ~opaque;
+    mask[0] = reversedBits_.values[transparent & 0xff];
+    mask[1] = reversedBits_.values[(transparent >> 8) & 0xff];
+}
+
+#elif defined(ICON_MASK_NEON)
+
+// the mask bits of sixteen pixels, first pixel in the high bit of the first byte
+void maskSixteen(const std::uint8_t * pixels, std::uint8_t * mask) noexcept
+{
+    static constexpr std::uint8_t weights[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                                  0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+
+    // splits the pixels into planes, the last is alpha
+    const uint8x16x4_t planes = vld4q_u8(pixels);
+    const uint8x16_t transparent = vcltq_u8(planes.val[alphaOffset_], vdupq_n_u8(opaqueAlpha_));
+    const uint8x16_t bits = vandq_u8(transparent, vld1q_u8(weights));
+    mask[0] = vaddv_u8(vget_low_u8(bits));
+    mask[1] = vaddv_u8(vget_high_u8(bits));
+}
+
+#endif
+
+void maskRowScalar(const std::uint8_t * pixels, size_t first, size_t width, std::uint8_t * mask) noexcept
+{
+    for (size_t x = first; x < width; ++x) {
+        if (pixels[(x * bytesPerPixel_) + alphaOffset_] < opaqueAlpha_) {
+            mask[x / 8] |= static_cast<std::uint8_t>(0x80U >> (x % 8));
+        }
+    }
+}
+
+} // anonymous namespace
+
+namespace IconMask
+{
+
+void fromAlpha(const std::uint8_t * pixels, size_t width, size_t height, std::uint8_t * mask) noexcept
+{
+#if defined(ICON_MASK_SSE2) || defined(ICON_MASK_NEON)
+    const size_t maskRowSize = rowSize(width);
+    std::memset(mask, 0, maskRowSize * height);
+
+    const size_t wholeWidth = width - (width % 16);
+    for (size_t y = 0; y < height; ++y) {
+        const std::uint8_t * row = pixels + (y * width * bytesPerPixel_);
+        std::uint8_t * maskRow = mask + (y * maskRowSize);
+        for (size_t x = 0; x < wholeWidth; x += 16) {
+            maskSixteen(row + (x * bytesPerPixel_), maskRow + (x / 8));
+        }
+        maskRowScalar(row, wholeWidth, width, maskRow);
+    }
+#else
+    fromAlphaScalar(pixels, width, height, mask);
+#endif
+}
+
+void fromAlphaScalar(const std::uint8_t * pixels, size_t width, size_t height, std::uint8_t * mask) noexcept
+{
+    const size_t maskRowSize = rowSize(width);
+    std::memset(mask, 0, maskRowSize * height);
+
+    for (size_t y = 0; y < height; ++y) {
+        maskRowScalar(pixels + (y * width * bytesPerPixel_), 0, width, mask + (y * maskRowSize));
+    }
+}
+
+const char * kernelName() noexcept
+{
+#if defined(ICON_MASK_SSE2)
+    return "SSE2";
+#elif defined(ICON_MASK_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace IconMask
@@ -0,0 +1,48 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+
+// Builds the monochrome mask of an icon from the alpha channel of its color
+// bitmap. Pixels are 32 bit BGRA, top row first. The mask has one bit per
+// pixel, with the leftmost pixel in the high bit, and rows padded to a
+// multiple of 16 bits, the layout CreateBitmap() takes. A bit is clear where
+// the pixel is opaque, alpha of at least 128, and set where it's transparent.
+//
+// Sixteen pixels are done at a time with SSE2 on x86 and x64, or NEON on
+// ARM64, which every CPU Windows runs on for those has, and the rest of a row
+// one at a time.
+namespace IconMask
+{
+
+// the bytes in each row of the mask
+constexpr size_t rowSize(size_t width) noexcept
+{
+    return ((width + 15) / 16) * 2;
+}
+
+// mask must have rowSize(width) * height bytes
+void fromAlpha(const std::uint8_t * pixels, size_t width, size_t height, std::uint8_t * mask) noexcept;
+
+// the same, a pixel at a time, for checking and comparing with fromAlpha
+void fromAlphaScalar(const std::uint8_t * pixels, size_t width, size_t height, std::uint8_t * mask) noexcept;
+
+// what fromAlpha uses, "SSE2", "NEON", or "scalar"
+const char * kernelName() noexcept;
+
+} // namespace IconMask
@@ -0,0 +1,99 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// App
+#include "LatencyHistogram.h"
+
+// Standard library
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+namespace
+{
+
+constexpr size_t barWidthMax_ = 40;
+
+// zero in the first bucket, one in the second, two and three in the third, and so on
+size_t bucketIndex(std::uint64_t microseconds) noexcept
+{
+    return std::min<size_t>(std::bit_width(microseconds), LatencyHistogram::bucketCount - 1);
+}
+
+} // anonymous namespace
+
+void LatencyHistogram::record(std::uint64_t microseconds) noexcept
+{
+    ++buckets_[bucketIndex(microseconds)];
+    min_ = count_ ? std::min(min_, microseconds) : microseconds;
+    max_ = std::max(max_, microseconds);
+    sum_ += microseconds;
+    ++count_;
+}
+
+std::uint64_t LatencyHistogram::percentile(double fraction) const noexcept
+{
+    if (!count_) {
+        return 0;
+    }
+
+    // the rank of the sample wanted, counting from one
+    const double clamped = std::clamp(fraction, 0.0, 1.0);
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(clamped * static_cast<double>(count_)));
+    std::uint64_t seen = 0;
+    for (size_t index = 0; index < bucketCount; ++index) {
+        seen += buckets_[index];
+        if (seen >= rank) {
+            return std::clamp(bucketLimit(index), min_, max_);
+        }
+    }
+    return max_;
+}
+
+std::uint64_t LatencyHistogram::bucketLimit(size_t index) noexcept
+{
+    return index ? ((std::uint64_t { 1 } << index) - 1) : 0;
+}
+
+std::string LatencyHistogram::format() const
+{
+    std::string text;
+    if (!count_) {
+        return text;
+    }
+
+    const size_t first = bucketIndex(min_);
+    const size_t last = bucketIndex(max_);
+    const std::uint64_t fullest = std::ranges::max(buckets_);
+    for (size_t index = first; index <= last; ++index) {
+        const std::uint64_t from = index ? (bucketLimit(index - 1) + 1) : 0;
+        const size_t barWidth = static_cast<size_t>((buckets_[index] * barWidthMax_ + fullest - 1) / fullest);
+
+        char line[96];
+        std::snprintf(
+            line,
+            sizeof(line),
+            "%8llu - %8llu%s us %8llu %5.1f%% ",
+            static_cast<unsigned long long>(from),
+            static_cast<unsigned long long>(bucketLimit(index)),
+            (index == bucketCount - 1) ? "+" : " ",
+            static_cast<unsigned long long>(buckets_[index]),
+            100.0 * static_cast<double>(buckets_[index]) / static_cast<double>(count_));
+        text += line;
+        text.append(barWidth, '#');
+        text += '\n';
+    }
+    return text;
+}
@@ -0,0 +1,86 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+// Standard library
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Counts latencies, in microseconds, in buckets that double in size, from
+// under a microsecond to over eight seconds, so a few numbers show how long
+// something usually takes and how long it takes at worst. Percentiles are
+// only as exact as the bucket they fall in, but the minimum, maximum, and
+// mean are exact.
+class LatencyHistogram
+{
+public:
+    static constexpr size_t bucketCount = 24;
+
+    void record(std::uint64_t microseconds) noexcept;
+
+    [[nodiscard]]
+    std::uint64_t count() const noexcept
+    {
+        return count_;
+    }
+
+    [[nodiscard]]
+    std::uint64_t min() const noexcept
+    {
+        return count_ ? min_ : 0;
+    }
+
+    [[nodiscard]]
+    std::uint64_t max() const noexcept
+    {
+        return max_;
+    }
+
+    [[nodiscard]]
+    std::uint64_t mean() const noexcept
+    {
+        return count_ ? (sum_ / count_) : 0;
+    }
+
+    [[nodiscard]]
+    std::uint64_t bucket(size_t index) const noexcept
+    {
+        return buckets_[index];
+    }
+
+    // The latency that the given fraction of them, from 0 to 1, are at or
+    // under, the top of the bucket it's in, but never more than the maximum.
+    [[nodiscard]]
+    std::uint64_t percentile(double fraction) const noexcept;
+
+    // Each bucket holds latencies from the previous bucket's limit up to
+    // this, and the last holds everything over that too.
+    [[nodiscard]]
+    static std::uint64_t bucketLimit(size_t index) noexcept;
+
+    // one line for each bucket from the first to the last used, with a bar scaled to the fullest
+    [[nodiscard]]
+    std::string format() const;
+
+private:
+    std::array<std::uint64_t, bucketCount> buckets_ {};
+    std::uint64_t count_ {};
+    std::uint64_t sum_ {};
+    std::uint64_t min_ {};
+    std::uint64_t max_ {};
+};
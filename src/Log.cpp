@@ -16,6 +16,11 @@
 #include "Log.h"
 #include "HandleWrapper.h"
 #include "Helpers.h"
+#include "LogBinary.h"
+#include "LogFlightRecorder.h"
+#include "LogRing.h"
+#include "LogRotation.h"
+#include "LogTimestamp.h"
 #include "Path.h"
 #include "StringUtility.h"
 
@@ -23,82 +28,1098 @@
 #include <Windows.h>
 
 // Standard library
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace
 {
 
+// Lines are formatted by the logging thread into a ring buffer, and a writer
+// thread drains the ring, sending lines to the debugger and batching writes to
+// the log file, so logging never waits on file IO. When the ring is full the
+// overflow setting decides whether to wait for the writer or drop the line.
+//
+// In the binary format, the logging thread only encodes the call site and the
+// arguments, and the writer stores those in the file as they are. Lines are
+// only formatted as text when a debugger is attached.
+//
+// When the log file gets too big or too old, the writer renames it to an
+// archive and starts a new one. Compressing and deleting old archives is left
+// to a maintenance thread, so the writer isn't held up by it.
+//
+// Separately, every call is kept in the flight recorder, a small ring that is
+// only read when it's saved, on request or after a crash.
+//
+// Call sites are rate limited before anything else is done, so a call over its
+// limit only counts itself. The writer collapses a line that's the same as the
+// line before into a count, which is written once a different line comes, or
+// the rate window has passed.
+
+using Ring = LogRing<4096>; // 1 MB
+using FlightRecorder = LogFlightRecorder<4096>; // 512 KB
+
+static_assert(FlightRecorder::payloadSize == Log::flightRecordSizeMax);
+
+constexpr size_t recordSizeMax_ = Ring::payloadSize * (Ring::slotCount / 4); // longer lines are truncated
+constexpr size_t batchRecordsMax_ = 256;
+constexpr DWORD crashFlushTimeout_ = 2000; // milliseconds
+constexpr const char * flightSuffix_ = "-flight.log";
+constexpr std::uint64_t ticksPerSecond_ = 10000000; // in FILETIME units
+constexpr std::uint64_t ticksPerMillisecond_ = 10000;
+constexpr std::uint64_t rotateRetryDelay_ = 60 * ticksPerSecond_; // after a log file couldn't be renamed
+
+// the log file and the lines logged before start() are shared by start() and the writer thread
+SRWLOCK fileLock_ = SRWLOCK_INIT;
 bool started_ = false;
 bool enableLogging_ = false;
 HandleWrapper fileHandle_;
-std::vector<std::string> pendingLogs_;
+std::string fileName_;
+std::string filePath_;
+std::string pendingLogs_;
+bool binaryFile_ = false;
+std::vector<bool> sitesWritten_; // sites described in the binary file so far, by id
+std::uint64_t lastTimestamp_ = 0;
+
+// the date and time of the last line, so it's only converted once a second
+bool toLocalCalendar(std::uint64_t timestamp, LogTimestamp::Calendar & calendar);
+constinit LogTimestamp timestamps_ { toLocalCalendar };
+
+// the last line written and how many times it has repeated since, for collapsing repeats
+std::string repeatData_;
+Log::Level repeatLevel_ = Log::Level::Debug;
+Ring::Kind repeatKind_ = Ring::Kind::Padding;
+std::uint64_t repeatStart_ = 0;
+std::uint64_t repeatLast_ = 0;
+std::uint32_t repeats_ = 0;
+LogRotation::Policy rotation_;
+std::uint64_t fileSize_ = 0;
+std::uint64_t fileOpened_ = 0;
+std::uint64_t rotateRetry_ = 0; // no rotating before this time
+std::string flightFileName_ = "Log-flight.log";
+
+// call sites registered for the binary format, by id starting at one
+SRWLOCK sitesLock_ = SRWLOCK_INIT;
+std::vector<const LogBinary::Site *> sites_;
+
+std::atomic<LogOverflow> overflow_ { LogOverflow::Block };
+std::atomic<size_t> dropped_ {};
+std::atomic<std::uint64_t> droppedTotal_ {};
+std::atomic<std::uint64_t> repeatedTotal_ {};
+std::atomic<std::uint64_t> rateWindow_ {}; // in milliseconds
+
+// monotonic timestamps count performance counter ticks from start()
+std::atomic<bool> monotonic_ {};
+LONGLONG monotonicStart_ = 0;
+LONGLONG monotonicFrequency_ = 1;
+
+// call sites that went over their rate limit, for statistics
+std::vector<LogBinary::Site *> limitedSites_;
+
+HANDLE writerThread_ = nullptr;
+DWORD writerThreadId_ = 0;
+std::atomic<bool> writerStopped_ {};
+std::atomic<bool> writerExit_ {};
+std::atomic<bool> writerSleeping_ {};
+std::atomic<std::uint32_t> writerWake_ {};
+std::atomic<size_t> written_ {}; // ring position up to which everything has been written
+LPTOP_LEVEL_EXCEPTION_FILTER previousExceptionFilter_ = nullptr;
+
+constinit FlightRecorder flight_;
+
+std::atomic<HANDLE> maintenanceThread_ {};
+std::atomic<bool> maintenanceExit_ {};
+std::atomic<std::uint32_t> maintenanceRequests_ {};
+
+class Lock
+{
+public:
+    explicit Lock(SRWLOCK & lock) noexcept
+        : lock_(lock)
+    {
+        AcquireSRWLockExclusive(&lock_);
+    }
+
+    ~Lock() noexcept { ReleaseSRWLockExclusive(&lock_); }
+
+    Lock(const Lock &) = delete;
+    Lock(Lock &&) = delete;
+    Lock & operator=(const Lock &) = delete;
+    Lock & operator=(Lock &&) = delete;
+
+private:
+    SRWLOCK & lock_;
+};
+
+// scratch space for the writer
+struct Buffers
+{
+    std::string batch;
+    std::string scratch;
+    std::string text;
+};
+
+Ring & ring() noexcept
+{
+    static Ring ring;
+    return ring;
+}
+
+bool writerRunning() noexcept;
+void writeAvailable(Buffers & buffers);
+void appendRecord(std::string & batch, const Ring::Record & record, std::string_view data, std::string & text);
+
+const LogBinary::Site * findSite(std::uint64_t id)
+{
+    const Lock lock(sitesLock_);
+    return ((id > 0) && (id <= sites_.size())) ? sites_[id - 1] : nullptr;
+}
+
+// wall clock time, for log file names and ages
+std::uint64_t now() noexcept
+{
+    FILETIME fileTime;
+    GetSystemTimeAsFileTime(&fileTime);
+    return (static_cast<std::uint64_t>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+}
+
+// the time for a log record, the wall clock, or the time since start() if timestamps are monotonic
+std::uint64_t stamp() noexcept
+{
+    if (!monotonic_.load(std::memory_order_acquire)) {
+        return now();
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    const auto elapsed = static_cast<std::uint64_t>(counter.QuadPart - monotonicStart_);
+    const auto frequency = static_cast<std::uint64_t>(monotonicFrequency_);
+    return ((elapsed / frequency) * ticksPerSecond_) + (((elapsed % frequency) * ticksPerSecond_) / frequency);
+}
+
+bool toLocalCalendar(std::uint64_t timestamp, LogTimestamp::Calendar & calendar)
+{
+    FILETIME fileTime;
+    fileTime.dwLowDateTime = static_cast<DWORD>(timestamp);
+    fileTime.dwHighDateTime = static_cast<DWORD>(timestamp >> 32);
+    FILETIME localFileTime;
+    SYSTEMTIME systemTime;
+    if (!FileTimeToLocalFileTime(&fileTime, &localFileTime) || !FileTimeToSystemTime(&localFileTime, &systemTime)) {
+        return false;
+    }
+
+    calendar.year = systemTime.wYear;
+    calendar.month = systemTime.wMonth;
+    calendar.day = systemTime.wDay;
+    calendar.hour = systemTime.wHour;
+    calendar.minute = systemTime.wMinute;
+    calendar.second = systemTime.wSecond;
+    return true;
+}
+
+void appendLine(
+    std::string & lines,
+    LogTimestamp & timestamps,
+    Log::Level level,
+    std::uint64_t timestamp,
+    std::string_view text)
+{
+    const std::string_view timeStr =
+        monotonic_.load(std::memory_order_relaxed) ? timestamps.elapsed(timestamp) : timestamps.dateTime(timestamp);
+
+    const char * levelString = nullptr;
+    switch (level) {
+        case Log::Level::Debug: levelString = "DEBUG  "; break;
+        case Log::Level::Info: levelString = "INFO   "; break;
+        case Log::Level::Warning: levelString = "WARNING"; break;
+        case Log::Level::Error: levelString = "ERROR  "; break;
+        default: {
+            levelString = "UNKNOWN";
+            assert(false);
+            break;
+        }
+    }
+
+    lines += timeStr;
+    lines += " - ";
+    lines += levelString;
+    lines += " - ";
+    lines += text;
+}
+
+// writes to the log file, or keeps the lines until start() if it hasn't been called yet, the file lock must be held
+void writeLocked(const std::string & bytes)
+{
+    if (!started_) {
+        pendingLogs_ += bytes;
+        return;
+    }
+
+    if (enableLogging_ && (fileHandle_ != INVALID_HANDLE_VALUE) && !bytes.empty()) {
+        DWORD bytesWritten = 0;
+        WriteFile(fileHandle_, bytes.c_str(), narrow_cast<DWORD>(bytes.size()), &bytesWritten, nullptr);
+        assert(bytesWritten == bytes.size());
+        fileSize_ += bytesWritten;
+    }
+}
+
+HANDLE createFile(const std::string & path) noexcept
+{
+    return CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+// opens a log file to carry on writing at its end, keeping what's in it
+HANDLE appendFile(const std::string & path) noexcept
+{
+    const HANDLE file =
+        CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        SetFilePointerEx(file, {}, nullptr, FILE_END);
+    }
+    return file;
+}
+
+DWORD WINAPI maintenanceMain(LPVOID /* parameter */) noexcept
+{
+    std::uint32_t handled = 0;
+
+    for (;;) {
+        const std::uint32_t requests = maintenanceRequests_.load(std::memory_order_acquire);
+        if (maintenanceExit_.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (requests == handled) {
+            maintenanceRequests_.wait(requests, std::memory_order_acquire);
+            continue;
+        }
+        handled = requests;
+
+        std::string path;
+        LogRotation::Policy policy;
+        {
+            const Lock lock(fileLock_);
+            path = filePath_;
+            policy = rotation_;
+        }
+
+        std::string error;
+        if (!path.empty() && !LogRotation::maintain(path, policy, error)) {
+            WARNING_PRINTF("could not clean up old log files: %s\n", error.c_str());
+        }
+    }
+
+    return 0;
+}
+
+bool startMaintenance() noexcept
+{
+    const HANDLE thread = CreateThread(nullptr, 0, maintenanceMain, nullptr, 0, nullptr);
+    if (!thread) {
+        OutputDebugStringA("could not create log maintenance thread, CreateThread() failed\n");
+        return false;
+    }
+
+    maintenanceThread_.store(thread, std::memory_order_release);
+    return true;
+}
+
+// asks the maintenance thread to compress and delete old archives, this doesn't wait
+void requestMaintenance() noexcept
+{
+    if (maintenanceExit_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    static const bool started = startMaintenance();
+    if (started) {
+        maintenanceRequests_.fetch_add(1, std::memory_order_release);
+        maintenanceRequests_.notify_one();
+    }
+}
+
+void stopMaintenance() noexcept
+{
+    if (maintenanceExit_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    const HANDLE thread = maintenanceThread_.exchange(nullptr, std::memory_order_acq_rel);
+    if (thread) {
+        // an archive being compressed is finished first
+        maintenanceRequests_.fetch_add(1, std::memory_order_release);
+        maintenanceRequests_.notify_one();
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+}
+
+// starts a new log file when the current one is too big or too old, the file lock must be held
+void rotateIfDue(std::string & batch, std::string & text)
+{
+    if (!started_ || !enableLogging_ || !rotation_.enabled() || (fileHandle_ == INVALID_HANDLE_VALUE)) {
+        return;
+    }
+
+    const std::uint64_t timestamp = now();
+    if (!rotation_.due(fileSize_, fileOpened_, timestamp) || (timestamp < rotateRetry_)) {
+        return;
+    }
+
+    fileHandle_.close();
+    std::string error;
+    const std::string archivePath = LogRotation::archive(filePath_, timestamp, error);
+
+    // A log file that couldn't be renamed, such as one a viewer has open, is
+    // written to where it left off, and renaming it is tried again later. It's
+    // never cleared, since what's in it wasn't archived.
+    if (archivePath.empty()) {
+        fileHandle_ = HandleWrapper(appendFile(filePath_));
+        if (fileHandle_ == INVALID_HANDLE_VALUE) {
+            OutputDebugStringA("could not reopen log file after failing to rotate it, CreateFileA() failed\n");
+            return;
+        }
+
+        rotateRetry_ = timestamp + rotateRetryDelay_;
+        const std::string message = "could not rotate log file, trying again in a minute: " + error + "\n";
+        appendRecord(batch, { stamp(), Log::Level::Warning, Ring::Kind::Text }, message, text);
+        return;
+    }
+
+    fileHandle_ = HandleWrapper(createFile(filePath_));
+    if (fileHandle_ == INVALID_HANDLE_VALUE) {
+        OutputDebugStringA("could not reopen log file after rotating it, CreateFileA() failed\n");
+        return;
+    }
+
+    fileSize_ = 0;
+    fileOpened_ = timestamp;
+    rotateRetry_ = 0;
+    sitesWritten_.clear();
+    lastTimestamp_ = 0;
+    if (binaryFile_) {
+        writeLocked(std::string(LogBinary::magic));
+    }
+
+    const std::string message = "rotated log file, earlier lines are in '" + archivePath + "'\n";
+    appendRecord(batch, { stamp(), Log::Level::Info, Ring::Kind::Text }, message, text);
+    requestMaintenance();
+}
+
+// writes how many times the last line repeated, if it did, the file lock must be held
+void appendRepeats(std::string & batch, std::string & text)
+{
+    if (!repeats_) {
+        return;
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "last line repeated %u more times\n", repeats_);
+    repeatedTotal_.fetch_add(repeats_, std::memory_order_relaxed);
+    repeats_ = 0;
+    appendRecord(batch, { repeatLast_, repeatLevel_, Ring::Kind::Text }, message, text);
+}
+
+// returns true if the record is the same as the one before it, within the rate window, the file lock must be held
+bool collapseRepeat(std::string & batch, const Ring::Record & record, std::string_view data, std::string & text)
+{
+    const std::uint64_t window = rateWindow_.load(std::memory_order_relaxed) * ticksPerMillisecond_;
+    if (!window) {
+        return false;
+    }
+
+    if ((record.level == repeatLevel_) && (record.kind == repeatKind_) && (record.timestamp < repeatStart_ + window) &&
+        (data == repeatData_)) {
+        ++repeats_;
+        repeatLast_ = record.timestamp;
+        return true;
+    }
+
+    appendRepeats(batch, text);
+    repeatData_.assign(data);
+    repeatLevel_ = record.level;
+    repeatKind_ = record.kind;
+    repeatStart_ = record.timestamp;
+    return false;
+}
+
+// adds a record to a batch in the format of the log file, and sends it to the debugger, the file lock must be held
+void appendRecord(std::string & batch, const Ring::Record & record, std::string_view data, std::string & text)
+{
+    if (collapseRepeat(batch, record, data, text)) {
+        return;
+    }
+
+    const bool binaryFile = started_ && binaryFile_;
+    const bool toDebugger = !binaryFile || IsDebuggerPresent();
+
+    std::uint64_t id = 0;
+    std::string_view message = data;
+    if (record.kind == Ring::Kind::Binary) {
+        if (!LogBinary::getVarint(data, id)) {
+            return;
+        }
+        if (toDebugger) {
+            text.clear();
+            const LogBinary::Site * site = findSite(id);
+            if (!site || !LogBinary::format(site->format, site->types, data, text)) {
+                text += "(bad binary log record)\n";
+            }
+            message = text;
+        }
+    }
+
+    if (!binaryFile) {
+        const size_t start = batch.size();
+        appendLine(batch, timestamps_, record.level, record.timestamp, message);
+        OutputDebugStringA(batch.c_str() + start);
+        return;
+    }
+
+    if (toDebugger) {
+        std::string line;
+        appendLine(line, timestamps_, record.level, record.timestamp, message);
+        OutputDebugStringA(line.c_str());
+    }
+
+    const auto timestampDelta = static_cast<std::int64_t>(record.timestamp - lastTimestamp_);
+    lastTimestamp_ = record.timestamp;
+
+    if (record.kind == Ring::Kind::Binary) {
+        if (id >= sitesWritten_.size()) {
+            sitesWritten_.resize(id + 1);
+        }
+        if (!sitesWritten_[id]) {
+            const LogBinary::Site * site = findSite(id);
+            if (site) {
+                LogBinary::appendSite(batch, static_cast<std::uint32_t>(id), *site);
+            }
+            sitesWritten_[id] = true;
+        }
+        LogBinary::appendEvent(batch, static_cast<std::uint32_t>(id), timestampDelta, data);
+    } else {
+        LogBinary::appendText(batch, static_cast<int>(record.level), timestampDelta, message);
+    }
+}
+
+void wakeWriter(bool force) noexcept
+{
+    // pairs with the fence in writerMain(), either the writer sees the new record or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (force || writerSleeping_.load(std::memory_order_relaxed)) {
+        writerWake_.fetch_add(1, std::memory_order_release);
+        writerWake_.notify_one();
+    }
+}
+
+// Claims slots for a record, following the overflow setting if the ring is
+// full. The writer thread drops its own records rather than waiting for
+// itself to make room, as it can log while holding the file, such as when a
+// handle it closes during rotation fails to close.
+bool claim(size_t count, size_t & position) noexcept
+{
+    Ring & r = ring();
+    while (!r.tryClaim(count, position)) {
+        if ((overflow_.load(std::memory_order_relaxed) == LogOverflow::Drop) ||
+            (GetCurrentThreadId() == writerThreadId_)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            wakeWriter(false);
+            return false;
+        }
+
+        const size_t written = written_.load(std::memory_order_acquire);
+        wakeWriter(true);
+        if (r.tryClaim(count, position)) {
+            break;
+        }
+        written_.wait(written, std::memory_order_acquire);
+    }
+
+    return true;
+}
+
+void push(Log::Level level, std::uint64_t timestamp, Ring::Kind kind, std::string_view text) noexcept
+{
+    text = text.substr(0, std::min(text.size(), recordSizeMax_));
+    const size_t count = Ring::slotsFor(text.size());
+    size_t position = 0;
+    if (!claim(count, position)) {
+        return;
+    }
+
+    ring().write(position, text);
+    ring().publish(position, count, { timestamp, level, kind }, text.size());
+    wakeWriter(false);
+}
+
+void write(Log::Level level, std::uint64_t timestamp, Ring::Kind kind, std::string_view data) noexcept
+{
+    if (writerRunning()) {
+        push(level, timestamp, kind, data);
+    } else {
+        std::string batch;
+        std::string text;
+        const Lock lock(fileLock_);
+        rotateIfDue(batch, text);
+        appendRecord(batch, { timestamp, level, kind }, data, text);
+        writeLocked(batch);
+    }
+
+    if (level == Log::Level::Error) {
+        Log::flush();
+    }
+}
+
+void writeAvailable(Buffers & buffers)
+{
+    Ring & r = ring();
+    while (r.ready()) {
+        {
+            const Lock lock(fileLock_);
+
+            rotateIfDue(buffers.batch, buffers.text);
+
+            r.drain(
+                [&buffers](const Ring::Record & record, std::string_view data) {
+                    appendRecord(buffers.batch, record, data, buffers.text);
+                },
+                buffers.scratch,
+                batchRecordsMax_);
+
+            const size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+            if (dropped) {
+                droppedTotal_.fetch_add(dropped, std::memory_order_relaxed);
+                char text[64];
+                snprintf(text, sizeof(text), "log full, dropped %zu lines\n", dropped);
+                appendRecord(buffers.batch, { stamp(), Log::Level::Warning, Ring::Kind::Text }, text, buffers.text);
+            }
+
+            writeLocked(buffers.batch);
+        }
+        buffers.batch.clear();
+
+        written_.store(r.consumed(), std::memory_order_release);
+        written_.notify_all();
+    }
+}
+
+DWORD WINAPI writerMain(LPVOID /* parameter */) noexcept
+{
+    Buffers buffers;
+    const Ring & r = ring();
+
+    for (;;) {
+        const std::uint32_t wake = writerWake_.load(std::memory_order_acquire);
+        const bool exiting = writerExit_.load(std::memory_order_acquire);
+
+        writeAvailable(buffers);
+
+        if (exiting) {
+            if (r.consumed() == r.claimed()) {
+                break;
+            }
+            // a line is still being formatted
+            SwitchToThread();
+            continue;
+        }
+
+        writerSleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!r.ready()) {
+            writerWake_.wait(wake, std::memory_order_acquire);
+        }
+        writerSleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    return 0;
+}
+
+// Saves the flight recorder as text, returning the file's path or an empty
+// string on failure. After a crash the locks might be held by the crashed
+// thread, so they are only tried, and records whose site can't be looked up
+// are saved without their text.
+std::string saveFlight(bool crashed) noexcept
+{
+    try {
+        std::string fileName;
+        if (!crashed) {
+            const Lock lock(fileLock_);
+            fileName = flightFileName_;
+        } else if (TryAcquireSRWLockExclusive(&fileLock_)) {
+            fileName = flightFileName_;
+            ReleaseSRWLockExclusive(&fileLock_);
+        } else {
+            fileName = "Log-flight.log";
+        }
+
+        const std::string writeableDir = getWriteableDir();
+        if (writeableDir.empty()) {
+            return {};
+        }
+        const std::string path = pathJoin(writeableDir, fileName);
+
+        // copy the sites so the lock isn't held while formatting
+        std::vector<const LogBinary::Site *> sites;
+        std::vector<const LogBinary::Site *> limitedSites;
+        if (!crashed) {
+            const Lock lock(sitesLock_);
+            sites = sites_;
+            limitedSites.assign(limitedSites_.begin(), limitedSites_.end());
+        } else if (TryAcquireSRWLockExclusive(&sitesLock_)) {
+            sites = sites_;
+            limitedSites.assign(limitedSites_.begin(), limitedSites_.end());
+            ReleaseSRWLockExclusive(&sitesLock_);
+        }
+
+        const std::uint64_t recorded = flight_.recorded();
+        const std::uint64_t overwritten =
+            (recorded > FlightRecorder::slotCount) ? (recorded - FlightRecorder::slotCount) : 0;
+
+        std::string lines;
+        LogTimestamp timestamps(toLocalCalendar); // the writer's is guarded by the file lock
+        char header[512];
+        snprintf(
+            header,
+            sizeof(header),
+            "%s, %llu calls recorded, %llu overwritten\n",
+            crashed ? "recent log calls before a crash" : "recent log calls",
+            static_cast<unsigned long long>(recorded),
+            static_cast<unsigned long long>(overwritten));
+        appendLine(lines, timestamps, Log::Level::Info, stamp(), header);
+
+        // lines that didn't make it to the log file
+        std::uint64_t suppressed = 0;
+        for (const LogBinary::Site * site : limitedSites) {
+            const std::uint64_t siteSuppressed = site->limiter.suppressedTotal() + site->limiter.suppressedPending();
+            suppressed += siteSuppressed;
+            snprintf(
+                header,
+                sizeof(header),
+                "%llu lines suppressed by the rate limit at %s(%u)\n",
+                static_cast<unsigned long long>(siteSuppressed),
+                site->file,
+                site->line);
+            appendLine(lines, timestamps, Log::Level::Info, stamp(), header);
+        }
+        snprintf(
+            header,
+            sizeof(header),
+            "%llu lines dropped, %llu suppressed, %llu collapsed as repeats\n",
+            static_cast<unsigned long long>(droppedTotal_.load(std::memory_order_relaxed)),
+            static_cast<unsigned long long>(suppressed),
+            static_cast<unsigned long long>(repeatedTotal_.load(std::memory_order_relaxed)));
+        appendLine(lines, timestamps, Log::Level::Info, stamp(), header);
+
+        std::string text;
+        flight_.read([&lines, &sites, &text, &timestamps](const FlightRecorder::Record & record) {
+            text.clear();
+            if (record.kind == FlightRecorder::Kind::Text) {
+                text = record.data;
+                if (record.truncated) {
+                    text += "...";
+                }
+            } else {
+                std::string_view data = record.data;
+                std::uint64_t id = 0;
+                const LogBinary::Site * site = nullptr;
+                if (LogBinary::getVarint(data, id) && (id > 0) && (id <= sites.size())) {
+                    site = sites[id - 1];
+                }
+                if (!site) {
+                    text = "(unknown log call)";
+                } else if (record.truncated) {
+                    // only the site was kept, so show the format without its arguments
+                    text = "(arguments too big to keep) ";
+                    text += site->format;
+                } else if (!LogBinary::format(site->format, site->types, data, text)) {
+                    text = "(bad binary log record)";
+                }
+            }
+            if (text.empty() || (text.back() != '\n')) {
+                text += '\n';
+            }
+            appendLine(lines, timestamps, static_cast<Log::Level>(record.level), record.timestamp, text);
+        });
+
+        const HandleWrapper file(createFile(path));
+        if (file == INVALID_HANDLE_VALUE) {
+            return {};
+        }
+        DWORD bytesWritten = 0;
+        if (!WriteFile(file, lines.c_str(), narrow_cast<DWORD>(lines.size()), &bytesWritten, nullptr) ||
+            (bytesWritten != lines.size())) {
+            return {};
+        }
+
+        return path;
+    } catch (...) {
+        return {};
+    }
+}
+
+LONG WINAPI unhandledExceptionFilter(EXCEPTION_POINTERS * exceptionPointers)
+{
+    // the writer might be stuck behind the crashed thread, so don't wait forever
+    if (writerRunning() && (GetCurrentThreadId() != writerThreadId_)) {
+        const size_t target = ring().claimed();
+        wakeWriter(true);
+        for (DWORD waited = 0; (written_.load(std::memory_order_acquire) < target) && (waited < crashFlushTimeout_);
+             ++waited) {
+            Sleep(1);
+        }
+    }
+
+    saveFlight(true);
+
+    return previousExceptionFilter_ ? previousExceptionFilter_(exceptionPointers) : EXCEPTION_CONTINUE_SEARCH;
+}
+
+void atExit()
+{
+    Log::stop();
+}
+
+bool startWriter() noexcept
+{
+    static_cast<void>(ring());
+
+    writerThread_ = CreateThread(nullptr, 0, writerMain, nullptr, 0, &writerThreadId_);
+    if (!writerThread_) {
+        // can't log this the usual way, everything will be written synchronously instead
+        OutputDebugStringA("could not create log writer thread, CreateThread() failed\n");
+        return false;
+    }
+
+    previousExceptionFilter_ = SetUnhandledExceptionFilter(unhandledExceptionFilter);
+    if (std::atexit(atExit)) {
+        OutputDebugStringA("could not register log flush at exit, atexit() failed\n");
+    }
+
+    return true;
+}
+
+bool writerRunning() noexcept
+{
+    if (writerStopped_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    // the writer is started by whatever logs first
+    static const bool started = startWriter();
+    return started;
+}
+
+// swaps in a new log file, and the caller's handle gets the old one to close outside the lock
+void setFile(
+    HandleWrapper & fileHandle,
+    const std::string & fileName,
+    const std::string & filePath,
+    bool binary,
+    const LogRotation::Policy & rotation)
+{
+    const Lock lock(fileLock_);
+
+    started_ = true;
+    enableLogging_ = fileHandle != INVALID_HANDLE_VALUE;
+    binaryFile_ = enableLogging_ && binary;
+    fileName_ = enableLogging_ ? fileName : std::string();
+    filePath_ = enableLogging_ ? filePath : std::string();
+    rotation_ = rotation;
+    fileSize_ = 0;
+    fileOpened_ = now();
+    rotateRetry_ = 0;
+    sitesWritten_.clear();
+    lastTimestamp_ = 0;
+
+    HandleWrapper previousFileHandle;
+    previousFileHandle = std::move(fileHandle_);
+    fileHandle_ = std::move(fileHandle);
+    fileHandle = std::move(previousFileHandle);
+
+    if (binaryFile_) {
+        std::string header(LogBinary::magic);
+        if (!pendingLogs_.empty()) {
+            LogBinary::appendRaw(header, pendingLogs_);
+        }
+        writeLocked(header);
+    } else if (enableLogging_) {
+        writeLocked(pendingLogs_);
+    }
+    pendingLogs_.clear();
+    pendingLogs_.shrink_to_fit();
+
+    // archives left from earlier runs may need to be compressed or deleted
+    if (enableLogging_ && rotation_.enabled()) {
+        requestMaintenance();
+    }
+}
 
 } // anonymous namespace
 
 namespace Log
 {
 
-void start(bool enable, const std::string & fileName)
+void start(bool enable, const std::string & fileName, const Options & options)
 {
-    started_ = true;
+    const Level level = levelValid(options.level) ? options.level : Level::Debug;
+    const Level flightLevel = levelValid(options.flightLevel) ? options.flightLevel : Level::Debug;
+    level_.store(level, std::memory_order_relaxed);
+    flightLevel_.store(flightLevel, std::memory_order_relaxed);
+    enabledLevel_.store(options.flightRecorder ? std::min(level, flightLevel) : level, std::memory_order_relaxed);
+    overflow_.store(
+        logOverflowValid(options.overflow) ? options.overflow : LogOverflow::Block,
+        std::memory_order_relaxed);
+    const bool binary = options.format == LogFormat::Binary;
+    flightRecorder_.store(options.flightRecorder, std::memory_order_relaxed);
+    rateWindow_.store(options.rateWindow * 1000ULL, std::memory_order_relaxed);
+    rateLimit_.store(options.rateWindow ? options.rateLimit : 0, std::memory_order_relaxed);
+    rateLimitWarning_.store(options.rateWindow ? options.rateLimitWarning : 0, std::memory_order_relaxed);
+
+    // the binary format stores wall clock times, and its decoder shows them as dates
+    const bool monotonic = options.monotonicTimestamps && !binary;
+    if (monotonic && !monotonicStart_) {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        monotonicFrequency_ = frequency.QuadPart;
+        monotonicStart_ = counter.QuadPart;
+    }
+    monotonic_.store(monotonic, std::memory_order_release);
+
+    if (!fileName.empty()) {
+        const Lock lock(fileLock_);
+        const size_t dot = fileName.rfind('.');
+        flightFileName_ = fileName.substr(0, dot) + flightSuffix_;
+    }
+
+    HandleWrapper fileHandle;
 
     if (!enable || fileName.empty()) {
-        enableLogging_ = false;
-        fileHandle_.close();
-        pendingLogs_.clear();
+        binary_.store(false, std::memory_order_relaxed);
+        setFile(fileHandle, fileName, {}, false, options.rotation);
         return;
     }
 
-    if (fileHandle_ != INVALID_HANDLE_VALUE) {
+    bool alreadyStarted = false;
+    {
+        const Lock lock(fileLock_);
+        if ((fileHandle_ != INVALID_HANDLE_VALUE) && (fileName_ == fileName) && (binaryFile_ == binary)) {
+            alreadyStarted = true;
+            enableLogging_ = true;
+            rotation_ = options.rotation;
+            assert(pendingLogs_.empty());
+        }
+    }
+    if (alreadyStarted) {
         WARNING_PRINTF("logging already started\n");
-        enableLogging_ = true;
-        assert(pendingLogs_.empty());
         return;
     }
 
     const std::string writeableDir = getWriteableDir();
     if (writeableDir.empty()) {
         WARNING_PRINTF("no writeable dir found, logging to file disabled\n");
-        enableLogging_ = false;
-        pendingLogs_.clear();
+        binary_.store(false, std::memory_order_relaxed);
+        setFile(fileHandle, fileName, {}, false, options.rotation);
         return;
     }
 
     const std::string logFileFullPath = pathJoin(writeableDir, fileName);
 
-    HandleWrapper fileHandle(CreateFileA(
-        logFileFullPath.c_str(),
-        GENERIC_WRITE,
-        FILE_SHARE_READ,
-        nullptr,
-        CREATE_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL,
-        nullptr));
+    fileHandle = HandleWrapper(createFile(logFileFullPath));
 
     if (fileHandle == INVALID_HANDLE_VALUE) {
         WARNING_PRINTF(
             "could not open log file '%s' for writing, CreateFileA() failed: %s\n",
             logFileFullPath.c_str(),
             StringUtility::lastErrorString().c_str());
-        enableLogging_ = false;
-        pendingLogs_.clear();
+        binary_.store(false, std::memory_order_relaxed);
+        setFile(fileHandle, fileName, {}, false, options.rotation);
         return;
     }
 
+    setFile(fileHandle, fileName, logFileFullPath, binary, options.rotation);
+    binary_.store(binary, std::memory_order_relaxed);
     DEBUG_PRINTF("logging to file '%s'\n", logFileFullPath.c_str());
-    fileHandle_ = std::move(fileHandle);
-    assert(fileHandle_ != INVALID_HANDLE_VALUE);
-    enableLogging_ = true;
+}
 
-    for (const std::string & pendingLog : pendingLogs_) {
-        DWORD bytesWritten = 0;
-        WriteFile(fileHandle_, pendingLog.c_str(), narrow_cast<DWORD>(pendingLog.size()), &bytesWritten, nullptr);
-        assert(bytesWritten == pendingLog.size());
+void flush() noexcept
+{
+    if (!writerRunning() || (GetCurrentThreadId() == writerThreadId_)) {
+        return;
+    }
+
+    const size_t target = ring().claimed();
+    wakeWriter(true);
+    for (size_t written = written_.load(std::memory_order_acquire); written < target;
+         written = written_.load(std::memory_order_acquire)) {
+        written_.wait(written, std::memory_order_acquire);
+    }
+}
+
+void stop() noexcept
+{
+    stopMaintenance();
+
+    const Statistics counts = statistics();
+    if (counts.dropped || counts.suppressed || counts.repeated) {
+        INFO_PRINTF(
+            "%llu lines were dropped, %llu suppressed by rate limits, and %llu collapsed as repeats\n",
+            static_cast<unsigned long long>(counts.dropped),
+            static_cast<unsigned long long>(counts.suppressed),
+            static_cast<unsigned long long>(counts.repeated));
+    }
+
+    if (writerStopped_.exchange(true, std::memory_order_acq_rel) || !writerThread_) {
+        return;
+    }
+
+    writerExit_.store(true, std::memory_order_release);
+    wakeWriter(true);
+    WaitForSingleObject(writerThread_, INFINITE);
+    CloseHandle(writerThread_);
+    writerThread_ = nullptr;
+
+    // lines queued by other threads while the writer was exiting
+    Buffers buffers;
+    writeAvailable(buffers);
+
+    const Lock lock(fileLock_);
+    appendRepeats(buffers.batch, buffers.text);
+    writeLocked(buffers.batch);
+}
+
+Statistics statistics() noexcept
+{
+    Statistics result;
+    result.dropped = droppedTotal_.load(std::memory_order_relaxed) + dropped_.load(std::memory_order_relaxed);
+    result.repeated = repeatedTotal_.load(std::memory_order_relaxed);
+
+    const Lock lock(sitesLock_);
+    for (const LogBinary::Site * site : limitedSites_) {
+        result.suppressed += site->limiter.suppressedTotal() + site->limiter.suppressedPending();
+    }
+
+    return result;
+}
+
+bool admitLimited(LogBinary::Site & site, std::uint32_t limit) noexcept
+{
+    const std::uint64_t window = rateWindow_.load(std::memory_order_relaxed);
+    if (!window) {
+        return true;
+    }
+
+    const LogRateLimiter::Result result = site.limiter.admit(static_cast<std::uint32_t>(GetTickCount64() / window), limit);
+    if (!result.admitted) {
+        if (site.limiter.list()) {
+            const Lock lock(sitesLock_);
+            try {
+                limitedSites_.push_back(&site);
+            } catch (...) {
+                // only the statistics miss it
+            }
+        }
+        return false;
+    }
+
+    if (result.suppressed) {
+        const char * file = site.file;
+        for (const char * c = site.file; *c; ++c) {
+            if ((*c == '\\') || (*c == '/')) {
+                file = c + 1;
+            }
+        }
+        printf(
+            static_cast<Level>(site.level),
+            "suppressed %u more lines from %s(%u), which is limited to %u lines in %llu seconds\n",
+            result.suppressed,
+            file,
+            site.line,
+            limit,
+            static_cast<unsigned long long>(window / 1000));
+    }
+
+    return true;
+}
+
+std::string saveFlightRecorder()
+{
+    const std::string path = saveFlight(false);
+    if (path.empty()) {
+        WARNING_PRINTF("could not save recent log lines\n");
+    } else {
+        INFO_PRINTF("saved recent log lines to '%s'\n", path.c_str());
+    }
+    return path;
+}
+
+std::uint32_t registerSite(LogBinary::Site & site, const char * types) noexcept
+{
+    const Lock lock(sitesLock_);
+
+    std::uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (!id) {
+        site.types = types;
+        try {
+            sites_.push_back(&site);
+        } catch (...) {
+            return 0;
+        }
+        id = narrow_cast<std::uint32_t>(sites_.size());
+        site.id.store(id, std::memory_order_release);
+    }
+
+    return id;
+}
+
+void recordFlight(Level level, std::string_view data, bool binary, bool truncated) noexcept
+{
+    flight_.record(
+        stamp(),
+        static_cast<int>(level),
+        binary ? FlightRecorder::Kind::Binary : FlightRecorder::Kind::Text,
+        data,
+        truncated);
+}
+
+char * BinaryRecord::begin(Level level, LogBinary::Site & site, const char * types, size_t size) noexcept
+{
+    const std::uint32_t id = siteId(site, types);
+
+    level_ = level;
+    timestamp_ = stamp();
+    size_ = LogBinary::varintSize(id) + size;
+
+    // usually the record fits in one slot, and is encoded straight into the ring
+    if ((size_ <= Ring::payloadSize) && writerRunning()) {
+        if (!claim(1, position_)) {
+            return nullptr;
+        }
+        return LogBinary::putVarint(ring().payload(position_), id);
+    }
+
+    buffer_.resize(size_);
+    return LogBinary::putVarint(buffer_.data(), id);
+}
+
+void BinaryRecord::end() noexcept
+{
+    if (buffer_.empty()) {
+        ring().publish(position_, 1, { timestamp_, level_, Ring::Kind::Binary }, size_);
+        wakeWriter(false);
+        if (level_ == Level::Error) {
+            flush();
+        }
+    } else {
+        write(level_, timestamp_, Ring::Kind::Binary, buffer_);
     }
-    pendingLogs_.clear();
 }
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -113,13 +1134,59 @@ void start(bool enable, const std::string & fileName)
 
 void printf(Level level, const char * fmt, ...) noexcept
 {
+    const bool toLog = logged(level);
+    const bool toFlight = recorded(level);
+    if (!toLog && !toFlight) {
+        return;
+    }
+
+    const std::uint64_t timestamp = stamp();
+
+    va_list ap;
+    va_start(ap, fmt);
+
+    // most lines fit in one slot, so they are formatted straight into the ring
+    if (toLog && writerRunning()) {
+        size_t position = 0;
+        if (!claim(1, position)) {
+            va_end(ap);
+            return;
+        }
+
+        va_list apCopy;
+        va_copy(apCopy, ap);
+        const int len = vsnprintf(ring().payload(position), Ring::payloadSize, fmt, apCopy);
+        va_end(apCopy);
+
+        if ((len >= 0) && (static_cast<size_t>(len) < Ring::payloadSize)) {
+            if (toFlight) {
+                flight_.record(
+                    timestamp,
+                    static_cast<int>(level),
+                    FlightRecorder::Kind::Text,
+                    std::string_view(ring().payload(position), static_cast<size_t>(len)));
+            }
+            ring().publish(position, 1, { timestamp, level, Ring::Kind::Text }, static_cast<size_t>(len));
+            wakeWriter(false);
+            va_end(ap);
+            if (level == Level::Error) {
+                flush();
+            }
+            return;
+        }
+
+        ring().publish(position, 1, { timestamp, level, Ring::Kind::Padding }, 0);
+        wakeWriter(false);
+    }
+
     char fixedBuffer[1024] = {};
     char * buffer = fixedBuffer;
     size_t bufferSize = sizeof(fixedBuffer);
 
-    va_list ap;
-    va_start(ap, fmt);
-    int len = vsnprintf(buffer, bufferSize, fmt, ap);
+    va_list apCopy;
+    va_copy(apCopy, ap);
+    int len = vsnprintf(buffer, bufferSize, fmt, apCopy);
+    va_end(apCopy);
     if (len >= narrow_cast<int>(bufferSize)) {
         bufferSize = static_cast<size_t>(len) + 1;
         buffer = new (std::nothrow) char[bufferSize];
@@ -130,63 +1197,37 @@ void printf(Level level, const char * fmt, ...) noexcept
     }
     va_end(ap);
 
-    if (!buffer) {
+    if (!buffer || (len < 0)) {
         return;
     }
 
-    print(level, buffer);
+    const std::string_view text(buffer, static_cast<size_t>(len));
+    if (toFlight) {
+        flight_.record(timestamp, static_cast<int>(level), FlightRecorder::Kind::Text, text);
+    }
+    if (toLog) {
+        write(level, timestamp, Ring::Kind::Text, text);
+    }
 
     if (buffer != fixedBuffer) {
         delete[] buffer;
     }
 }
 
-void print(Level level, const char * str) noexcept
+void print(Level level, std::string_view text) noexcept
 {
-    SYSTEMTIME systemTime;
-    memset(&systemTime, 0, sizeof(systemTime));
-    GetLocalTime(&systemTime);
-    char timeStr[64];
-    const int printed = snprintf(
-        timeStr,
-        sizeof(timeStr),
-        "%u-%02u-%02u %02u:%02u:%02u.%03u",
-        systemTime.wYear,
-        systemTime.wMonth,
-        systemTime.wDay,
-        systemTime.wHour,
-        systemTime.wMinute,
-        systemTime.wSecond,
-        systemTime.wMilliseconds);
-    assert(printed < narrow_cast<int>(sizeof(timeStr)));
-    static_cast<void>(printed);
-
-    const char * levelString = nullptr;
-    switch (level) {
-        case Level::Debug: levelString = "DEBUG  "; break;
-        case Level::Info: levelString = "INFO   "; break;
-        case Level::Warning: levelString = "WARNING"; break;
-        case Level::Error: levelString = "ERROR  "; break;
-        default: {
-            levelString = "UNKNOWN";
-            assert(false);
-            break;
-        }
-    }
-
-    const std::string line = std::string(timeStr) + " - " + levelString + " - " + str;
-
-    OutputDebugStringA(line.c_str());
-
-    if (!started_) {
-        pendingLogs_.push_back(line);
+    const bool toLog = logged(level);
+    const bool toFlight = recorded(level);
+    if (!toLog && !toFlight) {
         return;
     }
 
-    if (enableLogging_ && (fileHandle_ != INVALID_HANDLE_VALUE)) {
-        DWORD bytesWritten = 0;
-        WriteFile(fileHandle_, line.c_str(), narrow_cast<DWORD>(line.size()), &bytesWritten, nullptr);
-        assert(bytesWritten == line.size());
+    const std::uint64_t timestamp = stamp();
+    if (toFlight) {
+        flight_.record(timestamp, static_cast<int>(level), FlightRecorder::Kind::Text, text);
+    }
+    if (toLog) {
+        write(level, timestamp, Ring::Kind::Text, text);
     }
 
     // #if defined(_DEBUG)
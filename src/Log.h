@@ -14,19 +14,49 @@
 
 #pragma once
 
+// App
+#include "LogBinary.h"
+#include "LogFormat.h"
+#include "LogOverflow.h"
+#include "LogRotation.h"
+
 // Standard library
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
+
+// Calls below this level are removed at compile time, 0 keeps everything and 3
+// keeps only errors. Calls at or above it are checked against the lower of the
+// runtime level and the flight recorder's level before their arguments are
+// evaluated, so a call below both costs one branch.
+#if !defined(LOG_LEVEL_MIN)
+#define LOG_LEVEL_MIN 0
+#endif
+
+// Each call site has a constant description, used by the binary log format,
+// and its own rate limit for debug and info lines, so a line that repeats in a
+// loop can't flood the log.
+#define LOG_PRINTF(level, fmt, ...) \
+    do { \
+        if constexpr (static_cast<int>(level) >= LOG_LEVEL_MIN) { \
+            if (Log::enabled(level)) { \
+                static constinit LogBinary::Site logSite { __FILE__, __LINE__, static_cast<int>(level), fmt }; \
+                if (Log::admit(level, logSite)) { \
+                    Log::log(logSite, level, fmt, ##__VA_ARGS__); \
+                } \
+            } \
+        } \
+    } while (false)
 
-#define DEBUG_PRINTF(fmt, ...) Log::printf(Log::Level::Debug, fmt, ##__VA_ARGS__)
-#define INFO_PRINTF(fmt, ...) Log::printf(Log::Level::Info, fmt, ##__VA_ARGS__)
-#define WARNING_PRINTF(fmt, ...) Log::printf(Log::Level::Warning, fmt, ##__VA_ARGS__)
-#define ERROR_PRINTF(fmt, ...) Log::printf(Log::Level::Error, fmt, ##__VA_ARGS__)
+#define DEBUG_PRINTF(fmt, ...) LOG_PRINTF(Log::Level::Debug, fmt, ##__VA_ARGS__)
+#define INFO_PRINTF(fmt, ...) LOG_PRINTF(Log::Level::Info, fmt, ##__VA_ARGS__)
+#define WARNING_PRINTF(fmt, ...) LOG_PRINTF(Log::Level::Warning, fmt, ##__VA_ARGS__)
+#define ERROR_PRINTF(fmt, ...) LOG_PRINTF(Log::Level::Error, fmt, ##__VA_ARGS__)
 
 namespace Log
 {
 
-void start(bool enable, const std::string & fileName);
-
 enum class Level
 {
     Debug,
@@ -35,7 +65,169 @@ enum class Level
     Error
 };
 
+struct Options
+{
+    Level level { Level::Debug }; // lines below this level are ignored
+    LogOverflow overflow { LogOverflow::Block };
+    LogFormat format { LogFormat::Text };
+    LogRotation::Policy rotation; // off unless a size or age limit is set
+    bool flightRecorder { true };
+    Level flightLevel { Level::Debug }; // calls below this level aren't kept by the flight recorder
+    unsigned int rateLimit { 20 }; // debug and info lines each call site can log in a window, zero for no limit
+    unsigned int rateLimitWarning { 50 }; // warnings each call site can log in a window, zero for no limit
+    unsigned int rateWindow { 10 }; // in seconds, zero turns off rate limits and collapsing repeated lines
+    bool monotonicTimestamps { false }; // seconds since start instead of the date and time, for text logs
+};
+
+// counts of lines that weren't written as usual, since the start
+struct Statistics
+{
+    std::uint64_t dropped {}; // because the log was full
+    std::uint64_t suppressed {}; // because their call site was over its rate limit
+    std::uint64_t repeated {}; // because they were the same as the line before, and were collapsed into a count
+};
+
+// Log lines are queued and written by a background thread. Lines logged before
+// start() are kept, and written to the file if logging to file is enabled.
+void start(bool enable, const std::string & fileName, const Options & options = {});
+
+// waits until everything logged so far has been written, this also happens for every error
+void flush() noexcept;
+
+// flushes and stops the background thread, anything logged afterwards is written immediately
+void stop() noexcept;
+
+// The flight recorder keeps the most recent calls in memory, at its own level,
+// whether or not they are logged. Calls with simple arguments are kept in the
+// binary format, and only formatted when they are saved. This saves them as
+// text next to the log file, and returns the file's path, or an empty string
+// if it couldn't be saved. They are also saved if the app crashes.
+std::string saveFlightRecorder();
+
+[[nodiscard]]
+Statistics statistics() noexcept;
+
+// the size of the largest call the flight recorder keeps completely
+inline constexpr size_t flightRecordSizeMax = 104;
+
+// the runtime level and format, only set by start()
+inline std::atomic<Level> level_ { Level::Debug };
+inline std::atomic<bool> binary_ {};
+inline std::atomic<bool> flightRecorder_ { true };
+inline std::atomic<Level> flightLevel_ { Level::Debug };
+inline std::atomic<Level> enabledLevel_ { Level::Debug }; // the lower of the two levels in use
+inline std::atomic<std::uint32_t> rateLimit_ {};
+inline std::atomic<std::uint32_t> rateLimitWarning_ {};
+
+// whether a call at this level is written to the log
+[[nodiscard]]
+inline bool logged(Level level) noexcept
+{
+    return level >= level_.load(std::memory_order_relaxed);
+}
+
+// whether a call at this level is kept by the flight recorder
+[[nodiscard]]
+inline bool recorded(Level level) noexcept
+{
+    return flightRecorder_.load(std::memory_order_relaxed) && (level >= flightLevel_.load(std::memory_order_relaxed));
+}
+
+// whether a call at this level is written to the log or kept by the flight recorder
+[[nodiscard]]
+inline bool enabled(Level level) noexcept
+{
+    return level >= enabledLevel_.load(std::memory_order_relaxed);
+}
+
+bool admitLimited(LogBinary::Site & site, std::uint32_t limit) noexcept;
+
+// whether a call site is under its rate limit, when it isn't the call only counts itself. Warnings have their own,
+// usually higher, limit, as some repeat for every window on every poll. Errors aren't limited.
+[[nodiscard]]
+inline bool admit(Level level, LogBinary::Site & site) noexcept
+{
+    if (level >= Level::Error) {
+        return true;
+    }
+    const std::uint32_t limit =
+        ((level == Level::Warning) ? rateLimitWarning_ : rateLimit_).load(std::memory_order_relaxed);
+    return !limit || admitLimited(site, limit);
+}
+
 void printf(Level level, const char * fmt, ...) noexcept;
-void print(Level level, const char * str) noexcept;
+void print(Level level, std::string_view text) noexcept;
+
+// A binary record being written. begin() returns space for the encoded
+// arguments, or nullptr if the record was dropped, and end() queues it.
+class BinaryRecord
+{
+public:
+    char * begin(Level level, LogBinary::Site & site, const char * types, size_t size) noexcept;
+    void end() noexcept;
+
+private:
+    std::string buffer_; // for records that don't fit in one ring slot
+    size_t position_ {};
+    size_t size_ {};
+    std::uint64_t timestamp_ {};
+    Level level_ {};
+};
+
+// gives a call site its id in the binary format the first time it's used
+std::uint32_t registerSite(LogBinary::Site & site, const char * types) noexcept;
+
+inline std::uint32_t siteId(LogBinary::Site & site, const char * types) noexcept
+{
+    const std::uint32_t id = site.id.load(std::memory_order_acquire);
+    return id ? id : registerSite(site, types);
+}
+
+void recordFlight(Level level, std::string_view data, bool binary, bool truncated) noexcept;
+
+// keeps a call in the flight recorder, a call that's too big only keeps its site
+template <typename... Args>
+void recordFlight(LogBinary::Site & site, Level level, const char * types, const Args &... args) noexcept
+{
+    char buffer[flightRecordSizeMax];
+    char * out = LogBinary::putVarint(buffer, siteId(site, types));
+    const size_t size = LogBinary::argumentsSize(args...);
+    const bool fits = size <= static_cast<size_t>((buffer + sizeof(buffer)) - out);
+    if (fits) {
+        out = LogBinary::putArguments(out, args...);
+    }
+    recordFlight(level, std::string_view(buffer, static_cast<size_t>(out - buffer)), true, !fits);
+}
+
+template <typename... Args>
+void log(LogBinary::Site & site, Level level, const char * fmt, const Args &... args) noexcept
+{
+    if constexpr ((LogBinary::Encodable<Args> && ...)) {
+        static constexpr auto types = LogBinary::types<Args...>();
+        if (recorded(level)) {
+            recordFlight(site, level, types.data(), args...);
+        }
+        if (!logged(level)) {
+            return;
+        }
+
+        if (binary_.load(std::memory_order_relaxed)) {
+            BinaryRecord record;
+            char * out = record.begin(level, site, types.data(), LogBinary::argumentsSize(args...));
+            if (out) {
+                LogBinary::putArguments(out, args...);
+                record.end();
+            }
+            return;
+        }
+    }
+
+    printf(level, fmt, args...);
+}
+
+bool levelValid(Level level) noexcept;
+const char * levelToCString(Level level) noexcept;
+// leaves level unchanged if the string isn't a level
+bool levelFromCString(const char * levelString, Level & level) noexcept;
 
 } // namespace Log
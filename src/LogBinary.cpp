@@ -0,0 +1,377 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "LogBinary.h"
+
+// Standard library
+#include <algorithm>
+#include <cstdio>
+
+namespace LogBinary
+{
+
+namespace
+{
+
+constexpr unsigned int recordTypeBits_ = 2;
+constexpr std::uint64_t recordTypeMask_ = (1U << recordTypeBits_) - 1;
+
+std::uint64_t key(std::uint64_t value, RecordType type) noexcept
+{
+    return (value << recordTypeBits_) | static_cast<std::uint64_t>(type);
+}
+
+void appendString(std::string & out, std::string_view string)
+{
+    appendVarint(out, string.size());
+    out += string;
+}
+
+bool getString(std::string_view & in, std::string_view & string) noexcept
+{
+    std::uint64_t size = 0;
+    if (!getVarint(in, size) || (size > in.size())) {
+        return false;
+    }
+    string = in.substr(0, static_cast<size_t>(size));
+    in.remove_prefix(static_cast<size_t>(size));
+    return true;
+}
+
+struct Argument
+{
+    Type type {};
+    std::uint64_t integer {};
+    double real {};
+    std::string_view string;
+};
+
+bool getArgument(std::string_view & in, Type type, Argument & argument) noexcept
+{
+    argument.type = type;
+    switch (type) {
+        case Type::Signed:
+        case Type::Unsigned:
+        case Type::Pointer: return getVarint(in, argument.integer);
+
+        case Type::Double: {
+            if (in.size() < sizeof(std::uint64_t)) {
+                return false;
+            }
+            std::uint64_t bits = 0;
+            for (unsigned int i = 0; i < sizeof(bits); ++i) {
+                bits |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(in[i])) << (i * 8);
+            }
+            in.remove_prefix(sizeof(bits));
+            argument.real = std::bit_cast<double>(bits);
+            return true;
+        }
+
+        case Type::String: return getString(in, argument.string);
+
+        default: return false;
+    }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+
+// formats one conversion, spec is everything from the % up to but not including the conversion character
+void formatArgument(std::string & out, std::string spec, char conversion, const Argument & argument)
+{
+    char buffer[128];
+    int printed = 0;
+
+    switch (conversion) {
+        case 'd':
+        case 'i': {
+            const auto value = (argument.type == Type::Signed) ? unzigzag(argument.integer)
+                                                               : static_cast<std::int64_t>(argument.integer);
+            spec += "lld";
+            printed = snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<long long>(value));
+            break;
+        }
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            // signed values passed to unsigned conversions are shown the way printf would show them
+            const auto value = (argument.type == Type::Signed) ? static_cast<std::uint64_t>(unzigzag(argument.integer))
+                                                               : argument.integer;
+            spec += "ll";
+            spec += conversion;
+            printed = snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<unsigned long long>(value));
+            break;
+        }
+
+        case 'c': {
+            spec += 'c';
+            const auto value = (argument.type == Type::Signed) ? unzigzag(argument.integer)
+                                                               : static_cast<std::int64_t>(argument.integer);
+            printed = snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<int>(value));
+            break;
+        }
+
+        case 'p': {
+            printed = snprintf(buffer, sizeof(buffer), "%016llX", static_cast<unsigned long long>(argument.integer));
+            break;
+        }
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            spec += conversion;
+            const double value = (argument.type == Type::Double) ? argument.real : static_cast<double>(argument.integer);
+            printed = snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+            break;
+        }
+
+        case 's': {
+            if (argument.type != Type::String) {
+                out += "(bad string)";
+                return;
+            }
+            // formatted separately, since strings can be longer than the buffer
+            spec += 's';
+            const std::string string(argument.string);
+            const int needed = snprintf(nullptr, 0, spec.c_str(), string.c_str());
+            if (needed > 0) {
+                std::string formatted(static_cast<size_t>(needed) + 1, '\0');
+                snprintf(formatted.data(), formatted.size(), spec.c_str(), string.c_str());
+                formatted.pop_back();
+                out += formatted;
+            }
+            return;
+        }
+
+        default: {
+            out += '%';
+            out += conversion;
+            return;
+        }
+    }
+
+    if (printed > 0) {
+        out.append(buffer, std::min(static_cast<size_t>(printed), sizeof(buffer) - 1));
+    }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+} // anonymous namespace
+
+bool format(std::string_view format, std::string_view types, std::string_view arguments, std::string & out)
+{
+    size_t argumentIndex = 0;
+    const auto nextArgument = [&](Argument & argument) {
+        if (argumentIndex >= types.size()) {
+            return false;
+        }
+        return getArgument(arguments, static_cast<Type>(types[argumentIndex++]), argument);
+    };
+
+    for (size_t i = 0; i < format.size(); ++i) {
+        const char c = format[i];
+        if (c != '%') {
+            out += c;
+            continue;
+        }
+
+        if ((i + 1 < format.size()) && (format[i + 1] == '%')) {
+            out += '%';
+            ++i;
+            continue;
+        }
+
+        // flags, width, and precision are kept, length modifiers are dropped since values are 64 bit
+        std::string spec = "%";
+        size_t j = i + 1;
+        for (; j < format.size(); ++j) {
+            const char s = format[j];
+            if ((s == '-') || (s == '+') || (s == ' ') || (s == '#') || (s == '0') || (s == '.') ||
+                ((s >= '1') && (s <= '9'))) {
+                spec += s;
+            } else if (s == '*') {
+                Argument width;
+                if (!nextArgument(width)) {
+                    return false;
+                }
+                spec += std::to_string(
+                    (width.type == Type::Signed) ? unzigzag(width.integer) : static_cast<std::int64_t>(width.integer));
+            } else if ((s == 'h') || (s == 'l') || (s == 'L') || (s == 'z') || (s == 'j') || (s == 't')) {
+                continue;
+            } else if (s == 'I') {
+                // Microsoft size prefixes, I, I32, and I64
+                const std::string_view size = format.substr(j + 1, 2);
+                if ((size == "32") || (size == "64")) {
+                    j += 2;
+                }
+            } else {
+                break;
+            }
+        }
+        if (j >= format.size()) {
+            out += format.substr(i);
+            break;
+        }
+
+        Argument argument;
+        if (!nextArgument(argument)) {
+            return false;
+        }
+        formatArgument(out, std::move(spec), format[j], argument);
+        i = j;
+    }
+
+    return (argumentIndex == types.size()) && arguments.empty();
+}
+
+void appendSite(std::string & out, std::uint32_t id, const Site & site)
+{
+    appendVarint(out, key(id, RecordType::Site));
+    appendVarint(out, static_cast<std::uint64_t>(site.level));
+    appendVarint(out, site.line);
+    appendString(out, site.file);
+    appendString(out, site.format);
+    appendString(out, site.types ? site.types : "");
+}
+
+void appendEvent(std::string & out, std::uint32_t id, std::int64_t timestampDelta, std::string_view arguments)
+{
+    appendVarint(out, key(id, RecordType::Event));
+    appendVarint(out, zigzag(timestampDelta));
+    appendString(out, arguments);
+}
+
+void appendText(std::string & out, int level, std::int64_t timestampDelta, std::string_view text)
+{
+    appendVarint(out, key(static_cast<std::uint64_t>(level), RecordType::Text));
+    appendVarint(out, zigzag(timestampDelta));
+    appendString(out, text);
+}
+
+void appendRaw(std::string & out, std::string_view text)
+{
+    appendVarint(out, key(0, RecordType::Raw));
+    appendString(out, text);
+}
+
+Reader::Reader(std::string_view data)
+    : data_(data)
+{
+    valid_ = data_.starts_with(magic);
+    if (valid_) {
+        data_.remove_prefix(magic.size());
+    } else {
+        error_ = "not a binary log file";
+    }
+}
+
+bool Reader::next(Record & record)
+{
+    while (valid_ && !data_.empty()) {
+        std::uint64_t recordKey = 0;
+        if (!getVarint(data_, recordKey)) {
+            return fail("truncated record");
+        }
+        const auto type = static_cast<RecordType>(recordKey & recordTypeMask_);
+        const std::uint64_t value = recordKey >> recordTypeBits_;
+
+        if (type == RecordType::Site) {
+            SiteInfo site;
+            std::uint64_t level = 0;
+            std::uint64_t line = 0;
+            std::string_view file;
+            std::string_view format;
+            std::string_view types;
+            if (!getVarint(data_, level) || !getVarint(data_, line) || !getString(data_, file) ||
+                !getString(data_, format) || !getString(data_, types)) {
+                return fail("truncated site");
+            }
+            if (value == 0) {
+                return fail("bad site id");
+            }
+            site.level = static_cast<int>(level);
+            site.line = static_cast<unsigned int>(line);
+            site.file = file;
+            site.format = format;
+            site.types = types;
+            // ids aren't in order, since sites are described when they first log, and a rotated file starts over
+            sites_[value] = std::move(site);
+            continue;
+        }
+
+        record.type = type;
+        record.site = nullptr;
+        record.text.clear();
+
+        if (type == RecordType::Raw) {
+            std::string_view text;
+            if (!getString(data_, text)) {
+                return fail("truncated raw text");
+            }
+            record.level = 0;
+            record.text = text;
+            return true;
+        }
+
+        std::uint64_t delta = 0;
+        std::string_view payload;
+        if (!getVarint(data_, delta) || !getString(data_, payload)) {
+            return fail("truncated record");
+        }
+        timestamp_ += static_cast<std::uint64_t>(unzigzag(delta));
+        record.timestamp = timestamp_;
+
+        if (type == RecordType::Text) {
+            record.level = static_cast<int>(value);
+            record.text = payload;
+            return true;
+        }
+
+        const auto siteIt = sites_.find(value);
+        if (siteIt == sites_.end()) {
+            return fail("event for unknown site");
+        }
+        const SiteInfo & site = siteIt->second;
+        record.site = &site;
+        record.level = site.level;
+        if (!LogBinary::format(site.format, site.types, payload, record.text)) {
+            record.text += " (arguments don't match format)\n";
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool Reader::fail(const char * error)
+{
+    error_ = error;
+    valid_ = false;
+    return false;
+}
+
+} // namespace LogBinary
@@ -0,0 +1,296 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "LogRateLimiter.h"
+
+// Standard library
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+// Binary log format. Instead of formatting a line of text, a log call records
+// the id of its call site, and its arguments in a compact encoding. Each call
+// site is described once in the file, with its format string and the types of
+// its arguments, so the file can be turned back into text later.
+//
+// A file starts with the magic bytes, followed by records. A record starts with
+// a varint key that holds the record type in the low two bits, and the site id
+// or level in the rest:
+//
+//   Site:  key, level, line, file, format, types
+//   Event: key, timestamp delta, argument size, arguments
+//   Text:  key, timestamp delta, text
+//   Raw:   key, text (lines that were already formatted)
+//
+// Integers are LEB128 varints, signed integers are zigzag encoded first,
+// strings and arguments are prefixed by their size, and timestamps are in 100
+// nanosecond units since 1601 (a Windows FILETIME), stored as the signed
+// difference from the previous timestamp in the file.
+namespace LogBinary
+{
+
+inline constexpr std::string_view magic { "FSTLOG\x01\n", 8 };
+
+enum class RecordType : std::uint8_t
+{
+    Site,
+    Event,
+    Text,
+    Raw
+};
+
+// argument types, as they appear in a site's type string
+enum class Type : char
+{
+    Signed = 'i',
+    Unsigned = 'u',
+    Double = 'f',
+    String = 's',
+    Pointer = 'p'
+};
+
+// A log call site, defined as a constant by the logging macros. The site is
+// registered the first time it logs in binary mode, which assigns its id.
+struct Site
+{
+    const char * file;
+    unsigned int line;
+    int level;
+    const char * format;
+    const char * types {}; // set when registered
+    std::atomic<std::uint32_t> id {}; // zero until registered
+    LogRateLimiter limiter {};
+};
+
+constexpr size_t varintSize(std::uint64_t value) noexcept
+{
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline char * putVarint(char * out, std::uint64_t value) noexcept
+{
+    while (value >= 0x80) {
+        *out++ = static_cast<char>(static_cast<std::uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+inline void appendVarint(std::string & out, std::uint64_t value)
+{
+    char buffer[10];
+    const char * end = putVarint(buffer, value);
+    out.append(buffer, static_cast<size_t>(end - buffer));
+}
+
+inline bool getVarint(std::string_view & in, std::uint64_t & value) noexcept
+{
+    value = 0;
+    for (unsigned int shift = 0; !in.empty() && (shift < 64); shift += 7) {
+        const auto byte = static_cast<std::uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr std::uint64_t zigzag(std::int64_t value) noexcept
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+constexpr std::int64_t unzigzag(std::uint64_t value) noexcept
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+template <typename T>
+using Decayed = std::remove_cvref_t<std::decay_t<T>>;
+
+template <typename T>
+concept Encodable = std::is_arithmetic_v<Decayed<T>> || std::is_enum_v<Decayed<T>> || std::is_pointer_v<Decayed<T>>;
+
+template <typename T>
+constexpr Type typeOf() noexcept
+{
+    using D = Decayed<T>;
+    if constexpr (std::is_same_v<D, const char *> || std::is_same_v<D, char *>) {
+        return Type::String;
+    } else if constexpr (std::is_pointer_v<D>) {
+        return Type::Pointer;
+    } else if constexpr (std::is_floating_point_v<D>) {
+        return Type::Double;
+    } else if constexpr (std::is_enum_v<D>) {
+        return std::is_signed_v<std::underlying_type_t<D>> ? Type::Signed : Type::Unsigned;
+    } else if constexpr (std::is_signed_v<D>) {
+        return Type::Signed;
+    } else {
+        return Type::Unsigned;
+    }
+}
+
+// the site's type string, one character per argument
+template <typename... Args>
+constexpr std::array<char, sizeof...(Args) + 1> types() noexcept
+{
+    return { static_cast<char>(typeOf<Args>())..., '\0' };
+}
+
+template <typename T>
+std::uint64_t integerValue(const T & value) noexcept
+{
+    using D = Decayed<T>;
+    if constexpr (std::is_enum_v<D>) {
+        return integerValue(static_cast<std::underlying_type_t<D>>(value));
+    } else if constexpr (std::is_pointer_v<D>) {
+        return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value));
+    } else if constexpr (std::is_signed_v<D>) {
+        return zigzag(static_cast<std::int64_t>(value));
+    } else {
+        return static_cast<std::uint64_t>(value);
+    }
+}
+
+inline const char * stringValue(const char * value) noexcept
+{
+    return value ? value : "(null)";
+}
+
+template <typename T>
+size_t argumentSize(const T & value) noexcept
+{
+    constexpr Type type = typeOf<T>();
+    if constexpr (type == Type::String) {
+        const size_t length = std::strlen(stringValue(value));
+        return varintSize(length) + length;
+    } else if constexpr (type == Type::Double) {
+        return sizeof(double);
+    } else {
+        return varintSize(integerValue(value));
+    }
+}
+
+template <typename T>
+char * putArgument(char * out, const T & value) noexcept
+{
+    constexpr Type type = typeOf<T>();
+    if constexpr (type == Type::String) {
+        const char * string = stringValue(value);
+        const size_t length = std::strlen(string);
+        out = putVarint(out, length);
+        std::memcpy(out, string, length);
+        return out + length;
+    } else if constexpr (type == Type::Double) {
+        const auto bits = std::bit_cast<std::uint64_t>(static_cast<double>(value));
+        for (unsigned int i = 0; i < sizeof(bits); ++i) {
+            *out++ = static_cast<char>(bits >> (i * 8));
+        }
+        return out;
+    } else {
+        return putVarint(out, integerValue(value));
+    }
+}
+
+template <typename... Args>
+size_t argumentsSize(const Args &... args) noexcept
+{
+    return (size_t { 0 } + ... + argumentSize(args));
+}
+
+template <typename... Args>
+char * putArguments(char * out, const Args &... args) noexcept
+{
+    (static_cast<void>(out = putArgument(out, args)), ...);
+    return out;
+}
+
+// formats encoded arguments with a printf style format string, returns false if the arguments don't match the types
+bool format(std::string_view format, std::string_view types, std::string_view arguments, std::string & out);
+
+// file records
+void appendSite(std::string & out, std::uint32_t id, const Site & site);
+void appendEvent(std::string & out, std::uint32_t id, std::int64_t timestampDelta, std::string_view arguments);
+void appendText(std::string & out, int level, std::int64_t timestampDelta, std::string_view text);
+void appendRaw(std::string & out, std::string_view text);
+
+// Reads a binary log file one record at a time, and keeps track of the sites
+// and the timestamp so events can be formatted.
+class Reader
+{
+public:
+    struct SiteInfo
+    {
+        int level {};
+        unsigned int line {};
+        std::string file;
+        std::string format;
+        std::string types;
+    };
+
+    struct Record
+    {
+        RecordType type {};
+        std::uint64_t timestamp {};
+        int level {};
+        const SiteInfo * site {}; // for events
+        std::string text; // formatted message
+    };
+
+    explicit Reader(std::string_view data);
+
+    [[nodiscard]]
+    bool valid() const noexcept
+    {
+        return valid_;
+    }
+
+    // returns false at the end of the data, or if the data is bad, in which case error() is set
+    bool next(Record & record);
+
+    [[nodiscard]]
+    const std::string & error() const noexcept
+    {
+        return error_;
+    }
+
+private:
+    bool fail(const char * error);
+
+    std::string_view data_;
+    std::uint64_t timestamp_ {};
+    std::unordered_map<std::uint64_t, SiteInfo> sites_;
+    std::string error_;
+    bool valid_ {};
+};
+
+} // namespace LogBinary
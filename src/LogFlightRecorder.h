@@ -0,0 +1,169 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Fixed size ring of the most recent log records, kept in memory so they can
+// be saved after something goes wrong, even when logging to a file is off.
+// New records overwrite the oldest, so recording never waits, and nothing is
+// done with the records unless they are read.
+//
+// Recording a record is a fetch_add to claim a slot, and a few stores. Each
+// slot has a sequence number that is odd while the slot is being written and
+// even once it's complete, and a reader copies a slot and then checks that the
+// sequence didn't change, skipping records that were overwritten while being
+// read (a seqlock). Slot contents are stored as relaxed atomic words, so this
+// is race free.
+template <size_t SlotCount>
+class LogFlightRecorder
+{
+public:
+    static_assert(std::has_single_bit(SlotCount));
+
+    static constexpr size_t slotCount = SlotCount;
+    static constexpr size_t slotSize = 128;
+    static constexpr size_t headerWords = 3; // sequence, timestamp, description
+    static constexpr size_t payloadWords = (slotSize / sizeof(std::uint64_t)) - headerWords;
+    static constexpr size_t payloadSize = payloadWords * sizeof(std::uint64_t);
+
+    enum class Kind : std::uint8_t
+    {
+        Text,
+        Binary // a site id followed by encoded arguments, see LogBinary.h
+    };
+
+    struct Record
+    {
+        std::uint64_t position {}; // increases by one for every record
+        std::uint64_t timestamp {};
+        int level {};
+        Kind kind {};
+        bool truncated {}; // the data was longer than payloadSize
+        std::string_view data;
+    };
+
+    LogFlightRecorder() noexcept = default;
+    LogFlightRecorder(const LogFlightRecorder &) = delete;
+    LogFlightRecorder(LogFlightRecorder &&) = delete;
+    LogFlightRecorder & operator=(const LogFlightRecorder &) = delete;
+    LogFlightRecorder & operator=(LogFlightRecorder &&) = delete;
+    ~LogFlightRecorder() = default;
+
+    // any thread, data longer than payloadSize is cut short
+    void record(std::uint64_t timestamp, int level, Kind kind, std::string_view data, bool truncated = false) noexcept
+    {
+        if (data.size() > payloadSize) {
+            data = data.substr(0, payloadSize);
+            truncated = true;
+        }
+
+        std::array<std::uint64_t, payloadWords> words {};
+        if (!data.empty()) {
+            std::memcpy(words.data(), data.data(), data.size());
+        }
+        const std::uint64_t description = data.size() | (static_cast<std::uint64_t>(level & 0xff) << 16) |
+            (static_cast<std::uint64_t>(kind) << 24) | (static_cast<std::uint64_t>(truncated) << 32);
+
+        const std::uint64_t position = next_.value.fetch_add(1, std::memory_order_relaxed);
+        Slot & slot = slots_[position & (SlotCount - 1)];
+
+        slot.sequence.store((position * 2) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp.store(timestamp, std::memory_order_relaxed);
+        slot.description.store(description, std::memory_order_relaxed);
+        const size_t used = (data.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+        for (size_t i = 0; i < used; ++i) {
+            slot.payload[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store((position * 2) + 2, std::memory_order_release);
+    }
+
+    // Any thread. Calls function(const Record &) for each complete record,
+    // oldest first. The record's data is only valid during the call. This
+    // doesn't allocate, so it can be used while handling a crash.
+    template <typename Function>
+    void read(Function && function) const
+    {
+        const std::uint64_t end = next_.value.load(std::memory_order_acquire);
+        const std::uint64_t begin = (end > SlotCount) ? (end - SlotCount) : 0;
+
+        std::array<std::uint64_t, payloadWords> words;
+        for (std::uint64_t position = begin; position < end; ++position) {
+            const Slot & slot = slots_[position & (SlotCount - 1)];
+            const std::uint64_t sequence = (position * 2) + 2;
+            if (slot.sequence.load(std::memory_order_acquire) != sequence) {
+                continue; // still being written, or already overwritten
+            }
+
+            Record record;
+            record.position = position;
+            record.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+            const std::uint64_t description = slot.description.load(std::memory_order_relaxed);
+            const size_t size = std::min(static_cast<size_t>(description & 0xffff), payloadSize);
+            const size_t used = (size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+            for (size_t i = 0; i < used; ++i) {
+                words[i] = slot.payload[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+
+            record.level = static_cast<int>((description >> 16) & 0xff);
+            record.kind = static_cast<Kind>((description >> 24) & 0xff);
+            record.truncated = ((description >> 32) & 1) != 0;
+            record.data = std::string_view(reinterpret_cast<const char *>(words.data()), size);
+            function(record);
+        }
+    }
+
+    // the number of records since the start, including those that have been overwritten
+    [[nodiscard]]
+    std::uint64_t recorded() const noexcept
+    {
+        return next_.value.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(slotSize) Slot
+    {
+        std::atomic<std::uint64_t> sequence {};
+        std::atomic<std::uint64_t> timestamp {};
+        std::atomic<std::uint64_t> description {}; // size, level, kind, and whether it was truncated
+        std::array<std::atomic<std::uint64_t>, payloadWords> payload {};
+    };
+
+    static_assert(sizeof(Slot) == slotSize);
+
+    // keeps the counter off the slots' cache lines
+    struct alignas(slotSize) Position
+    {
+        std::atomic<std::uint64_t> value;
+        std::array<char, slotSize - sizeof(std::atomic<std::uint64_t>)> padding;
+    };
+
+    std::array<Slot, SlotCount> slots_ {};
+    Position next_ {};
+};
@@ -0,0 +1,68 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "LogFormat.h"
+#include "Log.h"
+
+// Standard library
+#include <cstring>
+
+bool logFormatValid(LogFormat logFormat) noexcept
+{
+    switch (logFormat) {
+        case LogFormat::Text:
+        case LogFormat::Binary: {
+            return true;
+        }
+
+        case LogFormat::None:
+        default: {
+            WARNING_PRINTF("error, bad log format: %d\n", logFormat);
+            return false;
+        }
+    }
+}
+
+const char * logFormatToCString(LogFormat logFormat) noexcept
+{
+    switch (logFormat) {
+        case LogFormat::None: return "none";
+        case LogFormat::Text: return "text";
+        case LogFormat::Binary: return "binary";
+
+        default: {
+            WARNING_PRINTF("error, bad log format: %d\n", logFormat);
+            return "none";
+        }
+    }
+}
+
+LogFormat logFormatFromCString(const char * logFormatString) noexcept
+{
+    if (!strcmp(logFormatString, "none")) {
+        return LogFormat::None;
+    }
+
+    if (!strcmp(logFormatString, "text")) {
+        return LogFormat::Text;
+    }
+
+    if (!strcmp(logFormatString, "binary")) {
+        return LogFormat::Binary;
+    }
+
+    WARNING_PRINTF("error, bad log format string: '%s'\n", logFormatString);
+    return LogFormat::None;
+}
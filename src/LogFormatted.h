@@ -0,0 +1,89 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "Log.h"
+
+// Standard library
+#include <array>
+#include <cstddef>
+#include <format>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Logging with std::format format strings, which are checked when compiling,
+// so an argument that doesn't match its placeholder is a compile error rather
+// than a garbled line. Any type with a std::formatter can be logged, see
+// LogFormatters.h for window handles and error contexts. For example:
+//   DEBUG_LOG("minimized {} to the tray, {} windows hidden\n", hwnd, count);
+//
+// Lines are formatted into a buffer kept by each thread, so nothing is
+// allocated unless a line is longer than the buffer. They are logged as text,
+// also when the log file is in the binary format. Call sites are rate limited
+// the same as for the printf style macros.
+#define LOG_FORMATTED(level, fmt, ...) \
+    do { \
+        if constexpr (static_cast<int>(level) >= LOG_LEVEL_MIN) { \
+            if (Log::enabled(level)) { \
+                static constinit LogBinary::Site logSite { __FILE__, __LINE__, static_cast<int>(level), fmt }; \
+                if (Log::admit(level, logSite)) { \
+                    Log::formatted(level, fmt, ##__VA_ARGS__); \
+                } \
+            } \
+        } \
+    } while (false)
+
+#define DEBUG_LOG(fmt, ...) LOG_FORMATTED(Log::Level::Debug, fmt, ##__VA_ARGS__)
+#define INFO_LOG(fmt, ...) LOG_FORMATTED(Log::Level::Info, fmt, ##__VA_ARGS__)
+#define WARNING_LOG(fmt, ...) LOG_FORMATTED(Log::Level::Warning, fmt, ##__VA_ARGS__)
+#define ERROR_LOG(fmt, ...) LOG_FORMATTED(Log::Level::Error, fmt, ##__VA_ARGS__)
+
+namespace Log
+{
+
+inline constexpr size_t formatBufferSize = 1024;
+
+// formatters must not log with these macros themselves, since they'd overwrite the line being formatted
+inline std::array<char, formatBufferSize> & formatBuffer() noexcept
+{
+    thread_local std::array<char, formatBufferSize> buffer;
+    return buffer;
+}
+
+template <typename... Args>
+void formatted(Level level, std::format_string<Args...> fmt, Args &&... args) noexcept
+{
+    try {
+        std::array<char, formatBufferSize> & buffer = formatBuffer();
+        const auto result = std::format_to_n(
+            buffer.data(),
+            static_cast<std::ptrdiff_t>(buffer.size()),
+            fmt,
+            std::forward<Args>(args)...);
+        const auto size = static_cast<size_t>(result.size);
+        if (size <= buffer.size()) {
+            print(level, std::string_view(buffer.data(), size));
+        } else {
+            // longer lines are formatted again into their own string, the arguments weren't moved from
+            print(level, std::format(fmt, std::forward<Args>(args)...));
+        }
+    } catch (...) {
+        print(level, "(could not format log line)\n");
+    }
+}
+
+} // namespace Log
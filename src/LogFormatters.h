@@ -0,0 +1,114 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "ErrorContext.h"
+#include "Helpers.h"
+#include "LogFormatted.h"
+
+// Windows
+#include <Windows.h>
+
+// Standard library
+#include <cstdint>
+#include <format>
+
+// std::format support for app and Windows types, so they can be logged with
+// the macros in LogFormatted.h. None take format options, so they are written
+// as "{}".
+
+// Windows handles in hex, for example 0x3045e. Each handle type is its own
+// pointer type, so each needs a formatter. HANDLE itself is a void pointer,
+// which std::format already shows in hex.
+struct HandleFormatter
+{
+    constexpr auto parse(std::format_parse_context & context)
+    {
+        if ((context.begin() != context.end()) && (*context.begin() != '}')) {
+            throw std::format_error("handles don't take format options");
+        }
+        return context.begin();
+    }
+
+    template <typename Handle, typename FormatContext>
+    auto format(Handle handle, FormatContext & context) const
+    {
+        return std::format_to(context.out(), "{:#x}", reinterpret_cast<std::uintptr_t>(handle));
+    }
+};
+
+template <>
+struct std::formatter<HBITMAP> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HBRUSH> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HDC> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HICON> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HMENU> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HMODULE> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HWINEVENTHOOK> : HandleFormatter
+{
+};
+
+template <>
+struct std::formatter<HWND> : HandleFormatter
+{
+};
+
+// an error context as it's shown to the user, the error's resource string followed by the details
+template <>
+struct std::formatter<ErrorContext>
+{
+    constexpr auto parse(std::format_parse_context & context)
+    {
+        if ((context.begin() != context.end()) && (*context.begin() != '}')) {
+            throw std::format_error("error contexts don't take format options");
+        }
+        return context.begin();
+    }
+
+    template <typename FormatContext>
+    auto format(const ErrorContext & errorContext, FormatContext & context) const
+    {
+        auto out = std::format_to(context.out(), "{}", getResourceString(errorContext.errorId()));
+        if (!errorContext.errorString().empty()) {
+            out = std::format_to(out, ": {}", errorContext.errorString());
+        }
+        return out;
+    }
+};
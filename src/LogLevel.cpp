@@ -0,0 +1,82 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "Log.h"
+
+// Standard library
+#include <cstring>
+
+namespace Log
+{
+
+bool levelValid(Level level) noexcept
+{
+    switch (level) {
+        case Level::Debug:
+        case Level::Info:
+        case Level::Warning:
+        case Level::Error: {
+            return true;
+        }
+
+        default: {
+            WARNING_PRINTF("error, bad log level: %d\n", level);
+            return false;
+        }
+    }
+}
+
+const char * levelToCString(Level level) noexcept
+{
+    switch (level) {
+        case Level::Debug: return "debug";
+        case Level::Info: return "info";
+        case Level::Warning: return "warning";
+        case Level::Error: return "error";
+
+        default: {
+            WARNING_PRINTF("error, bad log level: %d\n", level);
+            return "debug";
+        }
+    }
+}
+
+bool levelFromCString(const char * levelString, Level & level) noexcept
+{
+    if (!strcmp(levelString, "debug")) {
+        level = Level::Debug;
+        return true;
+    }
+
+    if (!strcmp(levelString, "info")) {
+        level = Level::Info;
+        return true;
+    }
+
+    if (!strcmp(levelString, "warning")) {
+        level = Level::Warning;
+        return true;
+    }
+
+    if (!strcmp(levelString, "error")) {
+        level = Level::Error;
+        return true;
+    }
+
+    WARNING_PRINTF("error, bad log level string: '%s'\n", levelString);
+    return false;
+}
+
+} // namespace Log
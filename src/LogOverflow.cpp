@@ -0,0 +1,68 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "LogOverflow.h"
+#include "Log.h"
+
+// Standard library
+#include <cstring>
+
+bool logOverflowValid(LogOverflow logOverflow) noexcept
+{
+    switch (logOverflow) {
+        case LogOverflow::Block:
+        case LogOverflow::Drop: {
+            return true;
+        }
+
+        case LogOverflow::None:
+        default: {
+            WARNING_PRINTF("error, bad log overflow: %d\n", logOverflow);
+            return false;
+        }
+    }
+}
+
+const char * logOverflowToCString(LogOverflow logOverflow) noexcept
+{
+    switch (logOverflow) {
+        case LogOverflow::None: return "none";
+        case LogOverflow::Block: return "block";
+        case LogOverflow::Drop: return "drop";
+
+        default: {
+            WARNING_PRINTF("error, bad log overflow: %d\n", logOverflow);
+            return "none";
+        }
+    }
+}
+
+LogOverflow logOverflowFromCString(const char * logOverflowString) noexcept
+{
+    if (!strcmp(logOverflowString, "none")) {
+        return LogOverflow::None;
+    }
+
+    if (!strcmp(logOverflowString, "block")) {
+        return LogOverflow::Block;
+    }
+
+    if (!strcmp(logOverflowString, "drop")) {
+        return LogOverflow::Drop;
+    }
+
+    WARNING_PRINTF("error, bad log overflow string: '%s'\n", logOverflowString);
+    return LogOverflow::None;
+}
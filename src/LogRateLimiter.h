@@ -0,0 +1,100 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <atomic>
+#include <cstdint>
+
+// Limits how many lines a log call site writes in each window of time, so a
+// warning that repeats on every poll doesn't flood the log. Each site has one
+// of these, and the caller divides the time into numbered windows.
+//
+// The state is one word, with the window number in the high half and the
+// number of calls admitted in that window in the low half. Once a window is
+// full, a call only reads the state and bumps the suppressed count, which is a
+// plain load and store rather than an atomic increment, so the suppressed path
+// costs a few nanoseconds. The count can miss calls from threads racing each
+// other, which only makes it approximate. The first call in a new window swaps
+// in a fresh state, and takes the suppressed count to report it.
+class LogRateLimiter
+{
+public:
+    struct Result
+    {
+        bool admitted {};
+        std::uint32_t suppressed {}; // in the earlier window, only set for the first call in a window
+    };
+
+    constexpr LogRateLimiter() noexcept = default;
+    LogRateLimiter(const LogRateLimiter &) = delete;
+    LogRateLimiter(LogRateLimiter &&) = delete;
+    LogRateLimiter & operator=(const LogRateLimiter &) = delete;
+    LogRateLimiter & operator=(LogRateLimiter &&) = delete;
+    ~LogRateLimiter() = default;
+
+    // any thread, limit is the number of calls admitted in each window
+    Result admit(std::uint32_t window, std::uint32_t limit) noexcept
+    {
+        std::uint64_t state = state_.load(std::memory_order_relaxed);
+        if (windowOf(state) != window) {
+            // only one caller starts the new window, the others count themselves in it
+            const std::uint64_t fresh = (static_cast<std::uint64_t>(window) << 32) | 1;
+            if (state_.compare_exchange_strong(state, fresh, std::memory_order_relaxed)) {
+                const std::uint32_t suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+                if (suppressed) {
+                    suppressedTotal_.fetch_add(suppressed, std::memory_order_relaxed);
+                }
+                return { true, suppressed };
+            }
+        }
+
+        if ((countOf(state) < limit) && (countOf(state_.fetch_add(1, std::memory_order_relaxed)) < limit)) {
+            return { true, 0 };
+        }
+
+        suppressed_.store(suppressed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return { false, 0 };
+    }
+
+    // true only the first time it's called, so the caller can keep a list of limited sites
+    bool list() noexcept
+    {
+        return !listed_.load(std::memory_order_relaxed) && !listed_.exchange(true, std::memory_order_relaxed);
+    }
+
+    // calls suppressed so far, not counting the current window
+    [[nodiscard]]
+    std::uint64_t suppressedTotal() const noexcept
+    {
+        return suppressedTotal_.load(std::memory_order_relaxed);
+    }
+
+    // calls suppressed in the current window so far
+    [[nodiscard]]
+    std::uint32_t suppressedPending() const noexcept
+    {
+        return suppressed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::uint32_t windowOf(std::uint64_t state) noexcept { return static_cast<std::uint32_t>(state >> 32); }
+    static constexpr std::uint32_t countOf(std::uint64_t state) noexcept { return static_cast<std::uint32_t>(state); }
+
+    std::atomic<std::uint64_t> state_ {};
+    std::atomic<std::uint32_t> suppressed_ {};
+    std::atomic<std::uint64_t> suppressedTotal_ {};
+    std::atomic<bool> listed_ {};
+};
@@ -0,0 +1,244 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "Log.h"
+
+// Standard library
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Bounded lock-free queue of log records, with any number of producer threads
+// and a single consumer thread. Records live in fixed size slots, and a record
+// that doesn't fit in one slot takes several consecutive slots which are
+// claimed together.
+//
+// Every slot has a sequence number that says whose turn it is. The slot for
+// position pos is free for the producer that claims pos when its sequence is
+// pos, and holds a published record for the consumer when its sequence is
+// pos + 1. The consumer frees slots in order, so when the last slot of a span
+// is free, all of the slots before it are free as well.
+template <size_t SlotCount>
+class LogRing
+{
+public:
+    static_assert(std::has_single_bit(SlotCount));
+
+    static constexpr size_t slotSize = 256;
+    static constexpr size_t headerSize = 24;
+    static constexpr size_t payloadSize = slotSize - headerSize;
+    static constexpr size_t slotCount = SlotCount;
+
+    enum class Kind : std::uint8_t
+    {
+        Text,
+        Binary, // a site id followed by encoded arguments, see LogBinary.h
+        Padding // claimed but not used, skipped by the consumer
+    };
+
+    struct Record
+    {
+        std::uint64_t timestamp {};
+        Log::Level level {};
+        Kind kind {};
+    };
+
+    LogRing() noexcept
+    {
+        for (size_t i = 0; i < SlotCount; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRing(const LogRing &) = delete;
+    LogRing(LogRing &&) = delete;
+    LogRing & operator=(const LogRing &) = delete;
+    LogRing & operator=(LogRing &&) = delete;
+    ~LogRing() = default;
+
+    [[nodiscard]]
+    static constexpr size_t slotsFor(size_t size) noexcept
+    {
+        return (size == 0) ? 1 : ((size + payloadSize - 1) / payloadSize);
+    }
+
+    // claims count consecutive slots starting at position, fails when the ring is full
+    bool tryClaim(size_t count, size_t & position) noexcept
+    {
+        if ((count == 0) || (count > SlotCount)) {
+            return false;
+        }
+
+        size_t pos = enqueuePos_.value.load(std::memory_order_relaxed);
+        for (;;) {
+            const size_t last = pos + count - 1;
+            const size_t sequence = slot(last).sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - last);
+            if (difference == 0) {
+                if (enqueuePos_.value.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                    position = pos;
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // space for a record that fits in the single slot at a claimed position
+    [[nodiscard]]
+    char * payload(size_t position) noexcept
+    {
+        return slot(position).payload.data();
+    }
+
+    // copies a record into slots claimed with tryClaim(slotsFor(data.size()))
+    void write(size_t position, std::string_view data) noexcept
+    {
+        const size_t count = slotsFor(data.size());
+        for (size_t i = 0; i < count; ++i) {
+            const size_t offset = i * payloadSize;
+            const size_t size = std::min(payloadSize, data.size() - std::min(offset, data.size()));
+            if (size) {
+                std::memcpy(slot(position + i).payload.data(), data.data() + offset, size);
+            }
+        }
+    }
+
+    // hands a record in count claimed slots to the consumer
+    void publish(size_t position, size_t count, const Record & record, size_t size) noexcept
+    {
+        Slot & first = slot(position);
+        first.timestamp = record.timestamp;
+        first.size = static_cast<std::uint32_t>(size);
+        first.span = static_cast<std::uint16_t>(count);
+        first.level = static_cast<std::uint8_t>(record.level);
+        first.kind = record.kind;
+
+        // publish the tail first, so a complete first slot means a complete record
+        for (size_t i = count; i-- > 0;) {
+            slot(position + i).sequence.store(position + i + 1, std::memory_order_release);
+        }
+    }
+
+    // Consumer only. Calls function(const Record &, std::string_view) for each
+    // complete record in order, and stops at the first record that is still
+    // being written. Records that span slots are joined in scratch. Returns the
+    // number of records consumed, including padding.
+    template <typename Function>
+    size_t drain(Function && function, std::string & scratch, size_t maxRecords = SlotCount)
+    {
+        size_t records = 0;
+        size_t pos = dequeuePos_.value.load(std::memory_order_relaxed);
+        while (records < maxRecords) {
+            Slot & first = slot(pos);
+            if (first.sequence.load(std::memory_order_acquire) != (pos + 1)) {
+                break;
+            }
+
+            const size_t count = first.span;
+            const Record record { first.timestamp, static_cast<Log::Level>(first.level), first.kind };
+            if (record.kind != Kind::Padding) {
+                if (count == 1) {
+                    function(record, std::string_view(first.payload.data(), first.size));
+                } else {
+                    scratch.resize(first.size);
+                    for (size_t i = 0; i < count; ++i) {
+                        const size_t offset = i * payloadSize;
+                        const size_t size = std::min(payloadSize, scratch.size() - offset);
+                        std::memcpy(scratch.data() + offset, slot(pos + i).payload.data(), size);
+                    }
+                    function(record, std::string_view(scratch));
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                slot(pos + i).sequence.store(pos + i + SlotCount, std::memory_order_release);
+            }
+            pos += count;
+            dequeuePos_.value.store(pos, std::memory_order_release);
+            ++records;
+        }
+        return records;
+    }
+
+    // consumer only, whether the next record has been published
+    [[nodiscard]]
+    bool ready() const noexcept
+    {
+        const size_t pos = dequeuePos_.value.load(std::memory_order_relaxed);
+        return slot(pos).sequence.load(std::memory_order_acquire) == (pos + 1);
+    }
+
+    // the position after the last claimed slot
+    [[nodiscard]]
+    size_t claimed() const noexcept
+    {
+        return enqueuePos_.value.load(std::memory_order_acquire);
+    }
+
+    // the position after the last consumed slot
+    [[nodiscard]]
+    size_t consumed() const noexcept
+    {
+        return dequeuePos_.value.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<size_t> sequence;
+        std::uint64_t timestamp {};
+        std::uint32_t size {}; // of the whole record, only set in the first slot
+        std::uint16_t span {}; // slots in the record, only set in the first slot
+        std::uint8_t level {};
+        Kind kind {};
+        std::array<char, payloadSize> payload;
+    };
+
+    static_assert(sizeof(Slot) == slotSize);
+
+    Slot & slot(size_t position) noexcept
+    {
+        return slots_[position & (SlotCount - 1)];
+    }
+
+    [[nodiscard]]
+    const Slot & slot(size_t position) const noexcept
+    {
+        return slots_[position & (SlotCount - 1)];
+    }
+
+    // keeps producers and the consumer from sharing a cache line
+    struct alignas(64) Position
+    {
+        std::atomic<size_t> value;
+        std::array<char, 64 - sizeof(std::atomic<size_t>)> padding;
+    };
+
+    std::array<Slot, SlotCount> slots_;
+    Position enqueuePos_ {};
+    Position dequeuePos_ {};
+};
@@ -0,0 +1,315 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "LogRotation.h"
+#include "Gzip.h"
+
+// Standard library
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+
+namespace
+{
+
+// FILETIME counts 100 nanosecond intervals since 1601
+constexpr std::uint64_t unixEpoch_ = 116444736000000000ULL;
+constexpr std::uint64_t ticksPerSecond_ = 10000000;
+constexpr std::uint64_t ticksPerMillisecond_ = 10000;
+constexpr unsigned int archiveNameAttempts_ = 1000;
+
+constexpr std::string_view compressedExtension_ = ".gz";
+constexpr std::string_view temporaryExtension_ = ".gz.tmp";
+constexpr std::string_view stampPattern_ = "00000000-000000-000"; // zeros are digits
+
+// in the order they sort when they have the same name
+enum class Kind
+{
+    Compressed,
+    Plain,
+    Temporary // left behind by compression that was interrupted
+};
+
+struct Entry
+{
+    std::filesystem::path path;
+    std::string name; // the archive name without the compressed or temporary extension
+    Kind kind {};
+};
+
+std::string stamp(std::uint64_t timestamp)
+{
+    using namespace std::chrono;
+
+    const auto sinceEpoch = duration_cast<milliseconds>(
+        duration<std::int64_t, std::ratio<1, 10000000>>(static_cast<std::int64_t>(timestamp - unixEpoch_)));
+    const sys_time<milliseconds> time(sinceEpoch);
+    const sys_days day = floor<days>(time);
+    const year_month_day date(day);
+    const hh_mm_ss<milliseconds> clock(time - day);
+
+    char buffer[64];
+    std::snprintf(
+        buffer,
+        sizeof(buffer),
+        "%04d%02u%02u-%02d%02d%02d-%03d",
+        static_cast<int>(date.year()),
+        static_cast<unsigned int>(date.month()),
+        static_cast<unsigned int>(date.day()),
+        static_cast<int>(clock.hours().count()),
+        static_cast<int>(clock.minutes().count()),
+        static_cast<int>(clock.seconds().count()),
+        static_cast<int>(clock.subseconds().count()));
+    return buffer;
+}
+
+bool isStamp(std::string_view text) noexcept
+{
+    if (text.size() != stampPattern_.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        const bool digit = std::isdigit(static_cast<unsigned char>(text[i])) != 0;
+        if (digit != (stampPattern_[i] == '0')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool removeSuffix(std::string_view & text, std::string_view suffix) noexcept
+{
+    if (!text.ends_with(suffix)) {
+        return false;
+    }
+    text.remove_suffix(suffix.size());
+    return true;
+}
+
+// finds the archives of a log file, oldest first
+std::vector<Entry> scan(const std::string & path, std::error_code & errorCode)
+{
+    const std::filesystem::path logPath(path);
+    const std::string prefix = logPath.stem().string() + '-';
+    const std::string extension = logPath.extension().string();
+    const std::filesystem::path directory = logPath.has_parent_path() ? logPath.parent_path() : ".";
+
+    std::vector<Entry> entries;
+    for (std::filesystem::directory_iterator it(directory, errorCode), end; !errorCode && (it != end);
+         it.increment(errorCode)) {
+        const std::string fileName = it->path().filename().string();
+        std::string_view name = fileName;
+
+        Kind kind = Kind::Plain;
+        if (removeSuffix(name, temporaryExtension_)) {
+            kind = Kind::Temporary;
+        } else if (removeSuffix(name, compressedExtension_)) {
+            kind = Kind::Compressed;
+        }
+
+        std::string_view middle = name;
+        if (!middle.starts_with(prefix) || !removeSuffix(middle, extension)) {
+            continue;
+        }
+        middle.remove_prefix(prefix.size());
+        if (!isStamp(middle)) {
+            continue;
+        }
+
+        entries.push_back({ it->path(), std::string(name), kind });
+    }
+
+    // the stamps have a fixed width, so names sort in time order
+    std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+        return (a.name != b.name) ? (a.name < b.name) : (a.kind < b.kind);
+    });
+
+    return entries;
+}
+
+void addError(std::string & error, const std::string & message)
+{
+    if (!error.empty()) {
+        error += "; ";
+    }
+    error += message;
+}
+
+bool removeFile(const std::filesystem::path & path, std::string & error)
+{
+    std::error_code errorCode;
+    if (!std::filesystem::remove(path, errorCode) && errorCode) {
+        addError(error, "couldn't delete '" + path.string() + "': " + errorCode.message());
+        return false;
+    }
+    return true;
+}
+
+// replaces an archive with a compressed copy, writing to a temporary file first so a partial copy is never mistaken for
+// a complete one
+bool compress(const std::filesystem::path & path, std::string & error)
+{
+    std::string contents;
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            addError(error, "couldn't open '" + path.string() + "' for reading");
+            return false;
+        }
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (file.bad()) {
+            addError(error, "couldn't read '" + path.string() + "'");
+            return false;
+        }
+    }
+
+    const std::string compressed = Gzip::compress(contents);
+
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += temporaryExtension_;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+        file.close();
+        if (!file) {
+            addError(error, "couldn't write '" + temporaryPath.string() + "'");
+            static_cast<void>(removeFile(temporaryPath, error));
+            return false;
+        }
+    }
+
+    std::filesystem::path compressedPath = path;
+    compressedPath += compressedExtension_;
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryPath, compressedPath, errorCode);
+    if (errorCode) {
+        addError(
+            error,
+            "couldn't rename '" + temporaryPath.string() + "' to '" + compressedPath.string() +
+                "': " + errorCode.message());
+        static_cast<void>(removeFile(temporaryPath, error));
+        return false;
+    }
+
+    return removeFile(path, error);
+}
+
+} // anonymous namespace
+
+namespace LogRotation
+{
+
+bool Policy::due(std::uint64_t size, std::uint64_t opened, std::uint64_t now) const noexcept
+{
+    if (maxSize && (size >= maxSize)) {
+        return true;
+    }
+
+    return maxAge && (now > opened) && (((now - opened) / ticksPerSecond_) >= maxAge);
+}
+
+std::string archiveName(const std::string & path, std::uint64_t timestamp)
+{
+    const std::filesystem::path logPath(path);
+    std::filesystem::path archivePath = logPath;
+    archivePath.replace_filename(logPath.stem().string() + '-' + stamp(timestamp) + logPath.extension().string());
+    return archivePath.string();
+}
+
+std::string archive(const std::string & path, std::uint64_t timestamp, std::string & error)
+{
+    // rotations in the same millisecond get the next unused millisecond
+    for (unsigned int attempt = 0; attempt < archiveNameAttempts_; ++attempt) {
+        const std::string archivePath = archiveName(path, timestamp + (attempt * ticksPerMillisecond_));
+
+        std::error_code errorCode;
+        if (std::filesystem::exists(archivePath, errorCode) ||
+            std::filesystem::exists(archivePath + std::string(compressedExtension_), errorCode)) {
+            continue;
+        }
+
+        std::filesystem::rename(path, archivePath, errorCode);
+        if (errorCode) {
+            error = "couldn't rename '" + path + "' to '" + archivePath + "': " + errorCode.message();
+            return {};
+        }
+
+        return archivePath;
+    }
+
+    error = "no unused archive name for '" + path + "'";
+    return {};
+}
+
+std::vector<std::string> archives(const std::string & path)
+{
+    std::error_code errorCode;
+    std::vector<std::string> paths;
+    for (const Entry & entry : scan(path, errorCode)) {
+        if (entry.kind != Kind::Temporary) {
+            paths.push_back(entry.path.string());
+        }
+    }
+    return paths;
+}
+
+bool maintain(const std::string & path, const Policy & policy, std::string & error)
+{
+    std::error_code errorCode;
+    std::vector<Entry> entries = scan(path, errorCode);
+    if (errorCode) {
+        addError(error, "couldn't list archives of '" + path + "': " + errorCode.message());
+        return false;
+    }
+
+    bool success = true;
+
+    // drop leftovers from interrupted compression, which are temporary copies, and plain copies of archives that were
+    // compressed but not deleted
+    std::vector<Entry> archives;
+    for (Entry & entry : entries) {
+        const bool compressedCopy = !archives.empty() && (archives.back().name == entry.name);
+        if ((entry.kind == Kind::Temporary) || compressedCopy) {
+            success = removeFile(entry.path, error) && success;
+        } else {
+            archives.push_back(std::move(entry));
+        }
+    }
+
+    const size_t excess = (archives.size() > policy.keep) ? (archives.size() - policy.keep) : 0;
+    for (size_t i = 0; i < excess; ++i) {
+        success = removeFile(archives[i].path, error) && success;
+    }
+
+    if (policy.compress) {
+        for (size_t i = excess; i < archives.size(); ++i) {
+            if (archives[i].kind == Kind::Plain) {
+                success = compress(archives[i].path, error) && success;
+            }
+        }
+    }
+
+    return success;
+}
+
+} // namespace LogRotation
@@ -0,0 +1,65 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Log file rotation. When the log file gets too big or too old, it's renamed
+// to an archive with the time in its name, for example Finestray.log becomes
+// Finestray-20261018-114000-123.log, and a new log file is started. Archives
+// are compressed with gzip later, and the oldest are deleted so only a few
+// are kept.
+//
+// Times are in 100 nanosecond units since 1601 (a Windows FILETIME), the same
+// as log timestamps, and archive names use UTC so they sort in time order.
+namespace LogRotation
+{
+
+struct Policy
+{
+    std::uint64_t maxSize {}; // in bytes, zero for no limit
+    std::uint64_t maxAge {}; // in seconds, zero for no limit
+    unsigned int keep { 5 }; // number of archives to keep
+    bool compress { true };
+
+    [[nodiscard]]
+    bool enabled() const noexcept
+    {
+        return maxSize || maxAge;
+    }
+
+    // whether a log file of this size, opened at the given time, should be rotated
+    [[nodiscard]]
+    bool due(std::uint64_t size, std::uint64_t opened, std::uint64_t now) const noexcept;
+};
+
+// the archive name for a log file at a time
+std::string archiveName(const std::string & path, std::uint64_t timestamp);
+
+// renames a closed log file to an unused archive name, returns the archive's path or an empty string on failure
+std::string archive(const std::string & path, std::uint64_t timestamp, std::string & error);
+
+// the archives of a log file, oldest first
+std::vector<std::string> archives(const std::string & path);
+
+// Deletes the oldest archives beyond the number to keep, then compresses the
+// rest if they aren't yet. This can take a while, so it's meant to be run in
+// the background. Returns false if anything failed, with the reasons in error.
+bool maintain(const std::string & path, const Policy & policy, std::string & error);
+
+} // namespace LogRotation
@@ -0,0 +1,92 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "LogTimestamp.h"
+
+namespace
+{
+
+constexpr std::uint64_t ticksPerSecond_ = 10000000;
+constexpr std::uint64_t ticksPerMillisecond_ = 10000;
+constexpr size_t elapsedSecondsWidth_ = 6; // padded with spaces to this many digits
+constexpr size_t elapsedFractionDigits_ = 7;
+
+// writes value as digits digits, with leading zeros, and returns the end
+char * putDigits(char * out, std::uint64_t value, size_t digits) noexcept
+{
+    for (size_t i = digits; i > 0; --i) {
+        out[i - 1] = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    }
+    return out + digits;
+}
+
+} // anonymous namespace
+
+std::string_view LogTimestamp::dateTime(std::uint64_t timestamp) noexcept
+{
+    const std::uint64_t second = timestamp / ticksPerSecond_;
+    if (second != second_) {
+        Calendar calendar;
+        if (!toCalendar_(second * ticksPerSecond_, calendar)) {
+            calendar = {};
+        }
+
+        char * out = dateTime_.data();
+        out = putDigits(out, calendar.year, 4);
+        *out++ = '-';
+        out = putDigits(out, calendar.month, 2);
+        *out++ = '-';
+        out = putDigits(out, calendar.day, 2);
+        *out++ = ' ';
+        out = putDigits(out, calendar.hour, 2);
+        *out++ = ':';
+        out = putDigits(out, calendar.minute, 2);
+        *out++ = ':';
+        out = putDigits(out, calendar.second, 2);
+        *out = '.';
+        second_ = second;
+    }
+
+    putDigits(dateTime_.data() + dateTimeSize_ - 3, (timestamp % ticksPerSecond_) / ticksPerMillisecond_, 3);
+    return { dateTime_.data(), dateTime_.size() };
+}
+
+std::string_view LogTimestamp::elapsed(std::uint64_t timestamp, std::uint64_t since) noexcept
+{
+    const std::uint64_t ticks = (timestamp > since) ? (timestamp - since) : 0;
+
+    // the seconds are right aligned, so lines line up until they need more digits
+    std::array<char, 20> seconds;
+    char * secondsEnd = seconds.data() + seconds.size();
+    char * secondsStart = secondsEnd;
+    std::uint64_t value = ticks / ticksPerSecond_;
+    do {
+        *--secondsStart = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    } while (value);
+
+    char * out = elapsed_.data();
+    for (auto digits = static_cast<size_t>(secondsEnd - secondsStart); digits < elapsedSecondsWidth_; ++digits) {
+        *out++ = ' ';
+    }
+    while (secondsStart != secondsEnd) {
+        *out++ = *secondsStart++;
+    }
+    *out++ = '.';
+    out = putDigits(out, ticks % ticksPerSecond_, elapsedFractionDigits_);
+
+    return { elapsed_.data(), static_cast<size_t>(out - elapsed_.data()) };
+}
@@ -0,0 +1,69 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Formats log line timestamps. A date and time looks like
+// "2026-10-18 11:40:00.123", and only the milliseconds change between lines
+// logged in the same second, so the rest is kept and only converted to a
+// calendar time again when the second changes. Conversion is left to the
+// caller, since it depends on the platform's time zone support.
+//
+// Elapsed time, for measuring latency, looks like "    12.3456789", in seconds
+// with 100 nanosecond digits.
+//
+// Timestamps are in 100 nanosecond units, the same as a Windows FILETIME.
+// Each object has its own cache, so it's meant to be used by one thread.
+class LogTimestamp
+{
+public:
+    struct Calendar
+    {
+        unsigned int year {};
+        unsigned int month {};
+        unsigned int day {};
+        unsigned int hour {};
+        unsigned int minute {};
+        unsigned int second {};
+    };
+
+    // converts a timestamp to calendar time, returns false on failure
+    using ToCalendar = bool (*)(std::uint64_t timestamp, Calendar & calendar);
+
+    explicit constexpr LogTimestamp(ToCalendar toCalendar) noexcept
+        : toCalendar_(toCalendar)
+    {
+    }
+
+    // the date and time, valid until the next call
+    std::string_view dateTime(std::uint64_t timestamp) noexcept;
+
+    // the time since an earlier timestamp, valid until the next call
+    std::string_view elapsed(std::uint64_t timestamp, std::uint64_t since = 0) noexcept;
+
+private:
+    static constexpr size_t dateTimeSize_ = 23; // "YYYY-MM-DD hh:mm:ss.mmm"
+    static constexpr std::uint64_t noSecond_ = ~std::uint64_t { 0 };
+
+    ToCalendar toCalendar_;
+    std::uint64_t second_ { noSecond_ }; // of the cached date and time
+    std::array<char, dateTimeSize_> dateTime_ {};
+    std::array<char, 32> elapsed_ {};
+};
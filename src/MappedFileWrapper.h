@@ -0,0 +1,106 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "HandleWrapper.h"
+#include "Helpers.h"
+#include "Log.h"
+#include "StringUtility.h"
+
+// Windows
+#include <Windows.h>
+
+// Standard library
+#include <string>
+#include <string_view>
+
+// maps a whole file into memory for reading
+class MappedFileWrapper
+{
+public:
+    MappedFileWrapper() = delete;
+
+    explicit MappedFileWrapper(const std::string & fileName) noexcept
+    {
+        const HandleWrapper file(CreateFileA(
+            fileName.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart <= 0)) {
+            return;
+        }
+
+        // the view keeps the mapping alive, so the handles can be closed once it's created
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            WARNING_PRINTF(
+                "could not map '%s', CreateFileMappingA() failed: %s\n",
+                fileName.c_str(),
+                StringUtility::lastErrorString().c_str());
+            return;
+        }
+
+        view_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view_) {
+            WARNING_PRINTF(
+                "could not map '%s', MapViewOfFile() failed: %s\n",
+                fileName.c_str(),
+                StringUtility::lastErrorString().c_str());
+        } else {
+            size_ = narrow_cast<size_t>(fileSize.QuadPart);
+        }
+
+        if (!CloseHandle(mapping)) {
+            WARNING_PRINTF("failed to close file mapping %p: %lu\n", mapping, GetLastError());
+        }
+    }
+
+    ~MappedFileWrapper()
+    {
+        if (view_) {
+            if (!UnmapViewOfFile(view_)) {
+                WARNING_PRINTF("UnmapViewOfFile() failed: %lu\n", GetLastError());
+            }
+        }
+    }
+
+    MappedFileWrapper(const MappedFileWrapper &) = delete;
+    MappedFileWrapper(MappedFileWrapper &&) = delete;
+    MappedFileWrapper & operator=(const MappedFileWrapper &) = delete;
+    MappedFileWrapper & operator=(MappedFileWrapper &&) = delete;
+
+    [[nodiscard]]
+    std::string_view data() const noexcept
+    {
+        return { static_cast<const char *>(view_), size_ };
+    }
+
+    // NOLINTNEXTLINE(*-explicit-*)
+    operator bool() const noexcept { return view_ != nullptr; }
+
+private:
+    const void * view_ {};
+    size_t size_ {};
+};
@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -35,7 +36,7 @@ public:
     {
         if (hmenu_) {
             if (!DestroyMenu(hmenu_)) {
-                WARNING_PRINTF("failed to destroy menu %#x: %lu\n", hmenu_, GetLastError());
+                WARNING_LOG("failed to destroy menu {}: {}\n", hmenu_, GetLastError());
             }
         }
     }
@@ -0,0 +1,307 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// App
+#include "MenuIcons.h"
+#include "Bitmap.h"
+#include "BitmapHandleWrapper.h"
+#include "DeviceContextHandleWrapper.h"
+#include "IconAtlas.h"
+#include "IconHandleWrapper.h"
+#include "Log.h"
+#include "PixelKernels.h"
+#include "StringUtility.h"
+#include "WindowIcon.h"
+
+// Standard library
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace
+{
+
+// Enough for the windows of a couple of hundred apps. A cell is 16 pixels
+// square at 96 DPI, so the atlas is 256 KB, and four times that at 192 DPI.
+constexpr size_t cellCount_ = 256;
+
+// the app's own bitmaps are keyed apart from the hashed icon cache keys
+constexpr IconAtlas::Key resourceKey_ = 0xffffffff00000000ULL;
+
+constexpr std::uint32_t colorMask_ = 0x00ffffff;
+
+IconAtlas atlas_(cellCount_);
+std::vector<bool> forget_(cellCount_); // cells with a window's own icon, which may differ next time
+BitmapHandleWrapper atlasBitmap_;
+std::unique_ptr<DeviceContextHandleWrapper> atlasDC_;
+std::uint32_t * pixels_;
+int cellSize_;
+DWORD menuColor_;
+
+bool create();
+template <typename Draw>
+MenuIcons::Icon acquire(IconAtlas::Key key, bool forget, Draw && drawIcon);
+std::span<std::uint32_t> getCellPixels(size_t cell) noexcept;
+void fillCell(size_t cell) noexcept;
+bool drawWindowIcon(size_t cell, HWND hwnd);
+bool drawResource(size_t cell, unsigned int id, bool transparent);
+
+} // anonymous namespace
+
+namespace MenuIcons
+{
+
+Icon acquireWindow(HWND hwnd)
+{
+    // a window whose icon isn't cached by app has its own, keyed by the window
+    std::uint64_t key = 0;
+    const bool cached = WindowIcon::cacheKey(hwnd, key);
+    if (!cached) {
+        key = reinterpret_cast<std::uintptr_t>(hwnd);
+    }
+
+    return acquire(key, !cached, [hwnd](size_t cell) { return drawWindowIcon(cell, hwnd); });
+}
+
+Icon acquireResource(unsigned int id, bool transparent)
+{
+    return acquire(resourceKey_ | id, false, [id, transparent](size_t cell) {
+        return drawResource(cell, id, transparent);
+    });
+}
+
+void release(Icon icon) noexcept
+{
+    if (icon) {
+        const size_t cell = icon - 1;
+        atlas_.release(cell, forget_[cell]);
+    }
+}
+
+void updateColors()
+{
+    const DWORD menuColor = GetSysColor(COLOR_MENU);
+    if (menuColor != menuColor_) {
+        DEBUG_PRINTF("menu color changed, menu icons will be drawn again\n");
+        atlas_.clear();
+        menuColor_ = menuColor;
+    }
+}
+
+bool measure(MEASUREITEMSTRUCT & measureItem) noexcept
+{
+    if ((measureItem.CtlType != ODT_MENU) || !measureItem.itemData) {
+        return false;
+    }
+
+    measureItem.itemWidth = static_cast<UINT>(cellSize_);
+    measureItem.itemHeight = static_cast<UINT>(cellSize_);
+    return true;
+}
+
+bool draw(const DRAWITEMSTRUCT & drawItem) noexcept
+{
+    if ((drawItem.CtlType != ODT_MENU) || !drawItem.itemData || !atlasDC_) {
+        return false;
+    }
+
+    // centered in the space the menu gives it
+    const RECT & rect = drawItem.rcItem;
+    const int x = rect.left + (((rect.right - rect.left) - cellSize_) / 2);
+    const int y = rect.top + (((rect.bottom - rect.top) - cellSize_) / 2);
+    const auto top = static_cast<int>(drawItem.itemData - 1) * cellSize_;
+    if (!BitBlt(drawItem.hDC, x, y, cellSize_, cellSize_, *atlasDC_, 0, top, SRCCOPY)) {
+        WARNING_PRINTF("failed to draw menu icon, BitBlt() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+    return true;
+}
+
+void stop()
+{
+    const IconAtlas::Statistics statistics = atlas_.statistics();
+    INFO_PRINTF(
+        "menu icons: %llu drawn, %llu found, %llu evicted, %llu didn't fit, %zu of %zu cells with an icon\n",
+        static_cast<unsigned long long>(statistics.draws),
+        static_cast<unsigned long long>(statistics.hits),
+        static_cast<unsigned long long>(statistics.evictions),
+        static_cast<unsigned long long>(statistics.full),
+        statistics.size,
+        atlas_.cellCount());
+
+    atlasDC_.reset();
+    atlasBitmap_.destroy();
+    pixels_ = nullptr;
+    atlas_.clear();
+}
+
+} // namespace MenuIcons
+
+namespace
+{
+
+// the atlas is a column of cells, top down so each cell's pixels are in one piece
+bool create()
+{
+    DEBUG_PRINTF("creating menu icon atlas\n");
+
+    cellSize_ = GetSystemMetrics(SM_CXMENUCHECK);
+
+    BITMAPINFO bitmapInfo;
+    memset(&bitmapInfo, 0, sizeof(bitmapInfo));
+    bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bitmapInfo.bmiHeader.biWidth = cellSize_;
+    bitmapInfo.bmiHeader.biHeight = -(cellSize_ * static_cast<int>(cellCount_));
+    bitmapInfo.bmiHeader.biPlanes = 1;
+    bitmapInfo.bmiHeader.biBitCount = 32;
+    bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+    void * bits = nullptr;
+    atlasBitmap_ = BitmapHandleWrapper(CreateDIBSection(nullptr, &bitmapInfo, DIB_RGB_COLORS, &bits, nullptr, 0));
+    if (!atlasBitmap_ || !bits) {
+        WARNING_PRINTF(
+            "failed to create menu icon atlas, CreateDIBSection() failed: %s\n",
+            StringUtility::lastErrorString().c_str());
+        atlasBitmap_.destroy();
+        return false;
+    }
+
+    atlasDC_ = std::make_unique<DeviceContextHandleWrapper>(
+        CreateCompatibleDC(nullptr),
+        DeviceContextHandleWrapper::Created);
+    if (!*atlasDC_ || !atlasDC_->selectObject(atlasBitmap_)) {
+        WARNING_PRINTF("failed to select menu icon atlas: %s\n", StringUtility::lastErrorString().c_str());
+        atlasDC_.reset();
+        atlasBitmap_.destroy();
+        return false;
+    }
+
+    pixels_ = static_cast<std::uint32_t *>(bits);
+    menuColor_ = GetSysColor(COLOR_MENU);
+    atlas_.clear();
+    return true;
+}
+
+template <typename Draw>
+MenuIcons::Icon acquire(IconAtlas::Key key, bool forget, Draw && drawIcon)
+{
+    if (!atlasDC_ && !create()) {
+        return 0;
+    }
+
+    size_t cell = 0;
+    bool draw = false;
+    if (!atlas_.acquire(key, cell, draw)) {
+        WARNING_PRINTF("menu icon atlas is full, all %zu icons are in use\n", atlas_.cellCount());
+        return 0;
+    }
+
+    forget_[cell] = forget;
+    if (draw && !drawIcon(cell)) {
+        atlas_.release(cell, true);
+        return 0;
+    }
+
+    return cell + 1;
+}
+
+std::span<std::uint32_t> getCellPixels(size_t cell) noexcept
+{
+    const auto size = static_cast<size_t>(cellSize_) * static_cast<size_t>(cellSize_);
+    return { pixels_ + (cell * size), size };
+}
+
+// Fills the cell with the menu color, as a DIB pixel, so with red and blue
+// swapped from a COLORREF. GDI may still be drawing into the atlas, so it's
+// flushed before the pixels are touched.
+void fillCell(size_t cell) noexcept
+{
+    GdiFlush();
+    const std::uint32_t menuPixel = RGB(GetBValue(menuColor_), GetGValue(menuColor_), GetRValue(menuColor_));
+    std::ranges::fill(getCellPixels(cell), menuPixel);
+}
+
+bool drawWindowIcon(size_t cell, HWND hwnd)
+{
+    const IconHandleWrapper icon = WindowIcon::get(hwnd);
+    if (!icon) {
+        return false;
+    }
+
+    fillCell(cell);
+    const int top = static_cast<int>(cell) * cellSize_;
+    if (!DrawIconEx(*atlasDC_, 0, top, icon, cellSize_, cellSize_, 0, nullptr, DI_NORMAL)) {
+        WARNING_PRINTF("failed to draw icon, DrawIconEx() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return false;
+    }
+    return true;
+}
+
+// The bitmap is drawn at its own size in the middle of the cell, or shrunk
+// to fit if it's bigger. The pixels' top bytes are cleared, so the white and
+// black can be found.
+bool drawResource(size_t cell, unsigned int id, bool transparent)
+{
+    const BitmapHandleWrapper bitmap = Bitmap::getResource(id);
+    if (!bitmap) {
+        return false;
+    }
+
+    BITMAP bm;
+    memset(&bm, 0, sizeof(bm));
+    if (!GetObject(bitmap, sizeof(bm), &bm)) {
+        WARNING_PRINTF("failed to get bm object, GetObject() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return false;
+    }
+
+    DeviceContextHandleWrapper bitmapDC(CreateCompatibleDC(*atlasDC_), DeviceContextHandleWrapper::Created);
+    if (!bitmapDC || !bitmapDC.selectObject(bitmap)) {
+        return false;
+    }
+
+    fillCell(cell);
+    const int top = static_cast<int>(cell) * cellSize_;
+    BOOL drawn = FALSE;
+    if ((bm.bmWidth <= cellSize_) && (bm.bmHeight <= cellSize_)) {
+        const int x = (cellSize_ - bm.bmWidth) / 2;
+        const int y = top + ((cellSize_ - bm.bmHeight) / 2);
+        drawn = BitBlt(*atlasDC_, x, y, bm.bmWidth, bm.bmHeight, bitmapDC, 0, 0, SRCCOPY);
+    } else {
+        SetStretchBltMode(*atlasDC_, HALFTONE);
+        drawn = StretchBlt(*atlasDC_, 0, top, cellSize_, cellSize_, bitmapDC, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY);
+    }
+    if (!drawn) {
+        WARNING_PRINTF("failed to draw bitmap %u: %s\n", id, StringUtility::lastErrorString().c_str());
+        return false;
+    }
+
+    GdiFlush();
+    const std::span<std::uint32_t> pixels = getCellPixels(cell);
+    for (std::uint32_t & pixel : pixels) {
+        pixel &= colorMask_;
+    }
+    if (transparent) {
+        const std::uint32_t menuPixel = RGB(GetBValue(menuColor_), GetGValue(menuColor_), GetRValue(menuColor_));
+        const PixelKernels::ColorReplacement replacements[] = {
+            { RGB(0xFF, 0xFF, 0xFF), menuPixel },
+            { RGB(0x00, 0x00, 0x00), menuPixel },
+        };
+        PixelKernels::replaceColors(pixels, replacements);
+    }
+    return true;
+}
+
+} // anonymous namespace
@@ -0,0 +1,59 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+// Windows
+#include <Windows.h>
+
+// The context menu's icons, the windows' and the app's own, are drawn into
+// one 32 bit DIB, an atlas of cells the size of a menu check mark, see
+// IconAtlas.h, and each menu item draws its icon from there rather than
+// having a bitmap of its own. Window icons are keyed by their app's key in
+// the icon cache, so the windows of an app share a cell. The atlas is kept
+// between shows and only drawn into for icons it doesn't have, so showing
+// the menu makes no GDI objects, and its icons are one bitmap however many
+// windows there are.
+//
+// Menu items show an icon with HBMMENU_CALLBACK as their bitmap and the icon
+// as their item data, and the menu's window passes WM_MEASUREITEM and
+// WM_DRAWITEM on to measure() and draw().
+namespace MenuIcons
+{
+
+// an icon held in the atlas, zero for none
+using Icon = ULONG_PTR;
+
+// Holds the window's icon until it's released, drawing it into the atlas if
+// it isn't there. Returns zero if the atlas is full or it can't be drawn.
+Icon acquireWindow(HWND hwnd);
+
+// the same for one of the app's bitmaps, with its white and black made the menu color if it's transparent
+Icon acquireResource(unsigned int id, bool transparent);
+
+void release(Icon icon) noexcept;
+
+// Forgets the icons if the menu color changed since they were drawn, since
+// they're drawn on it. Every icon must be released first.
+void updateColors();
+
+// answer WM_MEASUREITEM and WM_DRAWITEM for a menu item's icon, false if it's not one of ours
+bool measure(MEASUREITEMSTRUCT & measureItem) noexcept;
+bool draw(const DRAWITEMSTRUCT & drawItem) noexcept;
+
+// logs how well the atlas did, and destroys it
+void stop();
+
+} // namespace MenuIcons
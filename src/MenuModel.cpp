@@ -0,0 +1,285 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "MenuModel.h"
+
+// Standard library
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+
+using MenuModel::Item;
+using MenuModel::ItemKind;
+
+std::string shorten(const std::string & title, size_t lengthMax)
+{
+    const std::string_view ellipsis = "...";
+    if ((title.length() <= lengthMax) || (lengthMax <= ellipsis.length())) {
+        return title;
+    }
+
+    std::string shortened = title.substr(0, lengthMax - ellipsis.length());
+    shortened += ellipsis; // FIX - localize this?
+    return shortened;
+}
+
+// Splits the items into pages, submenus labeled with the numbers of the items
+// on them, and then the pages into pages, until they fit.
+std::vector<Item> paginate(std::vector<Item> items, size_t pageSize)
+{
+    if ((pageSize < 2) || (items.size() <= pageSize)) {
+        return items;
+    }
+
+    // the numbers of the first and last of the original items each item holds
+    std::vector<std::pair<size_t, size_t>> numbers(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        numbers[i] = { i + 1, i + 1 };
+    }
+
+    while (items.size() > pageSize) {
+        std::vector<Item> pages;
+        std::vector<std::pair<size_t, size_t>> pageNumbers;
+        for (size_t start = 0; start < items.size(); start += pageSize) {
+            const size_t end = std::min(start + pageSize, items.size());
+            const std::pair<size_t, size_t> range = { numbers[start].first, numbers[end - 1].second };
+
+            Item page;
+            page.kind = ItemKind::Submenu;
+            page.label = std::to_string(range.first) + "-" + std::to_string(range.second);
+            page.children.assign(
+                std::make_move_iterator(items.begin() + static_cast<std::ptrdiff_t>(start)),
+                std::make_move_iterator(items.begin() + static_cast<std::ptrdiff_t>(end)));
+            pages.push_back(std::move(page));
+            pageNumbers.push_back(range);
+        }
+        items = std::move(pages);
+        numbers = std::move(pageNumbers);
+    }
+
+    return items;
+}
+
+void diffLevel(
+    const std::vector<Item> & before,
+    const std::vector<Item> & after,
+    std::vector<size_t> & path,
+    std::vector<MenuModel::Edit> & edits)
+{
+    using MenuModel::EditKind;
+
+    // the same items at the start and the end are left alone
+    const size_t shorter = std::min(before.size(), after.size());
+    size_t prefix = 0;
+    while ((prefix < shorter) && (before[prefix] == after[prefix])) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while ((prefix + suffix < shorter) &&
+           (before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix])) {
+        ++suffix;
+    }
+
+    const size_t beforeCount = before.size() - prefix - suffix;
+    const size_t afterCount = after.size() - prefix - suffix;
+    const size_t common = std::min(beforeCount, afterCount);
+    for (size_t i = 0; i < common; ++i) {
+        const size_t position = prefix + i;
+        const Item & from = before[position];
+        const Item & to = after[position];
+        if (from == to) {
+            continue;
+        }
+
+        if ((from.kind == ItemKind::Submenu) && (to.kind == ItemKind::Submenu)) {
+            if (from.label != to.label) {
+                edits.push_back({ EditKind::Update, path, position, &to });
+            }
+            path.push_back(position);
+            diffLevel(from.children, to.children, path, edits);
+            path.pop_back();
+        } else if ((from.kind == to.kind) && (to.kind != ItemKind::Separator)) {
+            edits.push_back({ EditKind::Update, path, position, &to });
+        } else {
+            edits.push_back({ EditKind::Remove, path, position, nullptr });
+            edits.push_back({ EditKind::Insert, path, position, &to });
+        }
+    }
+
+    for (size_t i = common; i < afterCount; ++i) {
+        edits.push_back({ EditKind::Insert, path, prefix + i, &after[prefix + i] });
+    }
+    for (size_t i = common; i < beforeCount; ++i) {
+        edits.push_back({ EditKind::Remove, path, prefix + common, nullptr });
+    }
+}
+
+} // anonymous namespace
+
+namespace MenuModel
+{
+
+Item separator()
+{
+    return {};
+}
+
+Item command(unsigned int id, std::string label)
+{
+    Item item;
+    item.kind = ItemKind::Command;
+    item.id = id;
+    item.label = std::move(label);
+    return item;
+}
+
+WindowIds::WindowIds(unsigned int first, unsigned int last)
+    : first_(first)
+    , last_(last)
+    , next_(first)
+{
+}
+
+unsigned int WindowIds::acquire(WindowId window)
+{
+    const auto found = ids_.find(window);
+    if (found != ids_.end()) {
+        found->second.used = true;
+        return found->second.id;
+    }
+
+    unsigned int id = 0;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    } else if (next_ <= last_) {
+        id = next_++;
+        windows_.resize(next_ - first_);
+    } else {
+        return 0;
+    }
+
+    ids_.emplace(window, Entry { id, true });
+    windows_[id - first_] = window;
+    return id;
+}
+
+void WindowIds::releaseUnused()
+{
+    for (auto it = ids_.begin(); it != ids_.end();) {
+        if (it->second.used) {
+            it->second.used = false;
+            ++it;
+        } else {
+            windows_[it->second.id - first_] = 0;
+            free_.push_back(it->second.id);
+            it = ids_.erase(it);
+        }
+    }
+}
+
+WindowId WindowIds::window(unsigned int id) const noexcept
+{
+    if ((id < first_) || (id - first_ >= windows_.size())) {
+        return 0;
+    }
+    return windows_[id - first_];
+}
+
+size_t appendSection(std::vector<Item> & items, const Section & section, WindowIds & ids, const Layout & layout)
+{
+    size_t missing = 0;
+    const auto makeItem = [&ids, &layout, &missing](const Window & window, std::vector<Item> & windowItems) {
+        const unsigned int id = ids.acquire(window.window);
+        if (!id) {
+            ++missing;
+            return;
+        }
+
+        Item item;
+        item.kind = ItemKind::Window;
+        item.id = id;
+        item.label = shorten(window.title, layout.titleLengthMax);
+        item.window = window.window;
+        windowItems.push_back(std::move(item));
+    };
+
+    std::vector<Item> windowItems;
+    if (section.windows.size() > layout.groupThreshold) {
+        // groups are in the order of their first window, with their windows in order
+        std::unordered_map<std::string_view, size_t> groupIndexes;
+        std::vector<std::vector<const Window *>> groups;
+        for (const Window & window : section.windows) {
+            if (window.group.empty()) {
+                groups.push_back({ &window });
+                continue;
+            }
+            const auto [it, added] = groupIndexes.try_emplace(window.group, groups.size());
+            if (added) {
+                groups.emplace_back();
+            }
+            groups[it->second].push_back(&window);
+        }
+
+        for (const std::vector<const Window *> & group : groups) {
+            if (group.size() == 1) {
+                makeItem(*group.front(), windowItems);
+                continue;
+            }
+
+            std::vector<Item> groupItems;
+            for (const Window * window : group) {
+                makeItem(*window, groupItems);
+            }
+            if (groupItems.empty()) {
+                continue;
+            }
+
+            Item submenu;
+            submenu.kind = ItemKind::Submenu;
+            submenu.label = shorten(group.front()->group, layout.titleLengthMax) + " (" +
+                std::to_string(groupItems.size()) + ")";
+            submenu.children = paginate(std::move(groupItems), layout.pageSize);
+            windowItems.push_back(std::move(submenu));
+        }
+    } else {
+        for (const Window & window : section.windows) {
+            makeItem(window, windowItems);
+        }
+    }
+
+    if (windowItems.empty()) {
+        return missing;
+    }
+
+    std::vector<Item> pages = paginate(std::move(windowItems), layout.pageSize);
+    items.insert(items.end(), std::make_move_iterator(pages.begin()), std::make_move_iterator(pages.end()));
+    items.push_back(separator());
+    items.push_back(command(section.allId, section.allLabel));
+    items.push_back(separator());
+    return missing;
+}
+
+void diff(const std::vector<Item> & before, const std::vector<Item> & after, std::vector<Edit> & edits)
+{
+    std::vector<size_t> path;
+    diffLevel(before, after, path, edits);
+}
+
+} // namespace MenuModel
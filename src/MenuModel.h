@@ -0,0 +1,154 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What the context menu shows, as plain data, and the edits that turn one
+// menu into another, which ContextMenu.cpp applies to a Win32 menu.
+//
+// Windows are listed in sections, visible and minimized, each followed by a
+// command for all of its windows. A section with many windows has windows of
+// the same app grouped into a submenu for the app, and any menu with more
+// items than fit on a page is split into submenus of a page each, so the
+// menu stays usable with thousands of windows.
+//
+// Each window keeps the same item ID for as long as it's in its section, so
+// an ID picked from a menu shown a moment ago still means the same window,
+// and a window that moves doesn't change its ID.
+namespace MenuModel
+{
+
+using WindowId = std::uintptr_t; // a window handle
+
+enum class ItemKind
+{
+    Separator,
+    Command,
+    Window,
+    Submenu
+};
+
+struct Item
+{
+    ItemKind kind { ItemKind::Separator };
+    unsigned int id {}; // for commands and windows
+    std::string label;
+    WindowId window {}; // for windows
+    std::vector<Item> children; // for submenus
+
+    bool operator==(const Item & other) const = default;
+};
+
+Item separator();
+Item command(unsigned int id, std::string label);
+
+// a window to list, group is what it's grouped by, like its executable's name
+struct Window
+{
+    WindowId window {};
+    std::string title;
+    std::string group;
+};
+
+// Hands out item IDs in a range to windows, keeping them until the window is
+// gone, and reusing the IDs of windows that are gone.
+class WindowIds
+{
+public:
+    WindowIds(unsigned int first, unsigned int last);
+
+    // the window's ID, giving it one if it has none, or 0 if every ID is taken
+    unsigned int acquire(WindowId window);
+
+    // frees the IDs of windows that weren't acquired since the last call
+    void releaseUnused();
+
+    // the window with the ID, or 0 if none
+    [[nodiscard]]
+    WindowId window(unsigned int id) const noexcept;
+
+    [[nodiscard]]
+    bool contains(WindowId window) const noexcept
+    {
+        return ids_.contains(window);
+    }
+
+    [[nodiscard]]
+    size_t size() const noexcept
+    {
+        return ids_.size();
+    }
+
+private:
+    struct Entry
+    {
+        unsigned int id {};
+        bool used {};
+    };
+
+    unsigned int first_;
+    unsigned int last_;
+    unsigned int next_; // the first ID never handed out
+    std::vector<unsigned int> free_;
+    std::unordered_map<WindowId, Entry> ids_;
+    std::vector<WindowId> windows_; // by ID - first_
+};
+
+struct Layout
+{
+    size_t groupThreshold { 40 }; // group windows by app in sections with more windows than this
+    size_t pageSize { 40 }; // split menus with more items than this into pages
+    size_t titleLengthMax { 30 }; // longer titles are cut short with an ellipsis
+};
+
+struct Section
+{
+    std::vector<Window> windows;
+    unsigned int allId {}; // the command for all of the section's windows
+    std::string allLabel;
+};
+
+// Appends the items for a section, its windows followed by a separator, the
+// command for all of them, and another separator, or nothing if it has no
+// windows. Returns the number of windows left out because they had no ID.
+size_t appendSection(std::vector<Item> & items, const Section & section, WindowIds & ids, const Layout & layout);
+
+enum class EditKind
+{
+    Insert, // the item at position, with its children
+    Update, // the item at position gets the label, ID, and window of item, and keeps children
+    Remove // the item at position
+};
+
+struct Edit
+{
+    EditKind kind {};
+    std::vector<size_t> path; // the positions of the submenus leading to the menu that's edited
+    size_t position {};
+    const Item * item {}; // in the menu diffed to, for inserts and updates
+};
+
+// Appends the edits that turn before into after, in the order they apply.
+// Items that are the same at the start and end are skipped, so the edits
+// follow what changed rather than the size of the menu.
+void diff(const std::vector<Item> & before, const std::vector<Item> & after, std::vector<Edit> & edits);
+
+} // namespace MenuModel
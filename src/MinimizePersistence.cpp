@@ -16,6 +16,9 @@
 #include "MinimizePersistence.h"
 #include "Log.h"
 
+// Standard library
+#include <cstring>
+
 bool minimizePersistenceValid(MinimizePersistence minimizePersistence) noexcept
 {
     switch (minimizePersistence) {
@@ -16,6 +16,9 @@
 #include "MinimizePlacement.h"
 #include "Log.h"
 
+// Standard library
+#include <cstring>
+
 bool minimizePlacementValid(MinimizePlacement minimizePlacement) noexcept
 {
     switch (minimizePlacement) {
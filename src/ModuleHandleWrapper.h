@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -51,7 +52,7 @@ public:
     {
         if (hmodule_ != nullptr) {
             if (!FreeLibrary(hmodule_)) {
-                WARNING_PRINTF("failed to close free library %#x: %lu\n", hmodule_, GetLastError());
+                WARNING_LOG("failed to close free library {}: {}\n", hmodule_, GetLastError());
                 return;
             }
 
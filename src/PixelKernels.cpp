@@ -0,0 +1,262 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "PixelKernels.h"
+
+// Standard library
+#include <algorithm>
+#include <bit>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIXEL_KERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define PIXEL_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+constexpr std::uint32_t alphaMask_ = 0xff000000;
+
+// c * a / 255, rounded to nearest, exactly
+constexpr std::uint32_t multiplyAlpha(std::uint32_t color, std::uint32_t alpha) noexcept
+{
+    const std::uint32_t product = (color * alpha) + 128;
+    return (product + (product >> 8)) >> 8;
+}
+
+constexpr std::uint32_t channel(std::uint32_t pixel, unsigned int shift) noexcept
+{
+    return (pixel >> shift) & 0xff;
+}
+
+std::uint32_t premultiplyPixel(std::uint32_t pixel) noexcept
+{
+    const std::uint32_t alpha = pixel >> 24;
+    return (pixel & alphaMask_) | (multiplyAlpha(channel(pixel, 16), alpha) << 16) |
+        (multiplyAlpha(channel(pixel, 8), alpha) << 8) | multiplyAlpha(channel(pixel, 0), alpha);
+}
+
+std::uint32_t replacePixel(
+    std::uint32_t pixel,
+    std::span<const PixelKernels::ColorReplacement> replacements,
+    size_t & replaced) noexcept
+{
+    for (const PixelKernels::ColorReplacement & replacement : replacements) {
+        if (pixel == replacement.from) {
+            ++replaced;
+            return replacement.to;
+        }
+    }
+    return pixel;
+}
+
+} // anonymous namespace
+
+namespace PixelKernels
+{
+
+size_t replaceColors(std::span<std::uint32_t> pixels, std::span<const ColorReplacement> replacements) noexcept
+{
+    size_t replaced = 0;
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    for (; i + 4 <= pixels.size(); i += 4) {
+        auto * const address = reinterpret_cast<__m128i *>(pixels.data() + i);
+        const __m128i original = _mm_loadu_si128(address);
+        __m128i result = original;
+        __m128i matched = _mm_setzero_si128();
+        for (const ColorReplacement & replacement : replacements) {
+            const __m128i from = _mm_set1_epi32(static_cast<int>(replacement.from));
+            const __m128i to = _mm_set1_epi32(static_cast<int>(replacement.to));
+            const __m128i match = _mm_andnot_si128(matched, _mm_cmpeq_epi32(original, from));
+            result = _mm_or_si128(_mm_andnot_si128(match, result), _mm_and_si128(match, to));
+            matched = _mm_or_si128(matched, match);
+        }
+        const auto lanes = static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(matched)));
+        if (lanes) {
+            replaced += static_cast<size_t>(std::popcount(lanes));
+            _mm_storeu_si128(address, result);
+        }
+    }
+#elif defined(PIXEL_KERNELS_NEON)
+    for (; i + 4 <= pixels.size(); i += 4) {
+        std::uint32_t * const address = pixels.data() + i;
+        const uint32x4_t original = vld1q_u32(address);
+        uint32x4_t result = original;
+        uint32x4_t matched = vdupq_n_u32(0);
+        for (const ColorReplacement & replacement : replacements) {
+            const uint32x4_t match = vbicq_u32(vceqq_u32(original, vdupq_n_u32(replacement.from)), matched);
+            result = vbslq_u32(match, vdupq_n_u32(replacement.to), result);
+            matched = vorrq_u32(matched, match);
+        }
+        // each matched lane is all ones, so shifting down leaves one per lane to add up
+        const std::uint32_t lanes = vaddvq_u32(vshrq_n_u32(matched, 31));
+        if (lanes) {
+            replaced += lanes;
+            vst1q_u32(address, result);
+        }
+    }
+#endif
+
+    for (; i < pixels.size(); ++i) {
+        pixels[i] = replacePixel(pixels[i], replacements, replaced);
+    }
+    return replaced;
+}
+
+void premultiply(std::span<std::uint32_t> pixels) noexcept
+{
+    size_t i = 0;
+
+#if defined(PIXEL_KERNELS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(128);
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(alphaMask_));
+    for (; i + 4 <= pixels.size(); i += 4) {
+        auto * const address = reinterpret_cast<__m128i *>(pixels.data() + i);
+        const __m128i original = _mm_loadu_si128(address);
+
+        // two pixels in each half, as 16 bit channels, with each pixel's alpha copied to all its channels
+        __m128i low = _mm_unpacklo_epi8(original, zero);
+        __m128i high = _mm_unpackhi_epi8(original, zero);
+        const __m128i lowAlpha =
+            _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i highAlpha =
+            _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+        // the same rounding as multiplyAlpha
+        low = _mm_add_epi16(_mm_mullo_epi16(low, lowAlpha), rounding);
+        high = _mm_add_epi16(_mm_mullo_epi16(high, highAlpha), rounding);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+        const __m128i colors = _mm_packus_epi16(low, high);
+        _mm_storeu_si128(
+            address,
+            _mm_or_si128(_mm_andnot_si128(alphaMask, colors), _mm_and_si128(alphaMask, original)));
+    }
+#elif defined(PIXEL_KERNELS_NEON)
+    for (; i + 16 <= pixels.size(); i += 16) {
+        auto * const address = reinterpret_cast<std::uint8_t *>(pixels.data() + i);
+        uint8x16x4_t planes = vld4q_u8(address);
+        const uint8x16_t alpha = planes.val[3];
+        for (int c = 0; c < 3; ++c) {
+            // the same rounding as multiplyAlpha
+            const uint16x8_t low = vmull_u8(vget_low_u8(planes.val[c]), vget_low_u8(alpha));
+            const uint16x8_t high = vmull_u8(vget_high_u8(planes.val[c]), vget_high_u8(alpha));
+            planes.val[c] =
+                vcombine_u8(vrshrn_n_u16(vrsraq_n_u16(low, low, 8), 8), vrshrn_n_u16(vrsraq_n_u16(high, high, 8), 8));
+        }
+        vst4q_u8(address, planes);
+    }
+#endif
+
+    for (; i < pixels.size(); ++i) {
+        pixels[i] = premultiplyPixel(pixels[i]);
+    }
+}
+
+void unpremultiply(std::span<std::uint32_t> pixels) noexcept
+{
+    for (std::uint32_t & pixel : pixels) {
+        const std::uint32_t alpha = pixel >> 24;
+        if (!alpha) {
+            pixel = 0;
+            continue;
+        }
+        if (alpha == 0xff) {
+            continue;
+        }
+
+        std::uint32_t result = pixel & alphaMask_;
+        for (unsigned int shift = 0; shift < 24; shift += 8) {
+            const std::uint32_t color = ((channel(pixel, shift) * 255) + (alpha / 2)) / alpha;
+            result |= std::min<std::uint32_t>(color, 255) << shift;
+        }
+        pixel = result;
+    }
+}
+
+void boxDownscale(
+    std::span<const std::uint32_t> source,
+    size_t width,
+    size_t height,
+    size_t factor,
+    std::span<std::uint32_t> target) noexcept
+{
+    if (!factor) {
+        return;
+    }
+
+    const size_t targetWidth = width / factor;
+    const size_t targetHeight = height / factor;
+    const size_t count = factor * factor;
+    if ((source.size() < width * height) || (target.size() < targetWidth * targetHeight)) {
+        return;
+    }
+
+    for (size_t ty = 0; ty < targetHeight; ++ty) {
+        for (size_t tx = 0; tx < targetWidth; ++tx) {
+            size_t sums[4] = {};
+            for (size_t y = ty * factor; y < (ty + 1) * factor; ++y) {
+                const std::uint32_t * row = source.data() + (y * width) + (tx * factor);
+                for (size_t x = 0; x < factor; ++x) {
+                    for (unsigned int c = 0; c < 4; ++c) {
+                        sums[c] += channel(row[x], c * 8);
+                    }
+                }
+            }
+
+            std::uint32_t pixel = 0;
+            for (unsigned int c = 0; c < 4; ++c) {
+                pixel |= static_cast<std::uint32_t>((sums[c] + (count / 2)) / count) << (c * 8);
+            }
+            target[(ty * targetWidth) + tx] = pixel;
+        }
+    }
+}
+
+size_t replaceColorsScalar(std::span<std::uint32_t> pixels, std::span<const ColorReplacement> replacements) noexcept
+{
+    size_t replaced = 0;
+    for (std::uint32_t & pixel : pixels) {
+        pixel = replacePixel(pixel, replacements, replaced);
+    }
+    return replaced;
+}
+
+void premultiplyScalar(std::span<std::uint32_t> pixels) noexcept
+{
+    for (std::uint32_t & pixel : pixels) {
+        pixel = premultiplyPixel(pixel);
+    }
+}
+
+const char * kernelName() noexcept
+{
+#if defined(PIXEL_KERNELS_SSE2)
+    return "SSE2";
+#elif defined(PIXEL_KERNELS_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace PixelKernels
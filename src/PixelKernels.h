@@ -0,0 +1,66 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Operations on 32 bit pixels, the layout of a 32 bit DIB, blue in the low
+// byte and alpha in the high byte (0xAARRGGBB). Replacing colors and
+// premultiplying work on several pixels at a time with SSE2 on x86 and x64,
+// or NEON on ARM64, and the rest a pixel at a time. Unpremultiplying and
+// downscaling are only done a pixel at a time, they're used on a few small
+// icons. Making an icon mask from alpha is in IconMask.h.
+namespace PixelKernels
+{
+
+struct ColorReplacement
+{
+    std::uint32_t from {};
+    std::uint32_t to {};
+};
+
+// Replaces every pixel that equals a replacement's from color, in one pass.
+// A pixel is only replaced once, by the first replacement that matches it.
+// Returns the number of pixels replaced.
+size_t replaceColors(std::span<std::uint32_t> pixels, std::span<const ColorReplacement> replacements) noexcept;
+
+// multiplies each color by its alpha, rounding to nearest
+void premultiply(std::span<std::uint32_t> pixels) noexcept;
+
+// divides each color by its alpha, the reverse of premultiply, transparent pixels become black
+void unpremultiply(std::span<std::uint32_t> pixels) noexcept;
+
+// Shrinks an image by a whole factor, each target pixel being the average of
+// factor by factor source pixels. The source must be premultiplied, so
+// transparent pixels don't darken their neighbors. The target must have
+// (width / factor) * (height / factor) pixels, any leftover edge is ignored.
+void boxDownscale(
+    std::span<const std::uint32_t> source,
+    size_t width,
+    size_t height,
+    size_t factor,
+    std::span<std::uint32_t> target) noexcept;
+
+// the same, a pixel at a time, for checking and comparing with the above
+size_t replaceColorsScalar(std::span<std::uint32_t> pixels, std::span<const ColorReplacement> replacements) noexcept;
+void premultiplyScalar(std::span<std::uint32_t> pixels) noexcept;
+
+// what the kernels use, "SSE2", "NEON", or "scalar"
+const char * kernelName() noexcept;
+
+} // namespace PixelKernels
@@ -26,6 +26,7 @@
 #define IDS_MENU_RESTORE_ALL                      202
 #define IDS_MENU_SETTINGS                         203
 #define IDS_MENU_EXIT                             204
+#define IDS_MENU_SAVE_FLIGHT_RECORDER             205
 #define IDS_ABOUT_CAPTION                         211
 #define IDS_ABOUT_TEXT                            212
 #define IDS_COLUMN_INDEX                          221
@@ -39,6 +40,8 @@
 #define IDS_TRAY_EVENT_OPEN_AND_MINIMIZE          232
 #define IDS_MINIMIZE_PERSISTENCE_NEVER            233
 #define IDS_MINIMIZE_PERSISTENCE_ALWAYS           234
+#define IDS_IMPORT_AUTO_TRAY_COMPLETE             240
+#define IDS_SAVED_FLIGHT_RECORDER                 241
 
 // error strings
 #define IDS_ERROR_INIT_COM                        301
@@ -57,6 +60,8 @@
 #define IDS_ERROR_CREATE_DIALOG                   314
 #define IDS_ERROR_LOAD_SETTINGS                   315
 #define IDS_ERROR_SAVE_SETTINGS                   316
+#define IDS_ERROR_IMPORT_AUTO_TRAY                317
+#define IDS_ERROR_SAVE_FLIGHT_RECORDER            318
 
 // bitmaps
 #define IDB_APP                                   401
@@ -97,6 +102,7 @@
 #define IDC_ABOUT                                1026
 #define IDC_RESET                                1027
 #define IDC_EXIT                                 1028
+#define IDC_HOTKEY_SWITCHER                      1030
 
 // clang-format on
 
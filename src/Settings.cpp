@@ -21,6 +21,7 @@
 #include "Hotkey.h"
 #include "Log.h"
 #include "Path.h"
+#include "SettingsSchema.h"
 #include "StringUtility.h"
 
 // Windows
@@ -28,88 +29,38 @@
 #include <shellapi.h>
 
 // Standard library
-#include <cstdlib>
-#include <ranges>
+#include <algorithm>
 #include <regex>
+#include <string_view>
+#include <type_traits>
 
 namespace
 {
 
-bool autoTrayItemCallback(const cJSON * cjson, void * userData);
-bool isAutoTrayInvalid(const Settings::AutoTray & autoTray);
-bool getBool(const cJSON * cjson, const char * key, bool defaultValue) noexcept;
-double getNumber(const cJSON * cjson, const char * key, double defaultValue) noexcept;
-const char * getString(const cJSON * cjson, const char * key, const char * defaultValue) noexcept;
-void iterateArray(const cJSON * cjson, bool (*callback)(const cJSON *, void *), void * userData) noexcept;
-
-enum SettingKeys : unsigned int
-{
-    SK_Version,
-    SK_StartWithWindows,
-    SK_LogToFile,
-    SK_MinimizePlacement,
-    SK_Executable,
-    SK_WindowClass,
-    SK_WindowTitle,
-    SK_TrayEvent,
-    SK_MinimizePersistence,
-    SK_HotkeyMinimize,
-    SK_HotkeyMinimizeAll,
-    SK_HotkeyRestore,
-    SK_HotkeyRestoreAll,
-    SK_HotkeyMenu,
-    SK_ModifiersOverride,
-    SK_PollInterval,
-    SK_AutoTray,
-
-    SK_Count
-};
-
-constexpr unsigned int versionCurrent_ = 1;
-constexpr bool startWithWindowsDefault_ = false;
-constexpr bool logToFileDefault_ = false;
-constexpr MinimizePlacement minimizePlacementDefault_ = MinimizePlacement::TrayAndMenu;
-constexpr char hotkeyMinimizeDefault_[] = "alt ctrl shift down";
-constexpr char hotkeyMinimizeAllDefault_[] = "alt ctrl shift right";
-constexpr char hotkeyRestoreDefault_[] = "alt ctrl shift up";
-constexpr char hotkeyRestoreAllDefault_[] = "alt ctrl shift left";
-constexpr char hotkeyMenuDefault_[] = "alt ctrl shift home";
-constexpr char modifiersOverrideDefault_[] = "alt ctrl shift";
-constexpr unsigned int pollIntervalDefault_ = 500;
-const char * settingKeys_[SK_Count] = { "version",
-                                        "start-with-windows",
-                                        "log-to-file",
-                                        "minimize-placement",
-                                        "executable",
-                                        "window-class",
-                                        "window-title",
-                                        "tray-event",
-                                        "minimize-persistence",
-                                        "hotkey-minimize",
-                                        "hotkey-minimize-all",
-                                        "hotkey-restore",
-                                        "hotkey-restore-all",
-                                        "hotkey-menu",
-                                        "modifiers-override",
-                                        "poll-interval",
-                                        "auto-tray" };
+using SettingsSchema::autoTrayFields;
+using SettingsSchema::settingsFields;
+
+constexpr auto settingsKeyIndex_ = SettingsSchema::keyIndex(settingsFields);
+constexpr auto autoTrayKeyIndex_ = SettingsSchema::keyIndex(autoTrayFields);
+static_assert(settingsKeyIndex_.valid(), "settings keys must be unique");
+static_assert(autoTrayKeyIndex_.valid(), "auto-tray keys must be unique");
+
+template <typename T>
+void readValue(const cJSON * item, T & value);
+template <typename Owner, typename Fields, typename KeyIndex>
+void readObject(const Fields & fields, const KeyIndex & keyIndex, const cJSON * cjson, Owner & owner);
+template <typename Owner, typename Fields>
+bool writeObject(const Fields & fields, cJSON * cjson, const Owner & owner);
+#if !defined(NDEBUG)
+template <typename Owner, typename Fields>
+void dumpObject(const Fields & fields, const char * indent, const Owner & owner, std::string & text);
+#endif
 
 } // anonymous namespace
 
 void Settings::initDefaults()
 {
-    version_ = versionCurrent_;
-    startWithWindows_ = startWithWindowsDefault_;
-    logToFile_ = logToFileDefault_;
-    minimizePlacement_ = minimizePlacementDefault_;
-    hotkeyMinimize_ = hotkeyMinimizeDefault_;
-    hotkeyMinimizeAll_ = hotkeyMinimizeAllDefault_;
-    hotkeyRestore_ = hotkeyRestoreDefault_;
-    hotkeyRestoreAll_ = hotkeyRestoreAllDefault_;
-    hotkeyMenu_ = hotkeyMenuDefault_;
-    modifiersOverride_ = modifiersOverrideDefault_;
-    pollInterval_ = pollIntervalDefault_;
-    autoTrays_.clear();
+    SettingsSchema::forEach(settingsFields, [this](const auto & field) { field.reset(*this); });
 }
 
 bool Settings::fromJSON(const std::string & json)
@@ -122,30 +73,7 @@ bool Settings::fromJSON(const std::string & json)
 
     DEBUG_PRINTF("parsed settings JSON:\n%s\n", cjson.print().c_str());
 
-    version_ = narrow_cast<unsigned int>(getNumber(cjson, settingKeys_[SK_Version], static_cast<double>(versionCurrent_)));
-    startWithWindows_ = getBool(cjson, settingKeys_[SK_StartWithWindows], startWithWindows_);
-    logToFile_ = getBool(cjson, settingKeys_[SK_LogToFile], logToFile_);
-
-    const std::string & minimizePlacementString =
-        getString(cjson, settingKeys_[SK_MinimizePlacement], minimizePlacementToCString(minimizePlacement_));
-    minimizePlacement_ = minimizePlacementFromCString(minimizePlacementString.c_str());
-    if (minimizePlacement_ == MinimizePlacement::None) {
-        WARNING_PRINTF("bad %s argument: %s\n", settingKeys_[SK_MinimizePlacement], minimizePlacementString.c_str());
-    }
-
-    hotkeyMinimize_ = getString(cjson, settingKeys_[SK_HotkeyMinimize], hotkeyMinimize_.c_str());
-    hotkeyMinimizeAll_ = getString(cjson, settingKeys_[SK_HotkeyMinimizeAll], hotkeyMinimizeAll_.c_str());
-    hotkeyRestore_ = getString(cjson, settingKeys_[SK_HotkeyRestore], hotkeyRestore_.c_str());
-    hotkeyRestoreAll_ = getString(cjson, settingKeys_[SK_HotkeyRestoreAll], hotkeyRestoreAll_.c_str());
-    hotkeyMenu_ = getString(cjson, settingKeys_[SK_HotkeyMenu], hotkeyMenu_.c_str());
-    modifiersOverride_ = getString(cjson, settingKeys_[SK_ModifiersOverride], modifiersOverride_.c_str());
-    pollInterval_ = narrow_cast<unsigned int>(
-        getNumber(cjson, settingKeys_[SK_PollInterval], static_cast<double>(pollInterval_)));
-
-    const cJSON * autotray = cJSON_GetObjectItemCaseSensitive(cjson, settingKeys_[SK_AutoTray]);
-    if (autotray) {
-        iterateArray(autotray, autoTrayItemCallback, this);
-    }
+    readObject(settingsFields, settingsKeyIndex_, cjson, *this);
 
     normalize();
 
@@ -160,92 +88,7 @@ std::string Settings::toJSON() const
         return {};
     }
 
-    bool fail = false;
-
-    if (!cJSON_AddNumberToObject(cjson, settingKeys_[SK_Version], static_cast<double>(version_))) {
-        fail = true;
-    }
-
-    if (!cJSON_AddBoolToObject(cjson, settingKeys_[SK_StartWithWindows], startWithWindows_)) {
-        fail = true;
-    }
-
-    if (!cJSON_AddBoolToObject(cjson, settingKeys_[SK_LogToFile], logToFile_)) {
-        fail = true;
-    }
-
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_MinimizePlacement], minimizePlacementToCString(minimizePlacement_))) {
-        fail = true;
-    }
-
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_HotkeyMinimize], hotkeyMinimize_.c_str())) {
-        fail = true;
-    }
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_HotkeyMinimizeAll], hotkeyMinimizeAll_.c_str())) {
-        fail = true;
-    }
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_HotkeyRestore], hotkeyRestore_.c_str())) {
-        fail = true;
-    }
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_HotkeyRestoreAll], hotkeyRestoreAll_.c_str())) {
-        fail = true;
-    }
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_HotkeyMenu], hotkeyMenu_.c_str())) {
-        fail = true;
-    }
-    if (!cJSON_AddStringToObject(cjson, settingKeys_[SK_ModifiersOverride], modifiersOverride_.c_str())) {
-        fail = true;
-    }
-    if (!cJSON_AddNumberToObject(cjson, settingKeys_[SK_PollInterval], static_cast<double>(pollInterval_))) {
-        fail = true;
-    }
-
-    if (!autoTrays_.empty()) {
-        cJSON * autotrayArray = cJSON_AddArrayToObject(cjson, settingKeys_[SK_AutoTray]);
-        if (!autotrayArray) {
-            fail = true;
-        } else {
-            for (const AutoTray & autoTray : autoTrays_) {
-                cJSON * item = cJSON_CreateObject();
-                if (!item) {
-                    fail = true;
-                    break;
-                }
-
-                if (!autoTray.executable_.empty() &&
-                    !cJSON_AddStringToObject(item, settingKeys_[SK_Executable], autoTray.executable_.c_str())) {
-                    fail = true;
-                }
-
-                if (!autoTray.windowClass_.empty() &&
-                    !cJSON_AddStringToObject(item, settingKeys_[SK_WindowClass], autoTray.windowClass_.c_str())) {
-                    fail = true;
-                }
-
-                if (!autoTray.windowTitle_.empty() &&
-                    !cJSON_AddStringToObject(item, settingKeys_[SK_WindowTitle], autoTray.windowTitle_.c_str())) {
-                    fail = true;
-                }
-
-                if (!cJSON_AddStringToObject(item, settingKeys_[SK_TrayEvent], trayEventToCString(autoTray.trayEvent_))) {
-                    fail = true;
-                }
-
-                if (!cJSON_AddStringToObject(
-                        item,
-                        settingKeys_[SK_MinimizePersistence],
-                        minimizePersistenceToCString(autoTray.minimizePersistence_))) {
-                    fail = true;
-                }
-
-                if (!cJSON_AddItemToArray(autotrayArray, item)) {
-                    fail = true;
-                }
-            }
-        }
-    }
-
-    if (fail) {
+    if (!writeObject(settingsFields, cjson, *this)) {
         WARNING_PRINTF("failed to construct json settings\n");
         return {};
     }
@@ -255,257 +98,429 @@ std::string Settings::toJSON() const
 
 bool Settings::valid() const
 {
-    if (version_ != versionCurrent_) {
-        return false;
-    }
+    return SettingsSchema::allOf(settingsFields, [this](const auto & field) {
+        return !field.valid || field.valid(this->*field.member);
+    });
+}
 
-    if (!minimizePlacementValid(minimizePlacement_)) {
-        return false;
-    }
+void Settings::normalize()
+{
+    SettingsSchema::forEach(settingsFields, [this](const auto & field) {
+        if (field.normalize) {
+            field.normalize(this->*field.member);
+        }
+    });
+}
 
-    if (!Hotkey::valid(hotkeyMinimize_)) {
-        return false;
+void Settings::dump() const noexcept
+{
+#if !defined(NDEBUG)
+    // logged as one record, so the dump isn't cut short by the call site's rate limit
+    try {
+        std::string text;
+        dumpObject(settingsFields, "\t", *this, text);
+        DEBUG_PRINTF("Settings:\n%s", text.c_str());
+    } catch (...) {
+        DEBUG_PRINTF("Settings: out of memory\n");
     }
+#endif
+}
 
-    if (!Hotkey::valid(hotkeyMinimizeAll_)) {
-        return false;
-    }
+void Settings::addAutoTray(AutoTray && autoTray)
+{
+    autoTrays_.emplace_back(std::move(autoTray));
+}
 
-    if (!Hotkey::valid(hotkeyRestore_)) {
+bool Settings::autoTraysFromJSON(const std::string & json, std::vector<AutoTray> & autoTrays)
+{
+    const CJsonWrapper cjson(cJSON_Parse(json.c_str()));
+    if (!cjson) {
+        WARNING_PRINTF("failed to parse auto-tray JSON:\n%s\n", cJSON_GetErrorPtr());
         return false;
     }
 
-    if (!Hotkey::valid(hotkeyRestoreAll_)) {
-        return false;
+    const cJSON * array = cjson;
+    if (cJSON_IsObject(cjson)) {
+        constexpr std::string_view autoTrayKey = std::get<SettingsSchema::autoTraysIndex>(settingsFields).key;
+        array = cJSON_GetObjectItemCaseSensitive(cjson, autoTrayKey.data());
     }
-
-    if (!Hotkey::valid(hotkeyMenu_)) {
+    if (!cJSON_IsArray(array)) {
+        WARNING_PRINTF("no auto-tray array in JSON\n");
         return false;
     }
 
-    if (!Hotkey::valid(modifiersOverride_)) {
-        return false;
-    }
+    std::vector<AutoTray> parsed;
+    readValue(array, parsed);
+    autoTrays.insert(autoTrays.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+
+    return true;
+}
 
-    if (std::ranges::any_of(autoTrays_, isAutoTrayInvalid)) {
+bool Settings::fileExists(const std::string & fileName)
+{
+    const std::string writeableDir = getWriteableDir();
+    if (writeableDir.empty()) {
         return false;
     }
 
-    return true;
+    const std::string fullPath = pathJoin(writeableDir, fileName);
+    return ::fileExists(fullPath);
 }
 
-void Settings::normalize()
+namespace SettingsSchema
 {
-    version_ = versionCurrent_;
 
-    if (!minimizePlacementValid(minimizePlacement_)) {
-        WARNING_PRINTF("Fixing bad minimize placement: %d\n", minimizePlacement_);
-        minimizePlacement_ = minimizePlacementDefault_;
-    }
+bool versionValid(const unsigned int & version)
+{
+    return version == versionCurrent;
+}
 
-    hotkeyMinimize_ = Hotkey::normalize(hotkeyMinimize_);
-    hotkeyMinimizeAll_ = Hotkey::normalize(hotkeyMinimizeAll_);
-    hotkeyRestore_ = Hotkey::normalize(hotkeyRestore_);
-    hotkeyRestoreAll_ = Hotkey::normalize(hotkeyRestoreAll_);
-    hotkeyMenu_ = Hotkey::normalize(hotkeyMenu_);
-    modifiersOverride_ = Hotkey::normalize(modifiersOverride_);
+void versionNormalize(unsigned int & version)
+{
+    version = versionCurrent;
+}
 
-    for (std::vector<Settings::AutoTray>::iterator it = autoTrays_.begin(); it != autoTrays_.end();) {
-        AutoTray & autoTray = *it;
-        if (autoTray.executable_.empty() && autoTray.windowClass_.empty() && autoTray.windowTitle_.empty()) {
-            DEBUG_PRINTF("Removing empty auto-tray item\n");
-            it = autoTrays_.erase(it);
-            continue;
-        }
+bool logLevelFieldValid(const Log::Level & logLevel)
+{
+    return Log::levelValid(logLevel);
+}
 
-        if (autoTray.trayEvent_ == TrayEvent::None) {
-            DEBUG_PRINTF("Changing auto-tray item with no event to minimize\n");
-            autoTray.trayEvent_ = TrayEvent::Minimize;
-        }
+void logLevelNormalize(Log::Level & logLevel)
+{
+    if (!Log::levelValid(logLevel)) {
+        WARNING_PRINTF("Fixing bad log level: %d\n", logLevel);
+        logLevel = Log::Level::Debug;
+    }
+}
 
-        if (autoTray.minimizePersistence_ == MinimizePersistence::None) {
-            DEBUG_PRINTF("Changing auto-tray item with no minimize persistence to never\n");
-            autoTray.minimizePersistence_ = MinimizePersistence::Never;
-        }
+bool logOverflowFieldValid(const LogOverflow & logOverflow)
+{
+    return logOverflowValid(logOverflow);
+}
 
-        ++it;
+void logOverflowNormalize(LogOverflow & logOverflow)
+{
+    if (!logOverflowValid(logOverflow)) {
+        WARNING_PRINTF("Fixing bad log overflow: %d\n", logOverflow);
+        logOverflow = LogOverflow::Block;
     }
 }
 
-void Settings::dump() const noexcept
+bool logFormatFieldValid(const LogFormat & logFormat)
 {
-#if !defined(NDEBUG)
-    DEBUG_PRINTF("Settings:\n");
-    DEBUG_PRINTF("\t%s: %u\n", settingKeys_[SK_Version], version_);
-    DEBUG_PRINTF("\t%s: %s\n", settingKeys_[SK_StartWithWindows], StringUtility::boolToCString(startWithWindows_));
-    DEBUG_PRINTF("\t%s: %s\n", settingKeys_[SK_LogToFile], StringUtility::boolToCString(logToFile_));
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_MinimizePlacement], minimizePlacementToCString(minimizePlacement_));
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_HotkeyMinimize], hotkeyMinimize_.c_str());
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_HotkeyMinimizeAll], hotkeyMinimizeAll_.c_str());
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_HotkeyRestore], hotkeyRestore_.c_str());
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_HotkeyRestoreAll], hotkeyRestoreAll_.c_str());
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_HotkeyMenu], hotkeyMenu_.c_str());
-    DEBUG_PRINTF("\t%s: '%s'\n", settingKeys_[SK_ModifiersOverride], modifiersOverride_.c_str());
-    DEBUG_PRINTF("\t%s: %u\n", settingKeys_[SK_PollInterval], pollInterval_);
-
-    for (const AutoTray & autoTray : autoTrays_) {
-        DEBUG_PRINTF("\t%s:\n", settingKeys_[SK_AutoTray]);
-        DEBUG_PRINTF("\t\t%s: '%s'\n", settingKeys_[SK_Executable], autoTray.executable_.c_str());
-        DEBUG_PRINTF("\t\t%s: '%s'\n", settingKeys_[SK_WindowClass], autoTray.windowClass_.c_str());
-        DEBUG_PRINTF("\t\t%s: '%s'\n", settingKeys_[SK_WindowTitle], autoTray.windowTitle_.c_str());
-        DEBUG_PRINTF("\t\t%s: '%s'\n", settingKeys_[SK_TrayEvent], trayEventToCString(autoTray.trayEvent_));
-        DEBUG_PRINTF(
-            "\t\t%s: '%s'\n",
-            settingKeys_[SK_MinimizePersistence],
-            minimizePersistenceToCString(autoTray.minimizePersistence_));
+    return logFormatValid(logFormat);
+}
+
+void logFormatNormalize(LogFormat & logFormat)
+{
+    if (!logFormatValid(logFormat)) {
+        WARNING_PRINTF("Fixing bad log format: %d\n", logFormat);
+        logFormat = LogFormat::Text;
     }
-#endif
 }
 
-void Settings::addAutoTray(AutoTray && autoTray)
+bool minimizePlacementFieldValid(const MinimizePlacement & minimizePlacement)
 {
-    autoTrays_.emplace_back(std::move(autoTray));
+    return minimizePlacementValid(minimizePlacement);
 }
 
-bool Settings::fileExists(const std::string & fileName)
+void minimizePlacementNormalize(MinimizePlacement & minimizePlacement)
 {
-    const std::string writeableDir = getWriteableDir();
-    if (writeableDir.empty()) {
-        return false;
+    if (!minimizePlacementValid(minimizePlacement)) {
+        WARNING_PRINTF("Fixing bad minimize placement: %d\n", minimizePlacement);
+        minimizePlacement = minimizePlacementDefault;
     }
+}
 
-    const std::string fullPath = pathJoin(writeableDir, fileName);
-    return ::fileExists(fullPath);
+bool hotkeyValid(const std::string & hotkey)
+{
+    return Hotkey::valid(hotkey);
 }
 
-namespace
+void hotkeyNormalize(std::string & hotkey)
 {
+    hotkey = Hotkey::normalize(hotkey);
+}
 
-bool autoTrayItemCallback(const cJSON * cjson, void * userData)
+bool autoTraysValid(const std::vector<Settings::AutoTray> & autoTrays)
 {
-    if (!cjson) {
-        WARNING_PRINTF("null cjson\n");
-        return false;
-    }
-    if (!cJSON_IsObject(cjson)) {
-        WARNING_PRINTF("bad type for '%s'\n", cjson->string);
-        return false;
-    }
-    Settings * settings = static_cast<Settings *>(userData);
-    if (!settings) {
-        WARNING_PRINTF("null settings\n");
-        return false;
-    }
+    return std::ranges::all_of(autoTrays, [](const Settings::AutoTray & autoTray) {
+        return allOf(autoTrayFields, [&autoTray](const auto & field) {
+            return !field.valid || field.valid(autoTray.*field.member);
+        });
+    });
+}
 
-    const char * executable = getString(cjson, settingKeys_[SK_Executable], nullptr);
-    const char * windowClass = getString(cjson, settingKeys_[SK_WindowClass], nullptr);
-    const char * windowTitle = getString(cjson, settingKeys_[SK_WindowTitle], nullptr);
-    const char * trayEvent = getString(cjson, settingKeys_[SK_TrayEvent], nullptr);
-    const char * minimizePersistence = getString(cjson, settingKeys_[SK_MinimizePersistence], nullptr);
-    if (executable || windowClass || windowTitle) {
-        Settings::AutoTray autoTray;
-        autoTray.executable_ = executable ? executable : "";
-        autoTray.windowClass_ = windowClass ? windowClass : "";
-        autoTray.windowTitle_ = windowTitle ? windowTitle : "";
-        autoTray.trayEvent_ = trayEvent ? trayEventFromCString(trayEvent) : TrayEvent::Minimize;
-        autoTray.minimizePersistence_ = minimizePersistence ? minimizePersistenceFromCString(minimizePersistence)
-                                                            : MinimizePersistence::Never;
-
-        settings->addAutoTray(std::move(autoTray));
-    }
+void autoTraysNormalize(std::vector<Settings::AutoTray> & autoTrays)
+{
+    for (std::vector<Settings::AutoTray>::iterator it = autoTrays.begin(); it != autoTrays.end();) {
+        Settings::AutoTray & autoTray = *it;
+        if (autoTray.executable_.empty() && autoTray.windowClass_.empty() && autoTray.windowTitle_.empty()) {
+            DEBUG_PRINTF("Removing empty auto-tray item\n");
+            it = autoTrays.erase(it);
+            continue;
+        }
 
-    return true;
+        forEach(autoTrayFields, [&autoTray](const auto & field) {
+            if (field.normalize) {
+                field.normalize(autoTray.*field.member);
+            }
+        });
+
+        ++it;
+    }
 }
 
-bool isAutoTrayInvalid(const Settings::AutoTray & autoTray)
+bool windowTitleValid(const std::string & windowTitle)
 {
     try {
-        const std::regex re(autoTray.windowTitle_);
+        const std::regex re(windowTitle);
         static_cast<void>(re);
     } catch (const std::regex_error & e) {
         static_cast<void>(e);
-        return true;
+        return false;
     }
 
-    if (!trayEventValid(autoTray.trayEvent_)) {
-        return true;
-    }
+    return true;
+}
 
-    if (!minimizePersistenceValid(autoTray.minimizePersistence_)) {
-        return true;
+bool trayEventFieldValid(const TrayEvent & trayEvent)
+{
+    return trayEventValid(trayEvent);
+}
+
+void trayEventNormalize(TrayEvent & trayEvent)
+{
+    if (trayEvent == TrayEvent::None) {
+        DEBUG_PRINTF("Changing auto-tray item with no event to minimize\n");
+        trayEvent = TrayEvent::Minimize;
     }
+}
 
-    return false;
+bool minimizePersistenceFieldValid(const MinimizePersistence & minimizePersistence)
+{
+    return minimizePersistenceValid(minimizePersistence);
 }
 
-bool getBool(const cJSON * cjson, const char * key, bool defaultValue) noexcept
+void minimizePersistenceNormalize(MinimizePersistence & minimizePersistence)
 {
-    const cJSON * item = cJSON_GetObjectItemCaseSensitive(cjson, key);
-    if (!item) {
-        return defaultValue;
+    if (minimizePersistence == MinimizePersistence::None) {
+        DEBUG_PRINTF("Changing auto-tray item with no minimize persistence to never\n");
+        minimizePersistence = MinimizePersistence::Never;
     }
+}
 
-    if (!cJSON_IsBool(item)) {
-        WARNING_PRINTF("bad type for '%s'\n", item->string);
-        return defaultValue;
-    }
+} // namespace SettingsSchema
+
+namespace
+{
 
-    return cJSON_IsTrue(item) == 1;
+const char * toCString(Log::Level logLevel) noexcept
+{
+    return Log::levelToCString(logLevel);
 }
 
-double getNumber(const cJSON * cjson, const char * key, double defaultValue) noexcept
+const char * toCString(LogOverflow logOverflow) noexcept
 {
-    const cJSON * item = cJSON_GetObjectItemCaseSensitive(cjson, key);
-    if (!item) {
-        return defaultValue;
-    }
+    return logOverflowToCString(logOverflow);
+}
 
-    if (!cJSON_IsNumber(item)) {
-        WARNING_PRINTF("bad type for '%s'\n", item->string);
-        return defaultValue;
-    }
+const char * toCString(LogFormat logFormat) noexcept
+{
+    return logFormatToCString(logFormat);
+}
 
-    return cJSON_GetNumberValue(item);
+const char * toCString(MinimizePlacement minimizePlacement) noexcept
+{
+    return minimizePlacementToCString(minimizePlacement);
 }
 
-const char * getString(const cJSON * cjson, const char * key, const char * defaultValue) noexcept
+const char * toCString(TrayEvent trayEvent) noexcept
 {
-    const cJSON * item = cJSON_GetObjectItemCaseSensitive(cjson, key);
-    if (!item) {
-        return defaultValue;
-    }
+    return trayEventToCString(trayEvent);
+}
 
-    const char * str = cJSON_GetStringValue(item);
-    if (!str) {
-        WARNING_PRINTF("bad type for '%s'\n", cjson->string);
-        return defaultValue;
-    }
+const char * toCString(MinimizePersistence minimizePersistence) noexcept
+{
+    return minimizePersistenceToCString(minimizePersistence);
+}
+
+void fromCString(const char * string, Log::Level & logLevel) noexcept
+{
+    static_cast<void>(Log::levelFromCString(string, logLevel));
+}
 
-    return str;
+void fromCString(const char * string, LogOverflow & logOverflow) noexcept
+{
+    logOverflow = logOverflowFromCString(string);
 }
 
-void iterateArray(const cJSON * cjson, bool (*callback)(const cJSON *, void *), void * userData) noexcept
+void fromCString(const char * string, LogFormat & logFormat) noexcept
 {
-    if (!cjson) {
-        WARNING_PRINTF("null cjson\n");
-        return;
-    }
-    if (!callback) {
-        WARNING_PRINTF("null callback\n");
-        return;
-    }
+    logFormat = logFormatFromCString(string);
+}
 
-    if (!cJSON_IsArray(cjson)) {
-        WARNING_PRINTF("bad type for '%s'\n", cjson->string);
+void fromCString(const char * string, MinimizePlacement & minimizePlacement) noexcept
+{
+    minimizePlacement = minimizePlacementFromCString(string);
+}
+
+void fromCString(const char * string, TrayEvent & trayEvent) noexcept
+{
+    trayEvent = trayEventFromCString(string);
+}
+
+void fromCString(const char * string, MinimizePersistence & minimizePersistence) noexcept
+{
+    minimizePersistence = minimizePersistenceFromCString(string);
+}
+
+// values with the wrong JSON type are reported and left unchanged
+template <typename T>
+void readValue(const cJSON * item, T & value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        if (!cJSON_IsBool(item)) {
+            WARNING_PRINTF("bad type for '%s'\n", item->string);
+            return;
+        }
+        value = cJSON_IsTrue(item) == 1;
+    } else if constexpr (std::is_same_v<T, unsigned int>) {
+        if (!cJSON_IsNumber(item)) {
+            WARNING_PRINTF("bad type for '%s'\n", item->string);
+            return;
+        }
+        value = narrow_cast<unsigned int>(cJSON_GetNumberValue(item));
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_enum_v<T>) {
+        const char * str = cJSON_GetStringValue(item);
+        if (!str) {
+            WARNING_PRINTF("bad type for '%s'\n", item->string);
+            return;
+        }
+        if constexpr (std::is_enum_v<T>) {
+            fromCString(str, value);
+        } else {
+            value = str;
+        }
     } else {
-        const int arrSize = cJSON_GetArraySize(cjson);
-        for (int i = 0; i < arrSize; ++i) {
-            const cJSON * item = cJSON_GetArrayItem(cjson, i);
-            if (!callback(item, userData)) {
+        static_assert(std::is_same_v<T, std::vector<Settings::AutoTray>>);
+        if (!cJSON_IsArray(item)) {
+            WARNING_PRINTF("bad type for '%s'\n", item->string);
+            return;
+        }
+        value.clear();
+        const cJSON * element = nullptr;
+        cJSON_ArrayForEach(element, item)
+        {
+            if (!cJSON_IsObject(element)) {
+                WARNING_PRINTF("bad type for auto-tray item\n");
                 break;
             }
+            Settings::AutoTray autoTray;
+            SettingsSchema::forEach(autoTrayFields, [&autoTray](const auto & field) { field.reset(autoTray); });
+            readObject(autoTrayFields, autoTrayKeyIndex_, element, autoTray);
+            value.emplace_back(std::move(autoTray));
+        }
+    }
+}
+
+template <typename T>
+bool addValue(cJSON * cjson, const char * key, const T & value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        return cJSON_AddBoolToObject(cjson, key, value) != nullptr;
+    } else if constexpr (std::is_same_v<T, unsigned int>) {
+        return cJSON_AddNumberToObject(cjson, key, static_cast<double>(value)) != nullptr;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return cJSON_AddStringToObject(cjson, key, value.c_str()) != nullptr;
+    } else if constexpr (std::is_enum_v<T>) {
+        return cJSON_AddStringToObject(cjson, key, toCString(value)) != nullptr;
+    } else {
+        static_assert(std::is_same_v<T, std::vector<Settings::AutoTray>>);
+        cJSON * array = cJSON_AddArrayToObject(cjson, key);
+        if (!array) {
+            return false;
+        }
+        for (const Settings::AutoTray & autoTray : value) {
+            cJSON * item = cJSON_CreateObject();
+            if (!item) {
+                return false;
+            }
+            if (!cJSON_AddItemToArray(array, item) || !writeObject(autoTrayFields, item, autoTray)) {
+                return false;
+            }
         }
+        return true;
     }
 }
 
+#if !defined(NDEBUG)
+template <typename T>
+void dumpValue(const char * indent, const char * key, const T & value, std::string & text)
+{
+    if constexpr (std::is_same_v<T, std::vector<Settings::AutoTray>>) {
+        for (const Settings::AutoTray & autoTray : value) {
+            text.append(indent).append(key).append(":\n");
+            dumpObject(autoTrayFields, "\t\t", autoTray, text);
+        }
+    } else {
+        text.append(indent).append(key).append(": ");
+        if constexpr (std::is_same_v<T, bool>) {
+            text.append(StringUtility::boolToCString(value));
+        } else if constexpr (std::is_same_v<T, unsigned int>) {
+            text.append(std::to_string(value));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            text.append("'").append(value).append("'");
+        } else {
+            static_assert(std::is_enum_v<T>);
+            text.append("'").append(toCString(value)).append("'");
+        }
+        text.append("\n");
+    }
+}
+#endif
+
+template <typename Owner, typename Fields, typename KeyIndex>
+void readObject(const Fields & fields, const KeyIndex & keyIndex, const cJSON * cjson, Owner & owner)
+{
+    const cJSON * item = nullptr;
+    cJSON_ArrayForEach(item, cjson)
+    {
+        const int index = item->string ? keyIndex.find(item->string) : -1;
+        if (index < 0) {
+            DEBUG_PRINTF("ignoring unknown setting '%s'\n", item->string ? item->string : "");
+            continue;
+        }
+
+        SettingsSchema::visit(fields, static_cast<size_t>(index), [item, &owner](const auto & field) {
+            readValue(item, owner.*field.member);
+        });
+    }
+}
+
+template <typename Owner, typename Fields>
+bool writeObject(const Fields & fields, cJSON * cjson, const Owner & owner)
+{
+    bool fail = false;
+    SettingsSchema::forEach(fields, [cjson, &owner, &fail](const auto & field) {
+        if ((field.write == SettingsSchema::Write::NonDefault) && field.isDefault(owner)) {
+            return;
+        }
+        if (!addValue(cjson, field.key.data(), owner.*field.member)) {
+            fail = true;
+        }
+    });
+    return !fail;
+}
+
+#if !defined(NDEBUG)
+template <typename Owner, typename Fields>
+void dumpObject(const Fields & fields, const char * indent, const Owner & owner, std::string & text)
+{
+    SettingsSchema::forEach(fields, [indent, &owner, &text](const auto & field) {
+        dumpValue(indent, field.key.data(), owner.*field.member, text);
+    });
+}
+#endif
+
 } // anonymous namespace
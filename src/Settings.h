@@ -15,6 +15,9 @@
 #pragma once
 
 // App
+#include "Log.h"
+#include "LogFormat.h"
+#include "LogOverflow.h"
 #include "MinimizePersistence.h"
 #include "MinimizePlacement.h"
 #include "TrayEvent.h"
@@ -62,20 +65,38 @@ public:
 
     void addAutoTray(AutoTray && autoTray);
 
+    // reads auto-tray items from either a JSON array of items, or an object with an auto-tray array
+    static bool autoTraysFromJSON(const std::string & json, std::vector<AutoTray> & autoTrays);
+
     static bool fileExists(const std::string & fileName);
 
     // NOLINTBEGIN(misc-non-private-member-variables-in-classes)
     unsigned int version_ {};
     bool startWithWindows_ {};
     bool logToFile_ {};
+    Log::Level logLevel_ {};
+    LogOverflow logOverflow_ {};
+    LogFormat logFormat_ {};
+    unsigned int logMaxSize_ {}; // in kilobytes, zero for no limit
+    unsigned int logMaxAge_ {}; // in hours, zero for no limit
+    unsigned int logKeep_ {}; // number of rotated log files to keep
+    bool logCompress_ {};
+    bool logFlightRecorder_ {};
+    Log::Level logFlightRecorderLevel_ {};
+    unsigned int logRateLimit_ {}; // debug and info lines per call site in each window, zero for no limit
+    unsigned int logRateLimitWarning_ {}; // warnings per call site in each window, zero for no limit
+    unsigned int logRateWindow_ {}; // in seconds, zero for no rate limits or collapsing
+    bool logMonotonicTimestamps_ {};
     MinimizePlacement minimizePlacement_ {};
     std::string hotkeyMinimize_;
     std::string hotkeyMinimizeAll_;
     std::string hotkeyRestore_;
     std::string hotkeyRestoreAll_;
     std::string hotkeyMenu_;
+    std::string hotkeySwitcher_;
     std::string modifiersOverride_;
     unsigned int pollInterval_ {}; // zero to disable
+    unsigned int trayTipInterval_ {}; // in milliseconds, zero for no limit
     std::vector<AutoTray> autoTrays_;
     // NOLINTEND(misc-non-private-member-variables-in-classes)
 };
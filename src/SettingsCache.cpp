@@ -0,0 +1,371 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "SettingsCache.h"
+#include "Log.h"
+#include "SettingsSchema.h"
+
+// Standard library
+#include <type_traits>
+
+namespace
+{
+
+// Cache file layout, all values little endian:
+//
+//     header:
+//         u32 magic
+//         u32 format version
+//         u64 JSON size
+//         u64 JSON write time
+//         u64 JSON hash
+//         u32 payload size
+//         u64 payload hash
+//     payload:
+//         settings fields in schema order, numbers and enums are u32, bools are
+//         u8, strings are u32 length followed by the characters, and lists are
+//         u32 count followed by the items
+
+constexpr std::uint32_t magic_ = 0x43535446; // "FTSC"
+
+// the schema fingerprint invalidates caches written with a different field list
+constexpr std::uint32_t formatVersion_ = SettingsSchema::fingerprint(
+    SettingsSchema::autoTrayFields,
+    SettingsSchema::fingerprint(SettingsSchema::settingsFields, 2));
+constexpr size_t headerSize_ = 4 + 4 + 8 + 8 + 8 + 4 + 8;
+constexpr std::uint32_t stringSizeMax_ = 64 * 1024;
+
+class Writer
+{
+public:
+    void u8(std::uint8_t value) { data_.push_back(static_cast<char>(value)); }
+
+    void u32(std::uint32_t value)
+    {
+        for (unsigned int i = 0; i < 4; ++i) {
+            u8(static_cast<std::uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void u64(std::uint64_t value)
+    {
+        for (unsigned int i = 0; i < 8; ++i) {
+            u8(static_cast<std::uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void string(const std::string & value)
+    {
+        u32(static_cast<std::uint32_t>(value.size()));
+        data_ += value;
+    }
+
+    [[nodiscard]]
+    const std::string & data() const noexcept
+    {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+// all reads are bounds checked, once a read fails all following reads fail too
+class Reader
+{
+public:
+    explicit Reader(std::string_view data) noexcept
+        : data_(data)
+    {
+    }
+
+    bool u8(std::uint8_t & value) noexcept
+    {
+        if (!ok_ || data_.empty()) {
+            ok_ = false;
+            return false;
+        }
+        value = static_cast<std::uint8_t>(data_.front());
+        data_.remove_prefix(1);
+        return true;
+    }
+
+    bool u32(std::uint32_t & value) noexcept
+    {
+        value = 0;
+        for (unsigned int i = 0; i < 4; ++i) {
+            std::uint8_t byte = 0;
+            if (!u8(byte)) {
+                return false;
+            }
+            value |= static_cast<std::uint32_t>(byte) << (i * 8);
+        }
+        return true;
+    }
+
+    bool u64(std::uint64_t & value) noexcept
+    {
+        value = 0;
+        for (unsigned int i = 0; i < 8; ++i) {
+            std::uint8_t byte = 0;
+            if (!u8(byte)) {
+                return false;
+            }
+            value |= static_cast<std::uint64_t>(byte) << (i * 8);
+        }
+        return true;
+    }
+
+    bool boolean(bool & value) noexcept
+    {
+        std::uint8_t byte = 0;
+        if (!u8(byte) || (byte > 1)) {
+            ok_ = false;
+            return false;
+        }
+        value = byte != 0;
+        return true;
+    }
+
+    bool string(std::string & value)
+    {
+        std::uint32_t size = 0;
+        if (!u32(size) || (size > stringSizeMax_) || (size > data_.size())) {
+            ok_ = false;
+            return false;
+        }
+        value.assign(data_.data(), size);
+        data_.remove_prefix(size);
+        return true;
+    }
+
+    template <typename T>
+    bool enumeration(T & value) noexcept
+    {
+        std::uint32_t raw = 0;
+        if (!u32(raw)) {
+            return false;
+        }
+        value = static_cast<T>(raw);
+        return true;
+    }
+
+    void fail() noexcept { ok_ = false; }
+
+    [[nodiscard]]
+    size_t remaining() const noexcept
+    {
+        return data_.size();
+    }
+
+    [[nodiscard]]
+    bool ok() const noexcept
+    {
+        return ok_;
+    }
+
+private:
+    std::string_view data_;
+    bool ok_ { true };
+};
+
+bool enumValid(Log::Level logLevel) noexcept
+{
+    return Log::levelValid(logLevel);
+}
+
+bool enumValid(LogOverflow logOverflow) noexcept
+{
+    return logOverflowValid(logOverflow);
+}
+
+bool enumValid(LogFormat logFormat) noexcept
+{
+    return logFormatValid(logFormat);
+}
+
+bool enumValid(MinimizePlacement minimizePlacement) noexcept
+{
+    return minimizePlacementValid(minimizePlacement);
+}
+
+bool enumValid(TrayEvent trayEvent) noexcept
+{
+    return trayEventValid(trayEvent);
+}
+
+bool enumValid(MinimizePersistence minimizePersistence) noexcept
+{
+    return minimizePersistenceValid(minimizePersistence);
+}
+
+template <typename Owner, typename Fields>
+void writeObject(Writer & writer, const Fields & fields, const Owner & owner);
+template <typename Owner, typename Fields>
+void readObject(Reader & reader, const Fields & fields, Owner & owner);
+
+template <typename T>
+void writeValue(Writer & writer, const T & value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        writer.u8(value ? 1 : 0);
+    } else if constexpr (std::is_same_v<T, unsigned int>) {
+        writer.u32(value);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        writer.string(value);
+    } else if constexpr (std::is_enum_v<T>) {
+        writer.u32(static_cast<std::uint32_t>(value));
+    } else {
+        static_assert(std::is_same_v<T, std::vector<Settings::AutoTray>>);
+        writer.u32(static_cast<std::uint32_t>(value.size()));
+        for (const Settings::AutoTray & autoTray : value) {
+            writeObject(writer, SettingsSchema::autoTrayFields, autoTray);
+        }
+    }
+}
+
+// only valid settings are cached and the payload hash matched, so the hotkeys
+// and regular expressions are not validated again here, that's the expensive
+// part that the cache is meant to avoid, but enums are range checked
+template <typename T>
+void readValue(Reader & reader, T & value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        reader.boolean(value);
+    } else if constexpr (std::is_same_v<T, unsigned int>) {
+        reader.u32(value);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        reader.string(value);
+    } else if constexpr (std::is_enum_v<T>) {
+        if (reader.enumeration(value) && !enumValid(value)) {
+            reader.fail();
+        }
+    } else {
+        static_assert(std::is_same_v<T, std::vector<Settings::AutoTray>>);
+
+        // each item takes at least 4 bytes per field, so a bad count can't cause a huge allocation
+        constexpr size_t autoTraySizeMin = 4 * std::tuple_size_v<decltype(SettingsSchema::autoTrayFields)>;
+        std::uint32_t count = 0;
+        if (!reader.u32(count) || (count > (reader.remaining() / autoTraySizeMin))) {
+            reader.fail();
+            return;
+        }
+
+        value.resize(count);
+        for (Settings::AutoTray & autoTray : value) {
+            readObject(reader, SettingsSchema::autoTrayFields, autoTray);
+        }
+    }
+}
+
+template <typename Owner, typename Fields>
+void writeObject(Writer & writer, const Fields & fields, const Owner & owner)
+{
+    SettingsSchema::forEach(fields, [&writer, &owner](const auto & field) { writeValue(writer, owner.*field.member); });
+}
+
+template <typename Owner, typename Fields>
+void readObject(Reader & reader, const Fields & fields, Owner & owner)
+{
+    SettingsSchema::forEach(fields, [&reader, &owner](const auto & field) { readValue(reader, owner.*field.member); });
+}
+
+} // anonymous namespace
+
+namespace SettingsCache
+{
+
+// FNV-1a, this only needs to detect changes, not resist tampering
+std::uint64_t hash(std::string_view data) noexcept
+{
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char c : data) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+Source source(std::string_view json, std::uint64_t size, std::uint64_t writeTime) noexcept
+{
+    return { size, writeTime, hash(json) };
+}
+
+std::string encode(const Settings & settings, const Source & source)
+{
+    Writer payload;
+    writeObject(payload, SettingsSchema::settingsFields, settings);
+
+    Writer header;
+    header.u32(magic_);
+    header.u32(formatVersion_);
+    header.u64(source.size);
+    header.u64(source.writeTime);
+    header.u64(source.hash);
+    header.u32(static_cast<std::uint32_t>(payload.data().size()));
+    header.u64(hash(payload.data()));
+
+    return header.data() + payload.data();
+}
+
+bool decode(std::string_view data, const Source & source, Settings & settings)
+{
+    if (data.size() < headerSize_) {
+        DEBUG_PRINTF("settings cache too small: %zu bytes\n", data.size());
+        return false;
+    }
+
+    Reader header(data.substr(0, headerSize_));
+    std::uint32_t magic = 0;
+    std::uint32_t formatVersion = 0;
+    Source cached;
+    std::uint32_t payloadSize = 0;
+    std::uint64_t payloadHash = 0;
+    header.u32(magic);
+    header.u32(formatVersion);
+    header.u64(cached.size);
+    header.u64(cached.writeTime);
+    header.u64(cached.hash);
+    header.u32(payloadSize);
+    header.u64(payloadHash);
+    if (!header.ok() || (magic != magic_) || (formatVersion != formatVersion_)) {
+        DEBUG_PRINTF("settings cache has unknown format\n");
+        return false;
+    }
+
+    if ((cached.size != source.size) || (cached.writeTime != source.writeTime) || (cached.hash != source.hash)) {
+        DEBUG_PRINTF("settings cache is stale\n");
+        return false;
+    }
+
+    const std::string_view payloadData = data.substr(headerSize_);
+    if ((payloadData.size() != payloadSize) || (hash(payloadData) != payloadHash)) {
+        WARNING_PRINTF("settings cache payload is corrupt\n");
+        return false;
+    }
+
+    Settings decoded;
+    Reader payload(payloadData);
+    readObject(payload, SettingsSchema::settingsFields, decoded);
+    if (!payload.ok() || payload.remaining()) {
+        WARNING_PRINTF("settings cache payload is malformed\n");
+        return false;
+    }
+
+    settings = std::move(decoded);
+    return true;
+}
+
+} // namespace SettingsCache
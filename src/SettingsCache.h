@@ -0,0 +1,48 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "Settings.h"
+
+// Standard library
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Binary cache of normalized and validated settings, stored next to the JSON
+// settings file so that warm starts can skip parsing and normalization. The
+// JSON file is always the source of truth, the cache is only used when the
+// size, modification time, and hash of the JSON file match the values that
+// were recorded when the cache was written.
+//
+// The file is read and written by the caller.
+namespace SettingsCache
+{
+
+struct Source
+{
+    std::uint64_t size {};
+    std::uint64_t writeTime {};
+    std::uint64_t hash {};
+};
+
+std::uint64_t hash(std::string_view data) noexcept;
+Source source(std::string_view json, std::uint64_t size, std::uint64_t writeTime) noexcept;
+
+std::string encode(const Settings & settings, const Source & source);
+bool decode(std::string_view data, const Source & source, Settings & settings);
+
+} // namespace SettingsCache
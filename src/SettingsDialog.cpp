@@ -20,6 +20,7 @@
 #include "Helpers.h"
 #include "Hotkey.h"
 #include "Log.h"
+#include "LogFormatters.h"
 #include "Resource.h"
 #include "StringUtility.h"
 #include "WindowInfo.h"
@@ -121,7 +122,7 @@ namespace
 
 INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
-    // DEBUG_PRINTF("wnd %#x, message %#x, wparam %#x, lparam %#x\n", dialogHwnd, message, wParam, lParam);
+    // DEBUG_LOG("wnd {}, message {:#x}, wparam {:#x}, lparam {:#x}\n", dialogHwnd, message, wParam, lParam);
 
     if (spyMode_) {
         switch (message) {
@@ -150,7 +151,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
             }
 
             default: {
-                // DEBUG_PRINTF("spyMode message %#x, wparam %#x, lparam %#x\n", message, wParam, lParam);
+                // DEBUG_LOG("spyMode message {:#x}, wparam {:#x}, lparam {:#x}\n", message, wParam, lParam);
                 break;
             }
         }
@@ -182,6 +183,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
             setDlgItemTextSafe(dialogHwnd, IDC_HOTKEY_RESTORE, settings_.hotkeyRestore_);
             setDlgItemTextSafe(dialogHwnd, IDC_HOTKEY_RESTORE_ALL, settings_.hotkeyRestoreAll_);
             setDlgItemTextSafe(dialogHwnd, IDC_HOTKEY_MENU, settings_.hotkeyMenu_);
+            setDlgItemTextSafe(dialogHwnd, IDC_HOTKEY_SWITCHER, settings_.hotkeySwitcher_);
             setDlgItemTextSafe(dialogHwnd, IDC_MODIFIER_OVERRIDE, settings_.modifiersOverride_);
             setDlgItemTextSafe(dialogHwnd, IDC_AUTO_TRAY_EDIT_WINDOWCLASS, "");
             setDlgItemTextSafe(dialogHwnd, IDC_AUTO_TRAY_EDIT_EXECUTABLE, "");
@@ -208,7 +210,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
 
         case WM_NOTIFY: {
             const NMHDR * nmhdr = reinterpret_cast<const NMHDR *>(lParam);
-            // DEBUG_PRINTF("nmhdr hwnd %#x, id %#x, code %d\n", nmhdr->hwndFrom, nmhdr->idFrom, (int)nmhdr->code);
+            // DEBUG_LOG("nmhdr hwnd {}, id {:#x}, code {}\n", nmhdr->hwndFrom, nmhdr->idFrom, nmhdr->code);
             if (nmhdr->hwndFrom == GetDlgItem(dialogHwnd, IDC_AUTO_TRAY_LIST)) {
                 autoTrayListViewNotify(dialogHwnd, nmhdr);
             }
@@ -216,7 +218,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
         }
 
         case WM_COMMAND: {
-            // DEBUG_PRINTF("WM_COMMAND wparam %#x, lparam  %#x\n", wParam, lParam);
+            // DEBUG_LOG("WM_COMMAND wparam {:#x}, lparam {:#x}\n", wParam, lParam);
             if (HIWORD(wParam) == 0) {
                 switch (LOWORD(wParam)) {
                     case IDC_START_WITH_WINDOWS: {
@@ -298,6 +300,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
                         settings_.hotkeyRestore_ = getDialogItemText(dialogHwnd, IDC_HOTKEY_RESTORE);
                         settings_.hotkeyRestoreAll_ = getDialogItemText(dialogHwnd, IDC_HOTKEY_RESTORE_ALL);
                         settings_.hotkeyMenu_ = getDialogItemText(dialogHwnd, IDC_HOTKEY_MENU);
+                        settings_.hotkeySwitcher_ = getDialogItemText(dialogHwnd, IDC_HOTKEY_SWITCHER);
                         settings_.modifiersOverride_ = getDialogItemText(dialogHwnd, IDC_MODIFIER_OVERRIDE);
                         settings_.autoTrays_ = autoTrayListViewGetItems(dialogHwnd);
 
@@ -327,7 +330,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
                     }
 
                     default: {
-                        DEBUG_PRINTF("WM_COMMAND %#x\n", wParam);
+                        DEBUG_LOG("WM_COMMAND {:#x}\n", wParam);
                         break;
                     }
                 }
@@ -336,7 +339,7 @@ INT_PTR settingsDialogFunc(HWND dialogHwnd, UINT message, WPARAM wParam, LPARAM
         }
 
         default: {
-            // DEBUG_PRINTF("message %#x, param %#x\n", message, wParam);
+            // DEBUG_LOG("message {:#x}, param {:#x}\n", message, wParam);
             break;
         }
     }
@@ -890,7 +893,7 @@ void spyUpdate(HWND dialogHwnd)
         return;
     }
 
-    DEBUG_PRINTF("Spy mode: root hwnd %#x\n", rootHwnd);
+    DEBUG_LOG("Spy mode: root hwnd {}\n", rootHwnd);
 
     const WindowInfo windowInfo(rootHwnd);
     DEBUG_PRINTF("Class name: '%s'\n", windowInfo.className().c_str());
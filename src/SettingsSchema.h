@@ -0,0 +1,345 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// App
+#include "Log.h"
+#include "LogFormat.h"
+#include "LogOverflow.h"
+#include "MinimizePersistence.h"
+#include "MinimizePlacement.h"
+#include "Settings.h"
+#include "TrayEvent.h"
+
+// Standard library
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Every setting is described once in the field tables at the bottom of this
+// file. Parsing, serializing, validating, normalizing, dumping, and caching of
+// settings are all generated from these tables, so adding a setting only
+// requires adding a member to Settings and a field here.
+namespace SettingsSchema
+{
+
+template <typename T>
+struct IsVector : std::false_type
+{
+};
+
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type
+{
+};
+
+// strings can't be constexpr, so their defaults are stored as C strings, and
+// lists always default to empty
+template <typename T>
+struct DefaultType
+{
+    using type = T;
+};
+
+template <>
+struct DefaultType<std::string>
+{
+    using type = const char *;
+};
+
+struct EmptyDefault
+{
+};
+
+template <typename T>
+struct DefaultType<std::vector<T>>
+{
+    using type = EmptyDefault;
+};
+
+enum class Write
+{
+    Always,
+    NonDefault
+};
+
+template <typename Owner, typename T>
+struct Field
+{
+    using OwnerType = Owner;
+    using ValueType = T;
+
+    std::string_view key; // always a string literal, so data() is nul terminated
+    T Owner::*member;
+    typename DefaultType<T>::type defaultValue;
+    Write write;
+    bool (*valid)(const T &);
+    void (*normalize)(T &);
+
+    [[nodiscard]]
+    bool isDefault(const Owner & owner) const
+    {
+        if constexpr (IsVector<T>::value) {
+            return (owner.*member).empty();
+        } else {
+            return (owner.*member) == defaultValue;
+        }
+    }
+
+    void reset(Owner & owner) const
+    {
+        if constexpr (IsVector<T>::value) {
+            (owner.*member).clear();
+        } else {
+            owner.*member = defaultValue;
+        }
+    }
+};
+
+template <typename Owner, typename T>
+constexpr Field<Owner, T> field(
+    std::string_view key,
+    T Owner::*member,
+    typename DefaultType<T>::type defaultValue,
+    Write write = Write::Always,
+    std::type_identity_t<bool (*)(const T &)> valid = nullptr,
+    std::type_identity_t<void (*)(T &)> normalize = nullptr)
+{
+    return { key, member, defaultValue, write, valid, normalize };
+}
+
+template <typename Fields, typename Function>
+constexpr void forEach(const Fields & fields, Function && function)
+{
+    std::apply([&function](const auto &... field) { (function(field), ...); }, fields);
+}
+
+template <typename Fields, typename Predicate>
+constexpr bool allOf(const Fields & fields, Predicate && predicate)
+{
+    return std::apply([&predicate](const auto &... field) { return (predicate(field) && ...); }, fields);
+}
+
+// calls function with the field at a runtime index
+template <typename Fields, typename Function>
+constexpr void visit(const Fields & fields, size_t index, Function && function)
+{
+    std::apply(
+        [index, &function](const auto &... field) {
+            size_t i = 0;
+            const auto visitField = [index, &function, &i](const auto & f) {
+                if (i++ != index) {
+                    return false;
+                }
+                function(f);
+                return true;
+            };
+            static_cast<void>((visitField(field) || ...));
+        },
+        fields);
+}
+
+constexpr std::uint32_t keyHash(std::string_view key, std::uint32_t seed) noexcept
+{
+    std::uint32_t hash = 2166136261U ^ (seed * 0x9e3779b9U);
+    for (const char c : key) {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 16777619U;
+    }
+    return hash ^ (hash >> 16);
+}
+
+// Perfect hash of the field keys, built at compile time by searching for a seed
+// that puts every key in its own slot. A lookup is one hash and one compare.
+template <size_t Count>
+class KeyIndex
+{
+public:
+    static constexpr size_t slotCount = std::bit_ceil(Count * 4);
+    static constexpr std::uint32_t seedMax = 4096;
+
+    constexpr explicit KeyIndex(const std::array<std::string_view, Count> & keys)
+        : keys_(keys)
+    {
+        static_assert(Count < 255);
+        while ((seed_ < seedMax) && !build()) {
+            ++seed_;
+        }
+    }
+
+    [[nodiscard]]
+    constexpr bool valid() const noexcept
+    {
+        return seed_ < seedMax;
+    }
+
+    // returns the field index or -1 if the key is unknown
+    [[nodiscard]]
+    constexpr int find(std::string_view key) const noexcept
+    {
+        const std::uint8_t slot = slots_[keyHash(key, seed_) & (slotCount - 1)];
+        if (slot && (keys_[slot - 1U] == key)) {
+            return slot - 1;
+        }
+        return -1;
+    }
+
+private:
+    constexpr bool build() noexcept
+    {
+        slots_ = {};
+        for (size_t i = 0; i < Count; ++i) {
+            std::uint8_t & slot = slots_[keyHash(keys_[i], seed_) & (slotCount - 1)];
+            if (slot) {
+                return false;
+            }
+            slot = static_cast<std::uint8_t>(i + 1);
+        }
+        return true;
+    }
+
+    std::array<std::string_view, Count> keys_;
+    std::array<std::uint8_t, slotCount> slots_ {};
+    std::uint32_t seed_ {};
+};
+
+template <typename Fields>
+constexpr auto keyIndex(const Fields & fields)
+{
+    return std::apply(
+        [](const auto &... field) {
+            return KeyIndex<sizeof...(field)>(std::array<std::string_view, sizeof...(field)> { field.key... });
+        },
+        fields);
+}
+
+// changes whenever keys are added, removed, renamed, or reordered
+template <typename Fields>
+constexpr std::uint32_t fingerprint(const Fields & fields, std::uint32_t seed = 0)
+{
+    std::uint32_t hash = seed;
+    forEach(fields, [&hash](const auto & field) { hash = keyHash(field.key, hash); });
+    return hash;
+}
+
+inline constexpr unsigned int versionCurrent = 1;
+inline constexpr MinimizePlacement minimizePlacementDefault = MinimizePlacement::TrayAndMenu;
+
+// validators and normalizers, these are defined in Settings.cpp
+bool versionValid(const unsigned int & version);
+void versionNormalize(unsigned int & version);
+bool logLevelFieldValid(const Log::Level & logLevel);
+void logLevelNormalize(Log::Level & logLevel);
+bool logOverflowFieldValid(const LogOverflow & logOverflow);
+void logOverflowNormalize(LogOverflow & logOverflow);
+bool logFormatFieldValid(const LogFormat & logFormat);
+void logFormatNormalize(LogFormat & logFormat);
+bool minimizePlacementFieldValid(const MinimizePlacement & minimizePlacement);
+void minimizePlacementNormalize(MinimizePlacement & minimizePlacement);
+bool hotkeyValid(const std::string & hotkey);
+void hotkeyNormalize(std::string & hotkey);
+bool autoTraysValid(const std::vector<Settings::AutoTray> & autoTrays);
+void autoTraysNormalize(std::vector<Settings::AutoTray> & autoTrays);
+bool windowTitleValid(const std::string & windowTitle);
+bool trayEventFieldValid(const TrayEvent & trayEvent);
+void trayEventNormalize(TrayEvent & trayEvent);
+bool minimizePersistenceFieldValid(const MinimizePersistence & minimizePersistence);
+void minimizePersistenceNormalize(MinimizePersistence & minimizePersistence);
+
+// NOLINTBEGIN(*-magic-numbers)
+
+inline constexpr auto autoTrayFields = std::make_tuple(
+    field("executable", &Settings::AutoTray::executable_, "", Write::NonDefault),
+    field("window-class", &Settings::AutoTray::windowClass_, "", Write::NonDefault),
+    field("window-title", &Settings::AutoTray::windowTitle_, "", Write::NonDefault, windowTitleValid),
+    field("tray-event", &Settings::AutoTray::trayEvent_, TrayEvent::Minimize, Write::Always, trayEventFieldValid, trayEventNormalize),
+    field(
+        "minimize-persistence",
+        &Settings::AutoTray::minimizePersistence_,
+        MinimizePersistence::Never,
+        Write::Always,
+        minimizePersistenceFieldValid,
+        minimizePersistenceNormalize));
+
+inline constexpr auto settingsFields = std::make_tuple(
+    field("version", &Settings::version_, versionCurrent, Write::Always, versionValid, versionNormalize),
+    field("start-with-windows", &Settings::startWithWindows_, false),
+    field("log-to-file", &Settings::logToFile_, false),
+    field(
+        "log-level",
+        &Settings::logLevel_,
+        Log::Level::Debug,
+        Write::NonDefault,
+        logLevelFieldValid,
+        logLevelNormalize),
+    field(
+        "log-overflow",
+        &Settings::logOverflow_,
+        LogOverflow::Block,
+        Write::NonDefault,
+        logOverflowFieldValid,
+        logOverflowNormalize),
+    field(
+        "log-format",
+        &Settings::logFormat_,
+        LogFormat::Text,
+        Write::NonDefault,
+        logFormatFieldValid,
+        logFormatNormalize),
+    field("log-max-size", &Settings::logMaxSize_, 10240U, Write::NonDefault),
+    field("log-max-age", &Settings::logMaxAge_, 0U, Write::NonDefault),
+    field("log-keep", &Settings::logKeep_, 5U, Write::NonDefault),
+    field("log-compress", &Settings::logCompress_, true, Write::NonDefault),
+    field("log-flight-recorder", &Settings::logFlightRecorder_, true, Write::NonDefault),
+    field(
+        "log-flight-recorder-level",
+        &Settings::logFlightRecorderLevel_,
+        Log::Level::Debug,
+        Write::NonDefault,
+        logLevelFieldValid,
+        logLevelNormalize),
+    field("log-rate-limit", &Settings::logRateLimit_, 20U, Write::NonDefault),
+    field("log-rate-limit-warning", &Settings::logRateLimitWarning_, 50U, Write::NonDefault),
+    field("log-rate-window", &Settings::logRateWindow_, 10U, Write::NonDefault),
+    field("log-monotonic-timestamps", &Settings::logMonotonicTimestamps_, false, Write::NonDefault),
+    field(
+        "minimize-placement",
+        &Settings::minimizePlacement_,
+        minimizePlacementDefault,
+        Write::Always,
+        minimizePlacementFieldValid,
+        minimizePlacementNormalize),
+    field("hotkey-minimize", &Settings::hotkeyMinimize_, "alt ctrl shift down", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("hotkey-minimize-all", &Settings::hotkeyMinimizeAll_, "alt ctrl shift right", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("hotkey-restore", &Settings::hotkeyRestore_, "alt ctrl shift up", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("hotkey-restore-all", &Settings::hotkeyRestoreAll_, "alt ctrl shift left", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("hotkey-menu", &Settings::hotkeyMenu_, "alt ctrl shift home", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("hotkey-switcher", &Settings::hotkeySwitcher_, "alt ctrl shift end", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("modifiers-override", &Settings::modifiersOverride_, "alt ctrl shift", Write::Always, hotkeyValid, hotkeyNormalize),
+    field("poll-interval", &Settings::pollInterval_, 500U),
+    field("tray-tip-interval", &Settings::trayTipInterval_, 2000U, Write::NonDefault),
+    field("auto-tray", &Settings::autoTrays_, EmptyDefault {}, Write::NonDefault, autoTraysValid, autoTraysNormalize));
+
+// NOLINTEND(*-magic-numbers)
+
+inline constexpr size_t autoTraysIndex = std::tuple_size_v<decltype(settingsFields)> - 1;
+static_assert(std::get<autoTraysIndex>(settingsFields).member == &Settings::autoTrays_);
+
+} // namespace SettingsSchema
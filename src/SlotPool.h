@@ -0,0 +1,180 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// A pool of objects kept in numbered slots, for things that come and go often
+// but are expensive to set up, like tray icons. A slot that's given back keeps
+// its object, and is the next one handed out, so what was set up in it is used
+// again rather than made again, and nothing is allocated until more slots are
+// held at once than there are, when the number of slots is doubled.
+//
+// Slots are found by ID in constant time. An ID is the slot's index in its
+// low half, so IDs stay small and dense, and the slot's generation in its high
+// half, which changes each time the slot is given back. An ID that's been
+// given back no longer finds its slot, even once the slot is handed out again,
+// so a late message about an old ID can't be mistaken for the new one. Zero is
+// never an ID.
+//
+// Slots never move once made, so the objects in them don't need to be movable.
+//
+// This is only used from one thread.
+template <typename T>
+class SlotPool
+{
+public:
+    using Id = std::uint32_t;
+
+    static constexpr size_t slotsMax = 0xffff;
+
+    struct Statistics
+    {
+        std::uint64_t acquired {};
+        std::uint64_t reused {}; // handed out a slot that was held before
+        size_t held {};
+        size_t slots {};
+    };
+
+    // makes count slots up front
+    explicit SlotPool(size_t count) { grow(std::max<size_t>(count, 1)); }
+
+    SlotPool(const SlotPool &) = delete;
+    SlotPool(SlotPool &&) = delete;
+    SlotPool & operator=(const SlotPool &) = delete;
+    SlotPool & operator=(SlotPool &&) = delete;
+    ~SlotPool() = default;
+
+    // Holds a slot, the one given back most recently if any, and returns its
+    // ID, or zero if slotsMax are already held. The object in it is as it was
+    // left, or default constructed if the slot is new.
+    Id acquire()
+    {
+        if (free_.empty()) {
+            if (slots_.size() >= slotsMax) {
+                return 0;
+            }
+            grow(slots_.size());
+        }
+
+        const std::uint16_t index = free_.back();
+        free_.pop_back();
+        Slot & slot = slots_[index];
+        if (slot.used) {
+            ++reused_;
+        }
+        slot.held = true;
+        slot.used = true;
+        ++acquired_;
+        return makeId(index, slot.generation);
+    }
+
+    // gives back a held slot, ignored for an ID that isn't held
+    void release(Id id) noexcept
+    {
+        Slot * const slot = findSlot(id);
+        if (!slot) {
+            return;
+        }
+
+        slot->held = false;
+        ++slot->generation;
+        // free_ has room for every slot, so this never allocates
+        free_.push_back(static_cast<std::uint16_t>((id & 0xffff) - 1));
+    }
+
+    // the object in a held slot, or null if the ID isn't held
+    [[nodiscard]]
+    T * find(Id id) noexcept
+    {
+        Slot * const slot = findSlot(id);
+        return slot ? &slot->value : nullptr;
+    }
+
+    [[nodiscard]]
+    const T * find(Id id) const noexcept
+    {
+        return const_cast<SlotPool *>(this)->find(id);
+    }
+
+    // calls fn with the object in each held slot
+    template <typename Fn>
+    void forEachHeld(Fn && fn) const
+    {
+        for (const Slot & slot : slots_) {
+            if (slot.held) {
+                fn(slot.value);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    Statistics statistics() const noexcept
+    {
+        return { acquired_, reused_, slots_.size() - free_.size(), slots_.size() };
+    }
+
+private:
+    struct Slot
+    {
+        T value {};
+        std::uint16_t generation {};
+        bool held {};
+        bool used {};
+    };
+
+    static constexpr Id makeId(std::uint16_t index, std::uint16_t generation) noexcept
+    {
+        return (static_cast<Id>(generation) << 16) | (static_cast<Id>(index) + 1);
+    }
+
+    Slot * findSlot(Id id) noexcept
+    {
+        const size_t index = static_cast<size_t>(id & 0xffff) - 1;
+        if (index >= slots_.size()) {
+            return nullptr;
+        }
+
+        Slot & slot = slots_[index];
+        if (!slot.held || (makeId(static_cast<std::uint16_t>(index), slot.generation) != id)) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    // new slots are handed out lowest index first
+    void grow(size_t count)
+    {
+        const size_t first = slots_.size();
+        const size_t end = std::min(first + count, slotsMax);
+        for (size_t index = first; index < end; ++index) {
+            slots_.emplace_back();
+        }
+        free_.reserve(end);
+        for (size_t index = end; index > first; --index) {
+            free_.push_back(static_cast<std::uint16_t>(index - 1));
+        }
+    }
+
+    std::deque<Slot> slots_;
+    std::vector<std::uint16_t> free_; // indexes of slots not held, the next to hand out last
+    std::uint64_t acquired_ {};
+    std::uint64_t reused_ {};
+};
@@ -0,0 +1,392 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// App
+#include "Switcher.h"
+#include "AppInfo.h"
+#include "Helpers.h"
+#include "Log.h"
+#include "LogFormatters.h"
+#include "StringUtility.h"
+#include "WindowIndex.h"
+#include "WindowTracker.h"
+
+// Windows
+#include <CommCtrl.h>
+
+// Standard library
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// in pixels at 96 DPI, scaled for the system DPI
+constexpr int width_ = 560;
+constexpr int editHeight_ = 22;
+constexpr int listHeight_ = 300;
+constexpr int margin_ = 4;
+
+constexpr size_t resultsMax_ = 20;
+constexpr UINT_PTR editSubclassId_ = 1;
+
+alignas(4) const CHAR className_[] = APP_NAME "Switcher";
+
+HWND window_;
+HWND edit_;
+HWND list_;
+bool classRegistered_;
+void (*activateCallback_)(HWND);
+std::vector<WindowIndex::Match> matches_;
+std::vector<HWND> results_;
+
+bool create();
+LRESULT CALLBACK switcherProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+LRESULT CALLBACK editProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR id, DWORD_PTR data);
+void filter();
+void moveSelection(int delta);
+void activateSelected();
+void hide();
+
+} // anonymous namespace
+
+namespace Switcher
+{
+
+bool show(void (*activateCallback)(HWND))
+{
+    DEBUG_PRINTF("showing switcher\n");
+
+    activateCallback_ = activateCallback;
+    if (!window_ && !create()) {
+        return false;
+    }
+
+    // centered across the monitor the cursor is on, a quarter of the way down
+    POINT point {};
+    if (!GetCursorPos(&point)) {
+        WARNING_PRINTF("GetCursorPos() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+    MONITORINFO monitorInfo;
+    memset(&monitorInfo, 0, sizeof(MONITORINFO));
+    monitorInfo.cbSize = sizeof(MONITORINFO);
+    if (!GetMonitorInfoA(MonitorFromPoint(point, MONITOR_DEFAULTTONEAREST), &monitorInfo)) {
+        WARNING_PRINTF("GetMonitorInfoA() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+    RECT rect {};
+    if (!GetWindowRect(window_, &rect)) {
+        WARNING_PRINTF("GetWindowRect() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+    const RECT & work = monitorInfo.rcWork;
+    const int x = work.left + (((work.right - work.left) - (rect.right - rect.left)) / 2);
+    const int y = work.top + ((work.bottom - work.top) / 4);
+    if (!SetWindowPos(window_, HWND_TOPMOST, x, y, 0, 0, SWP_NOSIZE | SWP_SHOWWINDOW)) {
+        WARNING_PRINTF("SetWindowPos() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+
+    // start over with every window listed, clearing any text left from last time filters by way of EN_CHANGE
+    if (!GetWindowTextLengthA(edit_)) {
+        filter();
+    } else if (!SetWindowTextA(edit_, "")) {
+        WARNING_PRINTF("SetWindowTextA() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+
+    // return value intentionally ignored, SetForegroundWindow returns whether brought to foreground
+    SetForegroundWindow(window_);
+    SetFocus(edit_);
+
+    return true;
+}
+
+void stop() noexcept
+{
+    DEBUG_PRINTF("switcher stopping\n");
+
+    if (window_) {
+        if (!DestroyWindow(window_)) {
+            WARNING_PRINTF("DestroyWindow() failed: %ld\n", GetLastError());
+        }
+        window_ = nullptr;
+        edit_ = nullptr;
+        list_ = nullptr;
+    }
+
+    if (classRegistered_) {
+        if (!UnregisterClassA(className_, getInstance())) {
+            WARNING_PRINTF("UnregisterClassA() failed: %ld\n", GetLastError());
+        }
+        classRegistered_ = false;
+    }
+
+    activateCallback_ = nullptr;
+    matches_.clear();
+    results_.clear();
+}
+
+} // namespace Switcher
+
+namespace
+{
+
+bool create()
+{
+    DEBUG_PRINTF("creating switcher window\n");
+
+    const HINSTANCE hinstance = getInstance();
+
+    if (!classRegistered_) {
+        WNDCLASSEXA wc;
+        memset(&wc, 0, sizeof(WNDCLASSEX));
+        wc.cbSize = sizeof(WNDCLASSEX);
+        wc.lpfnWndProc = switcherProc;
+        wc.hInstance = hinstance;
+        wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+        wc.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW + 1);
+        wc.lpszClassName = className_;
+        if (!RegisterClassExA(&wc)) {
+            ERROR_PRINTF("could not create switcher window class: %s\n", StringUtility::lastErrorString().c_str());
+            return false;
+        }
+        classRegistered_ = true;
+    }
+
+    const UINT dpi = GetDpiForSystem();
+    const auto scale = [dpi](int value) {
+        return MulDiv(value, static_cast<int>(dpi), USER_DEFAULT_SCREEN_DPI);
+    };
+    const int margin = scale(margin_);
+    const int width = scale(width_);
+    const int editHeight = scale(editHeight_);
+    const int listHeight = scale(listHeight_);
+
+    const DWORD style = WS_POPUP | WS_BORDER;
+    const DWORD exStyle = WS_EX_TOOLWINDOW | WS_EX_TOPMOST;
+    RECT rect = { 0, 0, width, editHeight + listHeight + (margin * 3) };
+    if (!AdjustWindowRectEx(&rect, style, FALSE, exStyle)) {
+        WARNING_PRINTF("AdjustWindowRectEx() failed: %s\n", StringUtility::lastErrorString().c_str());
+    }
+
+    window_ = CreateWindowExA(
+        exStyle,
+        className_,
+        APP_NAME,
+        style,
+        0,
+        0,
+        rect.right - rect.left,
+        rect.bottom - rect.top,
+        nullptr,
+        nullptr,
+        hinstance,
+        nullptr);
+    if (!window_) {
+        ERROR_PRINTF("could not create switcher window: %s\n", StringUtility::lastErrorString().c_str());
+        return false;
+    }
+
+    edit_ = CreateWindowExA(
+        0,
+        WC_EDITA,
+        "",
+        WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL,
+        margin,
+        margin,
+        width - (margin * 2),
+        editHeight,
+        window_,
+        nullptr,
+        hinstance,
+        nullptr);
+    list_ = CreateWindowExA(
+        0,
+        WC_LISTBOXA,
+        "",
+        WS_CHILD | WS_VISIBLE | WS_BORDER | WS_VSCROLL | LBS_NOTIFY | LBS_NOINTEGRALHEIGHT,
+        margin,
+        editHeight + (margin * 2),
+        width - (margin * 2),
+        listHeight,
+        window_,
+        nullptr,
+        hinstance,
+        nullptr);
+    if (!edit_ || !list_) {
+        ERROR_PRINTF("could not create switcher controls: %s\n", StringUtility::lastErrorString().c_str());
+        Switcher::stop();
+        return false;
+    }
+
+    const auto font = reinterpret_cast<WPARAM>(GetStockObject(DEFAULT_GUI_FONT));
+    SendMessageA(edit_, WM_SETFONT, font, FALSE);
+    SendMessageA(list_, WM_SETFONT, font, FALSE);
+
+    // the edit keeps the focus, and passes the keys that move through the list on to it
+    if (!SetWindowSubclass(edit_, editProc, editSubclassId_, 0)) {
+        ERROR_PRINTF("could not subclass switcher edit control\n");
+        Switcher::stop();
+        return false;
+    }
+
+    return true;
+}
+
+LRESULT CALLBACK switcherProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    switch (uMsg) {
+        case WM_COMMAND: {
+            const auto control = reinterpret_cast<HWND>(lParam);
+            if ((control == edit_) && (HIWORD(wParam) == EN_CHANGE)) {
+                filter();
+                return 0;
+            }
+            if ((control == list_) && (HIWORD(wParam) == LBN_DBLCLK)) {
+                activateSelected();
+                return 0;
+            }
+            break;
+        }
+
+        // clicking anywhere else closes the switcher
+        case WM_ACTIVATE: {
+            if (LOWORD(wParam) == WA_INACTIVE) {
+                hide();
+            }
+            break;
+        }
+
+        case WM_CLOSE: {
+            hide();
+            return 0;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return DefWindowProcA(hwnd, uMsg, wParam, lParam);
+}
+
+LRESULT CALLBACK editProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR id, DWORD_PTR /* data */)
+{
+    switch (uMsg) {
+        case WM_KEYDOWN: {
+            switch (wParam) {
+                case VK_UP: moveSelection(-1); return 0;
+                case VK_DOWN: moveSelection(1); return 0;
+                case VK_PRIOR: moveSelection(-static_cast<int>(resultsMax_)); return 0;
+                case VK_NEXT: moveSelection(static_cast<int>(resultsMax_)); return 0;
+                case VK_RETURN: activateSelected(); return 0;
+                case VK_ESCAPE: hide(); return 0;
+                default: break;
+            }
+            break;
+        }
+
+        // a single line edit beeps at enter and escape
+        case WM_CHAR: {
+            if ((wParam == '\r') || (wParam == '\x1b')) {
+                return 0;
+            }
+            break;
+        }
+
+        case WM_NCDESTROY: {
+            if (!RemoveWindowSubclass(hwnd, editProc, id)) {
+                WARNING_PRINTF("could not remove switcher edit control subclass\n");
+            }
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return DefSubclassProc(hwnd, uMsg, wParam, lParam);
+}
+
+// searches for what's been typed, and lists the best matches with the best selected
+void filter()
+{
+    const int length = GetWindowTextLengthA(edit_);
+    std::string query(static_cast<size_t>(length) + 1, '\0');
+    query.resize(static_cast<size_t>(GetWindowTextA(edit_, query.data(), length + 1)));
+
+    const WindowIndex & index = WindowTracker::index();
+    index.search(query, resultsMax_, matches_);
+
+    SendMessageA(list_, WM_SETREDRAW, FALSE, 0);
+    SendMessageA(list_, LB_RESETCONTENT, 0, 0);
+    results_.clear();
+    std::string label;
+    for (const WindowIndex::Match & match : matches_) {
+        label = index.title(match.window);
+        label += "  (";
+        label += index.executable(match.window);
+        label += ')';
+        if (SendMessageA(list_, LB_ADDSTRING, 0, reinterpret_cast<LPARAM>(label.c_str())) < 0) {
+            WARNING_PRINTF("could not add switcher list item\n");
+            break;
+        }
+        results_.push_back(reinterpret_cast<HWND>(match.window));
+    }
+    SendMessageA(list_, LB_SETCURSEL, 0, 0);
+    SendMessageA(list_, WM_SETREDRAW, TRUE, 0);
+    if (!InvalidateRect(list_, nullptr, TRUE)) {
+        WARNING_PRINTF("InvalidateRect() failed\n");
+    }
+}
+
+void moveSelection(int delta)
+{
+    if (results_.empty()) {
+        return;
+    }
+
+    const auto selected = static_cast<int>(SendMessageA(list_, LB_GETCURSEL, 0, 0));
+    const int next = (selected == LB_ERR) ? 0 : std::clamp(selected + delta, 0, static_cast<int>(results_.size()) - 1);
+    SendMessageA(list_, LB_SETCURSEL, static_cast<WPARAM>(next), 0);
+}
+
+void activateSelected()
+{
+    const auto selected = static_cast<int>(SendMessageA(list_, LB_GETCURSEL, 0, 0));
+    if ((selected == LB_ERR) || (static_cast<size_t>(selected) >= results_.size())) {
+        return;
+    }
+
+    // the window may have closed since it was listed
+    const HWND hwnd = results_[static_cast<size_t>(selected)];
+    hide();
+    if (!IsWindow(hwnd)) {
+        WARNING_LOG("switcher window {} no longer exists\n", hwnd);
+        return;
+    }
+
+    INFO_LOG("switching to window {}\n", hwnd);
+    if (activateCallback_) {
+        activateCallback_(hwnd);
+    }
+}
+
+void hide()
+{
+    // return value intentionally ignored, ShowWindow returns previous visibility
+    ShowWindow(window_, SW_HIDE);
+}
+
+} // anonymous namespace
@@ -0,0 +1,35 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+// Windows
+#include <Windows.h>
+
+// A popup to switch to a window by typing part of its title or executable.
+// The windows the user can see or has minimized are listed best match first
+// as each key is typed, from the index the window tracker keeps up to date.
+// Up and down pick a window, enter switches to it, and escape or clicking
+// elsewhere closes the popup.
+namespace Switcher
+{
+
+// Shows the popup, which is kept hidden between shows. The callback is given
+// the window the user picked, which may be minimized to the tray.
+bool show(void (*activateCallback)(HWND));
+
+void stop() noexcept;
+
+} // namespace Switcher
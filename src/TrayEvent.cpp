@@ -16,6 +16,9 @@
 #include "TrayEvent.h"
 #include "Log.h"
 
+// Standard library
+#include <cstring>
+
 bool trayEventValid(TrayEvent trayEvent) noexcept
 {
     switch (trayEvent) {
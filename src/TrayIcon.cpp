@@ -14,108 +14,238 @@
 
 // App
 #include "TrayIcon.h"
-#include "Helpers.h"
+#include "ContentHash.h"
+#include "HandleWrapper.h"
 #include "IconHandleWrapper.h"
 #include "Log.h"
 #include "Resource.h"
+#include "SlotPool.h"
 #include "StringUtility.h"
 
-// Windows
-#include <combaseapi.h>
-
 // Standard library
-#include <map>
+#include <cstdint>
+#include <span>
 
 namespace
 {
 
-using IDMap = std::map<UINT, HWND>;
+// enough for the app and many minimized windows before the pool has to grow
+constexpr size_t slotCount_ = 64;
+
+struct Slot
+{
+    NOTIFYICONDATAA nid {};
+    IconHandleWrapper icon;
+    HWND hwnd {};
+    std::uint64_t app {}; // a hash of the window's executable path, if nid.guidItem was made from it
+    unsigned int instance {}; // which of the app's icons in the tray this is
+};
+
+SlotPool<Slot> slots_(slotCount_);
+
+// a hash of the path of a process's executable, zero if it can't be had
+std::uint64_t hashExecutablePath(HANDLE process, std::uint64_t seed)
+{
+    wchar_t path[1024];
+    DWORD size = sizeof(path) / sizeof(path[0]);
+    if (!QueryFullProcessImageNameW(process, 0, path, &size)) {
+        WARNING_PRINTF("QueryFullProcessImageNameW() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return 0;
+    }
+    const auto * bytes = reinterpret_cast<const std::uint8_t *>(path);
+    return ContentHash::hash(std::span(bytes, size * sizeof(wchar_t)), seed);
+}
+
+std::uint64_t hashWindowExecutable(HWND hwnd)
+{
+    // the shell ties a GUID to the executable that first used it, so a copy of this app elsewhere gets others
+    static const std::uint64_t seed = hashExecutablePath(GetCurrentProcess(), 0);
+
+    DWORD processID = 0;
+    if (!seed || !GetWindowThreadProcessId(hwnd, &processID)) {
+        return 0;
+    }
+    const HandleWrapper process(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID));
+    if (!process) {
+        WARNING_PRINTF("OpenProcess() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return 0;
+    }
+    return hashExecutablePath(process, seed);
+}
+
+// Makes the icon's GUID from the window's executable and how many of its icons
+// are already in the tray, the shell doesn't allow two icons with the same GUID.
+// The shell remembers whether to show or hide an icon by its GUID, so this way
+// the choice follows the app's first icon, second icon, and so on, from one run
+// to the next, rather than whichever window last had the slot. Returns false if
+// the executable can't be found, then the icon goes without a GUID.
+bool makeGuid(Slot & slot)
+{
+    slot.app = hashWindowExecutable(slot.hwnd);
+    if (!slot.app) {
+        return false;
+    }
+
+    slot.instance = 0;
+    for (bool taken = true; taken;) {
+        taken = false;
+        slots_.forEachHeld([&slot, &taken](const Slot & other) {
+            taken = taken || ((&other != &slot) && (other.app == slot.app) && (other.instance == slot.instance));
+        });
+        slot.instance += taken ? 1 : 0;
+    }
 
-IDMap idMap_;
-volatile LONG gid_ = 0;
+    // NOLINTBEGIN(*-magic-numbers)
+    const std::uint64_t low = ContentHash::hash({}, slot.app + slot.instance);
+    const std::uint64_t high = ContentHash::hash({}, low);
+    GUID & guid = slot.nid.guidItem;
+    guid.Data1 = static_cast<unsigned long>(high >> 32);
+    guid.Data2 = static_cast<unsigned short>(high >> 16);
+    guid.Data3 = static_cast<unsigned short>((high & 0x0fff) | 0x8000); // version 8, made by the app
+    for (size_t i = 0; i < sizeof(guid.Data4); ++i) {
+        guid.Data4[i] = static_cast<unsigned char>(low >> (i * 8));
+    }
+    guid.Data4[0] = static_cast<unsigned char>((guid.Data4[0] & 0x3f) | 0x80); // the RFC 4122 variant
+    // NOLINTEND(*-magic-numbers)
+    return true;
+}
 
 } // anonymous namespace
 
 ErrorContext TrayIcon::create(HWND hwnd, HWND messageHwnd, UINT msg, IconHandleWrapper && icon)
 {
-    LONG const gid = InterlockedIncrement(&gid_);
-
-    if (nid_.uID) {
+    if (id_) {
         WARNING_PRINTF("tray icon already created, destroying first\n");
         destroy();
     }
 
-    DEBUG_PRINTF("creating tray icon %u\n", gid);
+    const UINT id = slots_.acquire();
+    Slot * const slot = slots_.find(id);
+    if (!slot) {
+        WARNING_PRINTF("could not create tray icon, too many tray icons\n");
+        return { IDS_ERROR_CREATE_TRAY_ICON, "too many tray icons" };
+    }
+
+    DEBUG_PRINTF("creating tray icon %u\n", id);
 
-    icon_ = std::move(icon);
+    slot->icon = std::move(icon);
+    slot->hwnd = hwnd;
 
-    ZeroMemory(&nid_, sizeof(nid_));
-    nid_.cbSize = NOTIFYICONDATA_V3_SIZE;
-    nid_.hWnd = messageHwnd;
-    nid_.uID = narrow_cast<UINT>(gid);
-    nid_.uFlags = NIF_MESSAGE | NIF_ICON | NIF_TIP | NIF_GUID;
-    nid_.uCallbackMessage = msg;
-    nid_.hIcon = icon_ ? icon_ : LoadIcon(nullptr, IDI_APPLICATION);
-    nid_.uVersion = NOTIFYICON_VERSION;
+    NOTIFYICONDATAA & nid = slot->nid;
+    ZeroMemory(&nid, sizeof(nid));
+    nid.cbSize = NOTIFYICONDATA_V3_SIZE;
+    nid.hWnd = messageHwnd;
+    nid.uID = id;
+    nid.uFlags = NIF_MESSAGE | NIF_ICON | NIF_TIP;
+    nid.uCallbackMessage = msg;
+    nid.hIcon = slot->icon ? slot->icon : LoadIcon(nullptr, IDI_APPLICATION);
+    nid.uVersion = NOTIFYICON_VERSION;
+    if (makeGuid(*slot)) {
+        nid.uFlags |= NIF_GUID;
+    } else {
+        slot->app = 0;
+    }
 
-    if (!GetWindowTextA(hwnd, nid_.szTip, sizeof(nid_.szTip) / sizeof(nid_.szTip[0]))) {
+    if (!GetWindowTextA(hwnd, nid.szTip, sizeof(nid.szTip) / sizeof(nid.szTip[0]))) {
         const DWORD error = GetLastError();
         if (error != ERROR_SUCCESS) {
             WARNING_PRINTF(
                 "could not window text, GetWindowTextA() failed: %s\n",
                 StringUtility::errorToString(error).c_str());
-            nid_.uFlags &= ~static_cast<UINT>(NIF_TIP);
+            nid.uFlags &= ~static_cast<UINT>(NIF_TIP);
         }
     }
 
-    if (FAILED(CoCreateGuid(&nid_.guidItem))) {
-        WARNING_PRINTF(
-            "could not create tray icon guid, CoCreateGuid() failed: %s\n",
-            StringUtility::lastErrorString().c_str());
-        nid_.uFlags &= ~static_cast<UINT>(NIF_GUID);
+    // the shell turns down a GUID it has tied to another executable, the icon can still go without one
+    bool added = Shell_NotifyIconA(NIM_ADD, &nid);
+    if (!added && slot->app) {
+        DEBUG_PRINTF("adding tray icon %u without a GUID\n", id);
+        nid.uFlags &= ~static_cast<UINT>(NIF_GUID);
+        slot->app = 0;
+        added = Shell_NotifyIconA(NIM_ADD, &nid);
     }
-
-    if (!Shell_NotifyIconA(NIM_ADD, &nid_)) {
+    if (!added) {
         const std::string lastErrorString = StringUtility::lastErrorString();
         WARNING_PRINTF("could not add tray icon, Shell_NotifyIcon() failed: %s\n", lastErrorString.c_str());
-        ZeroMemory(&nid_, sizeof(nid_));
+        slot->icon = IconHandleWrapper();
+        slot->hwnd = nullptr;
+        slots_.release(id);
         return { IDS_ERROR_CREATE_TRAY_ICON, lastErrorString + " (NIM_ADD)" };
     }
 
-    if (!Shell_NotifyIconA(NIM_SETVERSION, &nid_)) {
+    id_ = id;
+
+    if (!Shell_NotifyIconA(NIM_SETVERSION, &nid)) {
         const std::string lastErrorString = StringUtility::lastErrorString();
         WARNING_PRINTF("could not set tray icon version, Shell_NotifyIcon() failed: %s\n", lastErrorString.c_str());
         destroy();
         return { IDS_ERROR_CREATE_TRAY_ICON, lastErrorString + " (NIM_SETVERSION)" };
     }
 
-    idMap_[nid_.uID] = hwnd;
-
     return {};
 }
 
 void TrayIcon::destroy() noexcept
 {
-    if (nid_.uID) {
-        DEBUG_PRINTF("destroying tray icon %u\n", nid_.uID);
+    // the slots may already be gone when a static icon is destructed, but it was destroyed before then
+    if (!id_) {
+        return;
+    }
 
-        idMap_.erase(nid_.uID);
+    Slot * const slot = slots_.find(id_);
+    if (slot) {
+        DEBUG_PRINTF("destroying tray icon %u\n", id_);
 
-        if (!Shell_NotifyIconA(NIM_DELETE, &nid_)) {
+        if (!Shell_NotifyIconA(NIM_DELETE, &slot->nid)) {
             WARNING_PRINTF("could not destroy tray icon, Shell_NotifyIcon() failed: %ld\n", GetLastError());
         }
 
-        ZeroMemory(&nid_, sizeof(nid_));
+        slot->icon = IconHandleWrapper();
+        slot->hwnd = nullptr;
+        slot->app = 0;
+        slots_.release(id_);
+    }
+    id_ = 0;
+}
+
+ErrorContext TrayIcon::recreate()
+{
+    Slot * const slot = slots_.find(id_);
+    if (!slot) {
+        return {};
+    }
+
+    DEBUG_PRINTF("recreating tray icon %u\n", id_);
+
+    if (!Shell_NotifyIconA(NIM_ADD, &slot->nid)) {
+        const std::string lastErrorString = StringUtility::lastErrorString();
+
+        // the taskbar is also recreated after a DPI change, which may leave the icon in place
+        if (Shell_NotifyIconA(NIM_MODIFY, &slot->nid)) {
+            DEBUG_PRINTF("tray icon %u was still there\n", id_);
+            return {};
+        }
+
+        WARNING_PRINTF("could not add tray icon again, Shell_NotifyIcon() failed: %s\n", lastErrorString.c_str());
+        return { IDS_ERROR_CREATE_TRAY_ICON, lastErrorString + " (NIM_ADD)" };
+    }
+
+    if (!Shell_NotifyIconA(NIM_SETVERSION, &slot->nid)) {
+        const std::string lastErrorString = StringUtility::lastErrorString();
+        WARNING_PRINTF("could not set tray icon version, Shell_NotifyIcon() failed: %s\n", lastErrorString.c_str());
+        return { IDS_ERROR_CREATE_TRAY_ICON, lastErrorString + " (NIM_SETVERSION)" };
     }
+
+    return {};
 }
 
 void TrayIcon::updateTip(const std::string & tip)
 {
-    if (nid_.uID) {
-        DEBUG_PRINTF("updating tray icon %u tip to '%s'\n", nid_.uID, tip.c_str());
-        constexpr size_t tipMaxSize = sizeof(nid_.szTip) / sizeof(nid_.szTip[0]);
-        strncpy_s(nid_.szTip, tip.c_str(), tipMaxSize - 1);
-        if (!Shell_NotifyIconA(NIM_MODIFY, &nid_)) {
+    Slot * const slot = slots_.find(id_);
+    if (slot) {
+        DEBUG_PRINTF("updating tray icon %u tip to '%s'\n", id_, tip.c_str());
+        strncpy_s(slot->nid.szTip, tip.c_str(), tipLengthMax);
+        if (!Shell_NotifyIconA(NIM_MODIFY, &slot->nid)) {
             WARNING_PRINTF(
                 "could not update tray icon tip, Shell_NotifyIcon() failed: %s\n",
                 StringUtility::lastErrorString().c_str());
@@ -123,11 +253,24 @@ void TrayIcon::updateTip(const std::string & tip)
     }
 }
 
-HWND TrayIcon::getWindowFromID(UINT id)
+void TrayIcon::updateIcon(IconHandleWrapper && icon)
 {
-    const IDMap::iterator it = idMap_.find(id);
-    if (it != idMap_.end()) {
-        return it->second;
+    // the same icon may come back, shared with another window of the app
+    Slot * const slot = slots_.find(id_);
+    if (slot && icon && (static_cast<HICON>(icon) != slot->nid.hIcon)) {
+        DEBUG_PRINTF("updating tray icon %u icon\n", id_);
+        slot->icon = std::move(icon);
+        slot->nid.hIcon = slot->icon;
+        if (!Shell_NotifyIconA(NIM_MODIFY, &slot->nid)) {
+            WARNING_PRINTF(
+                "could not update tray icon, Shell_NotifyIcon() failed: %s\n",
+                StringUtility::lastErrorString().c_str());
+        }
     }
-    return nullptr;
+}
+
+HWND TrayIcon::getWindowFromID(UINT id)
+{
+    const Slot * const slot = slots_.find(id);
+    return slot ? slot->hwnd : nullptr;
 }
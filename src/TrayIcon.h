@@ -24,8 +24,15 @@
 
 // Standard library
 #include <string>
+#include <utility>
 
-// manages a single icon in the tray (Windows taskbar notification area)
+// Manages a single icon in the tray (Windows taskbar notification area).
+//
+// What the tray needs for each icon is kept in a pool of slots shared by all
+// of them, so this only holds its slot's ID, which is also the icon's ID in the
+// tray. Slots are used again once their icons are destroyed. An icon's GUID is
+// made from its window's executable, so it's the same from one run to the next
+// and never passed on to another app's window with the slot.
 class TrayIcon
 {
 public:
@@ -34,19 +41,55 @@ public:
     ~TrayIcon() { destroy(); }
 
     TrayIcon(const TrayIcon &) = delete;
-    TrayIcon(TrayIcon &&) = delete;
+
+    TrayIcon(TrayIcon && other) noexcept
+        : id_(std::exchange(other.id_, 0))
+    {
+    }
+
     TrayIcon & operator=(const TrayIcon &) = delete;
-    TrayIcon & operator=(TrayIcon &&) = delete;
+
+    TrayIcon & operator=(TrayIcon && other) noexcept
+    {
+        if (this != &other) {
+            destroy();
+            id_ = std::exchange(other.id_, 0);
+        }
+        return *this;
+    }
 
     ErrorContext create(HWND hwnd, HWND messageHwnd, UINT msg, IconHandleWrapper && icon);
     void destroy() noexcept;
 
+    // Adds the icon back to the tray after the taskbar was recreated and
+    // forgot it, with the same ID, GUID, icon, and tip it had, so nothing
+    // needs loading or creating again. If this fails the icon is kept, so it
+    // can be tried again.
+    ErrorContext recreate();
+
+    [[nodiscard]]
+    bool created() const noexcept
+    {
+        return id_ != 0;
+    }
+
+    // zero when not created, and never the same for two icons, even once one is destroyed
+    [[nodiscard]]
+    UINT id() const noexcept
+    {
+        return id_;
+    }
+
+    // the most characters of a tip the tray keeps, the rest are cut off
+    static constexpr size_t tipLengthMax = sizeof(NOTIFYICONDATAA::szTip) - 1;
+
     void updateTip(const std::string & tip);
 
+    // replaces the icon shown, such as a placeholder once the real one is loaded
+    void updateIcon(IconHandleWrapper && icon);
+
     static HWND getWindowFromID(UINT id);
 
 private:
-    NOTIFYICONDATAA nid_ {};
-
-    IconHandleWrapper icon_;
+    UINT id_ {};
 };
@@ -0,0 +1,121 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// App
+#include "TrayTipThrottle.h"
+
+// Standard library
+#include <algorithm>
+#include <utility>
+
+TrayTipThrottle::TrayTipThrottle(size_t tipLength) noexcept
+    : tipLength_(tipLength)
+{
+}
+
+void TrayTipThrottle::setInterval(std::uint64_t interval) noexcept
+{
+    interval_ = interval;
+}
+
+void TrayTipThrottle::add(Key key, std::string_view tip, std::uint64_t now)
+{
+    Icon & icon = icons_[key];
+    icon.shown = tip.substr(0, tipLength_);
+    icon.pending.clear();
+    icon.sentTime = now;
+    icon.changed = false;
+}
+
+void TrayTipThrottle::remove(Key key) noexcept
+{
+    // a stale entry in changed_ is dropped by the next flush
+    icons_.erase(key);
+}
+
+void TrayTipThrottle::clear() noexcept
+{
+    icons_.clear();
+    changed_.clear();
+}
+
+void TrayTipThrottle::update(Key key, std::string_view tip)
+{
+    const auto it = icons_.find(key);
+    if (it == icons_.end()) {
+        return;
+    }
+
+    Icon & icon = it->second;
+    const std::string_view shown = tip.substr(0, tipLength_);
+    if (shown == icon.shown) {
+        ++unchanged_;
+        if (icon.changed) {
+            // undone before it was sent
+            ++coalesced_;
+            icon.changed = false;
+        }
+        return;
+    }
+
+    if (icon.changed) {
+        if (shown == icon.pending) {
+            return;
+        }
+        ++coalesced_;
+    } else {
+        icon.changed = true;
+        changed_.push_back(key);
+    }
+    icon.pending = shown;
+}
+
+size_t TrayTipThrottle::flush(std::uint64_t now, const Send & send)
+{
+    size_t sentCount = 0;
+    const auto waiting = std::ranges::remove_if(changed_, [this, now, &send, &sentCount](Key key) {
+        const auto it = icons_.find(key);
+        if ((it == icons_.end()) || !it->second.changed) {
+            return true;
+        }
+
+        Icon & icon = it->second;
+        if ((now - icon.sentTime) < interval_) {
+            return false;
+        }
+
+        std::swap(icon.shown, icon.pending);
+        icon.sentTime = now;
+        icon.changed = false;
+        send(key, icon.shown);
+        ++sentCount;
+        return true;
+    });
+    changed_.erase(waiting.begin(), waiting.end());
+
+    sent_ += sentCount;
+    return sentCount;
+}
+
+TrayTipThrottle::Statistics TrayTipThrottle::statistics() const noexcept
+{
+    Statistics statistics;
+    statistics.sent = sent_;
+    statistics.coalesced = coalesced_;
+    statistics.unchanged = unchanged_;
+    statistics.pending = static_cast<size_t>(std::ranges::count_if(icons_, [](const auto & entry) {
+        return entry.second.changed;
+    }));
+    return statistics;
+}
@@ -0,0 +1,92 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Decides when the tips of tray icons are sent to the shell. Each one is a
+// synchronous call into Explorer, and a window that changes its title every
+// second, like a media player or a terminal, would otherwise make one every
+// second for as long as it's minimized.
+//
+// A changed tip only marks its icon, and the marked icons are sent together
+// when flushed, each one at most once per interval. Changes in between
+// replace each other, so only the latest is sent. Tips are compared as the
+// tray shows them, cut to the length it keeps, so a change past the end of
+// that, or a change that's undone before it's sent, sends nothing.
+//
+// Times are in milliseconds, from any clock that only goes forward.
+//
+// This is only used from one thread.
+class TrayTipThrottle
+{
+public:
+    using Key = std::uint64_t;
+    using Send = std::function<void(Key, const std::string &)>;
+
+    struct Statistics
+    {
+        std::uint64_t sent {};
+        std::uint64_t coalesced {}; // replaced by a later change before it was sent
+        std::uint64_t unchanged {}; // the same as the tip shown
+        size_t pending {};
+    };
+
+    // tipLength is the most characters the tray keeps of a tip
+    explicit TrayTipThrottle(size_t tipLength) noexcept;
+
+    // the least time between tips sent for the same icon, zero to send every change when flushed
+    void setInterval(std::uint64_t interval) noexcept;
+
+    // an icon was added to the tray showing tip
+    void add(Key key, std::string_view tip, std::uint64_t now);
+
+    void remove(Key key) noexcept;
+    void clear() noexcept;
+
+    // the icon's tip should become tip, ignored for an icon that wasn't added
+    void update(Key key, std::string_view tip);
+
+    // Sends the changed tips of icons that haven't had one sent within the
+    // interval, the others wait for a later flush. Returns the number sent.
+    size_t flush(std::uint64_t now, const Send & send);
+
+    [[nodiscard]]
+    Statistics statistics() const noexcept;
+
+private:
+    struct Icon
+    {
+        std::string shown;
+        std::string pending;
+        std::uint64_t sentTime {};
+        bool changed {};
+    };
+
+    size_t tipLength_;
+    std::uint64_t interval_ {};
+    std::unordered_map<Key, Icon> icons_;
+    std::vector<Key> changed_; // icons that may have a tip to send, so flushing doesn't look at the rest
+    std::uint64_t sent_ {};
+    std::uint64_t coalesced_ {};
+    std::uint64_t unchanged_ {};
+};
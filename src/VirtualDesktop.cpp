@@ -16,6 +16,7 @@
 #include "VirtualDesktop.h"
 #include "Helpers.h"
 #include "Log.h"
+#include "LogFormatters.h"
 #include "WindowsUndocumented.h"
 
 // Windows
@@ -241,7 +242,7 @@ bool minimize(HWND hwnd)
         viewCollection_.Get(),
         VirtualDesktopSlot::GetViewForHwnd)(viewCollection_.Get(), hwnd, &view);
     if (FAILED(hr) || !view) {
-        WARNING_PRINTF("failed to get application view for %#x: 0x%08X\n", hwnd, hr);
+        WARNING_LOG("failed to get application view for {}: {:#010x}\n", hwnd, static_cast<unsigned long>(hr));
         return false;
     }
 
@@ -306,7 +307,7 @@ bool restore(HWND hwnd)
         viewCollection_.Get(),
         VirtualDesktopSlot::GetViewForHwnd)(viewCollection_.Get(), hwnd, view.ReleaseAndGetAddressOf());
     if (FAILED(hr) || !view) {
-        WARNING_PRINTF("failed to get application view for %#x: 0x%08X\n", hwnd, hr);
+        WARNING_LOG("failed to get application view for {}: {:#010x}\n", hwnd, static_cast<unsigned long>(hr));
         return false;
     }
 
@@ -344,19 +345,19 @@ bool restore(HWND hwnd)
 bool isWindowOnCurrentDesktop(HWND hwnd)
 {
     if (!initialized_ && !start()) {
-        WARNING_PRINTF("failed to start virtual desktop services, assuming window %#x is on the current desktop\n", hwnd);
+        WARNING_LOG("failed to start virtual desktop services, assuming window {} is on the current desktop\n", hwnd);
         return true;
     }
 
     if (!virtualDesktopManager_) {
-        DEBUG_PRINTF("virtual desktop manager unavailable, assuming window %#x is on the current desktop\n", hwnd);
+        DEBUG_LOG("virtual desktop manager unavailable, assuming window {} is on the current desktop\n", hwnd);
         return true;
     }
 
     BOOL onCurrentDesktop = FALSE;
     const HRESULT hr = virtualDesktopManager_->IsWindowOnCurrentVirtualDesktop(hwnd, &onCurrentDesktop);
     if (FAILED(hr)) {
-        WARNING_PRINTF("failed to determine desktop for window %#x: 0x%08X\n", hwnd, hr);
+        WARNING_LOG("failed to determine desktop for window {}: {:#010x}\n", hwnd, static_cast<unsigned long>(hr));
         return true;
     }
 
@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -41,10 +42,10 @@ public:
     void destroy() noexcept
     {
         if (hwineventhook_) {
-            DEBUG_PRINTF("destroying win event hook %#x\n", hwineventhook_);
+            DEBUG_LOG("destroying win event hook {}\n", hwineventhook_);
             if (!UnhookWinEvent(hwineventhook_)) {
-                WARNING_PRINTF(
-                    "failed to unhook win event %#x, UnhookWinEvent() failed: %lu\n",
+                WARNING_LOG(
+                    "failed to unhook win event {}, UnhookWinEvent() failed: {}\n",
                     hwineventhook_,
                     GetLastError());
                 return;
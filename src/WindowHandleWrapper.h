@@ -16,6 +16,7 @@
 
 // App
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -49,7 +50,7 @@ public:
     void destroy() noexcept
     {
         if (hwnd_) {
-            DEBUG_PRINTF("destroying window %#x\n", hwnd_);
+            DEBUG_LOG("destroying window {}\n", hwnd_);
             if (!DestroyWindow(hwnd_)) {
                 WARNING_PRINTF("DestroyWindow() failed: %lu\n", GetLastError());
                 return;
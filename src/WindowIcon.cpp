@@ -15,13 +15,18 @@
 // App
 #include "WindowIcon.h"
 #include "BitmapHandleWrapper.h"
-#include "BrushHandleWrapper.h"
+#include "ContentHash.h"
 #include "DeviceContextHandleWrapper.h"
 #include "HandleWrapper.h"
 #include "Helpers.h"
+#include "IconCache.h"
 #include "IconHandleWrapper.h"
+#include "IconMask.h"
 #include "Log.h"
+#include "LogFormatters.h"
+#include "PixelKernels.h"
 #include "StringUtility.h"
+#include "WindowMessage.h"
 
 // Windows
 #include <PropIdl.h>
@@ -35,16 +40,113 @@
 #include <wrl/client.h>
 
 // Standard library
+#include <algorithm>
+#include <cstdint>
 #include <cwchar>
+#include <deque>
+#include <memory>
 #include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 using Microsoft::WRL::ComPtr;
 
 namespace
 {
 
-bool getWindowAppUserModelId(HWND hwnd, wchar_t * appUserModelId, size_t appUserModelIdSize)
+using IconKey = IconCache<IconHandleWrapper>::Key;
+
+constexpr size_t iconCacheSize_ = 128; // each is a few GDI objects
+
+IconCache<IconHandleWrapper> icons_(iconCacheSize_);
+
+// Icons by a hash of their image, so identical icons under different keys,
+// such as an app's windows with and without an app user model ID, or apps
+// sharing an executable's icon, are one GDI icon. They're held weakly, an
+// icon goes once the caches and tray icons using it let it go.
+std::unordered_map<std::uint64_t, std::weak_ptr<const IconHandleWrapper>> images_;
+std::uint64_t imagesShared_;
+constexpr size_t imagesPruneSize_ = iconCacheSize_ * 2;
+
+constexpr UINT getIconTimeoutMillis_ = 500;
+constexpr size_t prefetchQueueSize_ = 32;
+
+// an icon to load on the worker thread
+struct Load
+{
+    HWND hwnd {};
+    IconKey key; // empty if the window's icon isn't cached, or isn't known yet
+    bool resolve {}; // the key isn't known yet, the worker looks it up first
+    bool prefetch {}; // ahead of being needed, rather than for a tray icon
+};
+
+// an icon the worker loaded, owned by this until it's cached, null if the window has none
+struct Loaded
+{
+    HWND hwnd {};
+    IconKey key; // empty if the icon is the window's own, which isn't cached
+    HICON hicon {};
+    bool prefetch {};
+    bool resolved {}; // the worker looked up the key
+    bool keyOnly {}; // only the key was looked up, the app's icon may already be cached
+};
+
+class Lock
 {
+public:
+    explicit Lock(SRWLOCK & lock) noexcept
+        : lock_(lock)
+    {
+        AcquireSRWLockExclusive(&lock_);
+    }
+
+    ~Lock() noexcept { ReleaseSRWLockExclusive(&lock_); }
+
+    Lock(const Lock &) = delete;
+    Lock(Lock &&) = delete;
+    Lock & operator=(const Lock &) = delete;
+    Lock & operator=(Lock &&) = delete;
+
+    SRWLOCK & get() noexcept { return lock_; }
+
+private:
+    SRWLOCK & lock_;
+};
+
+// the worker's queues and results, guarded by loadLock_, prefetches are only loaded when there are no other loads
+SRWLOCK loadLock_ = SRWLOCK_INIT;
+CONDITION_VARIABLE loadReady_ = CONDITION_VARIABLE_INIT;
+std::deque<Load> loads_;
+std::deque<Load> prefetches_;
+std::vector<Loaded> loaded_;
+HWND loadingHwnd_; // the window the worker is loading an icon for, if any
+bool loadingCancelled_;
+bool loaderExit_;
+
+HANDLE loaderThread_;
+HWND loaderMessageHwnd_;
+
+// how prefetching went, only used on the UI thread
+std::uint64_t prefetchesQueued_;
+std::uint64_t prefetchesDropped_; // the queue was full
+std::uint64_t prefetchesPromoted_; // needed for a tray icon while still queued
+std::uint64_t prefetchesCancelled_;
+
+// The key each window's icon is cached by, empty for a window that shows its
+// own icon, once it's been looked up. Looking it up asks the shell and opens
+// the window's process, so it's done on the worker thread, and only once for
+// each window. Only used on the UI thread.
+std::unordered_map<HWND, IconKey> windowKeys_;
+
+// Gets the key for the window's icon, its app user model ID, the same for
+// every window of the app. Windows without one show their own icon, which
+// can differ between windows of the same executable, such as javaw or mmc,
+// and change while they're open, so it isn't cached.
+bool getWindowIconKey(HWND hwnd, IconKey & key)
+{
+    key.dpi = GetDpiForSystem();
+
     ComPtr<IPropertyStore> propertyStore;
     if (SUCCEEDED(SHGetPropertyStoreForWindow(
             hwnd,
@@ -53,9 +155,9 @@ bool getWindowAppUserModelId(HWND hwnd, wchar_t * appUserModelId, size_t appUser
         PROPVARIANT propVariant;
         PropVariantInit(&propVariant);
         const bool found = SUCCEEDED(propertyStore->GetValue(PKEY_AppUserModel_ID, &propVariant)) &&
-            (propVariant.vt == VT_LPWSTR) && propVariant.pwszVal && (wcslen(propVariant.pwszVal) < appUserModelIdSize);
+            (propVariant.vt == VT_LPWSTR) && propVariant.pwszVal && *propVariant.pwszVal;
         if (found) {
-            wcscpy_s(appUserModelId, appUserModelIdSize, propVariant.pwszVal);
+            key.identity = propVariant.pwszVal;
         }
         PropVariantClear(&propVariant);
         if (found) {
@@ -65,31 +167,35 @@ bool getWindowAppUserModelId(HWND hwnd, wchar_t * appUserModelId, size_t appUser
 
     DWORD processID = 0;
     if (!GetWindowThreadProcessId(hwnd, &processID)) {
-        WARNING_PRINTF("GetWindowThreadProcessId failed for %#x: %s\n", hwnd, StringUtility::lastErrorString().c_str());
-    } else {
-        const HandleWrapper process(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID));
-        if (!process) {
-            WARNING_PRINTF("OpenProcess() failed: %s\n", StringUtility::lastErrorString().c_str());
-        } else {
-            UINT32 length = narrow_cast<UINT32>(appUserModelIdSize);
-            if (GetApplicationUserModelId(process, &length, appUserModelId) == ERROR_SUCCESS) {
-                return true;
-            }
-        }
+        WARNING_LOG("GetWindowThreadProcessId failed for {}: {}\n", hwnd, StringUtility::lastErrorString());
+        return false;
     }
 
-    return false;
+    const HandleWrapper process(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processID));
+    if (!process) {
+        WARNING_PRINTF("OpenProcess() failed: %s\n", StringUtility::lastErrorString().c_str());
+        return false;
+    }
+
+    wchar_t name[1024];
+    UINT32 length = sizeof(name) / sizeof(name[0]);
+    if (GetApplicationUserModelId(process, &length, name) != ERROR_SUCCESS) {
+        return false;
+    }
+    key.identity = name;
+    return true;
 }
 
-HICON createHIconFromBitmap(HBITMAP hbitmap)
+// makes an icon from a shell image, shrinking it to iconSize if it's a whole multiple of that
+HICON createHIconFromBitmap(HBITMAP hbitmap, LONG iconSize)
 {
     BITMAP bitmap;
     if (!GetObject(hbitmap, sizeof(bitmap), &bitmap) || (bitmap.bmWidth <= 0) || (bitmap.bmHeight <= 0)) {
         return nullptr;
     }
 
-    const LONG cx = bitmap.bmWidth;
-    const LONG cy = bitmap.bmHeight;
+    LONG cx = bitmap.bmWidth;
+    LONG cy = bitmap.bmHeight;
     const bool hasAlpha = bitmap.bmBitsPixel == 32;
 
     const DeviceContextHandleWrapper displayDC(GetDC(HWND_DESKTOP), DeviceContextHandleWrapper::Referenced);
@@ -128,47 +234,64 @@ HICON createHIconFromBitmap(HBITMAP hbitmap)
         return nullptr;
     }
 
-    const BitmapHandleWrapper maskBitmap(CreateBitmap(cx, cy, 1, 1, nullptr));
-    if (!maskBitmap) {
-        return nullptr;
-    }
-
-    DeviceContextHandleWrapper maskDC(CreateCompatibleDC(displayDC), DeviceContextHandleWrapper::Created);
-    if (!maskDC || !maskDC.selectObject(maskBitmap)) {
-        return nullptr;
+    // the copy has to be finished before its bits are read
+    GdiFlush();
+
+    // Big images are shrunk to the size they're shown at, which looks better
+    // than leaving it to drawing, and uses less memory. Colors are averaged
+    // premultiplied by alpha, so transparent pixels don't darken the edges.
+    HBITMAP color = colorBitmap;
+    BitmapHandleWrapper scaledBitmap;
+    if (hasAlpha && (iconSize > 0) && (cx == cy) && (cx > iconSize) && ((cx % iconSize) == 0)) {
+        bitmapInfo.bmiHeader.biWidth = iconSize;
+        bitmapInfo.bmiHeader.biHeight = -iconSize;
+        BYTE * scaledBits = nullptr;
+        scaledBitmap = BitmapHandleWrapper(CreateDIBSection(
+            displayDC,
+            &bitmapInfo,
+            DIB_RGB_COLORS,
+            reinterpret_cast<void **>(&scaledBits),
+            nullptr,
+            0));
+        if (scaledBitmap && scaledBits) {
+            const auto size = static_cast<size_t>(cx);
+            const auto scaledSize = static_cast<size_t>(iconSize);
+            const std::span<std::uint32_t> source(reinterpret_cast<std::uint32_t *>(bits), size * size);
+            const std::span<std::uint32_t> target(
+                reinterpret_cast<std::uint32_t *>(scaledBits),
+                scaledSize * scaledSize);
+            PixelKernels::premultiply(source);
+            PixelKernels::boxDownscale(source, size, size, size / scaledSize, target);
+            PixelKernels::unpremultiply(target);
+            color = scaledBitmap;
+            bits = scaledBits;
+            cx = iconSize;
+            cy = iconSize;
+        }
     }
 
-    const RECT rect = { 0, 0, cx, cy };
+    // the mask is built in memory and created in one go, it's opaque (black) where alpha is set and transparent
+    // (white) elsewhere, or all opaque without an alpha channel
+    const auto width = static_cast<size_t>(cx);
+    const auto height = static_cast<size_t>(cy);
+    std::vector<std::uint8_t> mask(IconMask::rowSize(width) * height);
     if (hasAlpha) {
-        // mask is transparent (white) by default, opaque (black) where alpha is set
-        if (!FillRect(maskDC, &rect, static_cast<HBRUSH>(GetStockObject(WHITE_BRUSH)))) {
-            WARNING_PRINTF("failed to fill icon mask, FillRect() failed: %s\n", StringUtility::lastErrorString().c_str());
-            return nullptr;
-        }
+        IconMask::fromAlpha(bits, width, height, mask.data());
+    }
 
-        const std::span<const BYTE> bitsSpan(bits, static_cast<size_t>(cx) * static_cast<size_t>(cy) * 4);
-        for (LONG y = 0; y < cy; ++y) {
-            const std::span<const BYTE> row =
-                bitsSpan.subspan(static_cast<size_t>(y) * static_cast<size_t>(cx) * 4, static_cast<size_t>(cx) * 4);
-            for (LONG x = 0; x < cx; ++x) {
-                if (row[(static_cast<size_t>(x) * 4) + 3] >= 128) {
-                    SetPixelV(maskDC, x, y, 0);
-                }
-            }
-        }
-    } else {
-        // no alpha channel, icon is fully opaque (black mask)
-        if (!FillRect(maskDC, &rect, static_cast<HBRUSH>(GetStockObject(BLACK_BRUSH)))) {
-            WARNING_PRINTF("failed to fill icon mask, FillRect() failed: %s\n", StringUtility::lastErrorString().c_str());
-            return nullptr;
-        }
+    const BitmapHandleWrapper maskBitmap(CreateBitmap(cx, cy, 1, 1, mask.data()));
+    if (!maskBitmap) {
+        WARNING_PRINTF(
+            "failed to create icon mask, CreateBitmap() failed: %s\n",
+            StringUtility::lastErrorString().c_str());
+        return nullptr;
     }
 
     ICONINFO iconInfo;
     memset(&iconInfo, 0, sizeof(iconInfo));
     iconInfo.fIcon = TRUE;
     iconInfo.hbmMask = maskBitmap;
-    iconInfo.hbmColor = colorBitmap;
+    iconInfo.hbmColor = color;
     return CreateIconIndirect(&iconInfo);
 }
 
@@ -205,47 +328,167 @@ HICON getAppUserModelIdIcon(const wchar_t * appUserModelId)
     }
 
     const BitmapHandleWrapper bitmap(hbitmap);
-    return createHIconFromBitmap(hbitmap);
+    return createHIconFromBitmap(hbitmap, iconSize);
 }
 
-} // anonymous namespace
-
-namespace WindowIcon
+// the window's icon, or null if it has none or doesn't answer, so a hung window can't hang us
+HICON getWindowIconMessage(HWND hwnd, WPARAM type)
 {
+    DWORD_PTR result = 0;
+    if (!SendMessageTimeout(hwnd, WM_GETICON, type, 0, SMTO_ABORTIFHUNG, getIconTimeoutMillis_, &result)) {
+        return nullptr;
+    }
+    return reinterpret_cast<HICON>(result);
+}
 
-IconHandleWrapper get(HWND hwnd)
+// the icon the window's class has
+HICON getWindowClassIcon(HWND hwnd)
 {
-    // Use the app user model ID to get the same icon the taskbar shows, which is
-    // needed for UWP apps and other packaged apps that don't expose a window icon.
-    wchar_t appUserModelId[1024];
-    if (getWindowAppUserModelId(hwnd, appUserModelId, sizeof(appUserModelId) / sizeof(appUserModelId[0]))) {
-        HICON appIcon = getAppUserModelIdIcon(appUserModelId);
-        if (appIcon) {
-            return { appIcon, IconHandleWrapper::Mode::Created };
-        }
+    HICON hicon = reinterpret_cast<HICON>(GetClassLongPtr(hwnd, GCLP_HICONSM));
+    if (hicon) {
+        return hicon;
     }
 
-    HICON hicon = reinterpret_cast<HICON>(SendMessage(hwnd, WM_GETICON, ICON_SMALL, 0));
+    return reinterpret_cast<HICON>(GetClassLongPtr(hwnd, GCLP_HICON));
+}
+
+// the icon the window or its class has, which belongs to the window
+HICON getWindowOwnIcon(HWND hwnd)
+{
+    HICON hicon = getWindowIconMessage(hwnd, ICON_SMALL);
     if (hicon) {
-        return { hicon, IconHandleWrapper::Mode::Referenced };
+        return hicon;
     }
 
-    hicon = reinterpret_cast<HICON>(SendMessage(hwnd, WM_GETICON, ICON_BIG, 0));
+    hicon = getWindowIconMessage(hwnd, ICON_BIG);
     if (hicon) {
-        return { hicon, IconHandleWrapper::Mode::Referenced };
+        return hicon;
     }
 
-    hicon = reinterpret_cast<HICON>(SendMessage(hwnd, WM_GETICON, ICON_SMALL2, 0));
+    hicon = getWindowIconMessage(hwnd, ICON_SMALL2);
     if (hicon) {
-        return { hicon, IconHandleWrapper::Mode::Referenced };
+        return hicon;
     }
 
-    hicon = reinterpret_cast<HICON>(GetClassLongPtr(hwnd, GCLP_HICONSM));
-    if (hicon) {
-        return { hicon, IconHandleWrapper::Mode::Referenced };
+    return getWindowClassIcon(hwnd);
+}
+
+// A copy of the window's icon, or null if it has none. The window's icon
+// goes away with the window, so whoever keeps it needs a copy.
+HICON copyWindowOwnIcon(HWND hwnd)
+{
+    HICON hicon = getWindowOwnIcon(hwnd);
+    return hicon ? CopyIcon(hicon) : nullptr;
+}
+
+// the bitmap's pixels, as 32 bits each
+bool getBitmapPixels(HDC hdc, HBITMAP hbitmap, std::vector<std::uint32_t> & pixels, std::uint64_t & size)
+{
+    BITMAP bitmap;
+    if (!GetObject(hbitmap, sizeof(bitmap), &bitmap) || (bitmap.bmWidth <= 0) || (bitmap.bmHeight <= 0)) {
+        return false;
+    }
+
+    BITMAPINFO bitmapInfo;
+    memset(&bitmapInfo, 0, sizeof(bitmapInfo));
+    bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bitmapInfo.bmiHeader.biWidth = bitmap.bmWidth;
+    bitmapInfo.bmiHeader.biHeight = -bitmap.bmHeight;
+    bitmapInfo.bmiHeader.biPlanes = 1;
+    bitmapInfo.bmiHeader.biBitCount = 32;
+    bitmapInfo.bmiHeader.biCompression = BI_RGB;
+
+    pixels.resize(static_cast<size_t>(bitmap.bmWidth) * static_cast<size_t>(bitmap.bmHeight));
+    const auto height = narrow_cast<UINT>(bitmap.bmHeight);
+    if (GetDIBits(hdc, hbitmap, 0, height, pixels.data(), &bitmapInfo, DIB_RGB_COLORS) != narrow_cast<int>(height)) {
+        return false;
+    }
+
+    size = (static_cast<std::uint64_t>(bitmap.bmWidth) << 32) | static_cast<std::uint64_t>(bitmap.bmHeight);
+    return true;
+}
+
+// a hash of the icon's image, its mask and its color pixels, with their sizes
+bool hashIcon(HICON hicon, std::uint64_t & hash)
+{
+    ICONINFO iconInfo;
+    if (!GetIconInfo(hicon, &iconInfo)) {
+        return false;
+    }
+    const BitmapHandleWrapper maskBitmap(iconInfo.hbmMask);
+    const BitmapHandleWrapper colorBitmap(iconInfo.hbmColor);
+
+    const DeviceContextHandleWrapper displayDC(GetDC(HWND_DESKTOP), DeviceContextHandleWrapper::Referenced);
+    if (!displayDC) {
+        return false;
+    }
+
+    std::vector<std::uint32_t> pixels;
+    const auto bytes = [&pixels]() {
+        return std::span(reinterpret_cast<const std::uint8_t *>(pixels.data()), pixels.size() * sizeof(pixels[0]));
+    };
+
+    std::uint64_t size = 0;
+    if (!getBitmapPixels(displayDC, maskBitmap, pixels, size)) {
+        return false;
     }
+    hash = ContentHash::hash(bytes(), size);
 
-    hicon = reinterpret_cast<HICON>(GetClassLongPtr(hwnd, GCLP_HICON));
+    if (colorBitmap) {
+        if (!getBitmapPixels(displayDC, colorBitmap, pixels, size)) {
+            return false;
+        }
+        hash = ContentHash::hash(bytes(), hash ^ size);
+    }
+    return true;
+}
+
+// Takes ownership of a newly created icon, and gives back the icon already
+// kept with the same image if there is one, destroying the new one.
+IconCache<IconHandleWrapper>::Shared shareIcon(HICON hicon)
+{
+    std::uint64_t hash = 0;
+    if (!hashIcon(hicon, hash)) {
+        return std::make_shared<const IconHandleWrapper>(hicon, IconHandleWrapper::Mode::Created);
+    }
+
+    std::weak_ptr<const IconHandleWrapper> & image = images_[hash];
+    IconCache<IconHandleWrapper>::Shared icon = image.lock();
+    if (icon) {
+        DestroyIcon(hicon);
+        ++imagesShared_;
+        return icon;
+    }
+
+    icon = std::make_shared<const IconHandleWrapper>(hicon, IconHandleWrapper::Mode::Created);
+    image = icon;
+
+    if (images_.size() > imagesPruneSize_) {
+        std::erase_if(images_, [](const auto & entry) { return entry.second.expired(); });
+    }
+    return icon;
+}
+
+// The icon for the app, the same one the taskbar shows, cached by its app
+// user model ID, or else the window's own. Packaged apps often have no window
+// icon, so the app's is tried first.
+IconHandleWrapper getIcon(HWND hwnd, bool cacheable, const IconKey & key)
+{
+    if (cacheable) {
+        IconCache<IconHandleWrapper>::Shared icon = icons_.find(key);
+        if (!icon) {
+            HICON hicon = getAppUserModelIdIcon(key.identity.c_str());
+            if (hicon) {
+                icon = shareIcon(hicon);
+                icons_.insert(key, icon);
+            }
+        }
+        if (icon) {
+            return IconHandleWrapper(std::move(icon));
+        }
+    }
+
+    HICON hicon = getWindowOwnIcon(hwnd);
     if (hicon) {
         return { hicon, IconHandleWrapper::Mode::Referenced };
     }
@@ -258,73 +501,369 @@ IconHandleWrapper get(HWND hwnd)
     return {};
 }
 
-BitmapHandleWrapper bitmap(HWND hwnd)
+// Loads queued icons until told to exit. Shell images need COM, and the
+// window messages may be slow, which is why this isn't done on the UI thread.
+// Prefetches are loaded in background mode, at idle CPU and I/O priority, and
+// only when no icon is waiting for a tray icon.
+DWORD WINAPI loaderMain(LPVOID /* parameter */) noexcept
 {
-    const IconHandleWrapper icon = get(hwnd);
-    if (!icon) {
-        return {};
+    const HRESULT comResult = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+    bool background = false;
+
+    for (;;) {
+        Load load;
+        {
+            Lock lock(loadLock_);
+            while (loads_.empty() && prefetches_.empty() && !loaderExit_) {
+                SleepConditionVariableSRW(&loadReady_, &lock.get(), INFINITE, 0);
+            }
+            if (loaderExit_) {
+                break;
+            }
+            std::deque<Load> & queue = loads_.empty() ? prefetches_ : loads_;
+            load = std::move(queue.front());
+            queue.pop_front();
+            loadingHwnd_ = load.hwnd;
+            loadingCancelled_ = false;
+        }
+
+        if (load.prefetch != background) {
+            background = load.prefetch;
+            if (!SetThreadPriority(
+                    GetCurrentThread(),
+                    background ? THREAD_MODE_BACKGROUND_BEGIN : THREAD_MODE_BACKGROUND_END)) {
+                WARNING_PRINTF(
+                    "could not change icon loader priority, SetThreadPriority() failed: %s\n",
+                    StringUtility::lastErrorString().c_str());
+            }
+        }
+
+        if (load.resolve && !getWindowIconKey(load.hwnd, load.key)) {
+            load.key = {};
+        }
+
+        // Only the UI thread knows what's cached, so a key that was just looked
+        // up goes back to it before the app's icon is loaded. A window without
+        // one has its own icon, which isn't cached, and isn't prefetched.
+        const bool keyOnly = load.resolve && (!load.key.identity.empty() || load.prefetch);
+
+        // only the app's icon is cached, the window's own is handed out once
+        HICON hicon = nullptr;
+        if (!keyOnly) {
+            hicon = load.key.identity.empty() ? nullptr : getAppUserModelIdIcon(load.key.identity.c_str());
+            if (!hicon) {
+                load.key = {};
+                hicon = copyWindowOwnIcon(load.hwnd);
+            }
+        }
+
+        bool post = false;
+        {
+            const Lock lock(loadLock_);
+            if (!loadingCancelled_) {
+                post = loaded_.empty();
+                loaded_.push_back({ load.hwnd, std::move(load.key), hicon, load.prefetch, load.resolve, keyOnly });
+                hicon = nullptr;
+            }
+            loadingHwnd_ = nullptr;
+        }
+
+        if (hicon) {
+            DestroyIcon(hicon);
+        }
+
+        // one message covers everything loaded until it's handled
+        if (post && !PostMessage(loaderMessageHwnd_, WM_ICONLOADED, 0, 0)) {
+            WARNING_PRINTF(
+                "could not post loaded icon, PostMessage() failed: %s\n",
+                StringUtility::lastErrorString().c_str());
+        }
     }
 
-    HICON hicon = icon;
+    if (SUCCEEDED(comResult)) {
+        CoUninitialize();
+    }
 
-    ICONINFOEXA iconInfo;
-    memset(&iconInfo, 0, sizeof(iconInfo));
-    iconInfo.cbSize = sizeof(ICONINFOEXA);
-    if (!GetIconInfoExA(hicon, &iconInfo)) {
-        WARNING_PRINTF(
-            "failed to get icon info for %#x, GetIconInfoEx() failed: %s\n",
-            hwnd,
-            StringUtility::lastErrorString().c_str());
-        return {};
+    return 0;
+}
+
+// the icon shown until the real one is loaded, which is fine to have for a moment
+IconHandleWrapper getPlaceholderIcon(HWND hwnd)
+{
+    HICON hicon = getWindowClassIcon(hwnd);
+    if (!hicon) {
+        hicon = LoadIcon(nullptr, IDI_APPLICATION);
     }
+    if (hicon) {
+        return { hicon, IconHandleWrapper::Mode::Referenced };
+    }
+    return {};
+}
 
-    const BitmapHandleWrapper iconMaskBitmap(iconInfo.hbmMask);
-    const BitmapHandleWrapper iconColorBitmap(iconInfo.hbmColor);
+// queues a load for a tray icon, taking the place of a prefetch of the window's icon
+void queueLoad(HWND hwnd, IconKey && key, bool resolve)
+{
+    {
+        const Lock lock(loadLock_);
+        const auto forWindow = [hwnd](const Load & load) { return load.hwnd == hwnd; };
+        prefetchesPromoted_ += std::erase_if(prefetches_, forWindow);
+        const bool loading = (loadingHwnd_ == hwnd) && !loadingCancelled_;
+        if (!loading && !std::ranges::any_of(loads_, forWindow)) {
+            loads_.push_back({ hwnd, std::move(key), resolve, false });
+        }
+    }
+    WakeConditionVariable(&loadReady_);
+}
 
-    const DeviceContextHandleWrapper displayDC(
-        CreateICA("DISPLAY", nullptr, nullptr, nullptr),
-        DeviceContextHandleWrapper::Created);
-    if (!displayDC) {
-        WARNING_PRINTF(
-            "failed to get desktop information context, CreateICA() failed: %s\n",
-            StringUtility::lastErrorString().c_str());
-        return {};
+// queues a prefetch, returns false if the window's icon, or its app's, is already queued or the queue is full
+bool queuePrefetch(HWND hwnd, IconKey && key, bool resolve)
+{
+    {
+        const Lock lock(loadLock_);
+        const auto queued = [hwnd, &key](const Load & load) {
+            return (load.hwnd == hwnd) || (!key.identity.empty() && (load.key == key));
+        };
+        if (std::ranges::any_of(loads_, queued) || std::ranges::any_of(prefetches_, queued)) {
+            return false;
+        }
+        if (prefetches_.size() >= prefetchQueueSize_) {
+            ++prefetchesDropped_;
+            return false;
+        }
+        prefetches_.push_back({ hwnd, std::move(key), resolve, true });
     }
+    WakeConditionVariable(&loadReady_);
+    return true;
+}
+
+template <typename Statistics>
+void logStatistics(const char * kind, const Statistics & statistics)
+{
+    const std::uint64_t lookups = statistics.hits + statistics.misses;
+    INFO_PRINTF(
+        "%s cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evicted, %zu kept, %zu in use\n",
+        kind,
+        static_cast<unsigned long long>(statistics.hits),
+        static_cast<unsigned long long>(statistics.misses),
+        lookups ? (100.0 * static_cast<double>(statistics.hits) / static_cast<double>(lookups)) : 0.0,
+        static_cast<unsigned long long>(statistics.evictions),
+        statistics.size,
+        statistics.inUse);
+}
+
+} // anonymous namespace
 
-    DeviceContextHandleWrapper bitmapDC(CreateCompatibleDC(displayDC), DeviceContextHandleWrapper::Created);
-    if (!bitmapDC) {
+namespace WindowIcon
+{
+
+bool start(HWND messageHwnd)
+{
+    loaderMessageHwnd_ = messageHwnd;
+    loaderExit_ = false;
+    loaderThread_ = CreateThread(nullptr, 0, loaderMain, nullptr, 0, nullptr);
+    if (!loaderThread_) {
         WARNING_PRINTF(
-            "failed to get desktop device context, CreateCompatibleDC() failed: %s\n",
+            "could not create icon loader thread, CreateThread() failed: %s\n",
             StringUtility::lastErrorString().c_str());
-        return {};
+        return false;
     }
+    return true;
+}
 
-    const int cx = GetSystemMetrics(SM_CXMENUCHECK);
-    const int cy = GetSystemMetrics(SM_CYMENUCHECK);
+IconHandleWrapper get(HWND hwnd)
+{
+    // the icon is needed now, so its key is looked up here if the worker hasn't yet
+    auto known = windowKeys_.find(hwnd);
+    if (known == windowKeys_.end()) {
+        IconKey key;
+        if (!getWindowIconKey(hwnd, key)) {
+            key = {};
+        }
+        known = windowKeys_.emplace(hwnd, std::move(key)).first;
+    }
 
-    BitmapHandleWrapper bitmap(CreateCompatibleBitmap(displayDC, cx, cy));
-    if (!bitmap) {
-        WARNING_PRINTF(
-            "failed to create bitmap, CreateCompatibleBitmap() failed: %s\n",
-            StringUtility::lastErrorString().c_str());
-        return {};
+    const IconKey & key = known->second;
+    return getIcon(hwnd, !key.identity.empty(), key);
+}
+
+IconHandleWrapper getAsync(HWND hwnd)
+{
+    if (!loaderThread_) {
+        return get(hwnd);
+    }
+
+    const auto known = windowKeys_.find(hwnd);
+    if (known == windowKeys_.end()) {
+        queueLoad(hwnd, {}, true);
+        return getPlaceholderIcon(hwnd);
+    }
+
+    if (!known->second.identity.empty()) {
+        IconCache<IconHandleWrapper>::Shared icon = icons_.find(known->second);
+        if (icon) {
+            return IconHandleWrapper(std::move(icon));
+        }
+    }
+
+    // an empty key loads the window's own icon instead, which isn't cached
+    queueLoad(hwnd, IconKey(known->second), false);
+    return getPlaceholderIcon(hwnd);
+}
+
+bool prefetch(HWND hwnd)
+{
+    if (!loaderThread_) {
+        return false;
     }
 
-    if (!bitmapDC.selectObject(bitmap)) {
-        return {};
+    bool queued = false;
+    const auto known = windowKeys_.find(hwnd);
+    if (known == windowKeys_.end()) {
+        queued = queuePrefetch(hwnd, {}, true);
+    } else if (!known->second.identity.empty() && !icons_.contains(known->second)) {
+        queued = queuePrefetch(hwnd, IconKey(known->second), false);
     }
 
-    RECT const rect = { 0, 0, cx, cy };
-    const BrushHandleWrapper brush(CreateSolidBrush(GetSysColor(COLOR_MENU)));
-    if (!FillRect(bitmapDC, &rect, brush)) {
-        WARNING_PRINTF("failed to fill background, FillRect() failed: %s\n", StringUtility::lastErrorString().c_str());
+    if (queued) {
+        ++prefetchesQueued_;
     }
+    return queued;
+}
 
-    if (!DrawIconEx(bitmapDC, 0, 0, hicon, cx, cy, 0, nullptr, DI_NORMAL)) {
-        WARNING_PRINTF("failed to draw icon, DrawIconEx() failed: %s\n", StringUtility::lastErrorString().c_str());
+void cancel(HWND hwnd)
+{
+    const Lock lock(loadLock_);
+    const auto forWindow = [hwnd](const Load & load) { return load.hwnd == hwnd; };
+    std::erase_if(loads_, forWindow);
+    prefetchesCancelled_ += std::erase_if(prefetches_, forWindow);
+    if (loadingHwnd_ == hwnd) {
+        loadingCancelled_ = true;
+    }
+    for (Loaded & loaded : loaded_) {
+        if (loaded.hwnd == hwnd) {
+            // still cached when taken, only not handed out
+            loaded.hwnd = nullptr;
+        }
+    }
+}
+
+void forget(HWND hwnd)
+{
+    cancel(hwnd);
+    windowKeys_.erase(hwnd);
+}
+
+void takeLoaded(const std::function<void(HWND, IconHandleWrapper &&)> & callback)
+{
+    std::vector<Loaded> loaded;
+    {
+        const Lock lock(loadLock_);
+        loaded.swap(loaded_);
+    }
+
+    for (Loaded & load : loaded) {
+        if (load.resolved && load.hwnd) {
+            windowKeys_.insert_or_assign(load.hwnd, load.key);
+        }
+
+        // the app's icon is only loaded if no other window of the app has cached it
+        if (load.keyOnly) {
+            if (!load.hwnd || load.key.identity.empty()) {
+                continue;
+            }
+            if (load.prefetch) {
+                if (!icons_.contains(load.key)) {
+                    queuePrefetch(load.hwnd, std::move(load.key), false);
+                }
+            } else if (IconCache<IconHandleWrapper>::Shared icon = icons_.find(load.key); icon) {
+                callback(load.hwnd, IconHandleWrapper(std::move(icon)));
+            } else {
+                queueLoad(load.hwnd, std::move(load.key), false);
+            }
+            continue;
+        }
+
+        if (!load.hicon) {
+            continue;
+        }
+
+        // another window of the same app may have been loaded first
+        IconCache<IconHandleWrapper>::Shared icon;
+        if (load.key.identity.empty()) {
+            icon = shareIcon(load.hicon);
+        } else {
+            icon = icons_.find(load.key);
+            if (icon) {
+                DestroyIcon(load.hicon);
+            } else {
+                icon = shareIcon(load.hicon);
+                icons_.insert(load.key, icon, load.prefetch);
+            }
+        }
+
+        if (load.hwnd) {
+            callback(load.hwnd, IconHandleWrapper(std::move(icon)));
+        }
+    }
+}
+
+bool cacheKey(HWND hwnd, std::uint64_t & key)
+{
+    const auto known = windowKeys_.find(hwnd);
+    if ((known == windowKeys_.end()) || known->second.identity.empty()) {
+        return false;
+    }
+
+    const IconKey & iconKey = known->second;
+    const auto * identity = reinterpret_cast<const std::uint8_t *>(iconKey.identity.data());
+    key = ContentHash::hash({ identity, iconKey.identity.size() * sizeof(wchar_t) }, iconKey.dpi);
+    return true;
+}
+
+void stop()
+{
+    if (loaderThread_) {
+        {
+            const Lock lock(loadLock_);
+            loaderExit_ = true;
+            loads_.clear();
+            prefetches_.clear();
+        }
+        WakeConditionVariable(&loadReady_);
+
+        // the loader can't be abandoned while it still uses the state below,
+        // and it stops soon, as each icon it asks a window for times out
+        if (WaitForSingleObject(loaderThread_, INFINITE) != WAIT_OBJECT_0) {
+            ERROR_PRINTF("WaitForSingleObject() failed: %s\n", StringUtility::lastErrorString().c_str());
+        }
+        CloseHandle(loaderThread_);
+        loaderThread_ = nullptr;
+
+        const Lock lock(loadLock_);
+        for (const Loaded & load : loaded_) {
+            if (load.hicon) {
+                DestroyIcon(load.hicon);
+            }
+        }
+        loaded_.clear();
     }
 
-    return bitmap;
+    const IconCache<IconHandleWrapper>::Statistics iconStatistics = icons_.statistics();
+    logStatistics("icon", iconStatistics);
+    INFO_PRINTF(
+        "icon prefetch: %llu queued, %llu dropped, %llu promoted, %llu cancelled, %llu loaded, %llu used\n",
+        static_cast<unsigned long long>(prefetchesQueued_),
+        static_cast<unsigned long long>(prefetchesDropped_),
+        static_cast<unsigned long long>(prefetchesPromoted_),
+        static_cast<unsigned long long>(prefetchesCancelled_),
+        static_cast<unsigned long long>(iconStatistics.prefetches),
+        static_cast<unsigned long long>(iconStatistics.prefetchHits));
+    INFO_PRINTF(
+        "icon images: %llu icons shared an identical image\n",
+        static_cast<unsigned long long>(imagesShared_));
+    icons_.clear();
+    images_.clear();
+    windowKeys_.clear();
 }
 
 } // namespace WindowIcon
@@ -15,16 +15,58 @@
 #pragma once
 
 // App
-#include "BitmapHandleWrapper.h"
 #include "IconHandleWrapper.h"
 
 // Windows
 #include <Windows.h>
 
+// Standard library
+#include <cstdint>
+#include <functional>
+
+// Window icons are cached for each app with an app user model ID, see
+// IconCache.h, so windows of the same app share them and they're only
+// rendered once. Other windows show their own icon, which isn't cached. Icons
+// that aren't cached yet can be loaded on a worker thread, which posts
+// WM_ICONLOADED to the message window when they're ready. The worker also
+// looks up which app each window belongs to, the first time it's needed, as
+// that asks the shell and opens the window's process.
 namespace WindowIcon
 {
 
+// starts the worker thread that loads icons for getAsync, posting to messageHwnd
+bool start(HWND messageHwnd);
+
+// the icon now, looking up the window's app here if the worker hasn't yet
 IconHandleWrapper get(HWND hwnd);
-BitmapHandleWrapper bitmap(HWND hwnd);
+
+// The cached icon, or if there's none yet a placeholder, the window class's
+// icon or the generic app icon, and loads the real one on the worker thread.
+// Loads synchronously if the worker isn't running.
+IconHandleWrapper getAsync(HWND hwnd);
+
+// Queues a load of the window's icon on the worker thread, at low priority,
+// if it isn't cached, so minimizing the window or showing the menu finds it
+// there. Returns false if it's cached, already queued, or the queue is full.
+bool prefetch(HWND hwnd);
+
+// drops pending loads for the window, so a restored or closed window doesn't get an icon it no longer needs
+void cancel(HWND hwnd);
+
+// cancels the window's loads and forgets its app, for a window that's closed, as its handle may be reused
+void forget(HWND hwnd);
+
+// Caches the icons the worker has loaded since the last call, and passes each
+// to the callback with the window it was loaded for. Called for WM_ICONLOADED.
+void takeLoaded(const std::function<void(HWND, IconHandleWrapper &&)> & callback);
+
+// The key the window's icon is cached by, hashed, the same for every window
+// of its app, so what's drawn from the icon can be kept by app too. Returns
+// false if the icon can't be cached, it's the window's own, or the window's
+// app hasn't been looked up yet.
+bool cacheKey(HWND hwnd, std::uint64_t & key);
+
+// stops the worker thread, logs how well the cache did, and drops it
+void stop();
 
 } // namespace WindowIcon
@@ -0,0 +1,436 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// App
+#include "WindowIndex.h"
+
+// Standard library
+#include <algorithm>
+
+namespace
+{
+
+// the score of each kind of match, each kind always ranks above the next
+constexpr int titleScore_ = 4000;
+constexpr int executableScore_ = 3000;
+constexpr int initialsScore_ = 2000;
+constexpr int similarScore_ = 1000;
+constexpr int wordStartBonus_ = 500;
+constexpr size_t positionPenaltyMax_ = 100;
+
+// The kinds of key a window is indexed by, in the top byte, with up to three
+// letters in the rest. Trigrams of the initials are kept apart from those of
+// the text, and the first one or two letters of each word are kept for
+// queries too short for trigrams.
+constexpr std::uint32_t textKind_ = 0;
+constexpr std::uint32_t initialsKind_ = 1U << 24;
+constexpr std::uint32_t titleStartKind_ = 2U << 24;
+constexpr std::uint32_t titleStartPairKind_ = 3U << 24;
+constexpr std::uint32_t executableStartKind_ = 4U << 24;
+constexpr std::uint32_t executableStartPairKind_ = 5U << 24;
+constexpr std::uint32_t initialsStartPairKind_ = 6U << 24;
+
+char lower(char c) noexcept
+{
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// letters, digits, and anything not ASCII, which is likely part of a word in another language
+bool isWordChar(char c) noexcept
+{
+    const auto u = static_cast<unsigned char>(c);
+    return ((u >= 'a') && (u <= 'z')) || ((u >= 'A') && (u <= 'Z')) || ((u >= '0') && (u <= '9')) || (u >= 0x80);
+}
+
+bool isWordStart(std::string_view text, size_t position) noexcept
+{
+    return isWordChar(text[position]) && (!position || !isWordChar(text[position - 1]));
+}
+
+std::string toLower(std::string_view text)
+{
+    std::string lowered(text);
+    std::ranges::transform(lowered, lowered.begin(), lower);
+    return lowered;
+}
+
+std::string getInitials(std::string_view lowered)
+{
+    std::string initials;
+    for (size_t i = 0; i < lowered.size(); ++i) {
+        if (isWordStart(lowered, i)) {
+            initials += lowered[i];
+        }
+    }
+    return initials;
+}
+
+std::uint32_t makeKey(std::uint32_t kind, std::string_view letters) noexcept
+{
+    std::uint32_t key = kind;
+    for (size_t i = 0; i < letters.size(); ++i) {
+        key |= static_cast<std::uint32_t>(static_cast<unsigned char>(letters[i])) << (16 - (i * 8));
+    }
+    return key;
+}
+
+void appendTrigrams(std::string_view text, std::uint32_t kind, std::vector<std::uint32_t> & keys)
+{
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+        keys.push_back(makeKey(kind, text.substr(i, 3)));
+    }
+}
+
+void appendWordStarts(
+    std::string_view text,
+    std::uint32_t kind,
+    std::uint32_t pairKind,
+    std::vector<std::uint32_t> & keys)
+{
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (isWordStart(text, i)) {
+            keys.push_back(makeKey(kind, text.substr(i, 1)));
+            if (i + 1 < text.size()) {
+                keys.push_back(makeKey(pairKind, text.substr(i, 2)));
+            }
+        }
+    }
+}
+
+void sortUnique(std::vector<std::uint32_t> & keys)
+{
+    std::ranges::sort(keys);
+    const auto duplicates = std::ranges::unique(keys);
+    keys.erase(duplicates.begin(), duplicates.end());
+}
+
+// the best place the query is in the text, earlier and at the start of a word is better, or -1
+int findScore(std::string_view text, std::string_view query, int base) noexcept
+{
+    size_t first = std::string_view::npos;
+    for (size_t position = text.find(query); position != std::string_view::npos;
+         position = text.find(query, position + 1)) {
+        if (isWordStart(text, position)) {
+            return base + wordStartBonus_ - static_cast<int>(std::min(position, positionPenaltyMax_));
+        }
+        if (first == std::string_view::npos) {
+            first = position;
+        }
+    }
+    return (first == std::string_view::npos) ? -1 : (base - static_cast<int>(std::min(first, positionPenaltyMax_)));
+}
+
+// the executable's file name without its extension, so every window isn't found by "exe"
+std::string_view stripExtension(std::string_view executable) noexcept
+{
+    const size_t dot = executable.find_last_of('.');
+    return ((dot == std::string_view::npos) || !dot) ? executable : executable.substr(0, dot);
+}
+
+} // anonymous namespace
+
+void WindowIndex::add(WindowId window, std::string_view title, std::string_view executable)
+{
+    const auto [it, added] = slots_.try_emplace(window);
+    if (added) {
+        if (freeSlots_.empty()) {
+            it->second = static_cast<std::uint32_t>(entries_.size());
+            entries_.emplace_back();
+        } else {
+            it->second = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+    }
+
+    Entry & entry = entries_[it->second];
+    entry.window = window;
+    entry.used = true;
+    entry.title = title;
+    entry.executable = executable;
+    entry.lowerTitle = toLower(title);
+    entry.lowerExecutable = toLower(stripExtension(executable));
+    entry.initials = getInitials(entry.lowerTitle);
+    reindex(it->second);
+}
+
+void WindowIndex::updateTitle(WindowId window, std::string_view title)
+{
+    const auto it = slots_.find(window);
+    if ((it == slots_.end()) || (entries_[it->second].title == title)) {
+        return;
+    }
+
+    Entry & entry = entries_[it->second];
+    entry.title = title;
+    entry.lowerTitle = toLower(title);
+    entry.initials = getInitials(entry.lowerTitle);
+    reindex(it->second);
+}
+
+void WindowIndex::remove(WindowId window)
+{
+    const auto it = slots_.find(window);
+    if (it == slots_.end()) {
+        return;
+    }
+
+    const std::uint32_t slot = it->second;
+    slots_.erase(it);
+
+    Entry & entry = entries_[slot];
+    entry.used = false;
+    entry.title.clear();
+    entry.executable.clear();
+    entry.lowerTitle.clear();
+    entry.lowerExecutable.clear();
+    entry.initials.clear();
+    reindex(slot);
+    freeSlots_.push_back(slot);
+}
+
+void WindowIndex::clear() noexcept
+{
+    entries_.clear();
+    freeSlots_.clear();
+    slots_.clear();
+    postings_.clear();
+    shared_.clear();
+}
+
+std::string_view WindowIndex::title(WindowId window) const noexcept
+{
+    const Entry * entry = find(window);
+    return entry ? std::string_view(entry->title) : std::string_view();
+}
+
+std::string_view WindowIndex::executable(WindowId window) const noexcept
+{
+    const Entry * entry = find(window);
+    return entry ? std::string_view(entry->executable) : std::string_view();
+}
+
+void WindowIndex::search(std::string_view query, size_t limit, std::vector<Match> & matches) const
+{
+    matches.clear();
+    candidates_.clear();
+    if (!limit) {
+        return;
+    }
+
+    // spaces around the query don't matter, but spaces within it do
+    const size_t first = query.find_first_not_of(' ');
+    const size_t last = query.find_last_not_of(' ');
+    query_ = (first == std::string_view::npos) ? std::string() : toLower(query.substr(first, last - first + 1));
+
+    if (query_.empty()) {
+        for (std::uint32_t slot = 0; (slot < entries_.size()) && (candidates_.size() < limit); ++slot) {
+            if (entries_[slot].used) {
+                candidates_.push_back({ slot, 0, entries_[slot].title.size() });
+            }
+        }
+        rank(limit, matches);
+        return;
+    }
+
+    shared_.resize(entries_.size());
+    if (query_.size() < 3) {
+        searchShort(limit);
+    } else {
+        searchTrigrams();
+    }
+    rank(limit, matches);
+}
+
+// The windows with a word that starts with the query, in the title, then in
+// the executable, then the windows whose initials start with it. Every match
+// of each kind ranks above any of the next, so once there are enough the rest
+// aren't looked at, a letter can start a word in nearly every window.
+void WindowIndex::searchShort(size_t limit) const
+{
+    const bool pair = query_.size() == 2;
+    const Key kinds[] = {
+        makeKey(pair ? titleStartPairKind_ : titleStartKind_, query_),
+        makeKey(pair ? executableStartPairKind_ : executableStartKind_, query_),
+        pair ? makeKey(initialsStartPairKind_, query_) : Key {},
+    };
+    for (const Key key : kinds) {
+        const auto it = key ? postings_.find(key) : postings_.end();
+        if (it != postings_.end()) {
+            for (const std::uint32_t slot : it->second) {
+                if (shared_[slot]++) {
+                    continue;
+                }
+                touched_.push_back(slot);
+                const int entryScore = score(entries_[slot], query_, 0, 0);
+                if (entryScore > 0) {
+                    candidates_.push_back({ slot, entryScore, entries_[slot].title.size() });
+                }
+            }
+        }
+        if (candidates_.size() >= limit) {
+            break;
+        }
+    }
+
+    for (const std::uint32_t slot : touched_) {
+        shared_[slot] = 0;
+    }
+    touched_.clear();
+}
+
+// the windows with enough of the query's trigrams, in their text or their initials
+void WindowIndex::searchTrigrams() const
+{
+    queryKeys_.clear();
+    appendTrigrams(query_, textKind_, queryKeys_);
+    sortUnique(queryKeys_);
+    const size_t trigramCount = queryKeys_.size();
+    for (size_t i = 0; i < trigramCount; ++i) {
+        queryKeys_.push_back(queryKeys_[i] | initialsKind_);
+    }
+
+    for (const Key key : queryKeys_) {
+        const auto it = postings_.find(key);
+        if (it == postings_.end()) {
+            continue;
+        }
+        for (const std::uint32_t slot : it->second) {
+            if (!shared_[slot]++) {
+                touched_.push_back(slot);
+            }
+        }
+    }
+
+    // every kind of match has at least a third of the query's trigrams, so the rest aren't looked at
+    const size_t sharedMin = (trigramCount + 2) / 3;
+    for (const std::uint32_t slot : touched_) {
+        const size_t shared = std::min<size_t>(shared_[slot], trigramCount);
+        const bool enough = shared_[slot] >= sharedMin;
+        shared_[slot] = 0;
+        const int entryScore = enough ? score(entries_[slot], query_, shared, trigramCount) : 0;
+        if (entryScore > 0) {
+            candidates_.push_back({ slot, entryScore, entries_[slot].title.size() });
+        }
+    }
+    touched_.clear();
+}
+
+int WindowIndex::score(const Entry & entry, std::string_view query, size_t shared, size_t trigramCount) noexcept
+{
+    const int titleFound = findScore(entry.lowerTitle, query, titleScore_);
+    if (titleFound >= 0) {
+        return titleFound;
+    }
+
+    const int executableFound = findScore(entry.lowerExecutable, query, executableScore_);
+    if (executableFound >= 0) {
+        return executableFound;
+    }
+
+    if (entry.initials.starts_with(query)) {
+        return initialsScore_;
+    }
+
+    // at least a third of the query's trigrams, so a typo in a short word still finds it
+    if (trigramCount && (shared * 3 >= trigramCount)) {
+        return static_cast<int>((similarScore_ * shared) / trigramCount);
+    }
+
+    return 0;
+}
+
+// the lists of windows with each key are only changed where the window's keys did
+void WindowIndex::reindex(std::uint32_t slot)
+{
+    Entry & entry = entries_[slot];
+    std::vector<Key> keys;
+    if (entry.used) {
+        appendTrigrams(entry.lowerTitle, textKind_, keys);
+        appendTrigrams(entry.lowerExecutable, textKind_, keys);
+        appendTrigrams(entry.initials, initialsKind_, keys);
+        appendWordStarts(entry.lowerTitle, titleStartKind_, titleStartPairKind_, keys);
+        appendWordStarts(entry.lowerExecutable, executableStartKind_, executableStartPairKind_, keys);
+        if (entry.initials.size() >= 2) {
+            keys.push_back(makeKey(initialsStartPairKind_, std::string_view(entry.initials).substr(0, 2)));
+        }
+        sortUnique(keys);
+    }
+
+    std::vector<Posting> postings;
+    postings.reserve(keys.size());
+    auto old = entry.postings.begin();
+    for (const Key key : keys) {
+        for (; (old != entry.postings.end()) && (old->key < key); ++old) {
+            removePosting(slot, *old);
+        }
+        if ((old != entry.postings.end()) && (old->key == key)) {
+            postings.push_back(*old);
+            ++old;
+            continue;
+        }
+
+        std::vector<std::uint32_t> & slots = postings_[key];
+        postings.push_back({ key, static_cast<std::uint32_t>(slots.size()) });
+        slots.push_back(slot);
+    }
+    for (; old != entry.postings.end(); ++old) {
+        removePosting(slot, *old);
+    }
+    entry.postings = std::move(postings);
+}
+
+// the last window with the key takes the removed one's place, so removing is constant time
+void WindowIndex::removePosting(std::uint32_t slot, const Posting & posting)
+{
+    const auto it = postings_.find(posting.key);
+    std::vector<std::uint32_t> & slots = it->second;
+    const std::uint32_t moved = slots.back();
+    slots[posting.position] = moved;
+    slots.pop_back();
+
+    if (moved != slot) {
+        std::vector<Posting> & movedPostings = entries_[moved].postings;
+        const auto movedPosting = std::ranges::lower_bound(movedPostings, posting.key, {}, &Posting::key);
+        movedPosting->position = posting.position;
+    }
+
+    if (slots.empty()) {
+        postings_.erase(it);
+    }
+}
+
+const WindowIndex::Entry * WindowIndex::find(WindowId window) const noexcept
+{
+    const auto it = slots_.find(window);
+    return (it == slots_.end()) ? nullptr : &entries_[it->second];
+}
+
+// the best candidates, ties going to the shorter title, which matched more of it
+void WindowIndex::rank(size_t limit, std::vector<Match> & matches) const
+{
+    const auto better = [](const Candidate & a, const Candidate & b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        return (a.titleLength != b.titleLength) ? (a.titleLength < b.titleLength) : (a.slot < b.slot);
+    };
+
+    const size_t count = std::min(limit, candidates_.size());
+    std::ranges::partial_sort(candidates_, candidates_.begin() + static_cast<std::ptrdiff_t>(count), better);
+    matches.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        matches.push_back({ entries_[candidates_[i].slot].window, candidates_[i].score });
+    }
+}
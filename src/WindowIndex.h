@@ -0,0 +1,135 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+// Standard library
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Finds windows by their title or executable as the user types, fast enough
+// for every keystroke with thousands of windows. Each window's title and
+// executable are split into trigrams, every three letters in a row, ignoring
+// case, and so are the initials of their words, so "vsc" finds "Visual Studio
+// Code". The index keeps the windows with each trigram, and is updated one
+// window at a time as they come and go or their titles change.
+//
+// A search only looks at the windows that share trigrams with the query, and
+// ranks them, best first:
+//   - the query found in the title, better at the start of a word or earlier
+//   - the query found in the executable
+//   - the query matching the start of the initials
+//   - sharing enough of the query's trigrams, which forgives a typo or two
+// Queries shorter than a trigram only find windows with a word, or initials,
+// that start with them.
+//
+// This is only used from one thread.
+class WindowIndex
+{
+public:
+    using WindowId = std::uintptr_t;
+
+    struct Match
+    {
+        WindowId window {};
+        int score {};
+    };
+
+    // adds a window, or replaces what's indexed for it
+    void add(WindowId window, std::string_view title, std::string_view executable);
+
+    // changes a window's title, only updating the trigrams that changed
+    void updateTitle(WindowId window, std::string_view title);
+
+    void remove(WindowId window);
+    void clear() noexcept;
+
+    [[nodiscard]]
+    bool contains(WindowId window) const noexcept
+    {
+        return slots_.contains(window);
+    }
+
+    [[nodiscard]]
+    size_t size() const noexcept
+    {
+        return slots_.size();
+    }
+
+    // the title and executable as added, empty for a window that isn't in the index
+    [[nodiscard]]
+    std::string_view title(WindowId window) const noexcept;
+
+    [[nodiscard]]
+    std::string_view executable(WindowId window) const noexcept;
+
+    // Replaces matches with up to limit windows that match the query, best
+    // first. An empty query matches every window, in no particular order.
+    void search(std::string_view query, size_t limit, std::vector<Match> & matches) const;
+
+private:
+    using Key = std::uint32_t;
+
+    struct Posting
+    {
+        Key key {};
+        std::uint32_t position {}; // in the key's list of slots
+    };
+
+    struct Entry
+    {
+        WindowId window {};
+        bool used {};
+        std::string title;
+        std::string executable;
+        std::string lowerTitle;
+        std::string lowerExecutable;
+        std::string initials;
+        std::vector<Posting> postings; // sorted by key
+    };
+
+    struct Candidate
+    {
+        std::uint32_t slot {};
+        int score {};
+        size_t titleLength {};
+    };
+
+    [[nodiscard]]
+    static int score(const Entry & entry, std::string_view query, size_t shared, size_t trigramCount) noexcept;
+    void searchShort(size_t limit) const;
+    void searchTrigrams() const;
+    void reindex(std::uint32_t slot);
+    void removePosting(std::uint32_t slot, const Posting & posting);
+    [[nodiscard]]
+    const Entry * find(WindowId window) const noexcept;
+    void rank(size_t limit, std::vector<Match> & matches) const;
+
+    std::vector<Entry> entries_;
+    std::vector<std::uint32_t> freeSlots_;
+    std::unordered_map<WindowId, std::uint32_t> slots_;
+    std::unordered_map<Key, std::vector<std::uint32_t>> postings_;
+
+    // reused by each search
+    mutable std::vector<std::uint32_t> shared_;
+    mutable std::vector<std::uint32_t> touched_;
+    mutable std::vector<Candidate> candidates_;
+    mutable std::string query_;
+    mutable std::vector<Key> queryKeys_;
+};
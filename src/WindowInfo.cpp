@@ -17,6 +17,7 @@
 #include "HandleWrapper.h"
 #include "Helpers.h"
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 
 // Windows
@@ -30,10 +31,10 @@ WindowInfo::WindowInfo(HWND hwnd)
     className_.resize(256);
     const int res = GetClassNameA(hwnd, className_.data(), narrow_cast<int>(className_.size()));
     if (!res) {
-        WARNING_PRINTF(
-            "failed to get window %#x class name, GetClassNameA() failed: %s\n",
+        WARNING_LOG(
+            "failed to get window {} class name, GetClassNameA() failed: {}\n",
             hwnd,
-            StringUtility::lastErrorString().c_str());
+            StringUtility::lastErrorString());
         className_.clear();
     } else {
         className_.resize(narrow_cast<size_t>(res)); // remove nul terminator
@@ -42,7 +43,7 @@ WindowInfo::WindowInfo(HWND hwnd)
     char executableFullPath[MAX_PATH] = {};
     DWORD processID = 0;
     if (!GetWindowThreadProcessId(hwnd, &processID)) {
-        WARNING_PRINTF("GetWindowThreadProcessId failed for %#x: %s\n", hwnd, StringUtility::lastErrorString().c_str());
+        WARNING_LOG("GetWindowThreadProcessId failed for {}: {}\n", hwnd, StringUtility::lastErrorString());
     } else {
         const HandleWrapper process(OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processID));
         if (!process) {
@@ -65,10 +66,10 @@ std::string WindowInfo::getTitle(HWND hwnd)
     if (!len) {
         const DWORD error = GetLastError();
         if (error != ERROR_SUCCESS) {
-            WARNING_PRINTF(
-                "failed to get window %#x title length, GetWindowTextLengthA() failed: %s\n",
+            WARNING_LOG(
+                "failed to get window {} title length, GetWindowTextLengthA() failed: {}\n",
                 hwnd,
-                StringUtility::errorToString(error).c_str());
+                StringUtility::errorToString(error));
         }
         return {};
     }
@@ -79,10 +80,10 @@ std::string WindowInfo::getTitle(HWND hwnd)
     if (!res) {
         const DWORD error = GetLastError();
         if (error != ERROR_SUCCESS) {
-            WARNING_PRINTF(
-                "failed to get window %#x title, GetWindowTextA() failed: %s\n",
+            WARNING_LOG(
+                "failed to get window {} title, GetWindowTextA() failed: {}\n",
                 hwnd,
-                StringUtility::errorToString(error).c_str());
+                StringUtility::errorToString(error));
             return {};
         }
     }
@@ -19,3 +19,7 @@
 
 #define WM_TRAYWINDOW (WM_USER + 1)
 #define WM_SHOWSETTINGS (WM_USER + 2)
+#define WM_ICONLOADED (WM_USER + 3)
+
+// WM_COPYDATA identifiers
+#define COPYDATA_IMPORT_AUTO_TRAY 1
@@ -16,18 +16,22 @@
 #include "WindowTracker.h"
 #include "Helpers.h"
 #include "Log.h"
+#include "LogFormatters.h"
 #include "StringUtility.h"
 #include "TrayIcon.h"
+#include "TrayTipThrottle.h"
 #include "VirtualDesktop.h"
 #include "WindowIcon.h"
+#include "WindowIndex.h"
 #include "WindowInfo.h"
 #include "WindowMessage.h"
 
 // Standard library
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <deque>
 #include <list>
-#include <memory>
 #include <ranges>
 #include <string>
 #include <vector>
@@ -37,16 +41,57 @@ namespace
 
 using Items = std::list<WindowTracker::Item>;
 
+// New windows have their icons prefetched a few at a time each poll, so a
+// burst of windows, like all of them at start, doesn't hold up the UI thread.
+constexpr size_t prefetchPerPoll_ = 4;
+constexpr size_t prefetchPendingMax_ = 64;
+
+// When the taskbar is recreated, such as when Explorer restarts, every tray
+// icon has to be added again. They're added a few at a time, so neither the UI
+// thread nor Explorer, which is still starting, is held up by all of them at
+// once, and an icon that can't be added yet is tried again later.
+constexpr UINT_PTR recreateTimerId_ = 2;
+constexpr UINT recreateMillis_ = 20;
+constexpr size_t recreatePerTick_ = 4;
+constexpr unsigned int recreateAttempts_ = 3;
+
+struct RecreatePending
+{
+    HWND hwnd {};
+    UINT trayIcon {}; // the ID of the icon to add again, unless create is set
+    bool create {}; // the window had no tray icon, but the placement wants one
+    unsigned int attempts {};
+};
+
 HWND messageHwnd_;
 UINT pollMillis_;
 void (*addWindowCallback_)(HWND);
 UINT_PTR timer_;
 Items items_;
 bool enumerating_;
+std::uint64_t generation_;
+std::deque<HWND> prefetchPending_;
+WindowIndex index_;
+TrayTipThrottle tipThrottle_(TrayIcon::tipLengthMax);
+std::deque<RecreatePending> recreatePending_;
+UINT_PTR recreateTimer_;
+LARGE_INTEGER recreateStart_;
+size_t recreateCount_;
+size_t recreateFailed_;
 
 Items::iterator findWindow(HWND hwnd);
 void addItem(HWND hwnd);
+void createTrayIcon(WindowTracker::Item & item);
+void destroyTrayIcon(WindowTracker::Item & item);
 void updateItem(WindowTracker::Item & item, HWND hwnd);
+void updateIndex(const WindowTracker::Item & item);
+void flushTips();
+void recreateNext();
+void finishRecreate();
+VOID recreateTimerProc(HWND unnamedParam1, UINT unnamedParam2, UINT_PTR unnamedParam3, DWORD unnamedParam4);
+
+TrayTipThrottle::Key tipKey(HWND hwnd) noexcept;
+void prefetchIcons();
 VOID timerProc(HWND unnamedParam1, UINT unnamedParam2, UINT_PTR unnamedParam3, DWORD unnamedParam4);
 BOOL enumWindowsProc(HWND hwnd, LPARAM lParam);
 void restoreRemovedVirtualDesktopWindows();
@@ -56,13 +101,14 @@ void restoreRemovedVirtualDesktopWindows();
 namespace WindowTracker
 {
 
-bool start(HWND messageHwnd, UINT pollMillis, void (*addWindowCallback)(HWND))
+bool start(HWND messageHwnd, UINT pollMillis, UINT tipMillis, void (*addWindowCallback)(HWND))
 {
     DEBUG_PRINTF("WindowTracker starting\n");
 
     messageHwnd_ = messageHwnd;
     pollMillis_ = pollMillis;
     addWindowCallback_ = addWindowCallback;
+    tipThrottle_.setInterval(tipMillis);
 
     if (pollMillis_ > 0) {
         DEBUG_PRINTF("WindowTracker setting poll timer to %u\n", pollMillis_);
@@ -81,7 +127,21 @@ void stop() noexcept
     DEBUG_PRINTF("WindowTracker stopping\n");
 
     assert(!enumerating_);
+
+    const TrayTipThrottle::Statistics statistics = tipThrottle_.statistics();
+    INFO_PRINTF(
+        "tray tips: %llu sent, %llu replaced before sending, %llu unchanged, %zu not sent\n",
+        static_cast<unsigned long long>(statistics.sent),
+        static_cast<unsigned long long>(statistics.coalesced),
+        static_cast<unsigned long long>(statistics.unchanged),
+        statistics.pending);
+
+    recreatePending_.clear();
+    finishRecreate();
     items_.clear();
+    prefetchPending_.clear();
+    index_.clear();
+    tipThrottle_.clear();
 
     if (timer_) {
         if (!KillTimer(messageHwnd_, timer_)) {
@@ -97,7 +157,7 @@ void stop() noexcept
 
 void minimize(HWND hwnd, MinimizePlacement minimizePlacement, MinimizePersistence minimizePersistence)
 {
-    DEBUG_PRINTF("tray window minimize %#x - '%s'\n", hwnd, WindowInfo::getTitle(hwnd).c_str());
+    DEBUG_LOG("tray window minimize {} - '{}'\n", hwnd, WindowInfo::getTitle(hwnd));
 
     assert(!enumerating_);
 
@@ -107,14 +167,14 @@ void minimize(HWND hwnd, MinimizePlacement minimizePlacement, MinimizePersistenc
 
     const Items::iterator it = findWindow(hwnd);
     if (it == items_.end()) {
-        DEBUG_PRINTF("not minimizing unknown window %#x\n", hwnd);
+        DEBUG_LOG("not minimizing unknown window {}\n", hwnd);
         return;
     }
 
     Item & item = *it;
 
     if (item.minimized_) {
-        DEBUG_PRINTF("not minimizing already minimized window %#x\n", hwnd);
+        DEBUG_LOG("not minimizing already minimized window {}\n", hwnd);
         return;
     }
 
@@ -123,7 +183,7 @@ void minimize(HWND hwnd, MinimizePlacement minimizePlacement, MinimizePersistenc
     if (isUwpWindow(hwnd)) {
         // move to virtual desktop
         if (!VirtualDesktop::minimize(hwnd)) {
-            ERROR_PRINTF("failed to minimize UWP window %#x to hidden virtual desktop\n", hwnd);
+            ERROR_LOG("failed to minimize UWP window {} to hidden virtual desktop\n", hwnd);
         }
     } else {
         // minimize and hide window
@@ -132,7 +192,7 @@ void minimize(HWND hwnd, MinimizePlacement minimizePlacement, MinimizePersistenc
         ShowWindow(hwnd, SW_HIDE);
 
         if (isWindowUserVisible(hwnd)) {
-            ERROR_PRINTF("window is not visible after minimize: %#x\n", hwnd);
+            ERROR_LOG("window is not visible after minimize: {}\n", hwnd);
         }
     }
 
@@ -151,34 +211,29 @@ void minimize(HWND hwnd, MinimizePlacement minimizePlacement, MinimizePersistenc
     // FIX - persistent implies tray placement
 
     if (!minimizePlacementIncludesTray(minimizePlacement)) {
-        item.trayIcon_.reset();
+        destroyTrayIcon(item);
     } else {
-        if (!item.trayIcon_) {
-            item.trayIcon_ = std::make_unique<TrayIcon>();
-            IconHandleWrapper icon = WindowIcon::get(hwnd);
-            const ErrorContext err = item.trayIcon_->create(hwnd, messageHwnd_, WM_TRAYWINDOW, std::move(icon));
-            if (err) {
-                WARNING_PRINTF("failed to create tray icon for minimized window %#x\n", hwnd);
-                errorMessage(err);
-                item.trayIcon_.reset();
-            }
+        if (!item.trayIcon_.created()) {
+            createTrayIcon(item);
         }
     }
 
+    updateIndex(item);
+
     // move item to end of list so restore order is reverse of minimize order
-    items_.push_back(item);
-    items_.erase(it);
+    items_.splice(items_.end(), items_, it);
+    ++generation_;
 }
 
 void restore(HWND hwnd)
 {
-    DEBUG_PRINTF("tray window restore %#x - '%s'\n", hwnd, WindowInfo::getTitle(hwnd).c_str());
+    DEBUG_LOG("tray window restore {} - '{}'\n", hwnd, WindowInfo::getTitle(hwnd));
 
     assert(!enumerating_);
 
     const Items::iterator it = findWindow(hwnd);
     if (it == items_.end()) {
-        WARNING_PRINTF("unknown window restored %#x\n", hwnd);
+        WARNING_LOG("unknown window restored {}\n", hwnd);
         // show and restore window
         // return value intentionally ignored, ShowWindow returns previous visibility
         ShowWindow(hwnd, SW_SHOWNORMAL);
@@ -203,7 +258,7 @@ void restore(HWND hwnd)
         ShowWindow(hwnd, SW_SHOWNORMAL);
 
         if (!isWindowUserVisible(hwnd)) {
-            ERROR_PRINTF("window is not visible after restore: %#x\n", hwnd);
+            ERROR_LOG("window is not visible after restore: {}\n", hwnd);
         }
     }
 
@@ -214,12 +269,14 @@ void restore(HWND hwnd)
     item.minimized_ = false;
     item.visible_ = true;
     if (item.minimizePersistence_ == MinimizePersistence::Never) {
-        item.trayIcon_.reset();
+        destroyTrayIcon(item);
     }
 
+    updateIndex(item);
+
     // put the item at the front of the list so the next restore is in reverse order of minimize
-    items_.push_front(item);
-    items_.erase(it);
+    items_.splice(items_.begin(), items_, it);
+    ++generation_;
 }
 
 void addAllMinimizedToTray(MinimizePlacement minimizePlacement)
@@ -236,26 +293,58 @@ void addAllMinimizedToTray(MinimizePlacement minimizePlacement)
         }
 
         if (minimizePlacementIncludesTray(minimizePlacement)) {
-            if (!item.trayIcon_) {
-                item.trayIcon_ = std::make_unique<TrayIcon>();
-                IconHandleWrapper icon = WindowIcon::get(item.hwnd_);
-                const ErrorContext err = item.trayIcon_->create(item.hwnd_, messageHwnd_, WM_TRAYWINDOW, std::move(icon));
-                if (err) {
-                    WARNING_PRINTF("failed to create tray icon for minimized window %#x\n", item.hwnd_);
-                    item.trayIcon_.reset();
-                    errorMessage(err);
-                }
+            if (!item.trayIcon_.created()) {
+                createTrayIcon(item);
             }
         } else {
-            if (item.trayIcon_) {
+            if (item.trayIcon_.created()) {
                 if (item.minimizePersistence_ == MinimizePersistence::Never) {
-                    item.trayIcon_.reset();
+                    destroyTrayIcon(item);
                 }
             }
         }
     }
 }
 
+void recreateTrayIcons(MinimizePlacement minimizePlacement)
+{
+    assert(!enumerating_);
+
+    // minimizing moves a window to the end of the list
+    recreatePending_.clear();
+    const bool tray = minimizePlacementIncludesTray(minimizePlacement);
+    for (const Item & item : std::ranges::reverse_view(items_)) {
+        if (!item.minimized_) {
+            continue;
+        }
+        if (item.trayIcon_.created()) {
+            recreatePending_.push_back({ item.hwnd_, item.trayIcon_.id(), false, 0 });
+        } else if (tray) {
+            recreatePending_.push_back({ item.hwnd_, 0, true, 0 });
+        }
+    }
+
+    DEBUG_PRINTF("recreating %zu tray icon(s)\n", recreatePending_.size());
+    QueryPerformanceCounter(&recreateStart_);
+    recreateCount_ = 0;
+    recreateFailed_ = 0;
+
+    // the first few right away, they're the most likely to be wanted
+    recreateNext();
+    if (recreatePending_.empty()) {
+        finishRecreate();
+    } else if (!recreateTimer_) {
+        recreateTimer_ = SetTimer(messageHwnd_, recreateTimerId_, recreateMillis_, recreateTimerProc);
+        if (!recreateTimer_) {
+            WARNING_PRINTF("SetTimer() failed: %s\n", StringUtility::lastErrorString().c_str());
+            while (!recreatePending_.empty()) {
+                recreateNext();
+            }
+            finishRecreate();
+        }
+    }
+}
+
 void updateMinimizePlacement(MinimizePlacement minimizePlacement)
 {
     DEBUG_PRINTF("updating minimize placement to '%s'\n", minimizePlacementToCString(minimizePlacement));
@@ -267,12 +356,24 @@ void updateMinimizePlacement(MinimizePlacement minimizePlacement)
 
         for (Item & item : items_) {
             if (item.minimizePersistence_ == MinimizePersistence::Never) {
-                item.trayIcon_.reset();
+                destroyTrayIcon(item);
             }
         }
     }
 }
 
+void updateIcon(HWND hwnd, IconHandleWrapper && icon)
+{
+    assert(!enumerating_);
+
+    const Items::iterator it = findWindow(hwnd);
+    if ((it == items_.end()) || !it->trayIcon_.created()) {
+        return;
+    }
+
+    it->trayIcon_.updateIcon(std::move(icon));
+}
+
 bool isMinimized(HWND hwnd)
 {
     assert(!enumerating_);
@@ -313,6 +414,16 @@ void reverseEnumerate(const std::function<bool(const Item &)> & callback)
     enumerating_ = false;
 }
 
+std::uint64_t generation() noexcept
+{
+    return generation_;
+}
+
+const WindowIndex & index() noexcept
+{
+    return index_;
+}
+
 } // namespace WindowTracker
 
 namespace
@@ -331,7 +442,7 @@ void addItem(HWND hwnd)
 {
     const std::string title = WindowInfo::getTitle(hwnd);
     const bool visible = isWindowUserVisible(hwnd);
-    DEBUG_PRINTF("window added %#x - '%s' (%s)\n", hwnd, title.c_str(), visible ? "visible" : "invisible");
+    DEBUG_LOG("window added {} - '{}' ({})\n", hwnd, title, visible ? "visible" : "invisible");
 
     assert(!enumerating_);
 
@@ -339,7 +450,32 @@ void addItem(HWND hwnd)
     item.hwnd_ = hwnd;
     item.title_ = title;
     item.visible_ = visible;
-    items_.push_back(item);
+    updateIndex(item);
+    items_.push_back(std::move(item));
+    ++generation_;
+}
+
+// The tray icon starts with whatever icon is at hand, so the window can be
+// hidden without waiting, and the real one is swapped in by updateIcon.
+void createTrayIcon(WindowTracker::Item & item)
+{
+    IconHandleWrapper icon = WindowIcon::getAsync(item.hwnd_);
+    const ErrorContext err = item.trayIcon_.create(item.hwnd_, messageHwnd_, WM_TRAYWINDOW, std::move(icon));
+    if (err) {
+        WARNING_LOG("failed to create tray icon for minimized window {}\n", item.hwnd_);
+        destroyTrayIcon(item);
+        errorMessage(err);
+        return;
+    }
+
+    tipThrottle_.add(tipKey(item.hwnd_), item.title_, GetTickCount64());
+}
+
+void destroyTrayIcon(WindowTracker::Item & item)
+{
+    WindowIcon::cancel(item.hwnd_);
+    tipThrottle_.remove(tipKey(item.hwnd_));
+    item.trayIcon_.destroy();
 }
 
 void restoreRemovedVirtualDesktopWindows()
@@ -362,30 +498,63 @@ void restoreRemovedVirtualDesktopWindows()
         item.minimized_ = false;
         item.visible_ = true;
         if (item.minimizePersistence_ == MinimizePersistence::Never) {
-            item.trayIcon_.reset();
+            destroyTrayIcon(item);
         }
 
+        updateIndex(item);
+
         // put the item at the front of the list so the next restore is in reverse order of minimize
-        items_.push_front(item);
-        items_.erase(it);
+        items_.splice(items_.begin(), items_, it);
+        ++generation_;
     }
 }
 
 void updateItem(WindowTracker::Item & item, HWND hwnd)
 {
+    bool changed = false;
+
     const bool visible = isWindowUserVisible(hwnd);
     if (item.visible_ != visible) {
-        DEBUG_PRINTF("\tchanged window %#x visibility: to %s\n", hwnd, StringUtility::boolToCString(visible));
+        DEBUG_LOG("\tchanged window {} visibility: to {}\n", hwnd, visible);
         item.visible_ = visible;
+        changed = true;
+        ++generation_;
     }
 
     const std::string title = WindowInfo::getTitle(hwnd);
     if (item.title_ != title) {
-        DEBUG_PRINTF("\tchanged window %#x title: to %s\n", hwnd, title.c_str());
+        DEBUG_LOG("\tchanged window {} title: to {}\n", hwnd, title);
         item.title_ = title;
-        if (item.trayIcon_) {
-            item.trayIcon_->updateTip(item.title_);
+        ++generation_;
+        if (item.trayIcon_.created()) {
+            tipThrottle_.update(tipKey(hwnd), item.title_);
         }
+        changed = true;
+    }
+
+    if (changed) {
+        updateIndex(item);
+    }
+}
+
+// The switcher finds the windows the user can see or has minimized, so the
+// index follows them. The executable is only looked up once, when a window
+// joins the index, and only its file name is indexed.
+void updateIndex(const WindowTracker::Item & item)
+{
+    const auto window = reinterpret_cast<WindowIndex::WindowId>(item.hwnd_);
+    if (!item.visible_ && !item.minimized_) {
+        index_.remove(window);
+    } else if (!index_.contains(window)) {
+        const WindowInfo windowInfo(item.hwnd_);
+        const std::string & executable = windowInfo.executable();
+        const size_t separator = executable.find_last_of("\\/");
+        index_.add(
+            window,
+            item.title_,
+            (separator == std::string::npos) ? executable : executable.substr(separator + 1));
+    } else {
+        index_.updateTitle(window, item.title_);
     }
 }
 
@@ -406,7 +575,12 @@ VOID timerProc(
         if (nit != newWindows.end()) {
             ++it;
         } else {
+            WindowIcon::forget(it->hwnd_);
+            std::erase(prefetchPending_, it->hwnd_);
+            index_.remove(reinterpret_cast<WindowIndex::WindowId>(it->hwnd_));
+            tipThrottle_.remove(tipKey(it->hwnd_));
             it = items_.erase(it);
+            ++generation_;
         }
     }
 
@@ -417,6 +591,9 @@ VOID timerProc(
             if (addWindowCallback_) {
                 addWindowCallback_(hwnd);
             }
+            if (prefetchPending_.size() < prefetchPendingMax_) {
+                prefetchPending_.push_back(hwnd);
+            }
         }
     }
 
@@ -427,6 +604,126 @@ VOID timerProc(
 
     // restore any windows that were on the hidden virtual desktop if the user removed it
     restoreRemovedVirtualDesktopWindows();
+
+    flushTips();
+    prefetchIcons();
+}
+
+// Tray icon tips are sent once a poll, for all the titles that changed, and
+// at most once per tip interval for each icon.
+void flushTips()
+{
+    tipThrottle_.flush(GetTickCount64(), [](TrayTipThrottle::Key key, const std::string & tip) {
+        const Items::iterator it = findWindow(reinterpret_cast<HWND>(static_cast<std::uintptr_t>(key)));
+        if ((it != items_.end()) && it->trayIcon_.created()) {
+            it->trayIcon_.updateTip(tip);
+        }
+    });
+}
+
+// Adds back the next few tray icons waiting to be recreated. A window that was
+// restored, or minimized again with a new icon, since the taskbar was recreated
+// is skipped.
+void recreateNext()
+{
+    for (size_t budget = recreatePerTick_; budget && !recreatePending_.empty();) {
+        RecreatePending pending = std::move(recreatePending_.front());
+        recreatePending_.pop_front();
+
+        const Items::iterator it = findWindow(pending.hwnd);
+        if ((it == items_.end()) || !it->minimized_) {
+            continue;
+        }
+
+        WindowTracker::Item & item = *it;
+        --budget;
+        if (pending.create) {
+            if (item.trayIcon_.created()) {
+                continue;
+            }
+            createTrayIcon(item);
+            if (item.trayIcon_.created()) {
+                ++recreateCount_;
+            } else {
+                ++recreateFailed_;
+            }
+            continue;
+        }
+
+        if (item.trayIcon_.id() != pending.trayIcon) {
+            continue;
+        }
+        if (!item.trayIcon_.recreate()) {
+            ++recreateCount_;
+        } else if (++pending.attempts < recreateAttempts_) {
+            recreatePending_.push_back(std::move(pending));
+        } else {
+            WARNING_LOG("giving up on adding the tray icon for window {} again\n", item.hwnd_);
+            ++recreateFailed_;
+        }
+    }
+}
+
+void finishRecreate()
+{
+    if (recreateTimer_) {
+        if (!KillTimer(messageHwnd_, recreateTimer_)) {
+            ERROR_PRINTF("KillTimer() failed: %ld\n", GetLastError());
+        }
+        recreateTimer_ = 0;
+    }
+
+    if (!recreateStart_.QuadPart) {
+        return;
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    const auto microseconds =
+        static_cast<std::uint64_t>(((now.QuadPart - recreateStart_.QuadPart) * 1000000) / frequency.QuadPart);
+    INFO_PRINTF(
+        "recreated %zu tray icon(s) in %llu us, %zu failed\n",
+        recreateCount_,
+        static_cast<unsigned long long>(microseconds),
+        recreateFailed_);
+    recreateStart_.QuadPart = 0;
+}
+
+VOID recreateTimerProc(
+    HWND /* unnamedParam1 */,
+    UINT /* unnamedParam2 */,
+    UINT_PTR /* unnamedParam3 */,
+    DWORD /* unnamedParam4 */)
+{
+    recreateNext();
+    if (recreatePending_.empty()) {
+        finishRecreate();
+    }
+}
+
+TrayTipThrottle::Key tipKey(HWND hwnd) noexcept
+{
+    return reinterpret_cast<std::uintptr_t>(hwnd);
+}
+
+// Warms the icon cache for visible windows, which can be minimized or are
+// shown in the menu. The add window callback may already have minimized some.
+void prefetchIcons()
+{
+    for (size_t budget = prefetchPerPoll_; budget && !prefetchPending_.empty();) {
+        const HWND hwnd = prefetchPending_.front();
+        prefetchPending_.pop_front();
+
+        const Items::const_iterator it = findWindow(hwnd);
+        if ((it == items_.end()) || it->minimized_ || !it->visible_) {
+            continue;
+        }
+
+        WindowIcon::prefetch(hwnd);
+        --budget;
+    }
 }
 
 BOOL enumWindowsProc(HWND hwnd, LPARAM lParam)
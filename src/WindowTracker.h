@@ -17,17 +17,19 @@
 // App
 #include "MinimizePersistence.h"
 #include "MinimizePlacement.h"
+#include "TrayIcon.h"
 
 // Windows
 #include <Windows.h>
 
 // Standard library
+#include <cstdint>
 #include <functional>
-#include <memory>
 #include <string>
 #include <vector>
 
-class TrayIcon;
+class IconHandleWrapper;
+class WindowIndex;
 
 namespace WindowTracker
 {
@@ -38,17 +40,32 @@ struct Item
     bool visible_ {};
     bool minimized_ {};
     MinimizePersistence minimizePersistence_ { MinimizePersistence::Never };
-    std::shared_ptr<TrayIcon> trayIcon_;
+    TrayIcon trayIcon_;
 };
 
-bool start(HWND messageHwnd, UINT pollMillis, void (*addWindowCallback)(HWND));
+// tipMillis is the least time between tip changes sent for each tray icon
+bool start(HWND messageHwnd, UINT pollMillis, UINT tipMillis, void (*addWindowCallback)(HWND));
 void stop() noexcept;
 void minimize(HWND hwnd, MinimizePlacement minimizePlacement, MinimizePersistence minimizePersistence);
 void restore(HWND hwnd);
 void addAllMinimizedToTray(MinimizePlacement minimizePlacement);
+
+// After the taskbar was recreated, adds the tray icons of minimized windows
+// back, a few at a time, most recently minimized first. Their icons, GUIDs,
+// and tips are kept from before.
+void recreateTrayIcons(MinimizePlacement minimizePlacement);
 void updateMinimizePlacement(MinimizePlacement minimizePlacement);
+void updateIcon(HWND hwnd, IconHandleWrapper && icon);
 bool isMinimized(HWND hwnd);
 void enumerate(const std::function<bool(const Item &)> & callback);
 void reverseEnumerate(const std::function<bool(const Item &)> & callback);
 
+// Changes whenever a window is added or removed, or its title, visibility, or
+// minimized state changes, so what's built from the windows can tell it's out
+// of date without looking at them.
+std::uint64_t generation() noexcept;
+
+// the windows the user can see or has minimized, for finding them by title or executable
+const WindowIndex & index() noexcept;
+
 } // namespace WindowTracker
@@ -0,0 +1,117 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures bulk auto-tray validation, usage:
+//   AutoTrayBenchmark [rule count] [repetitions] [csv file]
+// Without a CSV file, a rule set shaped like a fleet policy is generated.
+
+// App
+#include "AutoTrayValidator.h"
+
+// Standard library
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// mostly distinct rules with realistic regular expressions, plus some duplicates and shadowed rules
+std::string generateCsv(size_t ruleCount)
+{
+    std::string csv = "executable,window-class,window-title,tray-event,minimize-persistence\n";
+    for (size_t i = 0; i < ruleCount; ++i) {
+        const std::string n = std::to_string(i);
+        switch (i % 16) {
+            case 0: csv += "app" + n + ".exe,,,open,always\n"; break;
+            case 1: csv += ",Class" + n + ",,minimize,never\n"; break;
+            case 2: csv += "app" + std::to_string(i - 2) + ".exe,,\"Document [0-9]+ - App\",minimize,never\n"; break;
+            case 3: csv += "app" + std::to_string(i - 3) + ".exe,,,open,always\n"; break;
+            default:
+                csv += "tool" + n + ".exe,Window" + n + ",\"^(Untitled|Project [A-Z]{2,8}) - (Tool" + n +
+                    "|Viewer)( \\[[a-z, ]*\\])?$\",open-and-minimize,never\n";
+                break;
+        }
+    }
+    return csv;
+}
+
+double milliseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t ruleCount = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000;
+    const int repetitions = (argc > 2) ? std::atoi(argv[2]) : 5;
+
+    std::string csv;
+    if (argc > 3) {
+        std::ifstream file(argv[3], std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "couldn't open '%s'\n", argv[3]);
+            return 1;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        csv = contents.str();
+    } else {
+        csv = generateCsv(ruleCount);
+    }
+
+    std::vector<Settings::AutoTray> rules;
+    std::string error;
+    const auto parseStart = std::chrono::steady_clock::now();
+    if (!AutoTrayValidator::parseCsv(csv, rules, error)) {
+        std::fprintf(stderr, "couldn't parse CSV: %s\n", error.c_str());
+        return 1;
+    }
+    const auto parseEnd = std::chrono::steady_clock::now();
+    std::printf("parsed %zu rules from %zu bytes of CSV in %.3f ms\n", rules.size(), csv.size(), milliseconds(parseEnd - parseStart));
+
+    const unsigned int cores = std::max(1U, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts { 1 };
+    for (unsigned int threads = 2; threads < cores; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (cores > 1) {
+        threadCounts.push_back(cores);
+    }
+
+    AutoTrayValidator::Report report;
+    for (const unsigned int threads : threadCounts) {
+        double best = 0.0;
+        for (int r = 0; r < repetitions; ++r) {
+            const auto start = std::chrono::steady_clock::now();
+            report = AutoTrayValidator::validate(rules, threads);
+            const double elapsed = milliseconds(std::chrono::steady_clock::now() - start);
+            if ((r == 0) || (elapsed < best)) {
+                best = elapsed;
+            }
+        }
+        std::printf("validated with %2u threads in %8.3f ms (best of %d)\n", threads, best, repetitions);
+    }
+
+    std::printf("%s", report.toString(10).c_str());
+
+    return 0;
+}
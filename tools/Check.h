@@ -0,0 +1,53 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+// Standard library
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+
+// What the tools that check a module before measuring it have in common: a
+// check that says what went wrong, random numbers that are the same from run
+// to run, so a failure can be repeated, and the time taken per iteration.
+namespace Check
+{
+
+// how many random steps a check against a model takes, enough to reach the rare cases of a small one
+inline constexpr size_t modelSteps = 100000;
+
+[[nodiscard]]
+inline std::mt19937 random()
+{
+    return std::mt19937(12345);
+}
+
+// whether the condition holds, telling what failed if it doesn't
+inline bool expect(bool condition, const char * what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "%s\n", what);
+    }
+    return condition;
+}
+
+inline double nanoseconds(std::chrono::steady_clock::duration duration, size_t iterations)
+{
+    return std::chrono::duration<double, std::nano>(duration).count() / static_cast<double>(iterations);
+}
+
+} // namespace Check
@@ -0,0 +1,176 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks ContentHash.h, that the SIMD kernel matches hashing 64 bits at a
+// time for every length up to a few blocks and any alignment, and that
+// synthetic icon images that differ by a pixel, by swapped rows, or only in
+// size get different hashes. Then measures both for common icon sizes, usage:
+//   ContentHashBenchmark [iterations]
+
+// App
+#include "ContentHash.h"
+
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t checkSizeMax_ = 1100;
+constexpr size_t collisionImages_ = 100000;
+constexpr size_t iconSizes_[] = { 16, 32, 48, 256 };
+
+// a size by size icon of 32 bit pixels
+std::vector<std::uint8_t> makeIcon(size_t size, std::mt19937 & random)
+{
+    std::vector<std::uint8_t> pixels(size * size * 4);
+    for (std::uint8_t & byte : pixels) {
+        byte = static_cast<std::uint8_t>(random());
+    }
+    return pixels;
+}
+
+bool checkKernel(std::mt19937 & random)
+{
+    const std::vector<std::uint8_t> bytes = makeIcon(32, random);
+    for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t size = 0; size <= checkSizeMax_ && offset + size <= bytes.size(); ++size) {
+            const std::span<const std::uint8_t> span(bytes.data() + offset, size);
+            for (std::uint64_t seed : { 0ULL, 0x1234ULL }) {
+                if (ContentHash::hash(span, seed) != ContentHash::hashScalar(span, seed)) {
+                    std::fprintf(
+                        stderr,
+                        "%s hash doesn't match scalar for %zu bytes at offset %zu\n",
+                        ContentHash::kernelName(),
+                        size,
+                        offset);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool checkDistinct(std::mt19937 & random)
+{
+    // every single pixel change of a small icon, and the original
+    const std::vector<std::uint8_t> icon = makeIcon(16, random);
+    std::unordered_set<std::uint64_t> hashes = { ContentHash::hash(icon) };
+    for (size_t pixel = 0; pixel < icon.size() / 4; ++pixel) {
+        std::vector<std::uint8_t> changed = icon;
+        changed[(pixel * 4) + (pixel % 4)] ^= 1;
+        if (!hashes.insert(ContentHash::hash(changed)).second) {
+            std::fprintf(stderr, "changing pixel %zu didn't change the hash\n", pixel);
+            return false;
+        }
+    }
+
+    // swapped rows, within a block and across blocks, of a bigger icon
+    const std::vector<std::uint8_t> big = makeIcon(64, random);
+    const size_t row = 64 * 4;
+    for (size_t other : { 1, 7, 8, 63 }) {
+        std::vector<std::uint8_t> swapped = big;
+        std::swap_ranges(swapped.begin(), swapped.begin() + row, swapped.begin() + (other * row));
+        if (ContentHash::hash(swapped) == ContentHash::hash(big)) {
+            std::fprintf(stderr, "swapping rows 0 and %zu didn't change the hash\n", other);
+            return false;
+        }
+    }
+
+    // blank icons of different sizes, and trailing zeros that pad the last stripe
+    const std::uint8_t zeros[40] = {};
+    std::unordered_set<std::uint64_t> blanks;
+    for (size_t size = 0; size <= sizeof(zeros); ++size) {
+        if (!blanks.insert(ContentHash::hash(std::span(zeros, size))).second) {
+            std::fprintf(stderr, "%zu zero bytes hash the same as fewer\n", size);
+            return false;
+        }
+    }
+
+    // random icons don't collide
+    std::unordered_set<std::uint64_t> random64;
+    for (size_t i = 0; i < collisionImages_; ++i) {
+        if (!random64.insert(ContentHash::hash(makeIcon(4, random))).second) {
+            std::fprintf(stderr, "random icons collided after %zu\n", i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+double nanoseconds(std::chrono::steady_clock::duration duration, size_t iterations)
+{
+    return std::chrono::duration<double, std::nano>(duration).count() / static_cast<double>(iterations);
+}
+
+template <typename Function>
+double measure(const std::vector<std::uint8_t> & pixels, size_t iterations, Function && function)
+{
+    std::uint64_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink += function(pixels, i);
+    }
+    const auto time = std::chrono::steady_clock::now() - start;
+    if (sink == 1) {
+        std::printf("\n");
+    }
+    return nanoseconds(time, iterations);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+
+    std::mt19937 random(12345);
+    if (!checkKernel(random) || !checkDistinct(random)) {
+        return 1;
+    }
+    std::printf(
+        "%s matches scalar for 0 to %zu bytes, and similar images hash differently\n",
+        ContentHash::kernelName(),
+        checkSizeMax_);
+
+    for (size_t size : iconSizes_) {
+        const std::vector<std::uint8_t> pixels = makeIcon(size, random);
+        const double scalar = measure(pixels, iterations, [](const std::vector<std::uint8_t> & bytes, size_t seed) {
+            return ContentHash::hashScalar(bytes, seed);
+        });
+        const double kernel = measure(pixels, iterations, [](const std::vector<std::uint8_t> & bytes, size_t seed) {
+            return ContentHash::hash(bytes, seed);
+        });
+        std::printf(
+            "%3zux%-3zu: scalar %9.1f ns, %s %9.1f ns per icon (%.1f GB/s)\n",
+            size,
+            size,
+            scalar,
+            ContentHash::kernelName(),
+            kernel,
+            static_cast<double>(pixels.size()) / kernel);
+    }
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks the icon atlas in IconAtlas.h against known results, and against a
+// simple model of it over random acquires and releases, then measures
+// acquiring and releasing cells, usage:
+//   IconAtlasBenchmark [iterations]
+
+// App
+#include "Check.h"
+#include "IconAtlas.h"
+
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+using Check::expect;
+using Check::modelSteps;
+using Check::nanoseconds;
+
+constexpr size_t modelCells_ = 8;
+constexpr size_t modelKeys_ = 12;
+constexpr size_t cellCount_ = 256;
+constexpr size_t keyCount_ = 320;
+
+// the same behavior, the slow and obvious way
+class Model
+{
+public:
+    explicit Model(size_t cellCount)
+        : cells_(cellCount)
+    {
+        for (size_t cell = 0; cell < cellCount; ++cell) {
+            idle_.push_back(cell);
+        }
+    }
+
+    bool acquire(IconAtlas::Key key, size_t & cell, bool & draw)
+    {
+        for (cell = 0; cell < cells_.size(); ++cell) {
+            if (cells_[cell].keyed && (cells_[cell].key == key)) {
+                std::erase(idle_, cell);
+                ++cells_[cell].holds;
+                draw = false;
+                return true;
+            }
+        }
+        if (idle_.empty()) {
+            return false;
+        }
+        cell = idle_.front();
+        idle_.erase(idle_.begin());
+        cells_[cell] = { key, true, false, 1 };
+        draw = true;
+        return true;
+    }
+
+    void release(size_t cell, bool forget)
+    {
+        Cell & held = cells_[cell];
+        held.forget = held.forget || forget;
+        if (--held.holds) {
+            return;
+        }
+        if (held.forget) {
+            held = {};
+            idle_.insert(idle_.begin(), cell);
+        } else {
+            idle_.push_back(cell);
+        }
+    }
+
+private:
+    struct Cell
+    {
+        IconAtlas::Key key {};
+        bool keyed {};
+        bool forget {};
+        size_t holds {};
+    };
+
+    std::vector<Cell> cells_;
+    std::vector<size_t> idle_;
+};
+
+bool checkKnown()
+{
+    IconAtlas atlas(3);
+    size_t cell = 0;
+    bool draw = false;
+
+    // new keys take the cells in order, and need drawing
+    for (IconAtlas::Key key = 1; key <= 3; ++key) {
+        if (!expect(atlas.acquire(key, cell, draw) && (cell == key - 1) && draw, "new key didn't take the next cell")) {
+            return false;
+        }
+    }
+    if (!expect(!atlas.acquire(4, cell, draw) && (atlas.statistics().full == 1), "a full atlas took another key")) {
+        return false;
+    }
+
+    // a key already drawn shares its cell
+    if (!expect(atlas.acquire(1, cell, draw) && (cell == 0) && !draw, "held key wasn't shared")) {
+        return false;
+    }
+
+    // released cells are taken least recently released first, and keep their icon until then
+    atlas.release(0);
+    atlas.release(0);
+    atlas.release(2);
+    atlas.release(1);
+    if (!expect(atlas.acquire(3, cell, draw) && (cell == 2) && !draw, "released key wasn't kept")) {
+        return false;
+    }
+    atlas.release(2);
+    if (!expect(atlas.acquire(5, cell, draw) && (cell == 0) && draw, "least recently released cell wasn't taken")) {
+        return false;
+    }
+    if (!expect(atlas.acquire(1, cell, draw) && (cell == 1) && draw, "evicted key wasn't drawn again")) {
+        return false;
+    }
+
+    // a forgotten cell loses its icon, and is taken before cells that kept theirs
+    atlas.release(1, true);
+    if (!expect(atlas.acquire(6, cell, draw) && (cell == 1) && draw, "forgotten cell wasn't taken first")) {
+        return false;
+    }
+    if (!expect(atlas.acquire(1, cell, draw) && (cell == 2) && draw, "forgotten key wasn't drawn again")) {
+        return false;
+    }
+
+    const IconAtlas::Statistics statistics = atlas.statistics();
+    const bool counted = (statistics.hits == 2) && (statistics.draws == 7) && (statistics.evictions == 3);
+    if (!expect(counted && (statistics.size == 3) && (statistics.held == 3), "statistics don't add up")) {
+        return false;
+    }
+
+    atlas.clear();
+    return expect(
+        atlas.acquire(1, cell, draw) && (cell == 0) && draw && (atlas.statistics().held == 1),
+        "clear didn't start over");
+}
+
+// random acquires and releases, some forgetting, do the same as the model
+bool checkModel(std::mt19937 & random)
+{
+    IconAtlas atlas(modelCells_);
+    Model model(modelCells_);
+    std::vector<size_t> held;
+    for (size_t step = 0; step < modelSteps; ++step) {
+        if (held.empty() || (random() % 2)) {
+            const IconAtlas::Key key = random() % modelKeys_;
+            size_t cell = 0;
+            size_t modelCell = 0;
+            bool draw = false;
+            bool modelDraw = false;
+            const bool acquired = atlas.acquire(key, cell, draw);
+            const bool modelAcquired = model.acquire(key, modelCell, modelDraw);
+            if ((acquired != modelAcquired) || (acquired && ((cell != modelCell) || (draw != modelDraw)))) {
+                std::fprintf(
+                    stderr,
+                    "acquiring key %llu differs from the model at step %zu\n",
+                    static_cast<unsigned long long>(key),
+                    step);
+                return false;
+            }
+            if (acquired) {
+                held.push_back(cell);
+            }
+        } else {
+            const size_t index = random() % held.size();
+            const bool forget = (random() % 8) == 0;
+            atlas.release(held[index], forget);
+            model.release(held[index], forget);
+            held.erase(held.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+    }
+    // a cell held more than once is still one cell
+    std::ranges::sort(held);
+    const auto duplicates = std::ranges::unique(held);
+    held.erase(duplicates.begin(), duplicates.end());
+    return expect(atlas.statistics().held == held.size(), "held cells don't match");
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 random = Check::random();
+    if (!checkKnown() || !checkModel(random)) {
+        return 1;
+    }
+    std::printf("known results and %zu random steps match the model\n", modelSteps);
+
+    // like showing a menu of windows from a few hundred apps, a bit more than fit, each acquired and let go
+    IconAtlas atlas(cellCount_);
+    std::vector<IconAtlas::Key> keys(iterations);
+    for (IconAtlas::Key & key : keys) {
+        key = (random() % keyCount_) * 0x9e3779b97f4a7c15ULL;
+    }
+    size_t drawn = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (IconAtlas::Key key : keys) {
+        size_t cell = 0;
+        bool draw = false;
+        if (atlas.acquire(key, cell, draw)) {
+            drawn += draw ? 1 : 0;
+            atlas.release(cell);
+        }
+    }
+    const double elapsed = nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+
+    const IconAtlas::Statistics statistics = atlas.statistics();
+    std::printf(
+        "%zu cells, %zu keys: acquire and release %.1f ns, %zu drawn, %llu evicted\n",
+        cellCount_,
+        keyCount_,
+        elapsed,
+        drawn,
+        static_cast<unsigned long long>(statistics.evictions));
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks the window icon cache in IconCache.h against known results, least
+// recently used order, icons in use outliving eviction, the capacity and the
+// prefetch counts, and against a list kept the slow way over random finds,
+// inserts, and icons taken and let go. Then measures finding icons for a few
+// hundred apps, usage:
+//   IconCacheBenchmark [iterations]
+
+// App
+#include "Check.h"
+#include "IconCache.h"
+
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Check::expect;
+using Check::modelSteps;
+using Check::nanoseconds;
+
+constexpr size_t modelCapacity_ = 6;
+constexpr size_t modelKeys_ = 10;
+constexpr size_t modelHeldMax_ = 8;
+constexpr size_t cacheCapacity_ = 128;
+constexpr size_t appCount_ = 160;
+
+// stands in for an icon handle, the number tells icons apart
+struct FakeIcon
+{
+    int number {};
+};
+
+using Cache = IconCache<FakeIcon>;
+
+Cache::Key key(size_t number)
+{
+    return { L"App" + std::to_wstring(number), 96 };
+}
+
+Cache::Shared icon(int number)
+{
+    return std::make_shared<const FakeIcon>(number);
+}
+
+bool checkKnown()
+{
+    Cache cache(3);
+    for (int number = 1; number <= 3; ++number) {
+        cache.insert(key(number), icon(number));
+    }
+
+    // finding an icon makes it the most recently used, so the least recently used is dropped
+    const Cache::Shared first = cache.find(key(1));
+    if (!expect(first && (first->number == 1), "an inserted icon wasn't found")) {
+        return false;
+    }
+    cache.insert(key(4), icon(4));
+    if (!expect(!cache.contains(key(2)), "the least recently used icon wasn't dropped") ||
+        !expect(
+            cache.contains(key(1)) && cache.contains(key(3)) && cache.contains(key(4)),
+            "a recently used icon was dropped")) {
+        return false;
+    }
+
+    // an icon in use is passed over, the next least recently used goes instead
+    cache.insert(key(5), icon(5));
+    if (!expect(cache.contains(key(1)) && !cache.contains(key(3)), "an icon in use was dropped")) {
+        return false;
+    }
+
+    // with every icon in use there are more than the capacity, until they're let go, all but the first
+    std::vector<Cache::Shared> held { first, cache.find(key(4)), cache.find(key(5)) };
+    cache.insert(key(6), icon(6));
+    if (!expect(cache.statistics().size == 4, "an icon in use was dropped to keep to the capacity")) {
+        return false;
+    }
+    held.clear();
+    cache.insert(key(7), icon(7));
+    const Cache::Statistics capped = cache.statistics();
+    if (!expect((capped.size == 3) && (capped.inUse == 1), "the cache didn't shrink back to its capacity")) {
+        return false;
+    }
+
+    // a key inserted again gets the new icon
+    cache.insert(key(7), icon(70));
+    if (!expect(cache.find(key(7))->number == 70, "inserting again didn't replace the icon")) {
+        return false;
+    }
+
+    // a prefetched icon counts as a hit the first time it's found, and not after
+    cache.insert(key(8), icon(8), true);
+    cache.insert(key(9), icon(9), true);
+    cache.find(key(8));
+    cache.find(key(8));
+    const Cache::Statistics statistics = cache.statistics();
+    if (!expect((statistics.prefetches == 2) && (statistics.prefetchHits == 1), "prefetch counts are wrong") ||
+        !expect(!cache.find(key(2)), "a dropped icon was found") ||
+        !expect(
+            (statistics.hits == 6) && (statistics.misses == 0) && (statistics.evictions == 6),
+            "hit, miss, or eviction counts are wrong")) {
+        return false;
+    }
+
+    // a cache with no capacity keeps nothing
+    Cache none(0);
+    none.insert(key(1), icon(1));
+    return expect(!none.contains(key(1)), "a cache with no capacity kept an icon");
+}
+
+// The same behavior, the slow and obvious way, most recently used first. It
+// holds its icons weakly, so they're only in use when the check holds them.
+class Model
+{
+public:
+    explicit Model(size_t capacity)
+        : capacity_(capacity)
+    {
+    }
+
+    Cache::Shared find(size_t number)
+    {
+        const auto found = std::ranges::find(entries_, number, &Entry::number);
+        if (found == entries_.end()) {
+            return {};
+        }
+        std::rotate(entries_.begin(), found, found + 1);
+        return entries_.front().icon.lock();
+    }
+
+    void insert(size_t number, const Cache::Shared & icon)
+    {
+        const auto found = std::ranges::find(entries_, number, &Entry::number);
+        if (found != entries_.end()) {
+            found->icon = icon;
+            std::rotate(entries_.begin(), found, found + 1);
+            return;
+        }
+        entries_.insert(entries_.begin(), { number, icon });
+        for (size_t index = entries_.size(); (entries_.size() > capacity_) && index--;) {
+            // the cache has its own pointer to every icon it keeps
+            if (entries_[index].icon.use_count() <= 1) {
+                entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(index));
+            }
+        }
+    }
+
+    [[nodiscard]]
+    size_t size() const noexcept
+    {
+        return entries_.size();
+    }
+
+private:
+    struct Entry
+    {
+        size_t number {};
+        std::weak_ptr<const FakeIcon> icon;
+    };
+
+    size_t capacity_;
+    std::vector<Entry> entries_;
+};
+
+// random finds and inserts, with icons taken and let go, find the same icons as the model
+bool checkModel(std::mt19937 & random)
+{
+    Cache cache(modelCapacity_);
+    Model model(modelCapacity_);
+    std::vector<Cache::Shared> held;
+    int next = 0;
+
+    for (size_t step = 0; step < modelSteps; ++step) {
+        const size_t number = random() % modelKeys_;
+        switch (random() % 4) {
+            case 0: {
+                const Cache::Shared inserted = icon(++next);
+                cache.insert(key(number), inserted);
+                model.insert(number, inserted);
+                break;
+            }
+            case 1:
+                if (!held.empty()) {
+                    held.erase(held.begin() + static_cast<std::ptrdiff_t>(random() % held.size()));
+                }
+                break;
+            default: {
+                const Cache::Shared found = cache.find(key(number));
+                if (found != model.find(number)) {
+                    std::fprintf(stderr, "finding key %zu differs from the model at step %zu\n", number, step);
+                    return false;
+                }
+                if (found && (held.size() < modelHeldMax_) && (random() % 2)) {
+                    held.push_back(found);
+                }
+                break;
+            }
+        }
+
+        if (cache.statistics().size != model.size()) {
+            std::fprintf(stderr, "the cache's size differs from the model at step %zu\n", step);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 random = Check::random();
+    if (!checkKnown() || !checkModel(random)) {
+        return 1;
+    }
+    std::printf("icon cache agrees with its known cases and with a slow model\n");
+
+    // like minimizing windows of a few more apps than the cache keeps, an icon loaded for each miss
+    Cache cache(cacheCapacity_);
+    std::vector<Cache::Key> keys;
+    for (size_t app = 0; app < appCount_; ++app) {
+        keys.push_back(key(app));
+    }
+    std::vector<size_t> apps(iterations);
+    for (size_t & app : apps) {
+        // most windows are from a few apps
+        app = std::min(random() % appCount_, random() % appCount_);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t app : apps) {
+        if (!cache.find(keys[app])) {
+            cache.insert(keys[app], icon(static_cast<int>(app)));
+        }
+    }
+    const double elapsed = nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+
+    const Cache::Statistics statistics = cache.statistics();
+    std::printf(
+        "%zu icons, %zu apps: find or insert %.1f ns, %llu hits, %llu misses, %llu evicted\n",
+        cacheCapacity_,
+        appCount_,
+        elapsed,
+        static_cast<unsigned long long>(statistics.hits),
+        static_cast<unsigned long long>(statistics.misses),
+        static_cast<unsigned long long>(statistics.evictions));
+
+    return 0;
+}
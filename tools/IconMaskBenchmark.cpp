@@ -0,0 +1,114 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks that building icon masks sixteen pixels at a time matches doing it a
+// pixel at a time, for every width up to a few hundred pixels, and measures
+// both for common icon sizes, usage:
+//   IconMaskBenchmark [iterations]
+
+// App
+#include "IconMask.h"
+
+// Standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t checkWidthMax_ = 300;
+constexpr size_t checkHeight_ = 3;
+constexpr size_t iconSizes_[] = { 16, 32, 48, 256 };
+
+// pixels with random colors, and alpha mostly fully opaque or transparent like a real icon, with some in between
+std::vector<std::uint8_t> makePixels(size_t width, size_t height, std::mt19937 & random)
+{
+    std::vector<std::uint8_t> pixels(width * height * 4);
+    std::uniform_int_distribution<unsigned int> byte(0, 255);
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        pixels[i] = static_cast<std::uint8_t>(byte(random));
+        pixels[i + 1] = static_cast<std::uint8_t>(byte(random));
+        pixels[i + 2] = static_cast<std::uint8_t>(byte(random));
+        const unsigned int kind = byte(random) % 4;
+        pixels[i + 3] = (kind == 0) ? 0 : (kind == 1) ? 255 : static_cast<std::uint8_t>(byte(random));
+    }
+    return pixels;
+}
+
+double nanoseconds(std::chrono::steady_clock::duration duration, size_t iterations)
+{
+    return std::chrono::duration<double, std::nano>(duration).count() / static_cast<double>(iterations);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+
+    std::mt19937 random(12345);
+    for (size_t width = 1; width <= checkWidthMax_; ++width) {
+        const std::vector<std::uint8_t> pixels = makePixels(width, checkHeight_, random);
+        std::vector<std::uint8_t> expected(IconMask::rowSize(width) * checkHeight_, 0xff);
+        std::vector<std::uint8_t> actual(expected.size(), 0xff);
+        IconMask::fromAlphaScalar(pixels.data(), width, checkHeight_, expected.data());
+        IconMask::fromAlpha(pixels.data(), width, checkHeight_, actual.data());
+        if (actual != expected) {
+            std::fprintf(stderr, "%s mask doesn't match scalar mask for width %zu\n", IconMask::kernelName(), width);
+            return 1;
+        }
+    }
+
+    // the boundary between opaque and transparent
+    const std::uint8_t edge[] = { 0, 0, 0, 127, 0, 0, 0, 128 };
+    std::uint8_t edgeMask[2] = {};
+    IconMask::fromAlpha(edge, 2, 1, edgeMask);
+    if ((edgeMask[0] != 0x80) || (edgeMask[1] != 0)) {
+        std::fprintf(stderr, "alpha 127 should be transparent and 128 opaque\n");
+        return 1;
+    }
+
+    std::printf("%s matches scalar for widths 1 to %zu\n", IconMask::kernelName(), checkWidthMax_);
+
+    for (size_t size : iconSizes_) {
+        const std::vector<std::uint8_t> pixels = makePixels(size, size, random);
+        std::vector<std::uint8_t> mask(IconMask::rowSize(size) * size);
+
+        const auto scalarStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            IconMask::fromAlphaScalar(pixels.data(), size, size, mask.data());
+        }
+        const auto scalarTime = std::chrono::steady_clock::now() - scalarStart;
+
+        const auto kernelStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            IconMask::fromAlpha(pixels.data(), size, size, mask.data());
+        }
+        const auto kernelTime = std::chrono::steady_clock::now() - kernelStart;
+
+        std::printf(
+            "%3zux%-3zu: scalar %9.1f ns, %s %9.1f ns per icon\n",
+            size,
+            size,
+            nanoseconds(scalarTime, iterations),
+            IconMask::kernelName(),
+            nanoseconds(kernelTime, iterations));
+    }
+
+    return 0;
+}
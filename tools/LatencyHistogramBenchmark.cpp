@@ -0,0 +1,161 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks LatencyHistogram.h, that latencies land in the right buckets, and
+// that percentiles are no further from the exact ones than a bucket, for
+// random latencies spread like the time to show a menu. Then measures
+// recording them and prints the histogram, usage:
+//   LatencyHistogramBenchmark [iterations]
+
+// App
+#include "LatencyHistogram.h"
+
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t sampleCount_ = 100000;
+constexpr double percentiles_[] = { 0.0, 0.01, 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+// mostly a few hundred microseconds, with a long tail of tens of milliseconds, like showing a menu
+std::vector<std::uint64_t> makeLatencies(size_t count, std::mt19937 & random)
+{
+    std::lognormal_distribution<double> latency(std::log(400.0), 1.2);
+    std::vector<std::uint64_t> latencies(count);
+    for (std::uint64_t & microseconds : latencies) {
+        microseconds = static_cast<std::uint64_t>(latency(random));
+    }
+    return latencies;
+}
+
+bool checkBuckets()
+{
+    // each bucket ends where the next begins, and the edges land on the right side
+    for (size_t index = 0; index < LatencyHistogram::bucketCount; ++index) {
+        LatencyHistogram histogram;
+        const std::uint64_t limit = LatencyHistogram::bucketLimit(index);
+        histogram.record(limit);
+        histogram.record(limit + 1);
+        const size_t next = std::min(index + 1, LatencyHistogram::bucketCount - 1);
+        const std::uint64_t expected = (next == index) ? 2 : 1;
+        if ((histogram.bucket(index) != expected) || (histogram.bucket(next) != expected)) {
+            std::fprintf(
+                stderr,
+                "latencies %llu and %llu aren't in buckets %zu and %zu\n",
+                static_cast<unsigned long long>(limit),
+                static_cast<unsigned long long>(limit + 1),
+                index,
+                next);
+            return false;
+        }
+    }
+
+    // everything too long goes in the last bucket
+    LatencyHistogram histogram;
+    histogram.record(UINT64_MAX);
+    if (histogram.bucket(LatencyHistogram::bucketCount - 1) != 1) {
+        std::fprintf(stderr, "the longest latency isn't in the last bucket\n");
+        return false;
+    }
+
+    // an empty histogram has nothing to say
+    const LatencyHistogram empty;
+    if (empty.count() || empty.min() || empty.max() || empty.mean() || empty.percentile(0.5) ||
+        !empty.format().empty()) {
+        std::fprintf(stderr, "an empty histogram isn't empty\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool checkPercentiles(std::mt19937 & random)
+{
+    std::vector<std::uint64_t> latencies = makeLatencies(sampleCount_, random);
+    LatencyHistogram histogram;
+    for (std::uint64_t microseconds : latencies) {
+        histogram.record(microseconds);
+    }
+    std::ranges::sort(latencies);
+
+    if ((histogram.count() != latencies.size()) || (histogram.min() != latencies.front()) ||
+        (histogram.max() != latencies.back())) {
+        std::fprintf(stderr, "count, min, or max doesn't match\n");
+        return false;
+    }
+
+    // a percentile is the top of the bucket holding the exact one, so no lower, and less than twice as high
+    for (double fraction : percentiles_) {
+        const size_t rank = std::max<size_t>(1, static_cast<size_t>(fraction * static_cast<double>(latencies.size())));
+        const std::uint64_t exact = latencies[rank - 1];
+        const std::uint64_t approximate = histogram.percentile(fraction);
+        if ((approximate < exact) || (approximate > std::max<std::uint64_t>(1, exact * 2))) {
+            std::fprintf(
+                stderr,
+                "percentile %g is %llu, exactly %llu\n",
+                fraction,
+                static_cast<unsigned long long>(approximate),
+                static_cast<unsigned long long>(exact));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10;
+
+    std::mt19937 random(12345);
+    if (!checkBuckets() || !checkPercentiles(random)) {
+        return 1;
+    }
+    std::printf("buckets and percentiles match for %zu latencies\n", sampleCount_);
+
+    const std::vector<std::uint64_t> latencies = makeLatencies(sampleCount_, random);
+    LatencyHistogram histogram;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        for (std::uint64_t microseconds : latencies) {
+            histogram.record(microseconds);
+        }
+    }
+    const auto time = std::chrono::steady_clock::now() - start;
+    std::printf(
+        "record: %.2f ns per latency\n",
+        std::chrono::duration<double, std::nano>(time).count() / static_cast<double>(iterations * latencies.size()));
+
+    std::printf(
+        "%llu latencies, %llu us mean, %llu us median, %llu us 99th\n%s",
+        static_cast<unsigned long long>(histogram.count()),
+        static_cast<unsigned long long>(histogram.mean()),
+        static_cast<unsigned long long>(histogram.percentile(0.5)),
+        static_cast<unsigned long long>(histogram.percentile(0.99)),
+        histogram.format().c_str());
+
+    return 0;
+}
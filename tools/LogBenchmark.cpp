@@ -0,0 +1,497 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the cost of a typical log call in the text and binary log formats,
+// usage:
+//   LogBenchmark [iterations]
+// The text format is measured the way Log.cpp builds a line: formatting the
+// message and the timestamp prefix, with snprintf for the printf style macros,
+// and with std::format for the macros in LogFormatted.h, if the standard
+// library has it. The binary format is measured the way a
+// call site encodes its record, plus the file record the writer appends.
+// The flight recorder is measured the way a call that isn't logged is kept,
+// from one thread and from several at once, and the rate limit the way a call
+// site over its limit is turned away. Timestamps are measured converting and
+// printing every one, against LogTimestamp's cached date and time, for lines a
+// tenth of a millisecond apart. Compression of rotated log files is measured
+// on the text lines.
+//
+// First LogTimestamp is checked: its dates and times against ones printed from
+// gmtime(), across second, minute, hour, day and year boundaries and for times
+// that go backwards, and its elapsed times against known strings.
+
+// App
+#include "Check.h"
+#include "Gzip.h"
+#include "LogBinary.h"
+#include "LogFlightRecorder.h"
+#include "LogRateLimiter.h"
+#include "LogTimestamp.h"
+
+// Standard library
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <version>
+
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+namespace
+{
+
+// NOLINTBEGIN(*-magic-numbers)
+
+const char * const format_ = "window %#x minimized to %s, class '%s', title '%s', style %#lx\n";
+#if defined(__cpp_lib_format)
+constexpr std::string_view stdFormat_ = "window {:#x} minimized to {}, class '{}', title '{}', style {:#x}\n";
+#endif
+
+struct Call
+{
+    std::uintptr_t hwnd;
+    const char * placement;
+    const char * windowClass;
+    const char * title;
+    unsigned long style;
+};
+
+const Call calls_[] = {
+    { 0x000a0b3c, "tray", "Notepad", "Untitled - Notepad", 0x14cf0000UL },
+    { 0x0003045e, "menu", "CabinetWClass", "Downloads", 0x16cf0000UL },
+    { 0x001207f2, "tray and menu", "Chrome_WidgetWin_1", "Inbox - Mail", 0x17cf0000UL },
+};
+
+// NOLINTEND(*-magic-numbers)
+
+constexpr unsigned int flightThreads_ = 4;
+constexpr std::uint64_t stampStep_ = 1000; // between lines, in 100 nanosecond units
+constexpr std::uint64_t stampStart_ = 17607888000000000; // 2025-10-18, in 100 nanosecond units since 1970
+
+using FlightRecorder = LogFlightRecorder<4096>;
+
+FlightRecorder flight_;
+
+double nanoseconds(std::chrono::steady_clock::duration duration, size_t iterations)
+{
+    return std::chrono::duration<double, std::nano>(duration).count() / static_cast<double>(iterations);
+}
+
+// keeps calls the way Log.h does, the site id and the arguments, or only the id if they don't fit
+void recordFlight(size_t first, size_t count)
+{
+    char buffer[FlightRecorder::payloadSize];
+    constexpr size_t callCount = sizeof(calls_) / sizeof(calls_[0]);
+    for (size_t i = first; i < first + count; ++i) {
+        const Call & call = calls_[i % callCount];
+        const auto hwnd = reinterpret_cast<void *>(call.hwnd);
+        char * out = LogBinary::putVarint(buffer, 7);
+        const size_t size = LogBinary::argumentsSize(hwnd, call.placement, call.windowClass, call.title, call.style);
+        const bool fits = size <= static_cast<size_t>((buffer + sizeof(buffer)) - out);
+        if (fits) {
+            out = LogBinary::putArguments(out, hwnd, call.placement, call.windowClass, call.title, call.style);
+        }
+        const auto timestamp = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        flight_.record(
+            timestamp,
+            0,
+            FlightRecorder::Kind::Binary,
+            std::string_view(buffer, static_cast<size_t>(out - buffer)),
+            !fits);
+    }
+}
+
+// in UTC, timestamps are in 100 nanosecond units since 1970
+bool toCalendar(std::uint64_t timestamp, LogTimestamp::Calendar & calendar)
+{
+    using namespace std::chrono;
+
+    const sys_time<seconds> time(seconds(static_cast<std::int64_t>(timestamp / 10000000)));
+    const sys_days day = floor<days>(time);
+    const year_month_day date(day);
+    const hh_mm_ss<seconds> clock(time - day);
+    calendar.year = static_cast<unsigned int>(static_cast<int>(date.year()));
+    calendar.month = static_cast<unsigned int>(date.month());
+    calendar.day = static_cast<unsigned int>(date.day());
+    calendar.hour = static_cast<unsigned int>(clock.hours().count());
+    calendar.minute = static_cast<unsigned int>(clock.minutes().count());
+    calendar.second = static_cast<unsigned int>(clock.seconds().count());
+    return true;
+}
+
+// the date and time the way snprintf would print it, converted by the C library
+std::string printedDateTime(std::uint64_t timestamp)
+{
+    const auto seconds = static_cast<std::time_t>(timestamp / 10000000);
+    const std::tm * const tm = std::gmtime(&seconds);
+    char text[64];
+    std::snprintf(
+        text,
+        sizeof(text),
+        "%04d-%02d-%02d %02d:%02d:%02d.%03u",
+        tm->tm_year + 1900,
+        tm->tm_mon + 1,
+        tm->tm_mday,
+        tm->tm_hour,
+        tm->tm_min,
+        tm->tm_sec,
+        static_cast<unsigned int>((timestamp % 10000000) / 10000));
+    return text;
+}
+
+bool expectDateTime(LogTimestamp & timestamps, std::uint64_t timestamp)
+{
+    const std::string expected = printedDateTime(timestamp);
+    const std::string_view actual = timestamps.dateTime(timestamp);
+    if (actual != expected) {
+        std::fprintf(
+            stderr,
+            "date and time for %llu is '%.*s', expected '%s'\n",
+            static_cast<unsigned long long>(timestamp),
+            static_cast<int>(actual.size()),
+            actual.data(),
+            expected.c_str());
+        return false;
+    }
+    return true;
+}
+
+// dates and times match printed ones across each kind of boundary, stepping
+// forwards over it and then jumping back, and over random jumps either way
+bool checkDateTimes()
+{
+    using namespace std::chrono;
+
+    constexpr std::uint64_t second = 10000000;
+    constexpr auto ticks = [](sys_seconds time) {
+        return static_cast<std::uint64_t>(time.time_since_epoch().count()) * second;
+    };
+    constexpr sys_days day = 2025y / October / 18;
+    const std::uint64_t boundaries[] = {
+        ticks(day + 13h + 21min + 7s), // a second
+        ticks(day + 13h + 22min), // a minute
+        ticks(day + 14h), // an hour
+        ticks(day + days(1)), // midnight
+        ticks(sys_days(2024y / March / 1)), // after a leap day
+        ticks(sys_days(2026y / January / 1)), // a new year
+    };
+
+    LogTimestamp timestamps(toCalendar);
+    for (const std::uint64_t boundary : boundaries) {
+        // the step isn't a whole number of milliseconds, so every millisecond digit changes
+        for (std::uint64_t timestamp = boundary - 2 * second; timestamp < boundary + 2 * second; timestamp += 1234) {
+            if (!expectDateTime(timestamps, timestamp)) {
+                return false;
+            }
+        }
+        const std::uint64_t back[] = {
+            boundary - 1,
+            boundary - second,
+            boundary - second + 9999,
+            boundary - 3600 * second,
+        };
+        for (const std::uint64_t timestamp : back) {
+            if (!expectDateTime(timestamps, timestamp)) {
+                return false;
+            }
+        }
+    }
+
+    std::mt19937 random = Check::random();
+    std::uniform_int_distribution<std::uint64_t> jump(0, 3 * second);
+    std::uint64_t timestamp = stampStart_;
+    for (size_t i = 0; i < Check::modelSteps; ++i) {
+        const std::uint64_t distance = jump(random);
+        // mostly forwards, the way lines are stamped, and sometimes back
+        timestamp = (random() % 4) ? timestamp + distance : timestamp - distance;
+        if (!expectDateTime(timestamps, timestamp)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// elapsed times have six space padded seconds digits, more if needed, and seven fraction digits
+bool checkElapsed()
+{
+    struct Case
+    {
+        std::uint64_t timestamp;
+        std::uint64_t since;
+        const char * expected;
+    };
+    const Case cases[] = {
+        { 0, 0, "     0.0000000" },
+        { 1, 0, "     0.0000001" },
+        { 9999999, 0, "     0.9999999" },
+        { 10000000, 0, "     1.0000000" },
+        { 123456789, 0, "    12.3456789" },
+        { 30000007, 10000000, "     2.0000007" },
+        { 5, 10, "     0.0000000" }, // before since
+        { 9999999999999, 0, "999999.9999999" },
+        { 10000000000000, 0, "1000000.0000000" },
+        { 123456789012345678, 0, "12345678901.2345678" },
+    };
+
+    LogTimestamp timestamps(toCalendar);
+    for (const Case & c : cases) {
+        const std::string_view actual = timestamps.elapsed(c.timestamp, c.since);
+        if (actual != c.expected) {
+            std::fprintf(
+                stderr,
+                "elapsed time for %llu since %llu is '%.*s', expected '%s'\n",
+                static_cast<unsigned long long>(c.timestamp),
+                static_cast<unsigned long long>(c.since),
+                static_cast<int>(actual.size()),
+                actual.data(),
+                c.expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (!checkDateTimes() || !checkElapsed()) {
+        return 1;
+    }
+
+    constexpr size_t callCount = sizeof(calls_) / sizeof(calls_[0]);
+
+    constexpr size_t sampleSizeMax = 8 * 1024 * 1024;
+    std::string sample; // text lines for measuring compression
+    sample.reserve(sampleSizeMax + 512);
+
+    size_t textBytes = 0;
+    char line[512];
+    const auto textStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        const Call & call = calls_[i % callCount];
+        int length = std::snprintf(
+            line,
+            sizeof(line),
+            "%u-%02u-%02u %02u:%02u:%02u.%03u - %s - ",
+            2026U,
+            10U,
+            18U,
+            12U,
+            static_cast<unsigned int>(i / 60000 % 60),
+            static_cast<unsigned int>(i / 1000 % 60),
+            static_cast<unsigned int>(i % 1000),
+            "DEBUG  ");
+        length += std::snprintf(
+            line + length,
+            sizeof(line) - static_cast<size_t>(length),
+            format_,
+            static_cast<unsigned int>(call.hwnd),
+            call.placement,
+            call.windowClass,
+            call.title,
+            call.style);
+        textBytes += static_cast<size_t>(length);
+        if (sample.size() < sampleSizeMax) {
+            sample.append(line, static_cast<size_t>(length));
+        }
+    }
+    const auto textTime = std::chrono::steady_clock::now() - textStart;
+
+#if defined(__cpp_lib_format)
+    size_t formatBytes = 0;
+    const auto formatStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        const Call & call = calls_[i % callCount];
+        auto result = std::format_to_n(
+            line,
+            static_cast<std::ptrdiff_t>(sizeof(line)),
+            "{}-{:02}-{:02} {:02}:{:02}:{:02}.{:03} - {} - ",
+            2026U,
+            10U,
+            18U,
+            12U,
+            static_cast<unsigned int>(i / 60000 % 60),
+            static_cast<unsigned int>(i / 1000 % 60),
+            static_cast<unsigned int>(i % 1000),
+            "DEBUG  ");
+        result = std::format_to_n(
+            result.out,
+            static_cast<std::ptrdiff_t>(sizeof(line)) - result.size,
+            stdFormat_,
+            call.hwnd,
+            call.placement,
+            call.windowClass,
+            call.title,
+            call.style);
+        formatBytes += static_cast<size_t>(result.out - line);
+    }
+    const auto formatTime = std::chrono::steady_clock::now() - formatStart;
+#endif
+
+    size_t binaryBytes = 0;
+    char arguments[512];
+    std::string file;
+    file.reserve(4096);
+    const auto binaryStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        const Call & call = calls_[i % callCount];
+        const auto hwnd = reinterpret_cast<void *>(call.hwnd);
+        const size_t size = LogBinary::argumentsSize(hwnd, call.placement, call.windowClass, call.title, call.style);
+        char * end = LogBinary::putArguments(arguments, hwnd, call.placement, call.windowClass, call.title, call.style);
+        if (size != static_cast<size_t>(end - arguments)) {
+            std::fprintf(stderr, "encoded size mismatch\n");
+            return 1;
+        }
+        LogBinary::appendEvent(file, 7, 1500, std::string_view(arguments, size));
+        binaryBytes += file.size();
+        file.clear();
+    }
+    const auto binaryTime = std::chrono::steady_clock::now() - binaryStart;
+
+    std::printf(
+        "text:   %7.1f ns and %5.1f bytes per call\n",
+        nanoseconds(textTime, iterations),
+        static_cast<double>(textBytes) / static_cast<double>(iterations));
+#if defined(__cpp_lib_format)
+    std::printf(
+        "format: %7.1f ns and %5.1f bytes per call\n",
+        nanoseconds(formatTime, iterations),
+        static_cast<double>(formatBytes) / static_cast<double>(iterations));
+#else
+    std::printf("format: not measured, the standard library has no std::format\n");
+#endif
+    std::printf(
+        "binary: %7.1f ns and %5.1f bytes per call\n",
+        nanoseconds(binaryTime, iterations),
+        static_cast<double>(binaryBytes) / static_cast<double>(iterations));
+
+    const auto flightStart = std::chrono::steady_clock::now();
+    recordFlight(0, iterations);
+    const auto flightTime = std::chrono::steady_clock::now() - flightStart;
+
+    std::vector<std::thread> threads;
+    const size_t perThread = iterations / flightThreads_;
+    const auto flightThreadsStart = std::chrono::steady_clock::now();
+    for (unsigned int t = 0; t < flightThreads_; ++t) {
+        threads.emplace_back(recordFlight, t * perThread, perThread);
+    }
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+    const auto flightThreadsTime = std::chrono::steady_clock::now() - flightThreadsStart;
+
+    size_t flightRead = 0;
+    flight_.read([&flightRead](const FlightRecorder::Record & /* record */) { ++flightRead; });
+    if (flightRead != FlightRecorder::slotCount) {
+        std::fprintf(stderr, "flight recorder kept %zu records\n", flightRead);
+        return 1;
+    }
+
+    std::printf("flight: %7.1f ns per call\n", nanoseconds(flightTime, iterations));
+    std::printf(
+        "flight: %7.1f ns per call per thread, %u threads\n",
+        nanoseconds(flightThreadsTime * flightThreads_, perThread * flightThreads_),
+        flightThreads_);
+
+    // a call site over its rate limit, not counting reading the clock
+    LogRateLimiter limiter;
+    size_t admitted = 0;
+    const auto limitStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        admitted += limiter.admit(1, 20).admitted ? 1 : 0;
+    }
+    const auto limitTime = std::chrono::steady_clock::now() - limitStart;
+    std::printf("limit:  %7.1f ns per call, %zu of %zu admitted\n", nanoseconds(limitTime, iterations), admitted, iterations);
+
+    // converting and printing every timestamp, the way log lines used to be stamped
+    size_t stampCheck = 0;
+    const auto printStampStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        const std::uint64_t timestamp = stampStart_ + (i * stampStep_);
+        LogTimestamp::Calendar calendar;
+        toCalendar(timestamp, calendar);
+        const int length = std::snprintf(
+            line,
+            sizeof(line),
+            "%u-%02u-%02u %02u:%02u:%02u.%03u",
+            calendar.year,
+            calendar.month,
+            calendar.day,
+            calendar.hour,
+            calendar.minute,
+            calendar.second,
+            static_cast<unsigned int>((timestamp % 10000000) / 10000));
+        stampCheck += static_cast<size_t>(line[length - 1]);
+    }
+    const auto printStampTime = std::chrono::steady_clock::now() - printStampStart;
+
+    LogTimestamp timestamps(toCalendar);
+    size_t cachedCheck = 0;
+    const auto cachedStampStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        cachedCheck += static_cast<size_t>(timestamps.dateTime(stampStart_ + (i * stampStep_)).back());
+    }
+    const auto cachedStampTime = std::chrono::steady_clock::now() - cachedStampStart;
+
+    size_t elapsedCheck = 0;
+    const auto elapsedStampStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        elapsedCheck += static_cast<size_t>(timestamps.elapsed(i * stampStep_).back());
+    }
+    const auto elapsedStampTime = std::chrono::steady_clock::now() - elapsedStampStart;
+
+    // the checks also keep the loops from being optimized away
+    if ((cachedCheck != stampCheck) || (elapsedCheck < iterations * '0')) {
+        std::fprintf(stderr, "cached timestamps don't match printed ones\n");
+        return 1;
+    }
+    std::printf(
+        "stamp:  %7.1f ns printed, %.1f ns cached, %.1f ns elapsed per line\n",
+        nanoseconds(printStampTime, iterations),
+        nanoseconds(cachedStampTime, iterations),
+        nanoseconds(elapsedStampTime, iterations));
+
+    const auto compressStart = std::chrono::steady_clock::now();
+    const std::string compressed = Gzip::compress(sample);
+    const double compressSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - compressStart).count();
+    std::printf(
+        "gzip:   %7.1f MB/s, %zu bytes of text to %zu bytes (%.1f to 1)\n",
+        static_cast<double>(sample.size()) / (1024.0 * 1024.0) / compressSeconds,
+        sample.size(),
+        compressed.size(),
+        static_cast<double>(sample.size()) / static_cast<double>(compressed.size()));
+
+    return 0;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
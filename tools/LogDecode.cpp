@@ -0,0 +1,184 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Turns a binary log file back into text, usage:
+//   LogDecode [--json] Finestray.binlog
+// Times are shown in UTC. With --json, each line is a JSON object.
+
+// App
+#include "Log.h"
+#include "LogBinary.h"
+
+// Standard library
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+// FILETIME counts 100 nanosecond intervals since 1601
+constexpr std::uint64_t unixEpoch_ = 116444736000000000ULL;
+
+std::string timeString(std::uint64_t timestamp)
+{
+    using namespace std::chrono;
+
+    const auto sinceEpoch = duration_cast<milliseconds>(
+        duration<std::int64_t, std::ratio<1, 10000000>>(static_cast<std::int64_t>(timestamp - unixEpoch_)));
+    const sys_time<milliseconds> time(sinceEpoch);
+    const sys_days day = floor<days>(time);
+    const year_month_day date(day);
+    const hh_mm_ss<milliseconds> clock(time - day);
+
+    char buffer[64];
+    std::snprintf(
+        buffer,
+        sizeof(buffer),
+        "%d-%02u-%02u %02d:%02d:%02d.%03dZ",
+        static_cast<int>(date.year()),
+        static_cast<unsigned int>(date.month()),
+        static_cast<unsigned int>(date.day()),
+        static_cast<int>(clock.hours().count()),
+        static_cast<int>(clock.minutes().count()),
+        static_cast<int>(clock.seconds().count()),
+        static_cast<int>(clock.subseconds().count()));
+    return buffer;
+}
+
+std::string_view withoutNewline(std::string_view text)
+{
+    while (!text.empty() && ((text.back() == '\n') || (text.back() == '\r'))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+void appendJsonString(std::string & out, std::string_view string)
+{
+    out += '"';
+    for (const char c : string) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+                break;
+            }
+        }
+    }
+    out += '"';
+}
+
+const char * levelString(int level)
+{
+    const auto logLevel = static_cast<Log::Level>(level);
+    return Log::levelValid(logLevel) ? Log::levelToCString(logLevel) : "unknown";
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    bool json = false;
+    const char * fileName = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--json") {
+            json = true;
+        } else {
+            fileName = argv[i];
+        }
+    }
+    if (!fileName) {
+        std::fprintf(stderr, "usage: %s [--json] <binary log file>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "couldn't open '%s'\n", fileName);
+        return 1;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    const std::string data = contents.str();
+
+    LogBinary::Reader reader(data);
+    LogBinary::Reader::Record record;
+    std::string out;
+    while (reader.next(record)) {
+        out.clear();
+
+        if (record.type == LogBinary::RecordType::Raw) {
+            // lines logged before the file was opened, already formatted
+            if (json) {
+                std::istringstream lines(record.text);
+                for (std::string line; std::getline(lines, line);) {
+                    out += "{\"raw\":";
+                    appendJsonString(out, line);
+                    out += "}\n";
+                }
+            } else {
+                out = record.text;
+            }
+        } else if (json) {
+            out += "{\"time\":";
+            appendJsonString(out, timeString(record.timestamp));
+            out += ",\"level\":";
+            appendJsonString(out, levelString(record.level));
+            if (record.site) {
+                out += ",\"file\":";
+                appendJsonString(out, record.site->file);
+                out += ",\"line\":";
+                out += std::to_string(record.site->line);
+            }
+            out += ",\"message\":";
+            appendJsonString(out, withoutNewline(record.text));
+            out += "}\n";
+        } else {
+            char level[16];
+            std::snprintf(level, sizeof(level), "%-7s", levelString(record.level));
+            for (char * c = level; *c; ++c) {
+                *c = static_cast<char>(std::toupper(static_cast<unsigned char>(*c)));
+            }
+            out += timeString(record.timestamp);
+            out += " - ";
+            out += level;
+            out += " - ";
+            out += record.text;
+        }
+
+        std::fwrite(out.data(), 1, out.size(), stdout);
+    }
+
+    if (!reader.valid()) {
+        std::fprintf(stderr, "error in '%s': %s\n", fileName, reader.error().c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,442 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks log rotation in LogRotation.h in a temporary directory: when a log
+// is due, archive names, archiving twice in the same millisecond, and that
+// maintaining the archives keeps only the newest, compresses them, cleans up
+// after interrupted compression, and leaves other files alone. Compressed
+// archives, and Gzip.h output for known and random data, are decompressed
+// again and have to match. Then measures maintaining a few archives, usage:
+//   LogRotationBenchmark [archive megabytes]
+
+// App
+#include "Check.h"
+#include "Gzip.h"
+#include "LogRotation.h"
+
+// Standard library
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+
+using Check::expect;
+using Check::nanoseconds;
+
+// NOLINTBEGIN(*-magic-numbers)
+
+constexpr std::uint64_t ticksPerSecond_ = 10000000;
+constexpr std::uint64_t ticksPerMillisecond_ = 10000;
+constexpr std::uint64_t knownTime_ = 134367972001230000ULL; // 2026-10-18 11:40:00.123 UTC
+constexpr size_t gzipCases_ = 200;
+constexpr size_t benchmarkArchives_ = 4;
+
+// deflate length codes 257 to 285, and distance codes 0 to 29, as base and extra bits
+constexpr std::array<std::array<std::uint16_t, 2>, 29> lengthCodes_ { {
+    { 3, 0 },   { 4, 0 },   { 5, 0 },   { 6, 0 },   { 7, 0 },   { 8, 0 },   { 9, 0 },   { 10, 0 },
+    { 11, 1 },  { 13, 1 },  { 15, 1 },  { 17, 1 },  { 19, 2 },  { 23, 2 },  { 27, 2 },  { 31, 2 },
+    { 35, 3 },  { 43, 3 },  { 51, 3 },  { 59, 3 },  { 67, 4 },  { 83, 4 },  { 99, 4 },  { 115, 4 },
+    { 131, 5 }, { 163, 5 }, { 195, 5 }, { 227, 5 }, { 258, 0 },
+} };
+constexpr std::array<std::array<std::uint16_t, 2>, 30> distanceCodes_ { {
+    { 1, 0 },     { 2, 0 },     { 3, 0 },      { 4, 0 },      { 5, 1 },      { 7, 1 },
+    { 9, 2 },     { 13, 2 },    { 17, 3 },     { 25, 3 },     { 33, 4 },     { 49, 4 },
+    { 65, 5 },    { 97, 5 },    { 129, 6 },    { 193, 6 },    { 257, 7 },    { 385, 7 },
+    { 513, 8 },   { 769, 8 },   { 1025, 9 },   { 1537, 9 },   { 2049, 10 },  { 3073, 10 },
+    { 4097, 11 }, { 6145, 11 }, { 8193, 12 },  { 12289, 12 }, { 16385, 13 }, { 24577, 13 },
+} };
+
+// reads deflate's bits, least significant first, reading past the end gives ones so decoding fails
+class BitReader
+{
+public:
+    explicit BitReader(std::string_view data) noexcept
+        : data_(data)
+    {
+    }
+
+    std::uint32_t bits(unsigned int count) noexcept
+    {
+        std::uint32_t value = 0;
+        for (unsigned int i = 0; i < count; ++i) {
+            value |= bit() << i;
+        }
+        return value;
+    }
+
+    // Huffman codes start at their most significant bit
+    std::uint32_t code(std::uint32_t value, unsigned int count) noexcept
+    {
+        for (unsigned int i = 0; i < count; ++i) {
+            value = (value << 1) | bit();
+        }
+        return value;
+    }
+
+    [[nodiscard]]
+    bool overrun() const noexcept
+    {
+        return overrun_;
+    }
+
+    // the bytes after the last partly read one
+    [[nodiscard]]
+    std::string_view rest() const noexcept
+    {
+        return data_.substr(std::min(data_.size(), (position_ + 7) / 8));
+    }
+
+private:
+    std::uint32_t bit() noexcept
+    {
+        if ((position_ / 8) >= data_.size()) {
+            overrun_ = true;
+            return 1;
+        }
+        const auto byte = static_cast<std::uint8_t>(data_[position_ / 8]);
+        return (byte >> (position_++ % 8)) & 1U;
+    }
+
+    std::string_view data_;
+    size_t position_ {};
+    bool overrun_ {};
+};
+
+// a fixed literal and length code
+std::uint32_t symbol(BitReader & reader) noexcept
+{
+    std::uint32_t value = reader.code(0, 7);
+    if (value <= 0x17) {
+        return 256 + value;
+    }
+    value = reader.code(value, 1);
+    if ((value >= 0x30) && (value <= 0xbf)) {
+        return value - 0x30;
+    }
+    if ((value >= 0xc0) && (value <= 0xc7)) {
+        return 280 + (value - 0xc0);
+    }
+    return 144 + (reader.code(value, 1) - 0x190);
+}
+
+std::uint32_t littleEndian(std::string_view data) noexcept
+{
+    std::uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+// Decompresses what Gzip::compress writes, one final block of fixed codes,
+// which is all a check needs, and checks the gzip header and trailer.
+bool gunzip(std::string_view data, std::string & out)
+{
+    out.clear();
+    if ((data.size() < 18) || (data.substr(0, 4) != std::string_view("\x1f\x8b\x08\x00", 4))) {
+        return false;
+    }
+
+    BitReader reader(data.substr(10));
+    if ((reader.bits(1) != 1) || (reader.bits(2) != 1)) {
+        return false;
+    }
+
+    for (;;) {
+        const std::uint32_t value = symbol(reader);
+        if (reader.overrun() || (value > 285)) {
+            return false;
+        }
+        if (value < 256) {
+            out += static_cast<char>(value);
+            continue;
+        }
+        if (value == 256) {
+            break;
+        }
+
+        const auto & [lengthBase, lengthBits] = lengthCodes_[value - 257];
+        const size_t length = lengthBase + reader.bits(lengthBits);
+        const std::uint32_t distanceCode = reader.code(0, 5);
+        if (distanceCode >= distanceCodes_.size()) {
+            return false;
+        }
+        const auto & [distanceBase, distanceBits] = distanceCodes_[distanceCode];
+        const size_t distance = distanceBase + reader.bits(distanceBits);
+        if (reader.overrun() || (distance > out.size())) {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            out += out[out.size() - distance];
+        }
+    }
+
+    const std::string_view trailer = reader.rest();
+    return (trailer.size() == 8) && (littleEndian(trailer) == Gzip::crc32(out)) &&
+        (littleEndian(trailer.substr(4)) == static_cast<std::uint32_t>(out.size()));
+}
+
+// NOLINTEND(*-magic-numbers)
+
+bool roundTrips(std::string_view data)
+{
+    std::string out;
+    return gunzip(Gzip::compress(data), out) && (out == data);
+}
+
+// lines like the log writes, repetitive but not the same
+std::string logText(std::mt19937 & random, size_t size)
+{
+    std::string text;
+    while (text.size() < size) {
+        text += "2026-10-18 11:40:" + std::to_string(random() % 60) + " INFO minimized window " +
+            std::to_string(random() % 1000) + " to the tray\n";
+    }
+    text.resize(size);
+    return text;
+}
+
+bool checkGzip(std::mt19937 & random)
+{
+    // empty, one byte, the longest match, and repeats further back than the window reaches
+    const std::string far = logText(random, 40000);
+    const std::string known[] = { "", "a", std::string(1000, 'x'), std::string(258 * 3 + 1, 'y'), far + far };
+    for (const std::string & data : known) {
+        if (!roundTrips(data)) {
+            std::fprintf(stderr, "gzip didn't round trip %zu bytes\n", data.size());
+            return false;
+        }
+    }
+
+    // every byte value, and random sizes of log text and of noise
+    for (size_t i = 0; i < gzipCases_; ++i) {
+        std::string data = logText(random, random() % 5000);
+        if (i % 2) {
+            for (char & c : data) {
+                c = static_cast<char>(random() % ((i % 4) == 1 ? 256 : 4));
+            }
+        }
+        if (!roundTrips(data)) {
+            std::fprintf(stderr, "gzip didn't round trip case %zu, %zu bytes\n", i, data.size());
+            return false;
+        }
+    }
+
+    // a corrupt checksum is caught, so the check can fail
+    std::string corrupt = Gzip::compress("some log text");
+    corrupt[corrupt.size() - 8] ^= 1;
+    std::string out;
+    return expect(!gunzip(corrupt, out), "a corrupt checksum wasn't caught");
+}
+
+bool checkDue()
+{
+    LogRotation::Policy policy;
+    if (!expect(!policy.enabled() && !policy.due(1ULL << 40, 0, 1ULL << 60), "a log was due without limits")) {
+        return false;
+    }
+
+    policy.maxSize = 100;
+    policy.maxAge = 60;
+    const std::uint64_t opened = knownTime_;
+    return expect(!policy.due(99, opened, opened), "a log under its size was due") &&
+        expect(policy.due(100, opened, opened), "a log at its size wasn't due") &&
+        expect(!policy.due(0, opened, opened + (59 * ticksPerSecond_)), "a log under its age was due") &&
+        expect(policy.due(0, opened, opened + (60 * ticksPerSecond_)), "a log at its age wasn't due") &&
+        expect(!policy.due(0, opened, opened - ticksPerSecond_), "a log opened later than now was due");
+}
+
+bool writeFile(const std::filesystem::path & path, std::string_view contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    file.close();
+    return !!file;
+}
+
+std::string readFile(const std::filesystem::path & path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+std::vector<std::string> fileNames(const std::vector<std::string> & paths)
+{
+    std::vector<std::string> names;
+    for (const std::string & path : paths) {
+        names.push_back(std::filesystem::path(path).filename().string());
+    }
+    return names;
+}
+
+bool checkRotation(const std::filesystem::path & directory, std::mt19937 & random)
+{
+    std::error_code errorCode;
+    if (!std::filesystem::create_directory(directory, errorCode)) {
+        std::fprintf(stderr, "couldn't make '%s': %s\n", directory.string().c_str(), errorCode.message().c_str());
+        return false;
+    }
+    const std::string logPath = (directory / "Finestray.log").string();
+    std::string error;
+
+    if (!expect(
+            std::filesystem::path(LogRotation::archiveName(logPath, knownTime_)).filename() ==
+                "Finestray-20261018-114000-123.log",
+            "the archive name isn't the log's name with the time")) {
+        return false;
+    }
+
+    // archiving twice in the same millisecond takes the next one
+    std::vector<std::string> contents;
+    for (size_t i = 0; i < 2; ++i) {
+        contents.push_back(logText(random, 3000 + (i * 1000)));
+        if (!writeFile(logPath, contents.back())) {
+            std::fprintf(stderr, "couldn't write '%s'\n", logPath.c_str());
+            return false;
+        }
+        const std::string archived = LogRotation::archive(logPath, knownTime_, error);
+        const std::string expected = LogRotation::archiveName(logPath, knownTime_ + (i * ticksPerMillisecond_));
+        if (!expect(archived == expected, "archiving didn't take the next unused name") ||
+            !expect(!std::filesystem::exists(logPath), "the log is still there after archiving")) {
+            return false;
+        }
+    }
+
+    // more archives than are kept, a minute apart
+    for (size_t i = 2; i < 7; ++i) {
+        contents.push_back(logText(random, 1000 * i));
+        if (!writeFile(LogRotation::archiveName(logPath, knownTime_ + (i * 60 * ticksPerSecond_)), contents.back())) {
+            return false;
+        }
+    }
+
+    // leftovers of compression that was interrupted before and after renaming, and files that aren't archives
+    const std::string newest = LogRotation::archiveName(logPath, knownTime_ + (6 * 60 * ticksPerSecond_));
+    const std::string oldest = LogRotation::archiveName(logPath, knownTime_);
+    const std::filesystem::path others[] = { directory / "Finestray-notastamp.log",
+                                             directory / "Other-20261018-114000-123.log",
+                                             directory / "Finestray.txt" };
+    if (!writeFile(newest + ".gz.tmp", "partial") || !writeFile(newest + ".gz", Gzip::compress(contents.back()))) {
+        return false;
+    }
+    for (const std::filesystem::path & other : others) {
+        if (!writeFile(other, "not an archive")) {
+            return false;
+        }
+    }
+
+    LogRotation::Policy policy;
+    policy.keep = 3;
+    if (!expect(LogRotation::maintain(logPath, policy, error), error.c_str())) {
+        return false;
+    }
+
+    const std::vector<std::string> kept = LogRotation::archives(logPath);
+    const std::vector<std::string> expected {
+        "Finestray-20261018-114400-123.log.gz",
+        "Finestray-20261018-114500-123.log.gz",
+        "Finestray-20261018-114600-123.log.gz",
+    };
+    if (!expect(fileNames(kept) == expected, "the newest archives weren't the ones kept, compressed") ||
+        !expect(!std::filesystem::exists(newest + ".gz.tmp"), "a partly compressed archive was left") ||
+        !expect(!std::filesystem::exists(newest), "an archive was left next to its compressed copy") ||
+        !expect(!std::filesystem::exists(oldest), "the oldest archive wasn't deleted")) {
+        return false;
+    }
+    for (const std::filesystem::path & other : others) {
+        if (!expect(std::filesystem::exists(other), "a file that isn't an archive was deleted")) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < kept.size(); ++i) {
+        std::string out;
+        if (!expect(gunzip(readFile(kept[i]), out), "a compressed archive didn't decompress") ||
+            !expect(out == contents[contents.size() - kept.size() + i], "a compressed archive lost its contents")) {
+            return false;
+        }
+    }
+
+    // without compression new archives are kept as they are, and fewer are kept when the number goes down
+    policy.compress = false;
+    policy.keep = 2;
+    if (!writeFile(logPath, "the latest log") ||
+        LogRotation::archive(logPath, knownTime_ + (600 * ticksPerSecond_), error).empty() ||
+        !LogRotation::maintain(logPath, policy, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    return expect(
+        fileNames(LogRotation::archives(logPath)) ==
+            std::vector<std::string> { "Finestray-20261018-114600-123.log.gz", "Finestray-20261018-115000-123.log" },
+        "an archive was compressed without compression, or too many were kept");
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t megabytes = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 4;
+
+    std::error_code errorCode;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path(errorCode) /
+        ("FinestrayLogRotation-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    if (errorCode || !std::filesystem::create_directories(directory, errorCode)) {
+        std::fprintf(stderr, "couldn't make a temporary directory: %s\n", errorCode.message().c_str());
+        return 1;
+    }
+
+    std::mt19937 random = Check::random();
+    bool success = checkGzip(random) && checkDue() && checkRotation(directory / "check", random);
+    if (success) {
+        std::printf("rotated, pruned, and compressed archives decompress to the logs they came from\n");
+
+        // a few archives of the size they'd be rotated at, left for maintaining to compress
+        const std::string logPath = (directory / "Finestray.log").string();
+        std::uint64_t bytes = 0;
+        for (size_t i = 0; i < benchmarkArchives_; ++i) {
+            const std::string text = logText(random, megabytes << 20);
+            success = writeFile(LogRotation::archiveName(logPath, knownTime_ + (i * ticksPerSecond_)), text) && success;
+            bytes += text.size();
+        }
+
+        std::string error;
+        const auto start = std::chrono::steady_clock::now();
+        success = LogRotation::maintain(logPath, LogRotation::Policy {}, error) && success;
+        const double elapsed = nanoseconds(std::chrono::steady_clock::now() - start, 1);
+        std::printf(
+            "maintain: %zu archives of %zu MB compressed at %.1f MB/s\n",
+            benchmarkArchives_,
+            megabytes,
+            (static_cast<double>(bytes) / (1 << 20)) / (elapsed / 1e9));
+        if (!success) {
+            std::fprintf(stderr, "maintaining the archives failed: %s\n", error.c_str());
+        }
+    }
+
+    std::filesystem::remove_all(directory, errorCode);
+    return success ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Log implementation for the tools, warnings and errors go to stderr
+
+// App
+#include "Log.h"
+
+// Standard library
+#include <cstdarg>
+#include <cstdio>
+#include <string_view>
+
+namespace
+{
+
+// the tools have nothing to save the recent log lines for, and only show warnings and errors
+const bool flightRecorderOff_ = [] {
+    Log::flightRecorder_.store(false, std::memory_order_relaxed);
+    Log::level_.store(Log::Level::Warning, std::memory_order_relaxed);
+    Log::enabledLevel_.store(Log::Level::Warning, std::memory_order_relaxed);
+    return true;
+}();
+
+} // anonymous namespace
+
+namespace Log
+{
+
+void start(bool /* enable */, const std::string & /* fileName */, const Options & /* options */)
+{
+}
+
+void flush() noexcept
+{
+    std::fflush(stderr);
+}
+
+void stop() noexcept
+{
+}
+
+std::string saveFlightRecorder()
+{
+    return {};
+}
+
+void printf(Level level, const char * fmt, ...) noexcept
+{
+    if (level < Level::Warning) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void print(Level level, std::string_view text) noexcept
+{
+    if (level < Level::Warning) {
+        return;
+    }
+
+    std::fwrite(text.data(), 1, text.size(), stderr);
+}
+
+// the tools have no rate limits
+bool admitLimited(LogBinary::Site & /* site */, std::uint32_t /* limit */) noexcept
+{
+    return true;
+}
+
+// the tools never log in the binary format
+std::uint32_t registerSite(LogBinary::Site & /* site */, const char * /* types */) noexcept
+{
+    return 0;
+}
+
+void recordFlight(Level /* level */, std::string_view /* data */, bool /* binary */, bool /* truncated */) noexcept
+{
+}
+
+char * BinaryRecord::begin(Level /* level */, LogBinary::Site & /* site */, const char * /* types */, size_t /* size */) noexcept
+{
+    return nullptr;
+}
+
+void BinaryRecord::end() noexcept
+{
+}
+
+} // namespace Log
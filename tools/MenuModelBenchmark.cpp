@@ -0,0 +1,307 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks MenuModel.h, that windows keep their IDs, that big sections are
+// grouped and paged so no menu is longer than a page, and that applying the
+// edits from diffing two menus turns the first into the second, through a
+// series of random changes to thousands of windows. Then measures building
+// and diffing menus of 10,000 windows, usage:
+//   MenuModelBenchmark [iterations]
+
+// App
+#include "MenuModel.h"
+
+// Standard library
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+
+constexpr unsigned int visibleAllId_ = 0x1005;
+constexpr unsigned int minimizedAllId_ = 0x1006;
+constexpr size_t windowCount_ = 10000;
+constexpr size_t groupCount_ = 50;
+constexpr size_t changeSteps_ = 200;
+
+struct Windows
+{
+    std::vector<MenuModel::Window> visible;
+    std::vector<MenuModel::Window> minimized;
+};
+
+MenuModel::Window makeWindow(MenuModel::WindowId window, size_t groups)
+{
+    return { window, "Window " + std::to_string(window), groups ? "app" + std::to_string(window % groups) : "" };
+}
+
+Windows makeWindows(size_t count, size_t groups)
+{
+    Windows windows;
+    for (size_t i = 1; i <= count; ++i) {
+        (((i % 4) == 0) ? windows.minimized : windows.visible).push_back(makeWindow(i, groups));
+    }
+    return windows;
+}
+
+struct Model
+{
+    MenuModel::WindowIds visibleIds { 0x2000, 0x7fff };
+    MenuModel::WindowIds minimizedIds { 0x8000, 0xdfff };
+    MenuModel::Layout layout;
+
+    // the menu as ContextMenu builds it, the app, the window sections, and the fixed commands
+    std::vector<MenuModel::Item> build(const Windows & windows)
+    {
+        std::vector<MenuModel::Item> items;
+        items.push_back(MenuModel::command(0x1001, "Finestray"));
+        items.push_back(MenuModel::separator());
+        MenuModel::appendSection(items, { windows.visible, visibleAllId_, "Minimize All" }, visibleIds, layout);
+        MenuModel::appendSection(items, { windows.minimized, minimizedAllId_, "Restore All" }, minimizedIds, layout);
+        visibleIds.releaseUnused();
+        minimizedIds.releaseUnused();
+        items.push_back(MenuModel::command(0x1002, "Settings"));
+        items.push_back(MenuModel::command(0x1004, "Exit"));
+        return items;
+    }
+};
+
+// what the Win32 adapter does with each edit
+void apply(std::vector<MenuModel::Item> & menu, const MenuModel::Edit & edit)
+{
+    std::vector<MenuModel::Item> * items = &menu;
+    for (size_t position : edit.path) {
+        items = &(*items)[position].children;
+    }
+
+    switch (edit.kind) {
+        case MenuModel::EditKind::Insert: {
+            items->insert(items->begin() + static_cast<std::ptrdiff_t>(edit.position), *edit.item);
+            break;
+        }
+        case MenuModel::EditKind::Update: {
+            MenuModel::Item & item = (*items)[edit.position];
+            item.label = edit.item->label;
+            item.id = edit.item->id;
+            item.window = edit.item->window;
+            break;
+        }
+        case MenuModel::EditKind::Remove: {
+            items->erase(items->begin() + static_cast<std::ptrdiff_t>(edit.position));
+            break;
+        }
+    }
+}
+
+// counts window items, checks their IDs are unique and no menu is longer than a page
+bool checkShape(
+    const std::vector<MenuModel::Item> & items,
+    size_t pageSize,
+    size_t extra,
+    std::unordered_set<unsigned int> & ids,
+    size_t & windows)
+{
+    if (items.size() > pageSize + extra) {
+        std::fprintf(stderr, "a menu has %zu items\n", items.size());
+        return false;
+    }
+    for (const MenuModel::Item & item : items) {
+        if (item.kind == MenuModel::ItemKind::Window) {
+            ++windows;
+            if (!ids.insert(item.id).second) {
+                std::fprintf(stderr, "window ID %#x is used twice\n", item.id);
+                return false;
+            }
+        } else if (item.kind == MenuModel::ItemKind::Submenu) {
+            if (!checkShape(item.children, pageSize, 0, ids, windows)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool checkIds()
+{
+    MenuModel::WindowIds ids(10, 12);
+    const unsigned int a = ids.acquire(100);
+    const unsigned int b = ids.acquire(200);
+    const unsigned int c = ids.acquire(300);
+    if ((a != 10) || (b != 11) || (c != 12) || ids.acquire(400) || (ids.acquire(200) != b)) {
+        std::fprintf(stderr, "window IDs weren't handed out in order, or more than there are\n");
+        return false;
+    }
+    ids.releaseUnused();
+
+    // 200 is gone, the others keep their IDs, and its ID goes to the next new window
+    ids.acquire(100);
+    ids.acquire(300);
+    ids.releaseUnused();
+    if ((ids.window(b) != 0) || (ids.acquire(100) != a) || (ids.acquire(300) != c) || (ids.acquire(500) != b) ||
+        (ids.window(b) != 500)) {
+        std::fprintf(stderr, "window IDs weren't kept or reused\n");
+        return false;
+    }
+    return true;
+}
+
+bool checkLayout()
+{
+    for (size_t groups : { size_t { 0 }, groupCount_ }) {
+        Model model;
+        const Windows windows = makeWindows(windowCount_, groups);
+        const std::vector<MenuModel::Item> menu = model.build(windows);
+        std::unordered_set<unsigned int> ids;
+        size_t count = 0;
+        // the top level has the fixed items and two section trailers besides a page of each section
+        if (!checkShape(menu, model.layout.pageSize * 2, 10, ids, count)) {
+            return false;
+        }
+        if (count != windowCount_) {
+            std::fprintf(stderr, "the menu has %zu of %zu windows\n", count, windowCount_);
+            return false;
+        }
+    }
+
+    // a few windows are listed as they are
+    Model model;
+    const std::vector<MenuModel::Item> small = model.build(makeWindows(8, groupCount_));
+    if (small.size() != 2 + 6 + 3 + 2 + 3 + 2) {
+        std::fprintf(stderr, "a small menu has %zu items\n", small.size());
+        return false;
+    }
+    return true;
+}
+
+bool checkDiff(std::mt19937 & random)
+{
+    for (size_t groups : { size_t { 0 }, groupCount_ }) {
+        Model model;
+        Windows windows = makeWindows(windowCount_, groups);
+        std::vector<MenuModel::Item> menu = model.build(windows);
+        MenuModel::WindowId nextWindow = windowCount_ + 1;
+
+        for (size_t step = 0; step < changeSteps_; ++step) {
+            // a title change, a new window, a closed window, or a window minimized
+            std::vector<MenuModel::Window> & section = (random() % 2) ? windows.visible : windows.minimized;
+            const size_t index = section.empty() ? 0 : random() % section.size();
+            switch (random() % 4) {
+                case 0:
+                    if (!section.empty()) {
+                        section[index].title += "*";
+                    }
+                    break;
+                case 1:
+                    section.insert(
+                        section.begin() + static_cast<std::ptrdiff_t>(index),
+                        makeWindow(nextWindow++, groups));
+                    break;
+                case 2:
+                    if (!section.empty()) {
+                        section.erase(section.begin() + static_cast<std::ptrdiff_t>(index));
+                    }
+                    break;
+                default:
+                    if (!windows.visible.empty()) {
+                        const size_t visible = random() % windows.visible.size();
+                        windows.minimized.push_back(windows.visible[visible]);
+                        windows.visible.erase(windows.visible.begin() + static_cast<std::ptrdiff_t>(visible));
+                    }
+                    break;
+            }
+
+            const std::vector<MenuModel::Item> next = model.build(windows);
+            std::vector<MenuModel::Edit> edits;
+            MenuModel::diff(menu, next, edits);
+            for (const MenuModel::Edit & edit : edits) {
+                apply(menu, edit);
+            }
+            if (menu != next) {
+                std::fprintf(stderr, "applying %zu edits at step %zu didn't give the new menu\n", edits.size(), step);
+                return false;
+            }
+        }
+    }
+
+    // changing one title is one edit
+    Model model;
+    Windows windows = makeWindows(windowCount_, groupCount_);
+    const std::vector<MenuModel::Item> before = model.build(windows);
+    windows.visible[windowCount_ / 2].title = "changed";
+    const std::vector<MenuModel::Item> after = model.build(windows);
+    std::vector<MenuModel::Edit> edits;
+    MenuModel::diff(before, after, edits);
+    if (edits.size() != 1 || edits.front().kind != MenuModel::EditKind::Update) {
+        std::fprintf(stderr, "changing a title took %zu edits\n", edits.size());
+        return false;
+    }
+    return true;
+}
+
+double microseconds(std::chrono::steady_clock::duration duration, size_t iterations)
+{
+    return std::chrono::duration<double, std::micro>(duration).count() / static_cast<double>(iterations);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 20;
+
+    std::mt19937 random(12345);
+    if (!checkIds() || !checkLayout() || !checkDiff(random)) {
+        return 1;
+    }
+    std::printf("window IDs are kept, menus are paged, and diffs apply through %zu changes\n", changeSteps_);
+
+    for (size_t groups : { size_t { 0 }, groupCount_ }) {
+        Model model;
+        Windows windows = makeWindows(windowCount_, groups);
+        std::vector<MenuModel::Item> menu;
+
+        const auto buildStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            menu = model.build(windows);
+        }
+        const double build = microseconds(std::chrono::steady_clock::now() - buildStart, iterations);
+
+        size_t editCount = 0;
+        const auto diffStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            windows.visible[i % windows.visible.size()].title += "*";
+            const std::vector<MenuModel::Item> next = model.build(windows);
+            std::vector<MenuModel::Edit> edits;
+            MenuModel::diff(menu, next, edits);
+            editCount += edits.size();
+            menu = next;
+        }
+        const double rebuildAndDiff = microseconds(std::chrono::steady_clock::now() - diffStart, iterations);
+
+        std::printf(
+            "%zu windows, %s: build %8.1f us, build and diff after a title change %8.1f us, %.1f edits\n",
+            windowCount_,
+            groups ? "grouped by app" : "not grouped",
+            build,
+            rebuildAndDiff,
+            static_cast<double>(editCount) / static_cast<double>(iterations));
+    }
+
+    return 0;
+}
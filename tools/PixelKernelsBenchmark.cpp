@@ -0,0 +1,194 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks the pixel kernels in PixelKernels.h against doing the same a pixel
+// at a time, and against known results, then measures them on images the
+// size of the menu bitmaps and of large app icons, usage:
+//   PixelKernelsBenchmark [iterations]
+
+// App
+#include "PixelKernels.h"
+
+// Standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t checkCountMax_ = 100;
+constexpr size_t imageSizes_[] = { 16, 256 };
+
+// two menu bitmap colors, white and black, replaced with a menu color
+constexpr PixelKernels::ColorReplacement replacements_[] = {
+    { 0x00ffffff, 0x00f0f0f0 },
+    { 0x00000000, 0x00f0f0f0 },
+};
+
+// pixels like a menu bitmap or icon, many exactly white or black, and the rest random
+std::vector<std::uint32_t> makePixels(size_t count, std::mt19937 & random)
+{
+    std::vector<std::uint32_t> pixels(count);
+    for (std::uint32_t & pixel : pixels) {
+        switch (random() % 4) {
+            case 0: pixel = 0x00ffffff; break;
+            case 1: pixel = 0x00000000; break;
+            default: pixel = static_cast<std::uint32_t>(random()); break;
+        }
+    }
+    return pixels;
+}
+
+bool check(std::mt19937 & random)
+{
+    for (size_t count = 0; count <= checkCountMax_; ++count) {
+        const std::vector<std::uint32_t> pixels = makePixels(count, random);
+
+        std::vector<std::uint32_t> expected = pixels;
+        std::vector<std::uint32_t> actual = pixels;
+        const size_t expectedReplaced = PixelKernels::replaceColorsScalar(expected, replacements_);
+        const size_t actualReplaced = PixelKernels::replaceColors(actual, replacements_);
+        if ((actual != expected) || (actualReplaced != expectedReplaced)) {
+            std::fprintf(stderr, "replaceColors doesn't match scalar for %zu pixels\n", count);
+            return false;
+        }
+
+        expected = pixels;
+        actual = pixels;
+        PixelKernels::premultiplyScalar(expected);
+        PixelKernels::premultiply(actual);
+        if (actual != expected) {
+            std::fprintf(stderr, "premultiply doesn't match scalar for %zu pixels\n", count);
+            return false;
+        }
+    }
+
+    // a pixel is only replaced by the first match, even if the result matches a later one
+    std::vector<std::uint32_t> chain(9, 1);
+    const PixelKernels::ColorReplacement chained[] = { { 1, 2 }, { 2, 3 } };
+    if ((PixelKernels::replaceColors(chain, chained) != chain.size()) || (chain != std::vector<std::uint32_t>(9, 2))) {
+        std::fprintf(stderr, "replaceColors replaced a pixel twice\n");
+        return false;
+    }
+
+    // every color and alpha multiplies exactly, and unpremultiplying opaque and transparent pixels is exact
+    for (std::uint32_t alpha = 0; alpha < 256; ++alpha) {
+        std::vector<std::uint32_t> row(256);
+        for (std::uint32_t color = 0; color < 256; ++color) {
+            row[color] = (alpha << 24) | (color << 16) | (color << 8) | color;
+        }
+        std::vector<std::uint32_t> premultiplied = row;
+        PixelKernels::premultiply(premultiplied);
+        for (std::uint32_t color = 0; color < 256; ++color) {
+            const std::uint32_t expected = ((color * alpha) + 127) / 255;
+            if ((premultiplied[color] & 0xff) != expected || (premultiplied[color] >> 24) != alpha) {
+                std::fprintf(stderr, "premultiply of %u by %u isn't %u\n", color, alpha, expected);
+                return false;
+            }
+        }
+        PixelKernels::unpremultiply(premultiplied);
+        if (((alpha == 255) && (premultiplied != row)) ||
+            ((alpha == 0) && (premultiplied != std::vector<std::uint32_t>(256, 0)))) {
+            std::fprintf(stderr, "unpremultiply of alpha %u isn't exact\n", alpha);
+            return false;
+        }
+    }
+
+    // a two by two opaque checkerboard averages to grey, with alpha averaged too
+    const std::vector<std::uint32_t> board = { 0xffffffff, 0xff000000, 0x00000000, 0xffffffff };
+    std::vector<std::uint32_t> shrunk(1);
+    PixelKernels::boxDownscale(board, 2, 2, 2, shrunk);
+    if (shrunk[0] != 0xbf808080) {
+        std::fprintf(stderr, "boxDownscale gave %#x\n", shrunk[0]);
+        return false;
+    }
+
+    return true;
+}
+
+double nanoseconds(std::chrono::steady_clock::duration duration, size_t iterations)
+{
+    return std::chrono::duration<double, std::nano>(duration).count() / static_cast<double>(iterations);
+}
+
+template <typename Function>
+double measure(const std::vector<std::uint32_t> & pixels, size_t iterations, Function && function)
+{
+    std::vector<std::uint32_t> work = pixels;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        work = pixels;
+        function(work);
+    }
+    return nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+
+    std::mt19937 random(12345);
+    if (!check(random)) {
+        return 1;
+    }
+    std::printf("%s kernels match scalar\n", PixelKernels::kernelName());
+
+    for (size_t size : imageSizes_) {
+        const std::vector<std::uint32_t> pixels = makePixels(size * size, random);
+        const double copy = measure(pixels, iterations, [](std::vector<std::uint32_t> &) {});
+        const double replaceScalar = measure(pixels, iterations, [](std::vector<std::uint32_t> & work) {
+            PixelKernels::replaceColorsScalar(work, replacements_);
+        });
+        const double replace = measure(pixels, iterations, [](std::vector<std::uint32_t> & work) {
+            PixelKernels::replaceColors(work, replacements_);
+        });
+        const double premultiplyScalar = measure(pixels, iterations, [](std::vector<std::uint32_t> & work) {
+            PixelKernels::premultiplyScalar(work);
+        });
+        const double premultiply = measure(pixels, iterations, [](std::vector<std::uint32_t> & work) {
+            PixelKernels::premultiply(work);
+        });
+        const double unpremultiply = measure(pixels, iterations, [](std::vector<std::uint32_t> & work) {
+            PixelKernels::unpremultiply(work);
+        });
+        std::vector<std::uint32_t> shrunk((size / 4) * (size / 4));
+        const double downscale = measure(pixels, iterations, [size, &shrunk](std::vector<std::uint32_t> & work) {
+            PixelKernels::boxDownscale(work, size, size, 4, shrunk);
+        });
+
+        // the copy of the image each iteration makes is left out
+        std::printf(
+            "%3zux%-3zu: replace 2 colors scalar %8.1f ns, %s %8.1f ns\n",
+            size,
+            size,
+            replaceScalar - copy,
+            PixelKernels::kernelName(),
+            replace - copy);
+        std::printf(
+            "         premultiply scalar %8.1f ns, %s %8.1f ns, unpremultiply %8.1f ns, downscale by 4 %8.1f ns\n",
+            premultiplyScalar - copy,
+            PixelKernels::kernelName(),
+            premultiply - copy,
+            unpremultiply - copy,
+            downscale - copy);
+    }
+
+    return 0;
+}
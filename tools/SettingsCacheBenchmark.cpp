@@ -0,0 +1,386 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks the settings cache in SettingsCache.h, that random settings decode to
+// what was encoded, and that stale, truncated, and corrupt caches are turned
+// down. Then fuzzes the payload reader with mutated payloads whose header is
+// fixed up to match, so they get past the hash check, and anything decoded
+// from one has to encode back to the same bytes. Then measures decoding a
+// cache with a few auto-tray items, usage:
+//   SettingsCacheBenchmark [iterations]
+
+// App
+#include "Check.h"
+#include "Log.h"
+#include "SettingsCache.h"
+#include "SettingsSchema.h"
+
+// Standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+using Check::expect;
+using Check::nanoseconds;
+
+constexpr size_t roundTrips_ = 2000;
+constexpr size_t fuzzCases_ = 200000;
+constexpr size_t autoTraysMax_ = 4;
+constexpr size_t benchmarkAutoTrays_ = 8;
+
+// where the payload size and hash are in the cache header, see SettingsCache.cpp
+constexpr size_t payloadSizeOffset_ = 4 + 4 + 8 + 8 + 8;
+constexpr size_t payloadHashOffset_ = payloadSizeOffset_ + 4;
+constexpr size_t headerSize_ = payloadHashOffset_ + 8;
+
+bool enumValid(Log::Level logLevel) noexcept
+{
+    return Log::levelValid(logLevel);
+}
+
+bool enumValid(LogOverflow logOverflow) noexcept
+{
+    return logOverflowValid(logOverflow);
+}
+
+bool enumValid(LogFormat logFormat) noexcept
+{
+    return logFormatValid(logFormat);
+}
+
+bool enumValid(MinimizePlacement minimizePlacement) noexcept
+{
+    return minimizePlacementValid(minimizePlacement);
+}
+
+bool enumValid(TrayEvent trayEvent) noexcept
+{
+    return trayEventValid(trayEvent);
+}
+
+bool enumValid(MinimizePersistence minimizePersistence) noexcept
+{
+    return minimizePersistenceValid(minimizePersistence);
+}
+
+template <typename Owner, typename Fields>
+void randomObject(std::mt19937 & random, const Fields & fields, Owner & owner);
+
+// any value the cache can hold, strings with any bytes in them
+template <typename T>
+void randomValue(std::mt19937 & random, T & value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        value = (random() % 2) != 0;
+    } else if constexpr (std::is_same_v<T, unsigned int>) {
+        value = static_cast<unsigned int>(random());
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        value.resize(random() % 24);
+        for (char & c : value) {
+            c = static_cast<char>(random());
+        }
+    } else if constexpr (std::is_enum_v<T>) {
+        do {
+            value = static_cast<T>(random() % 8);
+        } while (!enumValid(value));
+    } else {
+        static_assert(std::is_same_v<T, std::vector<Settings::AutoTray>>);
+        value.resize(random() % (autoTraysMax_ + 1));
+        for (Settings::AutoTray & autoTray : value) {
+            randomObject(random, SettingsSchema::autoTrayFields, autoTray);
+        }
+    }
+}
+
+template <typename Owner, typename Fields>
+void randomObject(std::mt19937 & random, const Fields & fields, Owner & owner)
+{
+    SettingsSchema::forEach(fields, [&random, &owner](const auto & field) {
+        randomValue(random, owner.*field.member);
+    });
+}
+
+Settings randomSettings(std::mt19937 & random)
+{
+    Settings settings;
+    randomObject(random, SettingsSchema::settingsFields, settings);
+    return settings;
+}
+
+void putLittleEndian(std::string & data, size_t offset, std::uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        data[offset + i] = static_cast<char>(value >> (i * 8));
+    }
+}
+
+// makes the header match the payload again, so a changed payload gets past the hash check
+void reseal(std::string & data)
+{
+    const std::string_view payload = std::string_view(data).substr(headerSize_);
+    putLittleEndian(data, payloadSizeOffset_, payload.size(), 4);
+    putLittleEndian(data, payloadHashOffset_, SettingsCache::hash(payload), 8);
+}
+
+// random settings come back the same, and not for another JSON file
+bool checkRoundTrips(std::mt19937 & random)
+{
+    for (size_t i = 0; i < roundTrips_; ++i) {
+        const Settings settings = randomSettings(random);
+        const SettingsCache::Source source = SettingsCache::source("{}", random(), random());
+        const std::string data = SettingsCache::encode(settings, source);
+
+        Settings decoded;
+        if (!SettingsCache::decode(data, source, decoded) || (decoded != settings)) {
+            std::fprintf(stderr, "random settings %zu didn't decode to what was encoded\n", i);
+            return false;
+        }
+
+        SettingsCache::Source stale[] = { source, source, source };
+        ++stale[0].size;
+        ++stale[1].writeTime;
+        ++stale[2].hash;
+        for (const SettingsCache::Source & other : stale) {
+            if (!expect(!SettingsCache::decode(data, other, decoded), "a stale cache was used")) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// every truncation, and every bit changed, is caught before any settings are read
+bool checkCorruption(std::mt19937 & random)
+{
+    const SettingsCache::Source source = SettingsCache::source("{}", 2, 3);
+    const std::string data = SettingsCache::encode(randomSettings(random), source);
+    Settings decoded;
+
+    for (size_t size = 0; size < data.size(); ++size) {
+        if (SettingsCache::decode(std::string_view(data).substr(0, size), source, decoded)) {
+            std::fprintf(stderr, "a cache cut to %zu of %zu bytes was used\n", size, data.size());
+            return false;
+        }
+    }
+
+    std::string corrupt = data;
+    for (size_t bit = 0; bit < (corrupt.size() * 8); ++bit) {
+        corrupt[bit / 8] = static_cast<char>(corrupt[bit / 8] ^ (1 << (bit % 8)));
+        if (SettingsCache::decode(corrupt, source, decoded)) {
+            std::fprintf(stderr, "a cache with bit %zu changed was used\n", bit);
+            return false;
+        }
+        corrupt[bit / 8] = data[bit / 8];
+    }
+    return true;
+}
+
+// Mutated payloads with a matching header have to be read without going out
+// of bounds, and if they're used, what's read has to be what they hold.
+bool checkFuzz(std::mt19937 & random, size_t & accepted)
+{
+    const SettingsCache::Source source = SettingsCache::source("{}", 2, 3);
+    accepted = 0;
+
+    for (size_t i = 0; i < fuzzCases_; ++i) {
+        std::string data = SettingsCache::encode(randomSettings(random), source);
+        const size_t mutations = 1 + (random() % 4);
+        for (size_t mutation = 0; mutation < mutations; ++mutation) {
+            const size_t payloadSize = data.size() - headerSize_;
+            const size_t offset = headerSize_ + (payloadSize ? (random() % payloadSize) : 0);
+            switch (random() % 5) {
+                case 0:
+                    if (offset < data.size()) {
+                        data[offset] = static_cast<char>(data[offset] ^ (1 << (random() % 8)));
+                    }
+                    break;
+                case 1:
+                    if (offset < data.size()) {
+                        data[offset] = static_cast<char>((random() % 2) ? 0xff : random() % 4);
+                    }
+                    break;
+                case 2:
+                    data.insert(offset, 1 + (random() % 4), static_cast<char>(random()));
+                    break;
+                case 3:
+                    data.erase(offset, 1 + (random() % 4));
+                    break;
+                default:
+                    data.resize(offset);
+                    break;
+            }
+        }
+        reseal(data);
+
+        Settings decoded;
+        if (SettingsCache::decode(data, source, decoded)) {
+            ++accepted;
+            if (SettingsCache::encode(decoded, source) != data) {
+                std::fprintf(stderr, "fuzz case %zu decoded to settings that encode differently\n", i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+// The cache doesn't validate or normalize, the settings it holds already
+// were, so these only let the schema's tables link without Settings.cpp.
+namespace SettingsSchema
+{
+
+bool versionValid(const unsigned int & /* version */)
+{
+    return true;
+}
+
+void versionNormalize(unsigned int & /* version */)
+{
+}
+
+bool logLevelFieldValid(const Log::Level & /* logLevel */)
+{
+    return true;
+}
+
+void logLevelNormalize(Log::Level & /* logLevel */)
+{
+}
+
+bool logOverflowFieldValid(const LogOverflow & /* logOverflow */)
+{
+    return true;
+}
+
+void logOverflowNormalize(LogOverflow & /* logOverflow */)
+{
+}
+
+bool logFormatFieldValid(const LogFormat & /* logFormat */)
+{
+    return true;
+}
+
+void logFormatNormalize(LogFormat & /* logFormat */)
+{
+}
+
+bool minimizePlacementFieldValid(const MinimizePlacement & /* minimizePlacement */)
+{
+    return true;
+}
+
+void minimizePlacementNormalize(MinimizePlacement & /* minimizePlacement */)
+{
+}
+
+bool hotkeyValid(const std::string & /* hotkey */)
+{
+    return true;
+}
+
+void hotkeyNormalize(std::string & /* hotkey */)
+{
+}
+
+bool autoTraysValid(const std::vector<Settings::AutoTray> & /* autoTrays */)
+{
+    return true;
+}
+
+void autoTraysNormalize(std::vector<Settings::AutoTray> & /* autoTrays */)
+{
+}
+
+bool windowTitleValid(const std::string & /* windowTitle */)
+{
+    return true;
+}
+
+bool trayEventFieldValid(const TrayEvent & /* trayEvent */)
+{
+    return true;
+}
+
+void trayEventNormalize(TrayEvent & /* trayEvent */)
+{
+}
+
+bool minimizePersistenceFieldValid(const MinimizePersistence & /* minimizePersistence */)
+{
+    return true;
+}
+
+void minimizePersistenceNormalize(MinimizePersistence & /* minimizePersistence */)
+{
+}
+
+} // namespace SettingsSchema
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    // the corrupt caches are meant to be warned about, there are a lot of them
+    Log::enabledLevel_.store(Log::Level::Error, std::memory_order_relaxed);
+
+    std::mt19937 random = Check::random();
+    size_t accepted = 0;
+    if (!checkRoundTrips(random) || !checkCorruption(random) || !checkFuzz(random, accepted)) {
+        return 1;
+    }
+    std::printf(
+        "%zu random settings round trip, stale and corrupt caches are turned down, and %zu of %zu fuzzed payloads are "
+        "read back the same, the rest turned down\n",
+        roundTrips_,
+        accepted,
+        fuzzCases_);
+
+    // settings with a few auto-tray items, decoded the way a warm start does
+    Settings settings = randomSettings(random);
+    std::vector<Settings::AutoTray> autoTrays(benchmarkAutoTrays_);
+    for (Settings::AutoTray & autoTray : autoTrays) {
+        randomObject(random, SettingsSchema::autoTrayFields, autoTray);
+    }
+    settings.autoTrays_ = autoTrays;
+    const SettingsCache::Source source = SettingsCache::source("{}", 2, 3);
+    const std::string data = SettingsCache::encode(settings, source);
+
+    size_t decoded = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        Settings read;
+        decoded += SettingsCache::decode(data, source, read) ? 1 : 0;
+    }
+    const double elapsed = nanoseconds(std::chrono::steady_clock::now() - start, iterations);
+    std::printf(
+        "decode: %zu bytes with %zu auto-tray items, %.1f ns\n",
+        data.size(),
+        benchmarkAutoTrays_,
+        elapsed);
+
+    return (decoded == iterations) ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks the slot pool in SlotPool.h against known results, and against a map
+// over random acquires and releases, checks that a pool with enough slots
+// never allocates, then measures tray icons kept in one against the map of IDs
+// and heap allocated icons it replaced, usage:
+//   SlotPoolBenchmark [iterations]
+
+// App
+#include "Check.h"
+#include "SlotPool.h"
+
+// Standard library
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+using Check::expect;
+using Check::modelSteps;
+using Check::nanoseconds;
+
+constexpr size_t modelHeldMax_ = 40;
+constexpr size_t poolSlots_ = 64;
+constexpr size_t minimizedMax_ = 48;
+
+size_t allocations_;
+
+// about the size of what a tray icon keeps, a NOTIFYICONDATA, its window, and whether it has a GUID
+struct FakeTrayIcon
+{
+    std::array<char, 512> data {};
+    void * hwnd {};
+    bool guid {};
+};
+
+using Pool = SlotPool<FakeTrayIcon>;
+
+bool checkKnown()
+{
+    Pool pool(4);
+    std::vector<Pool::Id> ids;
+    for (int i = 0; i < 4; ++i) {
+        ids.push_back(pool.acquire());
+    }
+    if (!expect(ids == std::vector<Pool::Id> { 1, 2, 3, 4 }, "the first IDs aren't 1 to 4")) {
+        return false;
+    }
+
+    // a slot given back keeps its object, is handed out next with a new generation, and its old ID is forgotten
+    pool.find(2)->guid = true;
+    pool.release(2);
+    pool.release(2);
+    const Pool::Id reused = pool.acquire();
+    if (!expect(reused == 0x10002, "the slot given back wasn't handed out next") ||
+        !expect(pool.find(reused)->guid, "the slot's object wasn't kept") ||
+        !expect(!pool.find(2), "an ID given back still finds its slot") || !expect(!pool.find(0), "zero is an ID") ||
+        !expect(!pool.find(0x20002), "a later generation finds a slot") ||
+        !expect(!pool.find(9), "an ID past the last slot finds one")) {
+        return false;
+    }
+
+    // the fifth slot doubles them
+    const Pool::Id fifth = pool.acquire();
+    const Pool::Statistics statistics = pool.statistics();
+    if (!expect(fifth == 5, "the fifth ID isn't 5") ||
+        !expect(
+            (statistics.acquired == 6) && (statistics.reused == 1) && (statistics.held == 5) && (statistics.slots == 8),
+            "statistics don't match")) {
+        return false;
+    }
+
+    // every held slot is visited, and none that was given back
+    pool.release(3);
+    size_t visited = 0;
+    pool.forEachHeld([&visited](const FakeTrayIcon & /* icon */) { ++visited; });
+    return expect(visited == 4, "the held slots visited don't match");
+}
+
+// random acquires and releases, with a map of the IDs held to the values put in their slots
+bool checkModel(std::mt19937 & random)
+{
+    Pool pool(8);
+    std::map<Pool::Id, std::uint32_t> held;
+    std::vector<Pool::Id> released;
+    size_t peak = 0;
+
+    for (size_t step = 0; step < modelSteps; ++step) {
+        if (held.empty() || ((held.size() < modelHeldMax_) && (random() % 2))) {
+            const Pool::Id id = pool.acquire();
+            FakeTrayIcon * const icon = pool.find(id);
+            if (!expect(icon && !held.contains(id), "acquire gave an ID that's held or not found")) {
+                return false;
+            }
+            const auto value = static_cast<std::uint32_t>(random());
+            icon->hwnd = reinterpret_cast<void *>(static_cast<std::uintptr_t>(value));
+            held[id] = value;
+            peak = std::max(peak, held.size());
+        } else {
+            auto it = held.begin();
+            std::advance(it, static_cast<std::ptrdiff_t>(random() % held.size()));
+            pool.release(it->first);
+            released.push_back(it->first);
+            held.erase(it);
+        }
+
+        // dense: no slot index is past the most ever held at once
+        for (const auto & [id, value] : held) {
+            const FakeTrayIcon * const icon = pool.find(id);
+            if (!expect(
+                    icon && (icon->hwnd == reinterpret_cast<void *>(static_cast<std::uintptr_t>(value))),
+                    "a held slot lost its value") ||
+                !expect((id & 0xffff) <= peak, "an ID isn't dense")) {
+                return false;
+            }
+        }
+        if (!released.empty() && !expect(!pool.find(released[random() % released.size()]), "a released ID was found")) {
+            return false;
+        }
+    }
+
+    return expect(pool.statistics().held == held.size(), "the held count doesn't match");
+}
+
+// once the pool is made, minimizing and restoring up to as many windows as it has slots never allocates
+bool checkAllocations(std::mt19937 & random)
+{
+    Pool pool(poolSlots_);
+    std::vector<Pool::Id> held;
+    held.reserve(poolSlots_);
+
+    const size_t before = allocations_;
+    for (size_t step = 0; step < modelSteps; ++step) {
+        if (held.empty() || ((held.size() < poolSlots_) && (random() % 2))) {
+            held.push_back(pool.acquire());
+        } else {
+            const size_t index = random() % held.size();
+            pool.release(held[index]);
+            held[index] = held.back();
+            held.pop_back();
+        }
+    }
+    const size_t allocations = allocations_ - before;
+    if (allocations) {
+        std::fprintf(stderr, "%zu allocations holding up to %zu slots\n", allocations, poolSlots_);
+        return false;
+    }
+
+    // past the slots made up front, the pool allocates as it makes more, and then not again
+    while (held.size() < poolSlots_ * 4) {
+        held.push_back(pool.acquire());
+    }
+    const size_t grownBefore = allocations_;
+    for (size_t step = 0; step < modelSteps; ++step) {
+        const size_t index = random() % held.size();
+        pool.release(held[index]);
+        held[index] = pool.acquire();
+    }
+    return expect(allocations_ == grownBefore, "the pool allocated after it grew");
+}
+
+// A window is minimized, its icon clicked once, and it's restored, with up to
+// minimizedMax_ windows minimized at once. Returns the time per window, and
+// the allocations per window.
+template <typename Create, typename Find, typename Destroy>
+double measure(
+    size_t iterations,
+    std::mt19937 & random,
+    double & allocations,
+    Create && create,
+    Find && find,
+    Destroy && destroy)
+{
+    std::vector<std::uint32_t> minimized;
+    minimized.reserve(minimizedMax_);
+    std::uintptr_t hwnd = 0x10000;
+    size_t found = 0;
+
+    const size_t before = allocations_;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        if (minimized.size() == minimizedMax_) {
+            const size_t index = random() % minimized.size();
+            destroy(minimized[index]);
+            minimized[index] = minimized.back();
+            minimized.pop_back();
+        }
+        const std::uint32_t id = create(reinterpret_cast<void *>(hwnd += 0x10));
+        found += find(id) ? 1 : 0;
+        minimized.push_back(id);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    allocations = static_cast<double>(allocations_ - before) / static_cast<double>(iterations);
+
+    for (std::uint32_t id : minimized) {
+        destroy(id);
+    }
+    if (found != iterations) {
+        std::fprintf(stderr, "only found %zu of %zu icons\n", found, iterations);
+    }
+    return nanoseconds(elapsed, iterations);
+}
+
+} // anonymous namespace
+
+void * operator new(size_t size)
+{
+    ++allocations_;
+    if (void * const memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void * memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * memory, size_t /* size */) noexcept
+{
+    std::free(memory);
+}
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 random = Check::random();
+    if (!checkKnown() || !checkModel(random) || !checkAllocations(random)) {
+        return 1;
+    }
+    std::printf(
+        "known results and %zu random steps match a map, and %zu slots hold %zu windows without allocating\n",
+        modelSteps,
+        poolSlots_,
+        poolSlots_);
+
+    // what tray icons used before, a map of IDs to windows and a heap allocated icon shared by each window
+    std::map<std::uint32_t, void *> idMap;
+    std::map<std::uint32_t, std::shared_ptr<FakeTrayIcon>> icons;
+    std::uint32_t nextId = 0;
+    double mapAllocations = 0;
+    const double mapTime = measure(
+        iterations,
+        random,
+        mapAllocations,
+        [&](void * hwnd) {
+            std::shared_ptr<FakeTrayIcon> icon = std::make_unique<FakeTrayIcon>();
+            icon->hwnd = hwnd;
+            icons[++nextId] = std::move(icon);
+            idMap[nextId] = hwnd;
+            return nextId;
+        },
+        [&](std::uint32_t id) {
+            const auto it = idMap.find(id);
+            return (it != idMap.end()) ? it->second : nullptr;
+        },
+        [&](std::uint32_t id) {
+            idMap.erase(id);
+            icons.erase(id);
+        });
+
+    Pool pool(poolSlots_);
+    double poolAllocations = 0;
+    const double poolTime = measure(
+        iterations,
+        random,
+        poolAllocations,
+        [&](void * hwnd) {
+            const Pool::Id id = pool.acquire();
+            FakeTrayIcon & icon = *pool.find(id);
+            icon.hwnd = hwnd;
+            icon.guid = true;
+            return id;
+        },
+        [&](std::uint32_t id) {
+            const FakeTrayIcon * const icon = pool.find(id);
+            return icon ? icon->hwnd : nullptr;
+        },
+        [&](std::uint32_t id) { pool.release(id); });
+
+    std::printf(
+        "minimize, click, and restore with up to %zu minimized: map and heap %.1f ns and %.1f allocations, "
+        "pool %.1f ns and %.1f allocations\n",
+        minimizedMax_,
+        mapTime,
+        mapAllocations,
+        poolTime,
+        poolAllocations);
+
+    return 0;
+}
@@ -0,0 +1,331 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks the tray tip throttle in TrayTipThrottle.h against a fake shell that
+// records every tip sent to it, with known results and with random title
+// changes, then measures a minimized media player's worth of title changes,
+// usage:
+//   TrayTipThrottleBenchmark [seconds]
+
+// App
+#include "Check.h"
+#include "TrayTipThrottle.h"
+
+// Standard library
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Check::expect;
+using Check::modelSteps;
+
+constexpr size_t tipLength_ = 127; // what NOTIFYICONDATAA keeps
+constexpr std::uint64_t tipInterval_ = 2000;
+constexpr std::uint64_t pollMillis_ = 500;
+constexpr size_t modelKeys_ = 6;
+constexpr size_t benchmarkIcons_ = 32;
+
+// stands in for Shell_NotifyIcon(NIM_MODIFY), keeping what each icon shows and when it was last sent
+class FakeShell
+{
+public:
+    struct Icon
+    {
+        std::string tip;
+        std::uint64_t time {};
+        size_t sends {};
+    };
+
+    explicit FakeShell(std::uint64_t interval) noexcept
+        : interval_(interval)
+    {
+    }
+
+    void setInterval(std::uint64_t interval) noexcept { interval_ = interval; }
+
+    void add(TrayTipThrottle::Key key, const std::string & tip, std::uint64_t now) { icons_[key] = { tip, now, 0 }; }
+
+    void remove(TrayTipThrottle::Key key) { icons_.erase(key); }
+
+    // what the throttle is given to send with
+    TrayTipThrottle::Send sender(std::uint64_t now)
+    {
+        return [this, now](TrayTipThrottle::Key key, const std::string & tip) {
+            ++calls_;
+            const auto it = icons_.find(key);
+            if (it == icons_.end()) {
+                std::fprintf(
+                    stderr,
+                    "tip sent for icon %llu that isn't in the tray\n",
+                    static_cast<unsigned long long>(key));
+                failed_ = true;
+                return;
+            }
+            Icon & icon = it->second;
+            if (tip == icon.tip) {
+                std::fprintf(stderr, "tip '%s' sent when it's already shown\n", tip.c_str());
+                failed_ = true;
+            }
+            if ((now - icon.time) < interval_) {
+                std::fprintf(
+                    stderr,
+                    "tip sent %llu ms after the last one\n",
+                    static_cast<unsigned long long>(now - icon.time));
+                failed_ = true;
+            }
+            if (tip.size() > tipLength_) {
+                std::fprintf(stderr, "tip sent with %zu characters\n", tip.size());
+                failed_ = true;
+            }
+            icon = { tip, now, icon.sends + 1 };
+        };
+    }
+
+    [[nodiscard]]
+    const std::map<TrayTipThrottle::Key, Icon> & icons() const noexcept
+    {
+        return icons_;
+    }
+
+    [[nodiscard]]
+    size_t calls() const noexcept
+    {
+        return calls_;
+    }
+
+    [[nodiscard]]
+    bool failed() const noexcept
+    {
+        return failed_;
+    }
+
+private:
+    std::uint64_t interval_;
+    std::map<TrayTipThrottle::Key, Icon> icons_;
+    size_t calls_ {};
+    bool failed_ {};
+};
+
+size_t flush(TrayTipThrottle & throttle, FakeShell & shell, std::uint64_t now)
+{
+    return throttle.flush(now, shell.sender(now));
+}
+
+bool checkKnown()
+{
+    TrayTipThrottle throttle(tipLength_);
+    throttle.setInterval(tipInterval_);
+    FakeShell shell(tipInterval_);
+
+    throttle.add(1, "player", 0);
+    shell.add(1, "player", 0);
+
+    // changes within the interval wait, and only the latest is sent
+    throttle.update(1, "song 1");
+    throttle.update(1, "song 2");
+    if (!expect(!flush(throttle, shell, pollMillis_), "a tip was sent within the interval") ||
+        !expect(flush(throttle, shell, tipInterval_) == 1, "a waiting tip wasn't sent") ||
+        !expect(shell.icons().at(1).tip == "song 2", "the latest tip wasn't the one sent")) {
+        return false;
+    }
+
+    // a change that's undone before it's sent, or the same as what's shown, sends nothing
+    throttle.update(1, "song 3");
+    throttle.update(1, "song 2");
+    throttle.update(1, "song 2");
+    if (!expect(!flush(throttle, shell, tipInterval_ * 3), "an unchanged tip was sent")) {
+        return false;
+    }
+
+    // a change past what the tray keeps sends nothing, one within it does
+    const std::string longTitle(tipLength_, 'x');
+    throttle.update(1, longTitle);
+    flush(throttle, shell, tipInterval_ * 4);
+    throttle.update(1, longTitle + " (1)");
+    throttle.update(1, longTitle + " (2)");
+    if (!expect(!flush(throttle, shell, tipInterval_ * 5), "a change past the tip length was sent")) {
+        return false;
+    }
+    throttle.update(1, "y" + longTitle);
+    if (!expect(flush(throttle, shell, tipInterval_ * 5) == 1, "a truncated change wasn't sent") ||
+        !expect(shell.icons().at(1).tip == "y" + longTitle.substr(1), "the sent tip wasn't truncated")) {
+        return false;
+    }
+
+    // a removed icon's waiting tip is never sent, and one added again starts over
+    throttle.update(1, "gone");
+    throttle.remove(1);
+    shell.remove(1);
+    throttle.add(1, "back", tipInterval_ * 6);
+    shell.add(1, "back", tipInterval_ * 6);
+    throttle.update(1, "again");
+    if (!expect(!flush(throttle, shell, tipInterval_ * 6), "a removed icon's tip was sent") ||
+        !expect(flush(throttle, shell, tipInterval_ * 7) == 1, "a re-added icon's tip wasn't sent")) {
+        return false;
+    }
+
+    // without an interval, every change is sent at the next flush
+    throttle.setInterval(0);
+    shell.setInterval(0);
+    throttle.update(1, "now");
+    if (!expect(flush(throttle, shell, tipInterval_ * 7) == 1, "a tip wasn't sent without an interval")) {
+        return false;
+    }
+
+    const TrayTipThrottle::Statistics statistics = throttle.statistics();
+    if (!expect(
+            (statistics.sent == 5) && (statistics.coalesced == 2) && (statistics.unchanged == 4) &&
+                !statistics.pending,
+            "statistics don't match")) {
+        std::fprintf(
+            stderr,
+            "%llu sent, %llu coalesced, %llu unchanged, %zu pending\n",
+            static_cast<unsigned long long>(statistics.sent),
+            static_cast<unsigned long long>(statistics.coalesced),
+            static_cast<unsigned long long>(statistics.unchanged),
+            statistics.pending);
+        return false;
+    }
+
+    return !shell.failed();
+}
+
+// Random title changes, additions, and removals, flushed once a poll. The
+// fake shell checks the interval and that nothing unchanged is sent, and
+// once the changes stop, every icon must end up showing its latest title.
+bool checkModel(std::mt19937 & random)
+{
+    TrayTipThrottle throttle(8);
+    throttle.setInterval(tipInterval_);
+    FakeShell shell(tipInterval_);
+    std::map<TrayTipThrottle::Key, std::string> titles;
+
+    std::uint64_t now = 0;
+    for (size_t step = 0; step < modelSteps; ++step) {
+        const TrayTipThrottle::Key key = random() % modelKeys_;
+        // short titles, and long ones that differ only past the tip length
+        std::string title = "title " + std::to_string(random() % 4);
+        if (random() % 2) {
+            title += std::to_string(random() % 3);
+        }
+
+        switch (random() % 8) {
+            case 0:
+                throttle.add(key, title, now);
+                shell.add(key, title.substr(0, 8), now);
+                titles[key] = title;
+                break;
+            case 1:
+                throttle.remove(key);
+                shell.remove(key);
+                titles.erase(key);
+                break;
+            default:
+                throttle.update(key, title);
+                if (titles.contains(key)) {
+                    titles[key] = title;
+                }
+                break;
+        }
+
+        if (!(step % 4)) {
+            now += pollMillis_;
+            flush(throttle, shell, now);
+        }
+    }
+
+    now += tipInterval_;
+    flush(throttle, shell, now);
+    if (!expect(!throttle.statistics().pending, "tips are still pending after the interval")) {
+        return false;
+    }
+    for (const auto & [key, title] : titles) {
+        if (shell.icons().at(key).tip != title.substr(0, 8)) {
+            std::fprintf(
+                stderr,
+                "icon %llu shows '%s' not '%s'\n",
+                static_cast<unsigned long long>(key),
+                shell.icons().at(key).tip.c_str(),
+                title.c_str());
+            return false;
+        }
+    }
+
+    return !shell.failed();
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const std::uint64_t seconds = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 3600;
+
+    std::mt19937 random = Check::random();
+    if (!checkKnown() || !checkModel(random)) {
+        return 1;
+    }
+    std::printf("known results and %zu random steps match the fake shell\n", modelSteps);
+
+    // icons for windows that change their title every second, like media players or terminals, polled as often as the
+    // default poll interval
+    TrayTipThrottle throttle(tipLength_);
+    throttle.setInterval(tipInterval_);
+    FakeShell shell(tipInterval_);
+    std::vector<std::string> titles(benchmarkIcons_);
+    for (size_t icon = 0; icon < benchmarkIcons_; ++icon) {
+        titles[icon] = "Song " + std::to_string(icon) + " - 0:00";
+        throttle.add(icon, titles[icon], 0);
+        shell.add(icon, titles[icon], 0);
+    }
+
+    size_t updates = 0;
+    size_t changes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t now = pollMillis_; now <= seconds * 1000; now += pollMillis_) {
+        for (size_t icon = 0; icon < benchmarkIcons_; ++icon) {
+            const std::uint64_t elapsed = now / 1000;
+            const std::string title = titles[icon].substr(0, titles[icon].rfind(' ') + 1) +
+                std::to_string(elapsed / 60) + ((elapsed % 60 < 10) ? ":0" : ":") + std::to_string(elapsed % 60);
+            changes += (title != titles[icon]) ? 1 : 0;
+            titles[icon] = title;
+            throttle.update(icon, title);
+            ++updates;
+        }
+        flush(throttle, shell, now);
+    }
+    const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (shell.failed()) {
+        return 1;
+    }
+
+    std::printf(
+        "%zu icons for %llu s: %zu title polls, %zu changes, %zu sent to the shell, %.1f ns per poll\n",
+        benchmarkIcons_,
+        static_cast<unsigned long long>(seconds),
+        updates,
+        changes,
+        shell.calls(),
+        elapsed / static_cast<double>(updates));
+
+    return 0;
+}
@@ -0,0 +1,335 @@
+// Copyright 2020 Benbuck Nason
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Checks WindowIndex.h, that known queries find the right windows, that
+// every window with the query in its title is found, and that an index kept
+// up to date through thousands of random changes finds the same as one built
+// from scratch. Then measures typing queries a letter at a time, and title
+// changes, with 10,000 windows, usage:
+//   WindowIndexBenchmark [iterations]
+
+// App
+#include "LatencyHistogram.h"
+#include "WindowIndex.h"
+
+// Standard library
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t windowCount_ = 10000;
+constexpr size_t changeSteps_ = 20000;
+constexpr size_t checkQueries_ = 200;
+constexpr size_t resultsMax_ = 20;
+
+constexpr const char * words_[] = {
+    "Document", "Untitled", "Inbox",   "Project", "Report",  "Settings", "Terminal", "Console", "Meeting",
+    "Notes",    "Budget",   "Search",  "Music",   "Player",  "Server",   "Build",    "Release", "Debug",
+    "Visual",   "Studio",   "Code",    "Google",  "Chrome",  "Mozilla",  "Firefox",  "Explorer", "Window",
+    "Finestray", "Calendar", "Photos", "Editor",  "Preview", "Downloads", "Readme",  "Changelog", "Task",
+};
+constexpr const char * executables_[] = {
+    "code.exe",     "chrome.exe",  "firefox.exe", "explorer.exe", "notepad.exe", "WindowsTerminal.exe",
+    "outlook.exe",  "excel.exe",   "winword.exe", "spotify.exe",  "devenv.exe",  "slack.exe",
+};
+
+struct Window
+{
+    std::string title;
+    std::string executable;
+};
+
+using Windows = std::map<WindowIndex::WindowId, Window>;
+
+std::string makeTitle(std::mt19937 & random)
+{
+    std::string title;
+    const size_t wordCount = 2 + (random() % 5);
+    for (size_t i = 0; i < wordCount; ++i) {
+        if (i) {
+            title += (random() % 4) ? " " : " - ";
+        }
+        title += words_[random() % std::size(words_)];
+        if ((random() % 3) == 0) {
+            title += std::to_string(random() % 1000);
+        }
+    }
+    return title;
+}
+
+Window makeWindow(std::mt19937 & random)
+{
+    return { makeTitle(random), executables_[random() % std::size(executables_)] };
+}
+
+std::string toLower(std::string_view text)
+{
+    std::string lowered(text);
+    for (char & c : lowered) {
+        if ((c >= 'A') && (c <= 'Z')) {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return lowered;
+}
+
+// part of a random window's title, what someone might type to find it
+std::string makeQuery(const Windows & windows, std::mt19937 & random)
+{
+    auto it = windows.begin();
+    std::advance(it, static_cast<std::ptrdiff_t>(random() % windows.size()));
+    const std::string & title = it->second.title;
+    const size_t length = std::min<size_t>(title.size(), 1 + (random() % 10));
+    return title.substr(random() % (title.size() - length + 1), length);
+}
+
+// matches in a fixed order, since windows with the same score can be in any order
+std::vector<std::pair<int, WindowIndex::WindowId>> sorted(const std::vector<WindowIndex::Match> & matches)
+{
+    std::vector<std::pair<int, WindowIndex::WindowId>> result;
+    for (const WindowIndex::Match & match : matches) {
+        result.emplace_back(-match.score, match.window);
+    }
+    std::ranges::sort(result);
+    return result;
+}
+
+WindowIndex::WindowId findFirst(const WindowIndex & index, std::string_view query)
+{
+    std::vector<WindowIndex::Match> matches;
+    index.search(query, 1, matches);
+    return matches.empty() ? 0 : matches.front().window;
+}
+
+bool checkKnown()
+{
+    WindowIndex index;
+    index.add(1, "Visual Studio Code", "Code.exe");
+    index.add(2, "Inbox - Outlook", "outlook.exe");
+    index.add(3, "New Tab - Google Chrome", "chrome.exe");
+    index.add(4, "Command Prompt", "cmd.exe");
+    index.add(5, "Notes about code review", "notepad.exe");
+
+    struct Known
+    {
+        const char * query;
+        WindowIndex::WindowId window;
+    };
+    const Known known[] = {
+        { "code", 5 }, // at the start of a word, earlier in the title
+        { "studio code", 1 },
+        { "STUDIO", 1 }, // ignoring case
+        { "vsc", 1 }, // initials
+        { "chrme", 3 }, // a typo
+        { "outlook", 2 },
+        { "cmd", 4 }, // executable
+        { "  prompt ", 4 }, // spaces around
+        { "no", 5 }, // short, at the start of the title
+    };
+    for (const Known & k : known) {
+        const WindowIndex::WindowId found = findFirst(index, k.query);
+        if (found != k.window) {
+            std::fprintf(stderr, "'%s' found window %zu, not %zu\n", k.query, found, k.window);
+            return false;
+        }
+    }
+
+    index.updateTitle(1, "Visual Studio");
+    index.remove(3);
+    if (findFirst(index, "vsc") || findFirst(index, "chrome") || (index.size() != 4) ||
+        (index.title(1) != "Visual Studio") || !index.title(3).empty()) {
+        std::fprintf(stderr, "changing and removing windows didn't update the index\n");
+        return false;
+    }
+
+    std::vector<WindowIndex::Match> matches;
+    index.search("", 10, matches);
+    if (matches.size() != 4) {
+        std::fprintf(stderr, "an empty query found %zu windows, not all 4\n", matches.size());
+        return false;
+    }
+
+    return true;
+}
+
+bool isWordChar(char c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= '0') && (c <= '9'));
+}
+
+// whether the query is in the text, and for a query shorter than a trigram, at the start of a word
+bool contains(std::string_view text, std::string_view query)
+{
+    for (size_t position = text.find(query); position != std::string_view::npos;
+         position = text.find(query, position + 1)) {
+        if ((query.size() >= 3) || !position || !isWordChar(text[position - 1])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// every window with the query in its title is found, which the index mustn't miss
+bool checkFound(const WindowIndex & index, const Windows & windows, std::string_view query)
+{
+    std::vector<WindowIndex::Match> matches;
+    index.search(query, windows.size(), matches);
+    std::vector<WindowIndex::WindowId> found;
+    for (const WindowIndex::Match & match : matches) {
+        found.push_back(match.window);
+    }
+    std::ranges::sort(found);
+
+    std::string lowered = toLower(query);
+    lowered.erase(0, lowered.find_first_not_of(' '));
+    lowered.erase(lowered.find_last_not_of(' ') + 1);
+    for (const auto & [window, w] : windows) {
+        if (!lowered.empty() && isWordChar(lowered.front()) && contains(toLower(w.title), lowered) &&
+            !std::ranges::binary_search(found, window)) {
+            std::fprintf(
+                stderr,
+                "'%s' didn't find window %zu '%s'\n",
+                std::string(query).c_str(),
+                window,
+                w.title.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkChanges(std::mt19937 & random)
+{
+    WindowIndex index;
+    Windows windows;
+    WindowIndex::WindowId next = 1;
+    for (size_t step = 0; step < changeSteps_; ++step) {
+        const unsigned int change = random() % 10;
+        if ((change < 4) || windows.empty()) {
+            const Window window = makeWindow(random);
+            index.add(next, window.title, window.executable);
+            windows[next++] = window;
+        } else {
+            auto it = windows.begin();
+            std::advance(it, static_cast<std::ptrdiff_t>(random() % windows.size()));
+            if (change < 7) {
+                index.remove(it->first);
+                windows.erase(it);
+            } else {
+                it->second.title = makeTitle(random);
+                index.updateTitle(it->first, it->second.title);
+            }
+        }
+
+        if (((step + 1) % (changeSteps_ / 10)) != 0) {
+            continue;
+        }
+
+        WindowIndex rebuilt;
+        for (const auto & [window, w] : windows) {
+            rebuilt.add(window, w.title, w.executable);
+        }
+        for (size_t q = 0; q < checkQueries_; ++q) {
+            const std::string query = makeQuery(windows, random);
+            std::vector<WindowIndex::Match> kept;
+            std::vector<WindowIndex::Match> fresh;
+            index.search(query, windows.size(), kept);
+            rebuilt.search(query, windows.size(), fresh);
+            if (sorted(kept) != sorted(fresh)) {
+                std::fprintf(stderr, "step %zu: '%s' finds different windows than a new index\n", step, query.c_str());
+                return false;
+            }
+            if (!checkFound(index, windows, query)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+double microseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char ** argv)
+{
+    const size_t iterations = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 200;
+
+    std::mt19937 random(12345);
+    if (!checkKnown() || !checkChanges(random)) {
+        return 1;
+    }
+    std::printf("known queries, found windows, and %zu random changes match a new index\n", changeSteps_);
+
+    Windows windows;
+    for (WindowIndex::WindowId window = 1; window <= windowCount_; ++window) {
+        windows[window] = makeWindow(random);
+    }
+
+    WindowIndex index;
+    const auto buildStart = std::chrono::steady_clock::now();
+    for (const auto & [window, w] : windows) {
+        index.add(window, w.title, w.executable);
+    }
+    const auto buildTime = std::chrono::steady_clock::now() - buildStart;
+
+    // type each query a letter at a time, as the switcher searches on each keystroke
+    std::vector<WindowIndex::Match> matches;
+    LatencyHistogram keystrokes;
+    for (size_t i = 0; i < iterations; ++i) {
+        const std::string query = makeQuery(windows, random);
+        for (size_t length = 1; length <= query.size(); ++length) {
+            const auto start = std::chrono::steady_clock::now();
+            index.search(std::string_view(query).substr(0, length), resultsMax_, matches);
+            keystrokes.record(static_cast<std::uint64_t>(microseconds(std::chrono::steady_clock::now() - start)));
+        }
+    }
+
+    const auto updateStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        const auto window = static_cast<WindowIndex::WindowId>(1 + (random() % windowCount_));
+        index.updateTitle(window, makeTitle(random));
+    }
+    const auto updateTime = std::chrono::steady_clock::now() - updateStart;
+
+    std::printf(
+        "%zu windows: add all %.1f ms, title change %.2f us\n",
+        windowCount_,
+        microseconds(buildTime) / 1000.0,
+        microseconds(updateTime) / static_cast<double>(iterations));
+    std::printf(
+        "%llu keystrokes: %llu us mean, %llu us median, %llu us 99th, %llu us at most\n%s",
+        static_cast<unsigned long long>(keystrokes.count()),
+        static_cast<unsigned long long>(keystrokes.mean()),
+        static_cast<unsigned long long>(keystrokes.percentile(0.5)),
+        static_cast<unsigned long long>(keystrokes.percentile(0.99)),
+        static_cast<unsigned long long>(keystrokes.max()),
+        keystrokes.format().c_str());
+
+    return 0;
+}